@@ -28,6 +28,7 @@
 #include <ctype.h>
 #include <err.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -36,10 +37,13 @@
 #include <sysexits.h>
 #include <unistd.h>
 
+#include <sys/ioctl.h>
 #include <sys/queue.h>
 
 #include <dbus/dbus.h>
 
+#include "framework_inhibit.h"
+
 #define DBUS_IFACE_NAME "org.freedesktop.DBus.Properties"
 #define DBUS_NAMELEN          255
 #define DBUS_PARAM2LEN        255
@@ -80,6 +84,7 @@ struct dbus_message_signal_t {
 struct dbus_player_t {
 	char name[DBUS_NAMELEN];
 	uint8_t state;
+	int inhibit_fd;           /* /dev/framework while playing, or -1 */
 
 	LIST_ENTRY(dbus_player_t) entries;
 };
@@ -160,17 +165,62 @@ find_player(const char *name)
 		return NULL;
 	bzero(player, sizeof(struct dbus_player_t));
 	strncpy(player->name, name, DBUS_NAMELEN - 1);
+	player->inhibit_fd = -1;
 	LIST_INSERT_HEAD(&dbus_players, player, entries);
 
 	return player;
 }
 
+/*
+ * Keep the screen from dimming while player is playing
+ *
+ * The kernel releases the inhibitor once the descriptor is closed,
+ * also when this program exits.
+ */
+void
+inhibit_player(struct dbus_player_t *player)
+{
+	struct framework_inhibit_req req;
+
+	if (player->inhibit_fd >= 0)
+		return;
+
+	player->inhibit_fd = open("/dev/" FRAMEWORK_INHIBIT_DEVNAME,
+				  O_RDWR | O_CLOEXEC);
+	if (player->inhibit_fd < 0) {
+		warn("failed to open /dev/" FRAMEWORK_INHIBIT_DEVNAME);
+		return;
+	}
+
+	bzero(&req, sizeof(req));
+	snprintf(req.reason, sizeof(req.reason), "playback %s", player->name);
+	if (0 != ioctl(player->inhibit_fd, FRAMEWORKIOC_INHIBIT, &req)) {
+		warn("failed to inhibit dimming");
+		close(player->inhibit_fd);
+		player->inhibit_fd = -1;
+	}
+}
+
+/*
+ * Let the screen dim again
+ */
+void
+release_player(struct dbus_player_t *player)
+{
+	if (player->inhibit_fd < 0)
+		return;
+
+	close(player->inhibit_fd);
+	player->inhibit_fd = -1;
+}
+
 /*
  * Remove a player from the list
  */
 void
 rm_player(struct dbus_player_t *player)
 {
+	release_player(player);
 	LIST_REMOVE(player, entries);
 	free(player);
 }
@@ -185,8 +235,7 @@ clear_players()
 
 	while (!LIST_EMPTY(&dbus_players)) {
 		player = LIST_FIRST(&dbus_players);
-		LIST_REMOVE(player, entries);
-		free(player);
+		rm_player(player);
 	}
 }
 
@@ -206,6 +255,7 @@ signal_start(struct dbus_message_signal_t *parsed_msg)
 		/* Only if we aren't already playing, we start playback */
 		player->state = 1;
 		printf("framework-dbus: Playback started.\n");
+		inhibit_player(player);
 	}
 }
 
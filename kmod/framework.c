@@ -32,23 +32,32 @@
 #include <sys/kernel.h>
 #include <sys/malloc.h>
 #include <sys/module.h>
+#include <sys/sdt.h>
 #include <sys/types.h>
 #include <sys/malloc.h>
 
 #include "framework_evdev.h"
 #include "framework_backlight.h"
 #include "framework_callout.h"
+#include "framework_counters.h"
+#include "framework_inhibit.h"
 #include "framework_keyhandler.h"
+#include "framework_match.h"
 #include "framework_power.h"
 #include "framework_screen.h"
 #include "framework_sysctl.h"
 #include "framework_state.h"
+#include "framework_timer.h"
+#include "framework_trace.h"
 #include "framework_utils.h"
+#include "framework_wakeup.h"
 
 extern char cpu_model[128];
 
 MALLOC_DEFINE(M_FRAMEWORK, "framework", "Framework module data");
 
+SDT_PROVIDER_DEFINE(framework);
+
 /*
  * Central module data
  */
@@ -81,6 +90,18 @@ framework_init(void)
 	/* Initialize state structure */
 	framework_data.state = framework_state_init();
 
+	/* Initialize kthread wakeup accounting */
+	framework_wakeup_init();
+
+	/* Allocate activity counters */
+	framework_counters_init();
+
+	/* Initialize trace recorder, disabled until requested */
+	framework_trace_init();
+
+	/* Compile default input device match lists */
+	framework_match_init();
+
 	/* Fill default values for screen config */
 	error = framework_screen_init(&framework_data.power_config);
 	if (0 != error) {
@@ -89,6 +110,24 @@ framework_init(void)
 	}
 	undo++; /* 1 == screen */
 
+	/* Start timer service, backlight fades run on it */
+	error = framework_timer_init();
+	if (0 != error) {
+		ERROR("failed to initialize timer - error %d\n", error);
+		goto framework_errorexit;
+	}
+
+	undo++; /* 2 == timer */
+
+	/* Create /dev/framework for idle inhibitors */
+	error = framework_inhibit_init();
+	if (0 != error) {
+		ERROR("failed to initialize inhibitors - error %d\n", error);
+		goto framework_errorexit;
+	}
+
+	undo++; /* 3 == inhibit */
+
 	/* TODO use information for checking e- and p-cores */
 	DEBUG("Identified CPU model %s\n", cpu_model);
 
@@ -99,7 +138,7 @@ framework_init(void)
 		goto framework_errorexit;
 	}
 
-	undo++; /* 2 == pwr */
+	undo++; /* 4 == pwr */
 
 	/* Initialize key handler */
 	framework_data.keyhandler = framework_keyhandler_init(&framework_data.power_config);
@@ -109,7 +148,7 @@ framework_init(void)
 		goto framework_errorexit;
 	}
 
-	undo++; /* 3 == keyhandler */
+	undo++; /* 5 == keyhandler */
 
 	/* Initialize backlight system */
 	error = framework_bl_init();
@@ -119,7 +158,7 @@ framework_init(void)
 		goto framework_errorexit;
 	}
 	
-	undo++; /* 4 == bl */
+	undo++; /* 6 == bl */
 
 	/* Initialize sysctls */
 	error = framework_sysctl_init(&framework_data.sysctl,
@@ -131,7 +170,7 @@ framework_init(void)
 		goto framework_errorexit;
 	}
 	
-	undo++; /* 5 == sysctl */
+	undo++; /* 7 == sysctl */
 	
 	error = framework_evdev_init();
 	   
@@ -141,7 +180,7 @@ framework_init(void)
 		goto framework_errorexit;
 	}
 	
-	undo++; /* 6 == evdev */
+	undo++; /* 8 == evdev */
 
 	framework_data.callout = framework_callout_init(&framework_data.power_config,
 							framework_data.keyhandler);
@@ -158,17 +197,20 @@ framework_init(void)
 framework_errorexit:
 	switch (undo)
 	{
+	case 8:
+		framework_evdev_destroy();
 	case 7:
+		framework_sysctl_destroy(&framework_data.sysctl);
 	case 6:
-		framework_evdev_destroy();
+		framework_bl_destroy();
 	case 5:
-		framework_sysctl_destroy(&framework_data.sysctl);
+		framework_keyhandler_destroy(framework_data.keyhandler);
 	case 4:
-		framework_bl_destroy();
+		framework_pwr_destroy();
 	case 3:
-		framework_keyhandler_destroy(framework_data.keyhandler);
+		framework_inhibit_destroy();
 	case 2:
-		framework_pwr_destroy();
+		framework_timer_destroy();
 	case 1:
 		framework_screen_destroy(&framework_data.power_config);
 		break;
@@ -176,6 +218,10 @@ framework_errorexit:
 		ERROR("Unexpected error undo case %d!\n", undo);
 	}
 	framework_state_destroy(framework_data.state);
+	framework_wakeup_destroy();
+	framework_match_destroy();
+	framework_trace_destroy();
+	framework_counters_destroy();
 	framework_data.status = 2;
 	
 	return error;
@@ -193,11 +239,15 @@ framework_destroy(void)
 		return 0;
 	}
 	
+	/*
+	 * Stop and destroy event thread first; this waits for evdev
+	 * delivery and drains deferred callbacks, which still use
+	 * the callout.
+	 */
+	framework_evdev_destroy();
+
 	/* Stop and destroy callout system */
 	framework_callout_destroy(framework_data.callout);
-	
-	/* Stop and destroy event thread */
-	framework_evdev_destroy();
        
 	/* Destroy sysctls */
 	framework_sysctl_destroy(&framework_data.sysctl);
@@ -211,11 +261,29 @@ framework_destroy(void)
 	/* Destroy power system */
 	framework_pwr_destroy();
 
+	/* Release inhibitors and remove /dev/framework */
+	framework_inhibit_destroy();
+
+	/* Stop timer service, once no timer is left */
+	framework_timer_destroy();
+
 	/* Destroy screen config structure */
 	framework_screen_destroy(&framework_data.power_config);
 
 	/* Destroy state structure */
 	framework_state_destroy(framework_data.state);
+
+	/* Destroy wakeup accounting */
+	framework_wakeup_destroy();
+
+	/* Destroy input device match lists */
+	framework_match_destroy();
+
+	/* Destroy trace recorder */
+	framework_trace_destroy();
+
+	/* Free activity counters */
+	framework_counters_destroy();
 	
 	return 0;
 }
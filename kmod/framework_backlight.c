@@ -37,6 +37,9 @@
 #include <sys/queue.h>
 #include <sys/conf.h>
 #include <sys/types.h>
+#include <sys/mutex.h>
+#include <sys/sdt.h>
+#include <sys/sysctl.h>
 
 #include <fs/devfs/devfs.h>
 #include <fs/devfs/devfs_int.h>
@@ -46,13 +49,71 @@
 #include "backlight_if.h"
 
 #include "framework_backlight.h"
+#include "framework_counters.h"
+#include "framework_latency.h"
+#include "framework_lockstat.h"
+#include "framework_sysctl.h"
+#include "framework_timer.h"
+#include "framework_trace.h"
 #include "framework_utils.h"
 
+SDT_PROVIDER_DECLARE(framework);
+SDT_PROBE_DEFINE2(framework, backlight, , set, "uint32_t", "int");
+SDT_PROBE_DEFINE1(framework, backlight, setbrightness, entry, "uint32_t");
+SDT_PROBE_DEFINE2(framework, backlight, setbrightness, return, "uint32_t",
+		  "int");
+SDT_PROBE_DEFINE3(framework, backlight, fade, start, "uint32_t", "uint32_t",
+		  "uint32_t");
+SDT_PROBE_DEFINE2(framework, backlight, fade, done, "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE2(framework, backlight, fade, cancel, "uint32_t",
+		  "uint32_t");
+
+/* bounds of the fade settings */
+#define FRAMEWORK_BL_FADE_MAXMS 10000
+#define FRAMEWORK_BL_FADE_MAXHZ 1000
+
+/*
+ * Backlight state
+ *
+ * Locking: (l) lock, (b) owner of the busy flag.
+ */
 static struct framework_backlight_t {
 	struct backlight_softc *sc;
-	struct backlight_props props;
+	struct backlight_props props;     /* (b) */
+
+	/* driver updates may sleep, one thread at a time owns busy */
+	bool busy;                        /* (l) driver in use */
+
+	/* fade in progress, stepped by fade_timer */
+	struct framework_timer_t *fade_timer;
+	bool fading;                      /* (l) */
+	uint32_t fade_from;               /* (l) level at the start */
+	uint32_t fade_to;                 /* (l) target level */
+	uint32_t fade_last;               /* (l) level last written */
+	uint32_t fade_writes;             /* (l) writes of this fade */
+	sbintime_t fade_start;            /* (l) */
+	sbintime_t fade_duration;         /* (l) */
+	sbintime_t fade_interval;         /* (l) between steps */
+
+	uint32_t fade_ms;                 /* (l) fade duration, 0 jumps */
+	uint32_t fade_hz;                 /* (l) fade steps per second */
+	uint32_t fade_last_writes;        /* (l) writes of the last fade */
+
+	struct mtx lock;                  /* l - fade state and busy flag */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;        /* (l) lock acquisition time */
+#endif
 } framework_backlight;
 
+#define FRAMEWORK_BACKLIGHT_LOCK() \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_BACKLIGHT, \
+				    &framework_backlight.lock, \
+				    &framework_backlight.lockstat_stamp)
+#define FRAMEWORK_BACKLIGHT_UNLOCK() \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_BACKLIGHT, \
+				      &framework_backlight.lock, \
+				      &framework_backlight.lockstat_stamp)
+
 /* internal structure definition, borrowed from dev/backlight */
 struct backlight_softc {
 	struct cdev *cdev;
@@ -62,6 +123,8 @@ struct backlight_softc {
 	uint32_t cached_brightness;
 };
 
+static void framework_bl_fadestep(void *arg);
+
 /*
  * load properties from backlight
  */
@@ -78,6 +141,8 @@ framework_bl_loadprops(void)
 int
 framework_bl_init(void)
 {
+	int error = 0;
+
 	bzero(&framework_backlight, sizeof(struct framework_backlight_t));
 
 	framework_backlight.sc =
@@ -86,7 +151,44 @@ framework_bl_init(void)
 		return (ENXIO);
 
 	/* load settings into props at least once */
-	return framework_bl_loadprops();
+	error = framework_bl_loadprops();
+	if (0 != error)
+		return error;
+
+	framework_backlight.fade_ms = 500;
+	framework_backlight.fade_hz = 20;
+	mtx_init(&framework_backlight.lock, "framework_backlight", NULL,
+		 MTX_DEF);
+	framework_backlight.fade_timer =
+		framework_timer_register("fade", framework_bl_fadestep, NULL);
+
+	return 0;
+}
+
+/*
+ * Claim the driver, called with the lock held
+ */
+static void
+framework_bl_acquire(void)
+{
+	while (framework_backlight.busy) {
+		FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_BACKLIGHT,
+					 &framework_backlight.lockstat_stamp);
+		msleep(&framework_backlight.busy, &framework_backlight.lock,
+		       0, "blbusy", 0);
+		FRAMEWORK_LOCKSTAT_WAKEUP(&framework_backlight.lockstat_stamp);
+	}
+	framework_backlight.busy = true;
+}
+
+/*
+ * Hand the driver to the next thread, called with the lock held
+ */
+static void
+framework_bl_release(void)
+{
+	framework_backlight.busy = false;
+	wakeup(&framework_backlight.busy);
 }
 
 /*
@@ -109,35 +211,377 @@ framework_bl_getbrightness(void)
 }
 
 /*
- * Set new brightness level
+ * Write a brightness level to the driver, with the driver claimed
+ */
+static int
+framework_bl_write(uint32_t brightness, sbintime_t computed)
+{
+	sbintime_t trace_start = FRAMEWORK_TRACE_START();
+	int error = 0;
+
+	framework_backlight.props.brightness = brightness;
+	FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_BL_WRITE);
+	error = BACKLIGHT_UPDATE_STATUS(framework_backlight.sc->dev,
+					&framework_backlight.props);
+	if (computed)
+		framework_latency_record(FRAMEWORK_LATENCY_BACKLIGHT, computed);
+	if (0 == error)
+		framework_backlight.sc->cached_brightness = brightness;
+	SDT_PROBE2(framework, backlight, , set, brightness, error);
+	FRAMEWORK_TRACE(FRAMEWORK_TRACE_BACKLIGHT, trace_start, brightness,
+			error);
+
+	return error;
+}
+
+/*
+ * Level the driver shows for brightness
+ *
+ * Drivers reporting discrete levels show the closest of them; other
+ * drivers take brightness as it is.  Called with the driver claimed.
+ */
+static uint32_t
+framework_bl_quantise(uint32_t brightness)
+{
+	struct backlight_props *props = &framework_backlight.props;
+	uint32_t nlevels = MIN(props->nlevels, BACKLIGHTMAXLEVELS);
+	uint32_t best = brightness;
+	uint32_t distance = (uint32_t)-1;
+
+	for (uint32_t i = 0; i < nlevels; i++) {
+		uint32_t d = (props->levels[i] > brightness) ?
+			props->levels[i] - brightness :
+			brightness - props->levels[i];
+
+		if (d < distance) {
+			distance = d;
+			best = props->levels[i];
+		}
+	}
+
+	return best;
+}
+
+/*
+ * Stop a fade in progress, called with the lock held
+ */
+static void
+framework_bl_fadestop(void)
+{
+	if (!framework_backlight.fading)
+		return;
+
+	framework_backlight.fading = false;
+	framework_backlight.fade_last_writes = framework_backlight.fade_writes;
+	framework_timer_cancel(framework_backlight.fade_timer);
+	FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_FADE_CANCEL);
+	SDT_PROBE2(framework, backlight, fade, cancel,
+		   framework_backlight.fade_last,
+		   framework_backlight.fade_writes);
+}
+
+/*
+ * Set new brightness level at once, cancels a fade in progress
+ *
+ * If computed is non-zero, the time from computed until the update
+ * returned is accounted as backlight latency.
  */
 int
-framework_bl_setbrightness(uint32_t brightness)
+framework_bl_setbrightness(uint32_t brightness, sbintime_t computed)
 {
 	int error = 0;
 	uint32_t current_level = 0;
 	
+	SDT_PROBE1(framework, backlight, setbrightness, entry, brightness);
+
 	if (NULL == framework_backlight.sc)
 		return (ENXIO);
 
+	FRAMEWORK_BACKLIGHT_LOCK();
+	framework_bl_acquire();
+	framework_bl_fadestop();
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
 	current_level = framework_bl_getbrightness();
-	if (brightness == current_level)
-		return 0;
+	if (brightness == current_level) {
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_BL_SKIP);
+	} else {
+		error = framework_bl_write(brightness, computed);
+	}
 
-	framework_backlight.props.brightness = brightness;
-	error = BACKLIGHT_UPDATE_STATUS(framework_backlight.sc->dev,
-					&framework_backlight.props);
-	if (0 == error)
-		framework_backlight.sc->cached_brightness = brightness;
+	FRAMEWORK_BACKLIGHT_LOCK();
+	framework_bl_release();
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	SDT_PROBE2(framework, backlight, setbrightness, return, brightness,
+		   error);
 
 	return error;
 }
 
+/*
+ * Ramp the brightness level towards brightness
+ *
+ * Steps are taken at the configured rate until the configured duration
+ * passed; without a duration, this is framework_bl_setbrightness.  A
+ * fade already heading for brightness is left alone, one heading
+ * elsewhere restarts from where it got to.
+ */
+int
+framework_bl_fadeto(uint32_t brightness)
+{
+	uint32_t current_level = 0;
+
+	if (NULL == framework_backlight.sc)
+		return (ENXIO);
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	if (0 == framework_backlight.fade_ms ||
+	    0 == framework_backlight.fade_hz) {
+		FRAMEWORK_BACKLIGHT_UNLOCK();
+		return framework_bl_setbrightness(brightness, 0);
+	}
+	if (framework_backlight.fading &&
+	    brightness == framework_backlight.fade_to) {
+		FRAMEWORK_BACKLIGHT_UNLOCK();
+		return 0;
+	}
+
+	framework_bl_acquire();
+	if (framework_backlight.fading) {
+		/* retarget, not counted as a cancel */
+		framework_backlight.fading = false;
+		framework_backlight.fade_last_writes =
+			framework_backlight.fade_writes;
+	}
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	current_level = framework_bl_getbrightness();
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	framework_bl_release();
+	if (brightness == current_level) {
+		FRAMEWORK_BACKLIGHT_UNLOCK();
+		framework_timer_cancel(framework_backlight.fade_timer);
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_BL_SKIP);
+		return 0;
+	}
+
+	framework_backlight.fading = true;
+	framework_backlight.fade_from = current_level;
+	framework_backlight.fade_to = brightness;
+	framework_backlight.fade_last = current_level;
+	framework_backlight.fade_writes = 0;
+	framework_backlight.fade_start = sbinuptime();
+	framework_backlight.fade_duration =
+		mstosbt(framework_backlight.fade_ms);
+	framework_backlight.fade_interval = SBT_1S / framework_backlight.fade_hz;
+	SDT_PROBE3(framework, backlight, fade, start, current_level,
+		   brightness, framework_backlight.fade_ms);
+
+	framework_timer_schedule(framework_backlight.fade_timer,
+				 framework_backlight.fade_start +
+				 framework_backlight.fade_interval,
+				 framework_backlight.fade_interval / 4);
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	return 0;
+}
+
+/*
+ * Take one fade step, run by the fade timer
+ */
+static void
+framework_bl_fadestep(void *arg __unused)
+{
+	sbintime_t elapsed = 0;
+	sbintime_t next = 0;
+	uint32_t level = 0;
+	bool done = false;
+	bool write = false;
+	int64_t delta = 0;
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	if (!framework_backlight.fading) {
+		FRAMEWORK_BACKLIGHT_UNLOCK();
+		return;
+	}
+	framework_bl_acquire();
+	if (!framework_backlight.fading) {
+		/* cancelled while we waited for the driver */
+		framework_bl_release();
+		FRAMEWORK_BACKLIGHT_UNLOCK();
+		return;
+	}
+
+	/* a step due within its precision of the end finishes the fade */
+	elapsed = sbinuptime() - framework_backlight.fade_start;
+	if (elapsed + framework_backlight.fade_interval / 4 >=
+	    framework_backlight.fade_duration) {
+		level = framework_backlight.fade_to;
+		done = true;
+		write = (level != framework_backlight.fade_last);
+	} else {
+		delta = (int64_t)framework_backlight.fade_to -
+			framework_backlight.fade_from;
+		level = framework_backlight.fade_from +
+			delta * elapsed / framework_backlight.fade_duration;
+		write = (framework_bl_quantise(level) !=
+			 framework_bl_quantise(framework_backlight.fade_last));
+	}
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	if (write) {
+		framework_bl_write(level, 0);
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_FADE_WRITE);
+	} else {
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_FADE_ELIDE);
+	}
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	if (write) {
+		framework_backlight.fade_last = level;
+		framework_backlight.fade_writes++;
+	}
+	if (done) {
+		framework_backlight.fading = false;
+		framework_backlight.fade_last_writes =
+			framework_backlight.fade_writes;
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_FADE);
+		SDT_PROBE2(framework, backlight, fade, done, level,
+			   framework_backlight.fade_writes);
+	} else {
+		/* catch up rather than falling behind a slow driver */
+		next = framework_backlight.fade_start + elapsed +
+			framework_backlight.fade_interval;
+		if (next > framework_backlight.fade_start +
+		    framework_backlight.fade_duration)
+			next = framework_backlight.fade_start +
+				framework_backlight.fade_duration;
+		framework_timer_schedule(framework_backlight.fade_timer, next,
+					 framework_backlight.fade_interval / 4);
+	}
+	framework_bl_release();
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+}
+
+/*
+ * Called to process the fade duration
+ */
+static int
+framework_bl_sysctl_duration(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = 0;
+	int error = 0;
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	value = framework_backlight.fade_ms;
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (0 != error || NULL == req->newptr)
+		return error;
+
+	if (value > FRAMEWORK_BL_FADE_MAXMS)
+		return (EINVAL);
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	framework_backlight.fade_ms = value;
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	return 0;
+}
+
+/*
+ * Called to process the fade step rate
+ */
+static int
+framework_bl_sysctl_rate(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = 0;
+	int error = 0;
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	value = framework_backlight.fade_hz;
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (0 != error || NULL == req->newptr)
+		return error;
+
+	if (0 == value || value > FRAMEWORK_BL_FADE_MAXHZ)
+		return (EINVAL);
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	framework_backlight.fade_hz = value;
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	return 0;
+}
+
+/*
+ * Called to report the writes of the last fade
+ */
+static int
+framework_bl_sysctl_lastwrites(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = 0;
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	value = framework_backlight.fade_last_writes;
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	return sysctl_handle_32(oidp, &value, 0, req);
+}
+
+/*
+ * Add hw.framework.fade below parent
+ */
+void
+framework_bl_sysctl_init(struct sysctl_ctx_list *ctx,
+			 struct sysctl_oid *parent)
+{
+	struct sysctl_oid *fade_tree = NULL;
+
+	fade_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+				    "fade", CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				    "Brightness fades into idle stages");
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(fade_tree), OID_AUTO,
+			"duration_ms",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0, framework_bl_sysctl_duration, "IU",
+			"Fade duration in milliseconds, 0 switches at once");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(fade_tree), OID_AUTO, "rate_hz",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0, framework_bl_sysctl_rate, "IU",
+			"Fade steps per second");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(fade_tree), OID_AUTO,
+			"last_writes",
+			CTLTYPE_U32 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_bl_sysctl_lastwrites, "IU",
+			"Backlight updates of the last fade");
+}
+
 /*
  * Free any data associated with backlight
  */
 int
 framework_bl_destroy(void)
 {
+	if (NULL == framework_backlight.sc)
+		return 0;
+
+	FRAMEWORK_BACKLIGHT_LOCK();
+	framework_backlight.fading = false;
+	FRAMEWORK_BACKLIGHT_UNLOCK();
+
+	/* waits for a running fade step */
+	framework_timer_unregister(framework_backlight.fade_timer);
+	framework_backlight.fade_timer = NULL;
+
+	mtx_destroy(&framework_backlight.lock);
+	framework_backlight.sc = NULL;
+
 	return 0;
 }
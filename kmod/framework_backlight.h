@@ -31,14 +31,24 @@
 #ifndef __FRAMEWORK_BACKLIGHT_H__
 #define __FRAMEWORK_BACKLIGHT_H__
 
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
 /* initialize framework backlight */
 int framework_bl_init(void);
 
 /* get current brightness level */
 uint32_t framework_bl_getbrightness(void);
 
-/* set new brightness level */
-int framework_bl_setbrightness(uint32_t brightness);
+/* set new brightness level, computed is when the level was decided */
+int framework_bl_setbrightness(uint32_t brightness, sbintime_t computed);
+
+/* ramp brightness level towards brightness, see hw.framework.fade */
+int framework_bl_fadeto(uint32_t brightness);
+
+/* add hw.framework.fade below parent */
+void framework_bl_sysctl_init(struct sysctl_ctx_list *ctx,
+			      struct sysctl_oid *parent);
 
 /* uninitialize framework backlight */
 int framework_bl_destroy(void);
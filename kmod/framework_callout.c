@@ -30,255 +30,454 @@
 
 #include <sys/types.h>
 #include <sys/param.h>
+#include <sys/callout.h>
 #include <sys/conf.h>
+#include <sys/eventhandler.h>
 #include <sys/kernel.h>
 #include <sys/mutex.h>
 #include <sys/lock.h>
-#include <sys/rwlock.h>
+#include <sys/power.h>
+#include <sys/sdt.h>
+
+#include <machine/atomic.h>
 
 #include "framework_backlight.h"
 #include "framework_evdev.h"
 #include "framework_callout.h"
+#include "framework_counters.h"
+#include "framework_inhibit.h"
 #include "framework_keyhandler.h"
+#include "framework_latency.h"
+#include "framework_lockstat.h"
 #include "framework_power.h"
 #include "framework_screen.h"
 #include "framework_sysctl.h"
+#include "framework_timer.h"
+#include "framework_trace.h"
 #include "framework_utils.h"
 
 struct framework_callout_t {
 	/* Back-pointer to screen power configuration */
 	struct framework_screen_power_config_t *power_config;
 
-	/* (r) Cache currently expected level */
-	enum framework_callout_brightmode_t current_level;
-
-	int expect_next_callout;          /* (l) tick at which to expect next callout */
-
-	int active;                       /* active flag */
-	
-	struct mtx lock;                  /* l - structure and callout lock */
-	struct rwlock rwlock;             /* r - rwlock for internal vars */
+	/* idle stage reached and its generation, see FRAMEWORK_CALLOUT_STAGE */
+	volatile u_int state;
 
 	/* Key handler reference */
 	struct framework_keyhandler_t *keyhandler;
+
+	/* Deadline of the next idle stage, disarmed in the last one */
+	struct framework_timer_t *timer;
+
+	/* power_profile_change handler */
+	eventhandler_tag power_tag;
 };
 
-#define FRAMEWORK_CALLOUT_LOCK(x) mtx_lock(&(x)->lock)
-#define FRAMEWORK_CALLOUT_UNLOCK(x) mtx_unlock(&(x)->lock)
-#define FRAMEWORK_CALLOUT_RLOCK(x) rw_rlock(&(x)->rwlock)
-#define FRAMEWORK_CALLOUT_WLOCK(x) rw_wlock(&(x)->rwlock)
-#define FRAMEWORK_CALLOUT_RUNLOCK(x) rw_runlock(&(x)->rwlock)
-#define FRAMEWORK_CALLOUT_WUNLOCK(x) rw_wunlock(&(x)->rwlock)
-#define FRAMEWORK_CALLOUT_LOCK_ASSERT(x) mtx_assert(&(x)->lock, MA_OWNED)
+/*
+ * Idle state word: the stage in the low bits, 0 while in use, and a
+ * generation above it
+ *
+ * Input resets the stage, the dim check moves it on; both swap the
+ * word atomically and bump the generation with every stage change, so
+ * the dim check notices input that came in while it updated the
+ * backlight.
+ */
+#define FRAMEWORK_CALLOUT_STAGEBITS 8
+#define FRAMEWORK_CALLOUT_STAGE(s) \
+	((s) & ((1u << FRAMEWORK_CALLOUT_STAGEBITS) - 1))
+#define FRAMEWORK_CALLOUT_NEXT(s, stage) \
+	(((((s) >> FRAMEWORK_CALLOUT_STAGEBITS) + 1) << \
+	  FRAMEWORK_CALLOUT_STAGEBITS) | (stage))
+CTASSERT(FRAMEWORK_SCREEN_MAXSTAGES < (1u << FRAMEWORK_CALLOUT_STAGEBITS));
+
 #define FRAMEWORK_CALLOUT_MINTIMEOUT 5
 
 MALLOC_DECLARE(M_FRAMEWORK);
 
+SDT_PROVIDER_DECLARE(framework);
+SDT_PROBE_DEFINE2(framework, callout, , decision, "int", "uint32_t");
+SDT_PROBE_DEFINE2(framework, callout, inputintr, entry, "int", "size_t");
+SDT_PROBE_DEFINE0(framework, callout, inputintr, return);
+SDT_PROBE_DEFINE2(framework, callout, timer, wakeup, "uint32_t", "uint32_t");
+SDT_PROBE_DEFINE2(framework, callout, timer, sleep, "uint32_t", "uint32_t");
+
 static uint8_t framework_callout_drop = 1;
 
+/* slack for the dim deadline, both for sleeping and the dim check */
+#define FRAMEWORK_CALLOUT_PRECISION SBT_1MS
+
 /*
- * Retrieve currently valid brightness level
+ * Retrieve brightness level of an idle stage
  */
 static uint32_t
-framework_callout_getbrightnessfor(struct framework_callout_t *co)
+framework_callout_getbrightnessfor(struct framework_callout_t *co,
+				   struct framework_screen_config_t *screen_config,
+				   u_int stage)
 {
-	struct framework_screen_config_t *screen_config = NULL;
 	uint32_t brightness = 0;
 
 	/* if we can't establish anything, go to full brightness */
-	if (framework_util_getscreenconfig(co->power_config, &screen_config))
-		return 100; 
-	
-	FRAMEWORK_CALLOUT_RLOCK(co);
-	switch (co->current_level) {
-	case DIM:
-		brightness = co->power_config->funcs.get_brightness_low(co->power_config,
-									 screen_config);
-		break;
-	case HIGH:
+	if (NULL == screen_config)
+		return 100;
+
+	if (0 == stage)
 		brightness = co->power_config->funcs.get_brightness_high(co->power_config,
 									  screen_config);
-		break;
-	}
-	FRAMEWORK_CALLOUT_RUNLOCK(co);
+	else
+		brightness = co->power_config->funcs.get_stage_brightness(co->power_config,
+									   screen_config,
+									   stage - 1);
+
+	SDT_PROBE2(framework, callout, , decision, stage, brightness);
 
 	return brightness;
 }
 
 /*
- * Get current timeout for dimming
+ * Get screen config of the current power mode, NULL if unknown
  */
-static uint32_t
-framework_callout_getcurrenttimeout(struct framework_callout_t *co)
+static struct framework_screen_config_t *
+framework_callout_getscreenconfig(struct framework_callout_t *co)
 {
 	struct framework_screen_config_t *screen_config = NULL;
-	int state = framework_pwr_getpowermode();
-	uint32_t timeout_secs = 0;
-
-	switch (state) {
-	case BAT:
-		TRACE("callout getpowermode returned BAT\n");
-		screen_config = co->power_config->battery;
-		break;
-	case PWR:
-		TRACE("callout getpowermode returned PWR\n");
-		screen_config = co->power_config->power;
-		break;
-	case IVL:
-		TRACE("callout timeout check got INVALID battery state %d\n",
-		      state);
-		return 0;
-	}
 
-	if (!co->power_config) {
-		ERROR("callout poewr_config invalid\n");
-		return 0;
-	}
+	if (framework_util_getscreenconfig(co->power_config, &screen_config))
+		return NULL;
+
+	return screen_config;
+}
+
+/*
+ * Get idle time in milliseconds until a stage, 0 if it is disabled
+ */
+static uint32_t
+framework_callout_getstagetimeout(struct framework_callout_t *co,
+				  struct framework_screen_config_t *screen_config,
+				  u_int stage)
+{
+	struct framework_screen_power_config_t *power_config = co->power_config;
+	uint32_t timeout_ms = 0;
 
-	if (!co->power_config->funcs.get_timeout_secs) {
-		ERROR("callout poewr_config func get_timeout_secs invalid\n");
+	if (stage >= power_config->funcs.get_stages(power_config,
+						    screen_config))
 		return 0;
-	}
-	
-	/* get number of seconds for timeout */
-	timeout_secs = co->power_config->funcs.get_timeout_secs(co->power_config,
-								screen_config);
 
-	DEBUG("framework: callout got %u timeout seconds for current power mode\n",
-	      timeout_secs);
+	timeout_ms = power_config->funcs.get_stage_timeout_ms(power_config,
+							      screen_config,
+							      stage);
+
+	DEBUG("framework: callout got %u timeout ms for stage %u\n",
+	      timeout_ms, stage + 1);
+
+	return timeout_ms;
+}
+
+/*
+ * Arm the deadline of the first idle stage from the last input
+ */
+static void
+framework_callout_arm(struct framework_callout_t *co,
+		      struct framework_screen_config_t *screen_config)
+{
+	uint32_t timeout_ms = 0;
+
+	/* an inhibitor holds the stage until released */
+	if (NULL == screen_config || framework_inhibit_active())
+		return;
+
+	timeout_ms = framework_callout_getstagetimeout(co, screen_config, 0);
+	if (0 == timeout_ms)
+		return;
+
+	framework_timer_schedule(co->timer, framework_evdev_getlastinput() +
+				 mstosbt(timeout_ms),
+				 FRAMEWORK_CALLOUT_PRECISION);
+}
+
+/*
+ * Tell whether the key handler acts on any of the keys
+ */
+static bool
+framework_callout_haskeys(struct framework_callout_t *co,
+			  const uint16_t *keys, size_t nkeys)
+{
+	for (size_t i = 0; co->keyhandler && i < nkeys; i++) {
+		if (framework_keyhandler_haskey(co->keyhandler, keys[i]))
+			return true;
+	}
 
-	return timeout_secs;
+	return false;
 }
 
 /*
  * Called when input interrupt is received
  */
 static void
-framework_callout_inputintr(void *ctx, uint16_t *keycode)
+framework_callout_inputintr(void *ctx, const uint16_t *keys, size_t nkeys)
 {
 	struct framework_callout_t *co = ctx;
+	struct framework_screen_config_t *screen_config = NULL;
+	u_int state, old_stage;
 	uint32_t brightness = 0;
+	sbintime_t start = sbinuptime();
+	sbintime_t computed = 0;
 
 	TRACE("callout inputintr begin\n");
+	SDT_PROBE2(framework, callout, inputintr, entry,
+		   nkeys ? keys[0] : -1, nkeys);
 
 	/* no longer accept any further input signals */
 	if (framework_callout_drop) {
 		TRACE("callout dropping because global flag set\n");
+		SDT_PROBE0(framework, callout, inputintr, return);
+		return;
+	}
+
+	/*
+	 * Orders the last input time stored by evdev before the state
+	 * load, the dim check reads it again after storing the state.
+	 */
+	atomic_thread_fence_seq_cst();
+	state = atomic_load_acq_int(&co->state);
+
+	/* already at full brightness and no key to handle */
+	if (0 == FRAMEWORK_CALLOUT_STAGE(state) &&
+	    !framework_callout_haskeys(co, keys, nkeys)) {
+		SDT_PROBE0(framework, callout, inputintr, return);
 		return;
 	}
 
-	TRACE("callout locking\n");
-	FRAMEWORK_CALLOUT_WLOCK(co);
 	/* Reset to high now */
-	co->current_level = HIGH;
-	FRAMEWORK_CALLOUT_WUNLOCK(co);
-	brightness = framework_callout_getbrightnessfor(co);
-	TRACE("callout unlocked\n");
+	while (0 != FRAMEWORK_CALLOUT_STAGE(state) &&
+	       !atomic_fcmpset_int(&co->state, &state,
+				   FRAMEWORK_CALLOUT_NEXT(state, 0)))
+		;
+	old_stage = FRAMEWORK_CALLOUT_STAGE(state);
+	if (0 != old_stage) {
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_UNDIM);
+		FRAMEWORK_TRACE(FRAMEWORK_TRACE_LEVEL, 0, old_stage, 0);
+	}
+
+	/* forward keys first, so their brightness change applies now */
+	if (nkeys && co->keyhandler)
+		framework_keyhandler_handlekeys(co->keyhandler, keys, nkeys);
 
-	/* if we have a keycode, we forward to keyhandler */
-	if (keycode && co->keyhandler)
-		framework_keyhandler_handlekey(co->keyhandler, *keycode);
+	screen_config = framework_callout_getscreenconfig(co);
+	brightness = framework_callout_getbrightnessfor(co, screen_config, 0);
+	computed = framework_latency_record(FRAMEWORK_LATENCY_DECIDE, start);
 
-	framework_bl_setbrightness(brightness);
+	/* undim at once, cancelling a fade into an idle stage */
+	framework_bl_setbrightness(brightness, computed);
 
+	/* the idle deadline was disarmed once the last stage was reached */
+	if (0 != old_stage)
+		framework_callout_arm(co, screen_config);
+
+	SDT_PROBE0(framework, callout, inputintr, return);
 	TRACE("callout intr end\n");
 }
 
 /*
- * Calculate tick count from seconds
+ * Tell whether input needs framework_callout_inputintr
+ *
+ * Called from evdev's event delivery in direct mode, so must not
+ * sleep.  Input is only relevant while dimmed or for handled keys.
  */
-static uint32_t
-framework_callout_sec2tick(uint32_t seconds)
+static bool
+framework_callout_inputneeded(void *ctx, const uint16_t *keys, size_t nkeys)
 {
-	struct timeval tv = {0};
+	struct framework_callout_t *co = ctx;
+
+	if (framework_callout_drop)
+		return false;
 
-	tv.tv_sec = seconds;
+	if (framework_callout_haskeys(co, keys, nkeys))
+		return true;
 
-	return tvtohz(&tv);
+	return (0 != FRAMEWORK_CALLOUT_STAGE(atomic_load_acq_int(&co->state)));
 }
 
 /*
- * Kernel thread running dim check at expected intervals
+ * Convert a duration to milliseconds for probes
+ */
+static uint32_t
+framework_callout_sbt2ms(sbintime_t sbt)
+{
+	if (sbt / SBT_1MS > (uint32_t)-1)
+		return (uint32_t)-1;
+
+	return (sbt / SBT_1MS);
+}
+
+/*
+ * Idle check, run by the timer once the deadline of a stage passed
+ *
+ * Moves on to the deepest stage whose timeout expired and arms the
+ * deadline of the stage after it; the timer stays disarmed in the
+ * last stage until input arrives.
  */
 static void
-framework_callout_thread(void *ptr)
+framework_callout_check(void *ptr)
 {
 	struct framework_callout_t *co = ptr;
-	uint32_t current_timeout = 0;
-	time_t last_input = 0;
-	uint32_t elapsed_time = 0;
-	uint32_t next_seconds = 0;
-	uint32_t next_wait = 0;
+	struct framework_screen_config_t *screen_config = NULL;
+	uint32_t next_timeout = 0;
+	sbintime_t last_input = 0;
+	sbintime_t now = 0;
+	sbintime_t elapsed_time = 0;
+	sbintime_t input = 0;
 	uint32_t brightness = 0;
+	u_int state, new_state, old_stage, stage, stages;
+	bool inhibited = false;
 
-	TRACE("callout thread start\n");
-
-	/* Wire up interrupt */
-	framework_evdev_setintrfunc(framework_callout_inputintr, co);
-	framework_callout_drop = 0;
-	
-	FRAMEWORK_CALLOUT_LOCK(co);
-	while (co->active) {
-		/* get current timeout */
-		FRAMEWORK_CALLOUT_UNLOCK(co);
-		current_timeout = framework_callout_getcurrenttimeout(co);
-		FRAMEWORK_CALLOUT_LOCK(co);
-		
-		TRACE("callout thread timeout at %d seconds\n",
-		       current_timeout);
-
-		if (0 == current_timeout) {
-			/* invalid timeout */
-			ERROR("invalid timeout value - exiting\n");
-			co->active = 0;
-			break;
+	screen_config = framework_callout_getscreenconfig(co);
+	if (NULL == screen_config) {
+		/* invalid power mode, wait for input or a config change */
+		ERROR("invalid screen config - not rearming\n");
+		return;
+	}
+	stages = co->power_config->funcs.get_stages(co->power_config,
+						    screen_config);
+
+	/* get last input time, no lock needed */
+	input = framework_evdev_getlastinput();
+	last_input = input;
+	now = sbinuptime();
+
+	/* idle time starts over once the last inhibitor is released */
+	inhibited = framework_inhibit_active();
+	last_input = MAX(last_input, framework_inhibit_lastrelease());
+
+	/* prevent overflow */
+	if (last_input > now)
+		last_input = now;
+
+	/* calculate elapsed time since last input */
+	elapsed_time = now - last_input;
+	TRACE("callout check last input at %u ms ago\n",
+	      framework_callout_sbt2ms(elapsed_time));
+
+	state = atomic_load_acq_int(&co->state);
+	do {
+		old_stage = FRAMEWORK_CALLOUT_STAGE(state);
+		/* a stage disabled meanwhile falls back to the last enabled one */
+		stage = MIN(old_stage, stages);
+		while (!inhibited && stage < stages) {
+			next_timeout = co->power_config->funcs.get_stage_timeout_ms(co->power_config,
+										    screen_config,
+										    stage);
+			if (elapsed_time + FRAMEWORK_CALLOUT_PRECISION <
+			    mstosbt(next_timeout))
+				break;
+			stage++;
 		}
+		new_state = (stage == old_stage) ? state :
+		    FRAMEWORK_CALLOUT_NEXT(state, stage);
+	} while (new_state != state &&
+		 !atomic_fcmpset_int(&co->state, &state, new_state));
+
+	/*
+	 * Input may have come in after the last input time was read and
+	 * found the screen in use; undo the dim and wait for its idle
+	 * timeout instead.  Input that found the new stage resets it.
+	 */
+	if (stage > old_stage) {
+		atomic_thread_fence_seq_cst();
+		if (framework_evdev_getlastinput() != input &&
+		    atomic_cmpset_int(&co->state, new_state,
+				      FRAMEWORK_CALLOUT_NEXT(new_state,
+							     old_stage))) {
+			TRACE("callout check overtaken by input\n");
+			framework_callout_arm(co, screen_config);
+			return;
+		}
+	}
 
-		/* get last input time */
-		FRAMEWORK_CALLOUT_UNLOCK(co);
-		last_input = framework_evdev_getlastinput();
-		FRAMEWORK_CALLOUT_LOCK(co);
-		
-		/* prevent overflow */
-		if (last_input > time_uptime)
-			last_input = time_uptime;
-		
-		/* calculate elapsed time since last input */
-		elapsed_time = (time_uptime - last_input);
-		TRACE("callout thread last input at %d seconds ago\n",
-		       elapsed_time);
-
-		/* call dimcheck */
-		if (elapsed_time >= current_timeout) {
-			/* dim if we exeeded timeout */
-			FRAMEWORK_CALLOUT_WLOCK(co);
-			co->current_level = DIM;
-			FRAMEWORK_CALLOUT_WUNLOCK(co);
-		} /* else {
-			co->current_level = HIGH;
-			}*/
-
-		FRAMEWORK_CALLOUT_UNLOCK(co);
-		brightness = framework_callout_getbrightnessfor(co);
-		framework_bl_setbrightness(brightness);
-		FRAMEWORK_CALLOUT_LOCK(co);
-
-		/* calculate next wait duration */
-		next_seconds = (elapsed_time < current_timeout) ?
-			(current_timeout - elapsed_time) : current_timeout;
-		next_wait = framework_callout_sec2tick(next_seconds);
-		TRACE("callout thread will wake up again in %d ticks (%d secs)\n",
-		      next_wait, next_seconds);
-		co->expect_next_callout = tick + next_wait;
-		
-		msleep(co, &co->lock, 0, "sigwait", next_wait);
+	SDT_PROBE2(framework, callout, timer, wakeup,
+		   framework_callout_sbt2ms(elapsed_time), stage);
+
+	if (stage != old_stage) {
+		if (stage > old_stage)
+			FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_DIM);
+		FRAMEWORK_TRACE(FRAMEWORK_TRACE_LEVEL, 0, old_stage, stage);
 	}
-	FRAMEWORK_CALLOUT_UNLOCK(co);
 
-	wakeup(co);
-	TRACE("callout thread stopped\n");
+	/* also applies changed brightness settings, idle stages fade */
+	brightness = framework_callout_getbrightnessfor(co, screen_config,
+							stage);
+	if (0 != stage) {
+		framework_bl_fadeto(brightness);
+
+		/* input undimmed before the fade started, undim again */
+		if (atomic_load_acq_int(&co->state) != new_state) {
+			brightness = framework_callout_getbrightnessfor(co,
+									screen_config,
+									0);
+			framework_bl_setbrightness(brightness, 0);
+			return;
+		}
+	} else
+		framework_bl_setbrightness(brightness, 0);
+
+	/* in the last stage, only input rearms the deadline */
+	if (stage == stages)
+		return;
+
+	/* while inhibited, releasing the last inhibitor rearms it */
+	if (inhibited)
+		return;
+
+	TRACE("callout check will run again in %u ms\n",
+	      framework_callout_sbt2ms(last_input + mstosbt(next_timeout) -
+				       now));
+	SDT_PROBE2(framework, callout, timer, sleep,
+		   framework_callout_sbt2ms(last_input +
+					    mstosbt(next_timeout) - now),
+		   stage);
+	framework_timer_schedule(co->timer, last_input + mstosbt(next_timeout),
+				 FRAMEWORK_CALLOUT_PRECISION);
+}
+
+/*
+ * Have the timer run the dim check now
+ *
+ * Used when the deadline may have moved for other reasons than input,
+ * the check rearms the timer as needed.
+ */
+static void
+framework_callout_kick(void *ptr)
+{
+	struct framework_callout_t *co = ptr;
+
+	framework_timer_schedule(co->timer, sbinuptime(),
+				 FRAMEWORK_CALLOUT_PRECISION);
+}
+
+/*
+ * Called when the first inhibitor is taken or the last one released
+ *
+ * Disarms the deadline while inhibited instead of letting the check
+ * find out; the release has the check arm it again.
+ */
+static void
+framework_callout_inhibitchange(void *ptr)
+{
+	struct framework_callout_t *co = ptr;
+
+	if (framework_inhibit_active())
+		framework_timer_cancel(co->timer);
+	else
+		framework_callout_kick(co);
+}
 
-	kthread_exit();
+/*
+ * Called when switching between AC line and battery
+ */
+static void
+framework_callout_powerchange(void *ptr, int profile)
+{
+	TRACE("callout power profile changed to %d\n", profile);
+	framework_callout_kick(ptr);
 }
 
 /*
@@ -289,6 +488,7 @@ framework_callout_init(struct framework_screen_power_config_t *power_config,
 		       struct framework_keyhandler_t *keyhandler)
  {
 	struct framework_callout_t *co = NULL;
+	struct framework_screen_config_t *screen_config = NULL;
 	uint32_t brightness = 0;
 
 	co = malloc(sizeof(struct framework_callout_t),
@@ -296,24 +496,31 @@ framework_callout_init(struct framework_screen_power_config_t *power_config,
 
 	co->power_config = power_config;
 	co->keyhandler = keyhandler;
-	co->active = 1;
-
-	mtx_init(&co->lock, "framework_callout", NULL, MTX_DEF);
-	rw_init(&co->rwlock, "framework_callout_rw");
 
 	/* set to expected high value */
-	co->current_level = HIGH;
+	co->state = 0;
 	
-	brightness = framework_callout_getbrightnessfor(co);
-	framework_bl_setbrightness(brightness);
-
-	/* Schedule initial callout */
-	int error = kthread_add(framework_callout_thread, co, NULL,
-				NULL, 0, 0,
-				"framework_callout_thread");
-	if (0 != error) {
-		ERROR("failed to start callout thread with error %d\n", error);
-	}
+	screen_config = framework_callout_getscreenconfig(co);
+	brightness = framework_callout_getbrightnessfor(co, screen_config, 0);
+	framework_bl_setbrightness(brightness, 0);
+
+	co->timer = framework_timer_register("dim", framework_callout_check,
+					     co);
+
+	/* Wire up interrupt */
+	framework_evdev_setintrfunc(framework_callout_inputintr,
+				    framework_callout_inputneeded, co);
+	framework_callout_drop = 0;
+
+	/* Power source and config changes move the deadline */
+	co->power_tag = EVENTHANDLER_REGISTER(power_profile_change,
+					      framework_callout_powerchange,
+					      co, EVENTHANDLER_PRI_ANY);
+	framework_screen_sethook(power_config, framework_callout_kick, co);
+	framework_inhibit_sethook(framework_callout_inhibitchange, co);
+
+	/* Schedule initial check */
+	framework_callout_kick(co);
 	
 	return co;
 }
@@ -327,25 +534,19 @@ framework_callout_destroy(struct framework_callout_t *co)
 	TRACE("framework_callout_destroy begin\n");
   
 	/* Clear interrupt callback */
-	framework_evdev_setintrfunc(NULL, NULL);
+	framework_evdev_setintrfunc(NULL, NULL, NULL);
 	framework_callout_drop = 1;
 
 	if (NULL == co)
 		return;
 
-	FRAMEWORK_CALLOUT_LOCK(co);
-	if (co->active) {
-		co->active = 0;
-		DEBUG("waking up callout thread\n");
-		wakeup(co);
-		DEBUG("awaiting callout thread shutdown - sleeping\n");
-		/* wait for thread to finish */
-		msleep(co, &co->lock, 0, "sigwait", 0);
-	}
-	FRAMEWORK_CALLOUT_UNLOCK(co);
+	framework_screen_sethook(co->power_config, NULL, NULL);
+	framework_inhibit_sethook(NULL, NULL);
+	EVENTHANDLER_DEREGISTER(power_profile_change, co->power_tag);
+
+	/* waits for a running dim check */
+	framework_timer_unregister(co->timer);
 
-	rw_destroy(&co->rwlock);
-	mtx_destroy(&co->lock);
 	free(co, M_FRAMEWORK);
 
 	TRACE("framework_callout_destroy end\n");
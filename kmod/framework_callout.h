@@ -34,11 +34,6 @@
 #include "framework_keyhandler.h"
 #include "framework_screen.h"
 
-enum framework_callout_brightmode_t {
-	DIM,
-	HIGH
-};
-
 struct framework_callout_t;
 
 /* Initialize a new callout helper */
@@ -0,0 +1,119 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/kernel.h>
+#include <sys/counter.h>
+#include <sys/malloc.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include "framework_counters.h"
+
+counter_u64_t framework_counters[FRAMEWORK_COUNTER_COUNT];
+
+static const struct {
+	const char *name;
+	const char *descr;
+} framework_counter_names[FRAMEWORK_COUNTER_COUNT] = {
+	[FRAMEWORK_COUNTER_INPUT] = {
+		"inputs", "Input events from all devices" },
+	[FRAMEWORK_COUNTER_DIM] = {
+		"dims", "Switches to the dimmed level" },
+	[FRAMEWORK_COUNTER_UNDIM] = {
+		"undims", "Switches back to the high level" },
+	[FRAMEWORK_COUNTER_BL_WRITE] = {
+		"backlight_writes", "Backlight updates performed" },
+	[FRAMEWORK_COUNTER_BL_SKIP] = {
+		"backlight_skips", "Backlight updates skipped, level unchanged" },
+	[FRAMEWORK_COUNTER_ACPI_QUERY] = {
+		"acpi_queries", "ACPI battery queries" },
+	[FRAMEWORK_COUNTER_KEY] = {
+		"keys", "Keys dispatched to the key handler" },
+	[FRAMEWORK_COUNTER_SYN_DROPPED] = {
+		"syn_dropped", "evdev ring overflows, seen as SYN_DROPPED" },
+	[FRAMEWORK_COUNTER_KEY_OVERFLOW] = {
+		"key_overflows", "Keys dropped from a full key batch" },
+	[FRAMEWORK_COUNTER_COALESCED] = {
+		"coalesced", "Inputs that skipped the brightness update" },
+	[FRAMEWORK_COUNTER_FILTERED] = {
+		"filtered", "Input events discarded as insignificant" },
+	[FRAMEWORK_COUNTER_TIMER_ARM] = {
+		"timer_arms", "Timer deadlines armed" },
+	[FRAMEWORK_COUNTER_TIMER_SKIP] = {
+		"timer_skips", "Timer deadlines left alone, already armed" },
+	[FRAMEWORK_COUNTER_FADE] = {
+		"fades", "Brightness fades run to their target" },
+	[FRAMEWORK_COUNTER_FADE_CANCEL] = {
+		"fade_cancels", "Brightness fades cancelled" },
+	[FRAMEWORK_COUNTER_FADE_WRITE] = {
+		"fade_writes", "Backlight updates within fades" },
+	[FRAMEWORK_COUNTER_FADE_ELIDE] = {
+		"fade_elided", "Fade steps skipped, quantised level unchanged" },
+	[FRAMEWORK_COUNTER_INHIBIT] = {
+		"inhibits", "Inhibitors put in force" },
+	[FRAMEWORK_COUNTER_INHIBIT_EXPIRE] = {
+		"inhibit_expiries", "Inhibitors released by their timeout" }
+};
+
+void
+framework_counters_init(void)
+{
+	for (int i = 0; i < FRAMEWORK_COUNTER_COUNT; i++)
+		framework_counters[i] = counter_u64_alloc(M_WAITOK);
+}
+
+void
+framework_counters_sysctl_init(struct sysctl_ctx_list *ctx,
+			       struct sysctl_oid *parent)
+{
+	for (int i = 0; i < FRAMEWORK_COUNTER_COUNT; i++)
+		SYSCTL_ADD_COUNTER_U64(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+				       framework_counter_names[i].name,
+				       CTLFLAG_RD, &framework_counters[i],
+				       framework_counter_names[i].descr);
+}
+
+void
+framework_counters_zero(void)
+{
+	for (int i = 0; i < FRAMEWORK_COUNTER_COUNT; i++)
+		counter_u64_zero(framework_counters[i]);
+}
+
+void
+framework_counters_destroy(void)
+{
+	for (int i = 0; i < FRAMEWORK_COUNTER_COUNT; i++) {
+		counter_u64_free(framework_counters[i]);
+		framework_counters[i] = NULL;
+	}
+}
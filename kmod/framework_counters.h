@@ -0,0 +1,85 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_COUNTERS_H__
+#define __FRAMEWORK_COUNTERS_H__
+
+#include <sys/types.h>
+#include <sys/counter.h>
+#include <sys/sysctl.h>
+
+/*
+ * Module activity counters
+ *
+ * counter(9) based, so the input path only touches per-CPU memory.
+ * Exported below hw.framework.stats.
+ */
+enum framework_counter_id {
+	FRAMEWORK_COUNTER_INPUT,          /* input events, all bindings */
+	FRAMEWORK_COUNTER_DIM,            /* switches to dimmed level */
+	FRAMEWORK_COUNTER_UNDIM,          /* switches back to high level */
+	FRAMEWORK_COUNTER_BL_WRITE,       /* backlight updates performed */
+	FRAMEWORK_COUNTER_BL_SKIP,        /* backlight already at level */
+	FRAMEWORK_COUNTER_ACPI_QUERY,     /* ACPI battery queries */
+	FRAMEWORK_COUNTER_KEY,            /* keys dispatched to keyhandler */
+	FRAMEWORK_COUNTER_SYN_DROPPED,    /* evdev ring overflows seen */
+	FRAMEWORK_COUNTER_KEY_OVERFLOW,   /* keys beyond a full key batch */
+	FRAMEWORK_COUNTER_COALESCED,      /* inputs within notify interval */
+	FRAMEWORK_COUNTER_FILTERED,       /* events without significance */
+	FRAMEWORK_COUNTER_TIMER_ARM,      /* timer deadlines armed */
+	FRAMEWORK_COUNTER_TIMER_SKIP,     /* timer deadlines left as armed */
+	FRAMEWORK_COUNTER_FADE,           /* fades run to their target */
+	FRAMEWORK_COUNTER_FADE_CANCEL,    /* fades cut short by a jump */
+	FRAMEWORK_COUNTER_FADE_WRITE,     /* backlight updates within fades */
+	FRAMEWORK_COUNTER_FADE_ELIDE,     /* fade steps at an unchanged level */
+	FRAMEWORK_COUNTER_INHIBIT,        /* inhibitors put in force */
+	FRAMEWORK_COUNTER_INHIBIT_EXPIRE, /* inhibitors released by timeout */
+	FRAMEWORK_COUNTER_COUNT
+};
+
+extern counter_u64_t framework_counters[FRAMEWORK_COUNTER_COUNT];
+
+#define FRAMEWORK_COUNTER_INC(id) \
+	counter_u64_add(framework_counters[(id)], 1)
+
+/* Allocate counters */
+void framework_counters_init(void);
+
+/* Add counters below parent */
+void framework_counters_sysctl_init(struct sysctl_ctx_list *ctx,
+				    struct sysctl_oid *parent);
+
+/* Clear all counters */
+void framework_counters_zero(void);
+
+/* Free counters */
+void framework_counters_destroy(void);
+
+#endif /* __FRAMEWORK_COUNTERS_H__ */
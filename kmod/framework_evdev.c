@@ -31,143 +31,545 @@
 #include <sys/types.h>
 #include <sys/malloc.h>
 #include <sys/param.h>
+#include <sys/bus.h>
+#include <sys/epoch.h>
+#include <sys/eventhandler.h>
 #include <sys/kernel.h>
+#include <sys/sbuf.h>
 #include <sys/time.h>
+#include <sys/sdt.h>
 
+#include <machine/atomic.h>
+
+#include "framework_counters.h"
 #include "framework_evdev.h"
+#include "framework_lockstat.h"
+#include "framework_match.h"
 #include "framework_sysctl.h"
+#include "framework_trace.h"
 #include "framework_utils.h"
 
-static const char *framework_evdev_devnames[] = {
-	"TouchPad",
-	"Mouse",
-	"hcons0",
-	"hmt0",
-	"hms0",
-	"sysmouse",
-	"kbdmux",
-	"psm",
-	"atkbd",
-	NULL
+/*
+ * Interrupt callbacks, replaced as a whole
+ */
+struct framework_evdev_intr_t {
+	framework_evdev_intrfunc cbfunc;     /* interrupt function */
+	framework_evdev_checkfunc checkfunc; /* direct mode check */
+	void *ctx;                           /* callback context */
 };
 
 /*
  * evdev connector
  *
- * Attaches to an evdev device and adds a listener
- * client to receive updates from input signals
+ * Attaches to evdev devices, including those plugged in later, and
+ * adds a listener client to receive updates from input signals.
+ * Input delivery only reads bindings and callbacks within the epoch,
+ * so it never waits for the lock held while devices come and go.
  */
 static struct framework_evdev_t {
-	LIST_HEAD(, framework_evdev_binding_t) bindings;
+	CK_LIST_HEAD(, framework_evdev_binding_t) bindings; /* (l, e) */
 
-	time_t last_input;               /* (l) time_uptime the last input occurred */
+	struct framework_evdev_intr_t *intr; /* (l, e) interrupt callbacks */
 
-	framework_evdev_intrfunc cbfunc; /* (l) interrupt function */
-	void *cbctx;                     /* (l) callback context */
+	epoch_t epoch;                   /* e - readers of the above */
+	eventhandler_tag attach_tag;     /* device_attach handler */
+	struct sysctl_oid *input_tree;   /* hw.framework.input */
 
-	uint8_t active;
+	uint8_t active;                  /* (l) accepting input and devices */
 
 	struct mtx lock;                 /* l - lock mechanism */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;       /* (l) lock acquisition time */
+#endif
 
 	uint8_t state;
 } framework_evdev = {0};
 
-#define FRAMEWORK_EVDEV_LOCK(x) mtx_lock(&(x)->lock)
-#define FRAMEWORK_EVDEV_UNLOCK(x) mtx_unlock(&(x)->lock)
+/* bindings on their way out, see framework_evdev_unbind */
+SLIST_HEAD(framework_evdev_unbind_list, framework_evdev_binding_t);
+
+/*
+ * sbinuptime() of the last input
+ *
+ * Stored from evdev's event delivery on any CPU without taking a
+ * lock; on a cache line of its own so those stores do not contend
+ * with the evdev lock.
+ */
+static struct framework_evdev_lastinput_t {
+	volatile uint64_t last_input;
+} __aligned(CACHE_LINE_SIZE) framework_evdev_lastinput;
+
+#define FRAMEWORK_EVDEV_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_EVDEV, &(x)->lock, \
+				    &(x)->lockstat_stamp)
+#define FRAMEWORK_EVDEV_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_EVDEV, &(x)->lock, \
+				      &(x)->lockstat_stamp)
 
 MALLOC_DECLARE(M_FRAMEWORK);
 
+SDT_PROVIDER_DECLARE(framework);
+SDT_PROBE_DEFINE2(framework, evdev, , input, "int", "size_t");
+
+/* default minimum interval between callbacks per binding, in ms */
+#define FRAMEWORK_EVDEV_NOTIFY_INTERVAL 1000
+
+/* see framework_evdev_setnotifyinterval */
+static u_int framework_evdev_notify_interval = FRAMEWORK_EVDEV_NOTIFY_INTERVAL;
+
+/* weight of the last second in the input rate average, 1/2^n */
+#define FRAMEWORK_EVDEV_RATE_SHIFT 2
+/* fraction bits of the input rate average */
+#define FRAMEWORK_EVDEV_RATE_FRAC 8
+/* idle seconds after which the input rate average is 0 */
+#define FRAMEWORK_EVDEV_RATE_IDLE 64
+
+sbintime_t
+framework_evdev_getlastinput(void)
+{
+	return ((sbintime_t)
+		atomic_load_acq_64(&framework_evdev_lastinput.last_input));
+}
+
+/*
+ * Fold the input counted within one second into the rate average,
+ * then decay it for the idle seconds that followed
+ */
+static uint64_t
+framework_evdev_rate(uint64_t avg, uint64_t count, uint64_t seconds)
+{
+	if (seconds > FRAMEWORK_EVDEV_RATE_IDLE)
+		return 0;
+
+	avg = avg - (avg >> FRAMEWORK_EVDEV_RATE_SHIFT) +
+		((count << FRAMEWORK_EVDEV_RATE_FRAC) >>
+		 FRAMEWORK_EVDEV_RATE_SHIFT);
+	while (--seconds > 0)
+		avg -= avg >> FRAMEWORK_EVDEV_RATE_SHIFT;
+
+	return avg;
+}
+
+/*
+ * Count input towards the rate of a binding, must not sleep
+ */
+static void
+framework_evdev_ratecount(struct framework_evdev_binding_t *binding,
+			  sbintime_t now)
+{
+	uint64_t second = (uint64_t)(now / SBT_1S);
+	uint64_t last = atomic_load_64(&binding->rate_second);
+	uint64_t count = atomic_load_64(&binding->rate_count);
+
+	if (second != last) {
+		atomic_store_64(&binding->rate_avg,
+				framework_evdev_rate(
+					atomic_load_64(&binding->rate_avg),
+					count, second - last));
+		atomic_store_64(&binding->rate_second, second);
+		count = 0;
+	}
+	atomic_store_64(&binding->rate_count, count + 1);
+}
+
+/*
+ * Account an interrupt callback that started at start
+ */
+static void
+framework_evdev_callbackdone(struct framework_evdev_binding_t *binding,
+			     sbintime_t start)
+{
+	counter_u64_add(binding->callbacks, 1);
+	counter_u64_add(binding->callback_ns, sbttons(sbinuptime() - start));
+}
+
 /*
- * ATTENTION
+ * Record input activity and fetch the interrupt callback
  *
- * On every release upgrade, we need to check if this value
- * is still correct -> dev/evdev!
+ * Runs from evdev's event delivery in direct mode, must not sleep.
+ * Returns the time recorded as last input.
  */
-#define	DEF_RING_REPORTS	8
+static sbintime_t
+framework_evdev_activity(struct framework_evdev_binding_t *binding,
+			 const uint16_t *keys, size_t nkeys,
+			 framework_evdev_intrfunc *cbfunc,
+			 framework_evdev_checkfunc *checkfunc, void **cbctx)
+{
+	struct framework_evdev_t *edata = &framework_evdev;
+	struct framework_evdev_intr_t *intr = NULL;
+	struct epoch_tracker et;
+	sbintime_t now = sbinuptime();
+
+	counter_u64_add(binding->inputs, 1);
+	FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_INPUT);
+
+	atomic_store_rel_64(&framework_evdev_lastinput.last_input,
+			    (uint64_t)now);
+	atomic_store_64(&binding->last_input, (uint64_t)now);
+	framework_evdev_ratecount(binding, now);
+	SDT_PROBE2(framework, evdev, , input, nkeys ? keys[0] : -1, nkeys);
+
+	epoch_enter_preempt(edata->epoch, &et);
+	intr = (struct framework_evdev_intr_t *)
+		atomic_load_acq_ptr((uintptr_t *)&edata->intr);
+	if (intr) {
+		*cbfunc = intr->cbfunc;
+		*checkfunc = intr->checkfunc;
+		*cbctx = intr->ctx;
+	}
+	epoch_exit_preempt(edata->epoch, &et);
 
-time_t
-framework_evdev_getlastinput(void)
+	FRAMEWORK_TRACE(FRAMEWORK_TRACE_INPUT, 0, nkeys ? keys[0] : -1, nkeys);
+
+	return now;
+}
+
+/*
+ * Tell whether input on a binding has to run the interrupt callback
+ *
+ * It has to if checkfunc asks for it, i.e. to undim or for a handled
+ * key.  Otherwise it runs at most once per notify interval, so that
+ * continuous pointer movement does not recompute the brightness for
+ * every report.  Must not sleep.
+ */
+static bool
+framework_evdev_needsintr(struct framework_evdev_binding_t *binding,
+			  sbintime_t now, const uint16_t *keys, size_t nkeys,
+			  framework_evdev_checkfunc checkfunc, void *cbctx)
 {
-	time_t tval = 0;
+	sbintime_t interval =
+		mstosbt(atomic_load_int(&framework_evdev_notify_interval));
+	sbintime_t last = (sbintime_t)atomic_load_64(&binding->last_notify);
 
-	FRAMEWORK_EVDEV_LOCK(&framework_evdev);
-	tval = framework_evdev.last_input;
-	FRAMEWORK_EVDEV_UNLOCK(&framework_evdev);
+	if (now - last < interval && NULL != checkfunc &&
+	    !checkfunc(cbctx, keys, nkeys)) {
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_COALESCED);
+		return false;
+	}
+
+	atomic_store_64(&binding->last_notify, (uint64_t)now);
 
-	return tval;
+	return true;
 }
 
 /*
  * Called when input is received
  */
 static void
-framework_evdev_oninput(void *ctx, uint16_t *keycode)
+framework_evdev_oninput(void *ctx, const uint16_t *keys, size_t nkeys)
 {
-	struct framework_evdev_t *edata = ctx;
+	struct framework_evdev_binding_t *binding = ctx;
 	framework_evdev_intrfunc local_cbfunc = NULL;
+	framework_evdev_checkfunc local_checkfunc = NULL;
 	void *local_ctx = NULL;
+	sbintime_t now = 0, start = 0;
 
-	if (!edata->active) {
+	if (!framework_evdev.active) {
 		TRACE("evdev oninput callback while inactive\n");
 		return;
 	}
 
-	TRACE("evdev oninput lock\n");
-	FRAMEWORK_EVDEV_LOCK(edata);
-	edata->last_input = time_uptime;
-	TRACE("last input updated to %ld\n", edata->last_input);
-	
-	local_cbfunc = framework_evdev.cbfunc;
-	local_ctx = framework_evdev.cbctx;
-	FRAMEWORK_EVDEV_UNLOCK(edata);
-	TRACE("evdev oninput unlock\n");
+	now = framework_evdev_activity(binding, keys, nkeys, &local_cbfunc,
+				       &local_checkfunc, &local_ctx);
 
-	if (local_cbfunc) {
+	if (local_cbfunc &&
+	    framework_evdev_needsintr(binding, now, keys, nkeys,
+				      local_checkfunc, local_ctx)) {
 		TRACE("calling evdev callback at %p\n", local_cbfunc);
-		local_cbfunc(local_ctx, keycode);
+		start = sbinuptime();
+		local_cbfunc(local_ctx, keys, nkeys);
+		framework_evdev_callbackdone(binding, start);
 	}
 }
 
 /*
- * Check whether device needs to be monitored
+ * Called from evdev's event delivery in direct mode
  *
- * We don't want to monitor screen lid buttons, acpi video devices
- * and similar. This may lead to various timing conflicts.
+ * Returns true if the interrupt callback has to run, which then
+ * happens on the listener thread through framework_evdev_ondeferred.
  */
 static bool
-framework_evdev_matchname(const char *name, bool partial)
+framework_evdev_onnotify(void *ctx, const uint16_t *keys, size_t nkeys)
 {
-	if (NULL == name)
+	struct framework_evdev_binding_t *binding = ctx;
+	framework_evdev_intrfunc local_cbfunc = NULL;
+	framework_evdev_checkfunc local_checkfunc = NULL;
+	void *local_ctx = NULL;
+	sbintime_t now = 0;
+
+	if (!framework_evdev.active)
 		return false;
 
-	const char **strptr = framework_evdev_devnames;
-	size_t slen = 0;
-
-	while (*strptr) {
-		TRACE("matchname(\"%s\" =~ \"%s\"?)\n",
-		       name, *strptr);
-		
-		slen = strlen(*strptr);
-		
-		if (!partial && !strncmp(*strptr, name, slen)) {
-			TRACE("matchname precise OK\n");
-			return true;
-		}
-		if (partial && strnstr(*strptr, name, slen)) {
-			TRACE("matchname partial OK\n");
-			return true;
-		}
-		
-		strptr++;
+	now = framework_evdev_activity(binding, keys, nkeys, &local_cbfunc,
+				       &local_checkfunc, &local_ctx);
+
+	if (NULL == local_cbfunc)
+		return false;
+
+	return framework_evdev_needsintr(binding, now, keys, nkeys,
+					 local_checkfunc, local_ctx);
+}
+
+/*
+ * Run interrupt callback for input recorded by framework_evdev_onnotify
+ */
+static void
+framework_evdev_ondeferred(void *ctx, const uint16_t *keys, size_t nkeys)
+{
+	struct framework_evdev_t *edata = &framework_evdev;
+	struct framework_evdev_binding_t *binding = ctx;
+	struct framework_evdev_intr_t *intr = NULL;
+	framework_evdev_intrfunc local_cbfunc = NULL;
+	void *local_ctx = NULL;
+	struct epoch_tracker et;
+	sbintime_t start = 0;
+
+	if (!framework_evdev.active)
+		return;
+
+	epoch_enter_preempt(edata->epoch, &et);
+	intr = (struct framework_evdev_intr_t *)
+		atomic_load_acq_ptr((uintptr_t *)&edata->intr);
+	if (intr) {
+		local_cbfunc = intr->cbfunc;
+		local_ctx = intr->ctx;
+	}
+	epoch_exit_preempt(edata->epoch, &et);
+
+	if (local_cbfunc) {
+		TRACE("calling deferred evdev callback at %p\n", local_cbfunc);
+		start = sbinuptime();
+		local_cbfunc(local_ctx, keys, nkeys);
+		framework_evdev_callbackdone(binding, start);
+	}
+}
+
+/*
+ * Input events per second of a binding, averaged over the last seconds
+ *
+ * The second still being counted is left out.
+ */
+static int
+framework_evdev_sysctl_rate(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_evdev_binding_t *binding = arg1;
+	uint64_t second = (uint64_t)(sbinuptime() / SBT_1S);
+	uint64_t last = atomic_load_64(&binding->rate_second);
+	uint64_t avg = atomic_load_64(&binding->rate_avg);
+	uint32_t rate = 0;
+
+	if (second > last)
+		avg = framework_evdev_rate(avg,
+					   atomic_load_64(&binding->rate_count),
+					   second - last);
+	rate = (avg + (1 << (FRAMEWORK_EVDEV_RATE_FRAC - 1))) >>
+		FRAMEWORK_EVDEV_RATE_FRAC;
+
+	return sysctl_handle_32(oidp, &rate, 0, req);
+}
+
+/*
+ * Uptime of the last input of a binding in milliseconds
+ */
+static int
+framework_evdev_sysctl_lastinput(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_evdev_binding_t *binding = arg1;
+	uint64_t ms = sbttoms((sbintime_t)atomic_load_64(&binding->last_input));
+
+	return sysctl_handle_64(oidp, &ms, 0, req);
+}
+
+/*
+ * Client ring of a binding, arg2 selects the figure
+ */
+static int
+framework_evdev_sysctl_ring(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_evdev_binding_t *binding = arg1;
+	struct framework_evthread_ringstats_t stats = {0};
+	uint64_t value = 0;
+
+	if (binding->listener_thread)
+		framework_evthread_ringstats(binding->listener_thread, &stats);
+
+	switch (arg2) {
+	case 0:
+		value = stats.bytes;
+		break;
+	case 1:
+		value = stats.events;
+		break;
+	case 2:
+		value = stats.highwater;
+		break;
+	default:
+		value = stats.resizes;
 	}
 
-	TRACE("matchname NO\n");
+	return sysctl_handle_64(oidp, &value, 0, req);
+}
+
+/*
+ * Device class of a binding
+ */
+static int
+framework_evdev_sysctl_class(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_evdev_binding_t *binding = arg1;
+	char class[16] = "";
+
+	if (binding->listener_thread)
+		strlcpy(class,
+			framework_evthread_classname(binding->listener_thread),
+			sizeof(class));
+
+	return sysctl_handle_string(oidp, class, sizeof(class), req);
+}
+
+/*
+ * Tell whether a bound device uses a sysctl node name, called with
+ * the evdev lock held
+ */
+static bool
+framework_evdev_sysctlused(struct framework_evdev_t *edata,
+			   const char *name)
+{
+	struct framework_evdev_binding_t *bound = NULL;
+
+	CK_LIST_FOREACH(bound, &edata->bindings, entries) {
+		if (!strcmp(bound->sysctl_name, name))
+			return true;
+	}
 
 	return false;
 }
 
+/*
+ * Name the sysctl node of a binding, called with the evdev lock held
+ *
+ * The name is the device's short name, followed by its serial if it
+ * has one and a unit number if the name is taken already.  Characters
+ * not allowed in sysctl names are replaced.
+ */
+static void
+framework_evdev_sysctlname(struct framework_evdev_t *edata,
+			   struct framework_evdev_binding_t *binding,
+			   const struct evdev_dev *devdata)
+{
+	char *name = binding->sysctl_name;
+	size_t len = sizeof(binding->sysctl_name), base = 0;
+
+	strlcpy(name, devdata->ev_shortname, len);
+	if (devdata->ev_serial[0]) {
+		strlcat(name, "_", len);
+		strlcat(name, devdata->ev_serial, len);
+	}
+	if ('\0' == name[0])
+		strlcpy(name, "device", len);
+
+	for (char *c = name; *c; c++) {
+		if (!(('a' <= *c && *c <= 'z') || ('A' <= *c && *c <= 'Z') ||
+		      ('0' <= *c && *c <= '9') || '-' == *c))
+			*c = '_';
+	}
+
+	base = MIN(strlen(name), len - 8);
+	for (int unit = 1; framework_evdev_sysctlused(edata, name); unit++)
+		snprintf(name + base, len - base, "_%d", unit);
+}
+
+/*
+ * Add hw.framework.input.<device> for a binding
+ */
+static void
+framework_evdev_sysctlbind(struct framework_evdev_t *edata,
+			   struct framework_evdev_binding_t *binding)
+{
+	struct sysctl_ctx_list *ctx = &binding->sysctl_ctx;
+	struct sysctl_oid *node = NULL;
+
+	if (NULL == edata->input_tree)
+		return;
+
+	node = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(edata->input_tree),
+			       OID_AUTO, binding->sysctl_name,
+			       CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+			       "Input device statistics");
+	if (NULL == node) {
+		ERROR("failed to add sysctl node for %s\n", binding->name);
+		return;
+	}
+
+	SYSCTL_ADD_STRING(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "name",
+			  CTLFLAG_RD | CTLFLAG_MPSAFE, binding->name, 0,
+			  "Device name");
+	SYSCTL_ADD_COUNTER_U64(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "inputs",
+			       CTLFLAG_RD, &binding->inputs,
+			       "Input events");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "rate",
+			CTLTYPE_U32 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			binding, 0, framework_evdev_sysctl_rate, "IU",
+			"Input events per second, moving average");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "last_input_ms",
+			CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			binding, 0, framework_evdev_sysctl_lastinput, "QU",
+			"Uptime of the last input in milliseconds, 0 if none");
+	if (binding->overflows)
+		SYSCTL_ADD_COUNTER_U64(ctx, SYSCTL_CHILDREN(node), OID_AUTO,
+				       "overflows", CTLFLAG_RD,
+				       &binding->overflows,
+				       "Input lost to ring overflows");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "class",
+			CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			binding, 0, framework_evdev_sysctl_class, "A",
+			"Device class of the significance filter");
+	if (binding->filtered)
+		SYSCTL_ADD_COUNTER_U64(ctx, SYSCTL_CHILDREN(node), OID_AUTO,
+				       "filtered", CTLFLAG_RD,
+				       &binding->filtered,
+				       "Input events discarded as insignificant");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "ring_bytes",
+			CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			binding, 0, framework_evdev_sysctl_ring, "QU",
+			"Memory allocated for the input ring");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "ring_events",
+			CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			binding, 1, framework_evdev_sysctl_ring, "QU",
+			"Input ring capacity in events");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(node), OID_AUTO,
+			"ring_highwater",
+			CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			binding, 2, framework_evdev_sysctl_ring, "QU",
+			"Most events queued in the input ring at once");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "ring_resizes",
+			CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			binding, 3, framework_evdev_sysctl_ring, "QU",
+			"Input ring resizes");
+	SYSCTL_ADD_COUNTER_U64(ctx, SYSCTL_CHILDREN(node), OID_AUTO,
+			       "callbacks", CTLFLAG_RD, &binding->callbacks,
+			       "Brightness updates run for input");
+	SYSCTL_ADD_COUNTER_U64(ctx, SYSCTL_CHILDREN(node), OID_AUTO,
+			       "callback_ns", CTLFLAG_RD, &binding->callback_ns,
+			       "Time spent in brightness updates in nanoseconds");
+}
+
+/*
+ * Free the counters of a binding
+ */
+static void
+framework_evdev_freestats(struct framework_evdev_binding_t *binding)
+{
+	counter_u64_free(binding->inputs);
+	counter_u64_free(binding->callbacks);
+	counter_u64_free(binding->callback_ns);
+}
+
 /*
  * Callback method for evdev iteration
+ *
+ * Binds every matching device that is not bound yet, so it serves
+ * both the scan at load and the rescans for devices plugged in later.
  */
 static int
 framework_evdev_matchdevs(const char *name,
@@ -176,13 +578,28 @@ framework_evdev_matchdevs(const char *name,
 {
 	struct framework_evdev_t *edata = ctx;
 	struct evdev_dev *devdata = drv_data;
-	
-	size_t buffer_size = devdata->ev_report_size * DEF_RING_REPORTS;
+	struct framework_evdev_binding_t *bound = NULL;
+	bool insert = false;
+
+	if (NULL == devdata)
+		return 0;
+
+	/*
+	 * Leave out lid switches, acpi video devices and similar, which
+	 * may lead to various timing conflicts.
+	 */
+	if (!framework_match_test(devdata->ev_name, devdata->ev_shortname,
+				  devdata->ev_id.vendor, devdata->ev_id.product))
+		return 0;
 
-	if (!framework_evdev_matchname(devdata->ev_shortname, false)) {
-		if (!framework_evdev_matchname(devdata->ev_name, true))
-			return 0;
+	FRAMEWORK_EVDEV_LOCK(edata);
+	CK_LIST_FOREACH(bound, &edata->bindings, entries) {
+		if (bound->evdev_device == devdata)
+			break;
 	}
+	FRAMEWORK_EVDEV_UNLOCK(edata);
+	if (bound)
+		return 0;
 	
 	struct framework_evdev_binding_t *binding =
 		malloc(sizeof(struct framework_evdev_binding_t),
@@ -200,40 +617,204 @@ framework_evdev_matchdevs(const char *name,
 	      devdata->ev_id.version);
 	
 	binding->evdev_device = devdata;
-	binding->listener_thread = framework_evthread_init(buffer_size,
+	strlcpy(binding->name, devdata->ev_name, sizeof(binding->name));
+	strlcpy(binding->shortname, devdata->ev_shortname,
+		sizeof(binding->shortname));
+	binding->vendor = devdata->ev_id.vendor;
+	binding->product = devdata->ev_id.product;
+	binding->inputs = counter_u64_alloc(M_WAITOK);
+	binding->callbacks = counter_u64_alloc(M_WAITOK);
+	binding->callback_ns = counter_u64_alloc(M_WAITOK);
+	sysctl_ctx_init(&binding->sysctl_ctx);
+	binding->listener_thread = framework_evthread_init(devdata->ev_report_size,
 							   devdata,
-							   edata);
-	if (binding->listener_thread)
+							   binding);
+	if (binding->listener_thread) {
+		binding->overflows =
+			framework_evthread_overflows(binding->listener_thread);
+		binding->filtered =
+			framework_evthread_filtered(binding->listener_thread);
 		framework_evthread_setcb(binding->listener_thread,
 					 framework_evdev_oninput);
+		framework_evthread_setnotify(binding->listener_thread,
+					     framework_evdev_onnotify,
+					     framework_evdev_ondeferred);
+	}
 
+	/* the device may have been bound meanwhile by another scan */
 	FRAMEWORK_EVDEV_LOCK(edata);
-	LIST_INSERT_HEAD(&edata->bindings, binding, entries);
+	CK_LIST_FOREACH(bound, &edata->bindings, entries) {
+		if (bound->evdev_device == devdata)
+			break;
+	}
+	insert = (NULL == bound && edata->active);
+	if (insert) {
+		framework_evdev_sysctlname(edata, binding, devdata);
+		CK_LIST_INSERT_HEAD(&edata->bindings, binding, entries);
+	}
 	FRAMEWORK_EVDEV_UNLOCK(edata);
 
+	if (!insert) {
+		TRACE("evdev dropping duplicate binding for %s\n", name);
+		framework_evthread_destroy(binding->listener_thread);
+		framework_evdev_freestats(binding);
+		free(binding, M_FRAMEWORK);
+		return 0;
+	}
+
+	framework_evdev_sysctlbind(edata, binding);
+
 	/* After starting thread, we register as client */
 	framework_evthread_registerclient(binding->listener_thread, binding->evdev_device);
 	
 	return 0;
 }
 
+/*
+ * Stop and free bindings already removed from the list
+ */
+static void
+framework_evdev_unbind(struct framework_evdev_t *edata,
+		       struct framework_evdev_unbind_list *unbind)
+{
+	struct framework_evdev_binding_t *binding = NULL;
+
+	if (SLIST_EMPTY(unbind))
+		return;
+
+	/*
+	 * Unregister and detach every session from the listener
+	 * first, so no input is dispatched while bindings are freed.
+	 */
+	SLIST_FOREACH(binding, unbind, unbind_entry) {
+		/* waits for running handlers of the node */
+		sysctl_ctx_free(&binding->sysctl_ctx);
+
+		if (NULL == binding->listener_thread) {
+			ERROR("evdev session unavailable\n");
+			continue;
+		}
+		TRACE("evdev stopping binding %p\n", binding);
+		framework_evthread_unregisterclient(binding->listener_thread,
+						    binding->evdev_device);
+		framework_evthread_stop(binding->listener_thread);
+	}
+
+	/* readers may still be walking past them */
+	epoch_wait_preempt(edata->epoch);
+
+	while (!SLIST_EMPTY(unbind)) {
+		binding = SLIST_FIRST(unbind);
+		SLIST_REMOVE_HEAD(unbind, unbind_entry);
+		TRACE("evdev destroying binding %p\n", binding);
+
+		if (binding->listener_thread)
+			framework_evthread_destroy(binding->listener_thread);
+		binding->listener_thread = NULL;
+		binding->evdev_device = NULL;
+		framework_evdev_freestats(binding);
+		free(binding, M_FRAMEWORK);
+	}
+}
+
+/*
+ * Unbind departed devices, resize rings and bind arrived devices
+ *
+ * Runs on the listener thread, requested from the device_attach
+ * event, when evdev revokes one of our clients, when a session asks
+ * for a ring size check and when the match lists change; bound
+ * devices no longer matched are released.
+ */
+static void
+framework_evdev_hotplug(void *ctx)
+{
+	struct framework_evdev_t *edata = ctx;
+	struct framework_evdev_unbind_list unbind;
+	struct framework_evdev_binding_t *binding = NULL, *tmp = NULL;
+
+	SLIST_INIT(&unbind);
+
+	FRAMEWORK_EVDEV_LOCK(edata);
+	CK_LIST_FOREACH_SAFE(binding, &edata->bindings, entries, tmp) {
+		if (!framework_evthread_revoked(binding->listener_thread) &&
+		    framework_match_test(binding->name, binding->shortname,
+					 binding->vendor, binding->product))
+			continue;
+		DEBUG("Unregistering from %s\n", binding->name);
+		CK_LIST_REMOVE(binding, entries);
+		SLIST_INSERT_HEAD(&unbind, binding, unbind_entry);
+	}
+	FRAMEWORK_EVDEV_UNLOCK(edata);
+
+	framework_evdev_unbind(edata, &unbind);
+
+	/*
+	 * Only this callback and framework_evdev_destroy, which waits for
+	 * it, remove bindings; the list may be walked without the lock.
+	 */
+	CK_LIST_FOREACH(binding, &edata->bindings, entries)
+		framework_evthread_adapt(binding->listener_thread);
+
+	framework_util_matchcdev_drv1("input/event",
+				      framework_evdev_matchdevs, edata);
+}
+
+/*
+ * Match devices again after the match lists changed
+ */
+void
+framework_evdev_rematch(void)
+{
+	if (0 == framework_evdev.state)
+		return;
+
+	FRAMEWORK_EVDEV_LOCK(&framework_evdev);
+	if (framework_evdev.state)
+		framework_evthread_hotplug();
+	FRAMEWORK_EVDEV_UNLOCK(&framework_evdev);
+}
+
+/*
+ * device_attach event, a driver may have registered an evdev device
+ */
+static void
+framework_evdev_onattach(void *ctx __unused, device_t dev __unused)
+{
+	framework_evthread_hotplug();
+}
+
 /*
  * Initialize evdev connector
  */
 int
 framework_evdev_init(void)
 {
-	LIST_INIT(&framework_evdev.bindings);
+	CK_LIST_INIT(&framework_evdev.bindings);
 
-	framework_evdev.cbfunc = NULL;
+	framework_evdev.intr = NULL;
 	framework_evdev.active = 1;
+	atomic_store_rel_64(&framework_evdev_lastinput.last_input, 0);
 	
 	mtx_init(&framework_evdev.lock,
 		 "framework_evdev", NULL, MTX_DEF);
+	framework_evdev.epoch = epoch_alloc("framework_evdev", EPOCH_PREEMPT);
+
+	int error = framework_evthread_listener_init();
+	if (0 != error) {
+		epoch_free(framework_evdev.epoch);
+		mtx_destroy(&framework_evdev.lock);
+		return error;
+	}
+
+	/* devices attaching during the scan below are picked up later */
+	framework_evthread_sethotplug(framework_evdev_hotplug, &framework_evdev);
+	framework_evdev.attach_tag =
+		EVENTHANDLER_REGISTER(device_attach, framework_evdev_onattach,
+				      NULL, EVENTHANDLER_PRI_ANY);
 	
-	int error = framework_util_matchcdev_drv1("input/event",
-						  framework_evdev_matchdevs,
-						  &framework_evdev);
+	error = framework_util_matchcdev_drv1("input/event",
+					      framework_evdev_matchdevs,
+					      &framework_evdev);
 
 	framework_evdev.state = 1;
 	
@@ -242,14 +823,59 @@ framework_evdev_init(void)
 
 /*
  * Set evdev interrupt function callback pointer
+ *
+ * In direct mode, checkfunc decides from evdev's event delivery whether
+ * cbfunc needs to run for an input; without one it always runs.
+ *
+ * Callbacks are called outside the epoch section, so clearing them does
+ * not wait for a running one; the owner must outlive framework_evdev_destroy.
+ * Once evdev is destroyed, this is a no-op.
  */
 void
-framework_evdev_setintrfunc(framework_evdev_intrfunc cbfunc, void *ctx)
+framework_evdev_setintrfunc(framework_evdev_intrfunc cbfunc,
+			    framework_evdev_checkfunc checkfunc, void *ctx)
 {
+	struct framework_evdev_intr_t *intr = NULL, *old = NULL;
+
+	if (0 == framework_evdev.state)
+		return;
+
+	if (cbfunc) {
+		intr = malloc(sizeof(struct framework_evdev_intr_t),
+			      M_FRAMEWORK, M_WAITOK | M_ZERO);
+		intr->cbfunc = cbfunc;
+		intr->checkfunc = checkfunc;
+		intr->ctx = ctx;
+	}
+
 	FRAMEWORK_EVDEV_LOCK(&framework_evdev);
-	framework_evdev.cbfunc = cbfunc;
-	framework_evdev.cbctx = ctx;
+	old = framework_evdev.intr;
+	atomic_store_rel_ptr((uintptr_t *)&framework_evdev.intr,
+			     (uintptr_t)intr);
 	FRAMEWORK_EVDEV_UNLOCK(&framework_evdev);
+
+	if (old) {
+		epoch_wait_preempt(framework_evdev.epoch);
+		free(old, M_FRAMEWORK);
+	}
+}
+
+/*
+ * Set minimum interval between interrupt callbacks per binding
+ *
+ * Input that checkfunc does not need is coalesced within the interval;
+ * 0 runs the callback for every input.
+ */
+void
+framework_evdev_setnotifyinterval(uint32_t interval_ms)
+{
+	atomic_store_int(&framework_evdev_notify_interval, interval_ms);
+}
+
+uint32_t
+framework_evdev_getnotifyinterval(void)
+{
+	return (atomic_load_int(&framework_evdev_notify_interval));
 }
 
 /*
@@ -258,44 +884,116 @@ framework_evdev_setintrfunc(framework_evdev_intrfunc cbfunc, void *ctx)
 int
 framework_evdev_destroy(void)
 {
-	struct framework_evdev_binding_t *binding = NULL;
+	struct framework_evdev_unbind_list unbind;
+	struct framework_evdev_binding_t *binding = NULL, *tmp = NULL;
+	struct framework_evdev_intr_t *intr = NULL;
 
 	if (0 == framework_evdev.state)
 		return 0;
 
+	/* no more hotplug processing */
+	EVENTHANDLER_DEREGISTER(device_attach, framework_evdev.attach_tag);
+	framework_evthread_sethotplug(NULL, NULL);
+
+	/* take over all bindings, nobody else sees them after this */
+	SLIST_INIT(&unbind);
 	TRACE("evdev destroy lock\n");
 	FRAMEWORK_EVDEV_LOCK(&framework_evdev);
-	framework_evdev.cbfunc = NULL;
+	framework_evdev.state = 0;
+	intr = framework_evdev.intr;
+	atomic_store_rel_ptr((uintptr_t *)&framework_evdev.intr, 0);
 	framework_evdev.active = 0;
-
-	while (!LIST_EMPTY(&framework_evdev.bindings)) {
-		binding = LIST_FIRST(&framework_evdev.bindings);
-		LIST_REMOVE(binding, entries);
-		TRACE("evdev destroying binding %p\n", binding);
-
-		/* Unregister client before destroying the binding */
-		if (binding->listener_thread) {
-			TRACE("evdev unlocking, destroying thread\n");
-			FRAMEWORK_EVDEV_UNLOCK(&framework_evdev);
-			framework_evthread_unregisterclient(binding->listener_thread, binding->evdev_device);
-			framework_evthread_destroy(binding->listener_thread);
-			binding->listener_thread = NULL;
-
-			TRACE("evdev relocking\n");
-			FRAMEWORK_EVDEV_LOCK(&framework_evdev);
-		} else {
-			ERROR("evdev listener thread unavailable\n");
-		}
-					
-		binding->evdev_device = NULL;
-		free(binding, M_FRAMEWORK);
+	CK_LIST_FOREACH_SAFE(binding, &framework_evdev.bindings, entries, tmp) {
+		CK_LIST_REMOVE(binding, entries);
+		SLIST_INSERT_HEAD(&unbind, binding, unbind_entry);
 	}
 	FRAMEWORK_EVDEV_UNLOCK(&framework_evdev);
 	TRACE("evdev destroy unlock\n");
-	
+
+	framework_evdev_unbind(&framework_evdev, &unbind);
+
+	framework_evthread_listener_destroy();
+
+	epoch_wait_preempt(framework_evdev.epoch);
+	free(intr, M_FRAMEWORK);
+	epoch_free(framework_evdev.epoch);
 	mtx_destroy(&framework_evdev.lock);
 
-	framework_evdev.state = 0;
-	
 	return 0;
 }
+
+/*
+ * Print input events per device
+ */
+static int
+framework_evdev_sysctl_inputs(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_evdev_binding_t *binding = NULL;
+	struct epoch_tracker et;
+	struct sbuf *sb;
+	int error = 0;
+
+	/* no page faults while within the epoch */
+	error = sysctl_wire_old_buffer(req, 0);
+	if (0 != error)
+		return (error);
+
+	sb = sbuf_new_for_sysctl(NULL, NULL, 256, req);
+	if (NULL == sb)
+		return (ENOMEM);
+
+	sbuf_printf(sb, "%-32s %10s", "device", "inputs");
+
+	if (framework_evdev.state) {
+		epoch_enter_preempt(framework_evdev.epoch, &et);
+		CK_LIST_FOREACH(binding, &framework_evdev.bindings, entries) {
+			sbuf_printf(sb, "\n%-32.32s %10ju", binding->name,
+				    (uintmax_t)counter_u64_fetch(binding->inputs));
+		}
+		epoch_exit_preempt(framework_evdev.epoch, &et);
+	}
+
+	error = sbuf_finish(sb);
+	sbuf_delete(sb);
+
+	return (error);
+}
+
+void
+framework_evdev_sysctl_init(struct sysctl_ctx_list *ctx,
+			    struct sysctl_oid *root,
+			    struct sysctl_oid *stats)
+{
+	framework_evdev.input_tree =
+		SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(root), OID_AUTO, "input",
+				CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				"Statistics per input device");
+	framework_evthread_sysctl_init(ctx, root);
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(stats), OID_AUTO, "devices",
+			CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_evdev_sysctl_inputs, "A",
+			"Input events per device");
+}
+
+void
+framework_evdev_zerocounters(void)
+{
+	struct framework_evdev_binding_t *binding = NULL;
+	struct epoch_tracker et;
+
+	if (0 == framework_evdev.state)
+		return;
+
+	epoch_enter_preempt(framework_evdev.epoch, &et);
+	CK_LIST_FOREACH(binding, &framework_evdev.bindings, entries) {
+		counter_u64_zero(binding->inputs);
+		counter_u64_zero(binding->callbacks);
+		counter_u64_zero(binding->callback_ns);
+		if (binding->overflows)
+			counter_u64_zero(binding->overflows);
+		if (binding->filtered)
+			counter_u64_zero(binding->filtered);
+	}
+	epoch_exit_preempt(framework_evdev.epoch, &et);
+}
@@ -32,6 +32,7 @@
 #define __FRAMEWORK_EVDEV_H__
 
 #include <sys/types.h>
+#include <sys/counter.h>
 #include <sys/malloc.h>
 #include <sys/param.h>
 #include <sys/kernel.h>
@@ -41,22 +42,55 @@
 #include <sys/systm.h>
 #include <sys/proc.h>
 #include <sys/queue.h>
+#include <sys/ck.h>
+#include <sys/sysctl.h>
 
 #include "framework_evdev_thread.h"
 
 /*
  * Callback prototype for interrupt function
  */
-typedef void(*framework_evdev_intrfunc)(void *, uint16_t *);
+typedef void(*framework_evdev_intrfunc)(void *, const uint16_t *, size_t);
+
+/*
+ * Tells whether input needs the interrupt function, must not sleep
+ */
+typedef bool(*framework_evdev_checkfunc)(void *, const uint16_t *, size_t);
 
 /*
  * A bound evdev device
+ *
+ * Bindings are added and removed under the evdev lock and read within
+ * the evdev epoch; a removed binding is freed once the epoch drained.
+ * The statistics fields are written without a lock, only by the input
+ * delivery of the device, and exported below hw.framework.input.
  */
 struct framework_evdev_binding_t {
 	struct framework_evdev_thread_t *listener_thread;
-	struct evdev_dev *evdev_device;
+	struct evdev_dev *evdev_device;  /* not to be used once revoked */
+	char name[NAMELEN];              /* device name when bound */
+	char shortname[NAMELEN];         /* device short name when bound */
+	uint16_t vendor;                 /* device vendor ID */
+	uint16_t product;                /* device product ID */
+
+	counter_u64_t inputs;            /* input events from this device */
+	counter_u64_t callbacks;         /* interrupt callbacks run */
+	counter_u64_t callback_ns;       /* time spent in them */
+	counter_u64_t overflows;         /* owned by listener_thread */
+	counter_u64_t filtered;          /* owned by listener_thread */
+	volatile uint64_t last_notify;   /* sbinuptime() of last callback */
+	volatile uint64_t last_input;    /* sbinuptime() of last input */
+
+	/* input events per second, see framework_evdev_rate */
+	volatile uint64_t rate_second;   /* second of uptime being counted */
+	volatile uint64_t rate_count;    /* events within rate_second */
+	volatile uint64_t rate_avg;      /* moving average, fixed point */
 
-	LIST_ENTRY(framework_evdev_binding_t) entries;
+	char sysctl_name[NAMELEN];       /* node below hw.framework.input */
+	struct sysctl_ctx_list sysctl_ctx;
+
+	CK_LIST_ENTRY(framework_evdev_binding_t) entries;
+	SLIST_ENTRY(framework_evdev_binding_t) unbind_entry;
 };
 
 struct framework_evdev_t;
@@ -64,11 +98,29 @@ struct framework_evdev_t;
 /* Initialize evdev system */
 int framework_evdev_init(void);
 
-/* Get boot time seconds when last input occurred */
-time_t framework_evdev_getlastinput(void);
+/* Get sbinuptime() when last input occurred, 0 if none yet */
+sbintime_t framework_evdev_getlastinput(void);
 
 /* Set interrupt callback function */
-void framework_evdev_setintrfunc(framework_evdev_intrfunc cbfunc, void *);
+void framework_evdev_setintrfunc(framework_evdev_intrfunc cbfunc,
+				 framework_evdev_checkfunc checkfunc, void *);
+
+/* Set minimum interval between callbacks for continuous input */
+void framework_evdev_setnotifyinterval(uint32_t interval_ms);
+
+/* Get minimum interval between callbacks in milliseconds */
+uint32_t framework_evdev_getnotifyinterval(void);
+
+/* Bind and release devices according to changed match lists */
+void framework_evdev_rematch(void);
+
+/* Add per device statistics below stats and a node per device below root */
+void framework_evdev_sysctl_init(struct sysctl_ctx_list *ctx,
+				 struct sysctl_oid *root,
+				 struct sysctl_oid *stats);
+
+/* Clear per device statistics */
+void framework_evdev_zerocounters(void);
 
 /* Destroy evdev system */
 int framework_evdev_destroy(void);
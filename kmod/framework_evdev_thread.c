@@ -37,68 +37,359 @@
 #include <sys/kthread.h>
 #include <sys/systm.h>
 #include <sys/proc.h>
+#include <sys/queue.h>
+#include <sys/sdt.h>
 #include <sys/conf.h>
+#include <sys/epoch.h>
+#include <sys/event.h>
+#include <sys/eventvar.h>
 
+#include <machine/atomic.h>
+
+#include "framework_counters.h"
 #include "framework_evdev_thread.h"
+#include "framework_latency.h"
+#include "framework_lockstat.h"
 #include "framework_sysctl.h"
 #include "framework_utils.h"
+#include "framework_wakeup.h"
 
 #include <dev/evdev/evdev_private.h>
 #include <fs/devfs/devfs_int.h>
 
 /*
- * Event thread structure
+ * Event session, one per bound evdev device
+ *
+ * Sessions have no thread of their own.  A knote on the client's
+ * selinfo is run by evdev's event delivery, drains the ring and, for
+ * input that counts as activity, queues the session and wakes the
+ * shared listener thread.  In direct mode, the knote hands input to
+ * notifyfunc instead and only queues the session when that asks for
+ * the deferred callback.
  */
 struct framework_evdev_thread_t {
 	struct mtx session;      /* session lock */
 
-	uint8_t active;          /* flag whether thread should remain active */
+	uint8_t active;          /* (s) flag whether session accepts input */
 
 	/* evdev_client.ec_buffer_mtx used as lock mechanism for structure! */
 	struct evdev_client *evdev_client;    /* client structure */
 
 	void *ctx;
 
-	framework_evdev_thread_cbfunc cbfunc; /* callback function */
+	framework_evdev_thread_cbfunc cbfunc; /* (s) callback function */
+	framework_evdev_thread_notifyfunc notifyfunc; /* (s) direct mode */
+	framework_evdev_thread_cbfunc deferfunc; /* (s) deferred callback */
+
+	uint8_t flags;                        /* (s) */
+
+	struct knote knote;                   /* (c) event notification */
 
-	uint8_t flags;
+	bool revoked;                         /* (c) device went away */
+	counter_u64_t overflows;              /* ring overflows */
+
+	/*
+	 * Ring sizing, see framework_evthread_adapt.  The statistics
+	 * are also read without a lock.
+	 */
+	size_t report_size;                   /* events per device report */
+	u_int ring_reports;                   /* (c) ring size in reports */
+	u_int highwater;                      /* (c) most events queued */
+	u_int resizes;                        /* (c) ring replacements */
+	u_int check_highwater;                /* (c) since last check */
+	bool check_overflow;                  /* (c) since last check */
+	bool resize;                          /* (c) check requested */
+	sbintime_t resize_check;              /* (c) time of last check */
+	/*
+	 * Significance filter, see framework_evthread_significant.
+	 */
+	u_int class;                          /* device class, set at init */
+	int64_t rel_motion[REL_HWHEEL];       /* (c) since last significant */
+	int32_t abs_anchor[ABS_MT_SLOT];      /* (c) at last significant */
+	uint64_t abs_seen;                    /* (c) axes with an anchor */
+	counter_u64_t filtered;               /* events discarded */
+
+	bool input;                           /* (c) queued for cbfunc */
+	bool deferred;                        /* (c) queued by notifyfunc */
+	size_t deferred_nkeys;                /* (c) */
+	uint16_t deferred_keys[FRAMEWORK_EVTHREAD_MAXKEYS]; /* (c) for deferfunc */
+
+	STAILQ_ENTRY(framework_evdev_thread_t) pending_entry; /* (l) */
+	bool pending;                         /* (l) queued on listener */
+	sbintime_t notified;                  /* (l) time input was queued */
+
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;         /* ec_buffer_mtx acquisition time */
+	sbintime_t lockstat_session_stamp; /* session acquisition time */
+#endif
 };
 
-#define FRAMEWORK_EVTHREAD_LOCK(x) mtx_lock(&x->evdev_client->ec_buffer_mtx)
-#define FRAMEWORK_EVTHREAD_UNLOCK(x) mtx_unlock(&x->evdev_client->ec_buffer_mtx)
-#define FRAMEWORK_EVSESSION_LOCK(x) mtx_lock(&x->session)
-#define FRAMEWORK_EVSESSION_UNLOCK(x) mtx_unlock(&x->session)
+/*
+ * Listener thread serving all sessions
+ */
+static struct framework_evdev_listener_t {
+	STAILQ_HEAD(, framework_evdev_thread_t) pending; /* (l) with input */
+
+	/* (l) session whose input is being dispatched */
+	struct framework_evdev_thread_t *current;
+
+	uint8_t active;          /* (l) flag whether thread should remain active */
+	uint8_t running;         /* (l) thread has not exited yet */
+
+	framework_evdev_thread_hotplugfunc hotplugfunc; /* (l) */
+	void *hotplugctx;        /* (l) */
+	bool hotplug;            /* (l) hotplugfunc requested */
+	bool inhotplug;          /* (l) hotplugfunc running */
+
+	/*
+	 * knote() locks the queue of a knote around its filter.  Our
+	 * knotes never activate; this queue only provides that lock.
+	 */
+	struct kqueue kq;
+
+	struct framework_wakeup_t *wakeup;    /* wakeup accounting */
+
+	struct mtx lock;         /* l - lock mechanism */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;            /* (l) lock acquisition time */
+#endif
+} framework_evdev_listener;
+
+#define FRAMEWORK_EVTHREAD_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_EVTHREAD, \
+				    &(x)->evdev_client->ec_buffer_mtx, \
+				    &(x)->lockstat_stamp)
+#define FRAMEWORK_EVTHREAD_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_EVTHREAD, \
+				      &(x)->evdev_client->ec_buffer_mtx, \
+				      &(x)->lockstat_stamp)
+#define FRAMEWORK_EVSESSION_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_EVSESSION, \
+				    &(x)->session, &(x)->lockstat_session_stamp)
+#define FRAMEWORK_EVSESSION_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_EVSESSION, \
+				      &(x)->session, \
+				      &(x)->lockstat_session_stamp)
+#define FRAMEWORK_EVLISTENER_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_EVLISTENER, \
+				    &(x)->lock, &(x)->lockstat_stamp)
+#define FRAMEWORK_EVLISTENER_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_EVLISTENER, \
+				      &(x)->lock, &(x)->lockstat_stamp)
 
 #define FRAMEWORK_EVSESSION_FLAG_CLIENTREG 1
 #define FRAMEWORK_EVSESSION_FLAG_KQUEUE 2
-#define FRAMEWORK_EVSESSION_FLAG_THREAD 4
-#define FRAMEWORK_EVSESSION_FLAG_SHUTDOWN 8 
+#define FRAMEWORK_EVSESSION_FLAG_KNOTE 4
 
 MALLOC_DECLARE(M_FRAMEWORK);
 
+/* notify sessions from evdev's event delivery, see setdirect */
+static u_int framework_evthread_direct = 0;
+
 /*
- * attempts to read key code, returns true on success
+ * Significance filter of a device class
+ *
+ * types has a bit per event type that counts as activity.  threshold
+ * is the motion an axis needs to count, in device units: summed up
+ * for relative axes, away from the last counted value for absolute
+ * axes.  Both are read without a lock.
+ */
+static struct framework_evthread_filter_t {
+	const char *name;
+	u_int types;
+	u_int threshold;
+} framework_evthread_filters[FRAMEWORK_EVTHREAD_CLASS_COUNT] = {
+	[FRAMEWORK_EVTHREAD_CLASS_KEYBOARD] = {
+		"keyboard", 1 << EV_KEY, 0 },
+	[FRAMEWORK_EVTHREAD_CLASS_MOUSE] = {
+		"mouse", 1 << EV_KEY | 1 << EV_REL, 2 },
+	[FRAMEWORK_EVTHREAD_CLASS_TOUCHPAD] = {
+		"touchpad", 1 << EV_KEY | 1 << EV_ABS, 8 },
+};
+
+SDT_PROVIDER_DECLARE(framework);
+SDT_PROBE_DEFINE1(framework, evdev, thread, wakeup, "int");
+
+/*
+ * Append a key to a batch, counting keys that do not fit
+ */
+static void
+framework_evthread_addkey(uint16_t *keys, size_t *nkeys, uint16_t keycode)
+{
+	if (*nkeys >= FRAMEWORK_EVTHREAD_MAXKEYS) {
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_KEY_OVERFLOW);
+		return;
+	}
+
+	keys[(*nkeys)++] = keycode;
+}
+
+/*
+ * Pick the device class from the event types evdev supports
+ *
+ * Touchpads and touchscreens report absolute axes, mice relative ones;
+ * anything else is judged as a keyboard.
+ */
+static u_int
+framework_evthread_classify(struct evdev_dev *evdev)
+{
+	if (NULL == evdev)
+		return (FRAMEWORK_EVTHREAD_CLASS_KEYBOARD);
+	if (evdev_event_supported(evdev, EV_ABS))
+		return (FRAMEWORK_EVTHREAD_CLASS_TOUCHPAD);
+	if (evdev_event_supported(evdev, EV_REL))
+		return (FRAMEWORK_EVTHREAD_CLASS_MOUSE);
+	return (FRAMEWORK_EVTHREAD_CLASS_KEYBOARD);
+}
+
+/*
+ * Tell whether an event counts as activity, called with the client
+ * buffer lock held
+ *
+ * Jitter of a resting finger or a shaking desk moves an axis back
+ * and forth; motion only counts once it adds up to the threshold of
+ * the device class.  Wheels and other discrete relative axes count
+ * on every event.  Multitouch axes report per contact and are judged
+ * by the single touch axes evdev derives from them instead; a contact
+ * starting or ending counts.
  */
 static bool
-framework_evthread_readkeycode(struct evdev_client *client,
-			       uint16_t *keycode)
+framework_evthread_significant(struct framework_evdev_thread_t *ethread,
+			       const struct input_event *event)
 {
-	if (!client->ec_buffer[client->ec_buffer_head].value)
-		return false;
-	if (!client->ec_buffer[client->ec_buffer_head].code)
+	struct framework_evthread_filter_t *filter = NULL;
+	int64_t motion = 0;
+
+	filter = &framework_evthread_filters[ethread->class];
+	if (event->type >= EV_CNT ||
+	    !(atomic_load_int(&filter->types) & (1u << event->type)))
 		return false;
 
-	*keycode = client->ec_buffer[client->ec_buffer_head].code;
-	return true;
+	switch (event->type) {
+	case EV_REL:
+		if (event->code >= REL_HWHEEL)
+			return true;
+		/* 64 bit, so hostile values cannot overflow the sum */
+		motion = ethread->rel_motion[event->code] + event->value;
+		if (llabs(motion) < atomic_load_int(&filter->threshold)) {
+			ethread->rel_motion[event->code] = motion;
+			return false;
+		}
+		ethread->rel_motion[event->code] = 0;
+		return true;
+	case EV_ABS:
+		if (ABS_MT_TRACKING_ID == event->code)
+			return true;
+		if (event->code >= ABS_MT_SLOT)
+			return false;
+		motion = (int64_t)event->value -
+			ethread->abs_anchor[event->code];
+		if ((ethread->abs_seen & (1ull << event->code)) &&
+		    llabs(motion) < atomic_load_int(&filter->threshold))
+			return false;
+		ethread->abs_anchor[event->code] = event->value;
+		ethread->abs_seen |= 1ull << event->code;
+		return true;
+	default:
+		return true;
+	}
+}
+
+/*
+ * Consume all completed reports in the ring, returns whether any
+ * event counts as activity
+ *
+ * Key presses and repeats of significant events are appended to keys.
+ * Events of a report still being written, past ec_buffer_ready, stay
+ * in the ring.  An overflow always counts, the input it lost may have.
+ */
+static bool
+framework_evthread_drain(struct framework_evdev_thread_t *ethread,
+			 uint16_t *keys, size_t *nkeys)
+{
+	struct evdev_client *client = ethread->evdev_client;
+	struct input_event *event = NULL;
+	size_t head = client->ec_buffer_head;
+	u_int filtered = 0;
+	bool significant = false;
+	u_int queued = (client->ec_buffer_ready + client->ec_buffer_size -
+			head) % client->ec_buffer_size;
+
+	if (queued > ethread->highwater)
+		atomic_store_int(&ethread->highwater, queued);
+	if (queued > ethread->check_highwater)
+		ethread->check_highwater = queued;
+
+	while (head != client->ec_buffer_ready) {
+		event = &client->ec_buffer[head];
+		TRACE("evdev thread event type=%d, code=%d, value=%d\n",
+		      event->type, event->code, event->value);
+
+		if (EV_SYN == event->type && SYN_DROPPED == event->code) {
+			FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_SYN_DROPPED);
+			counter_u64_add(ethread->overflows, 1);
+			ethread->check_overflow = true;
+			significant = true;
+		} else if (!framework_evthread_significant(ethread, event)) {
+			filtered++;
+		} else {
+			significant = true;
+			if (EV_KEY == event->type && 0 != event->value)
+				framework_evthread_addkey(keys, nkeys,
+							  event->code);
+		}
+
+		head = (head + 1) % client->ec_buffer_size;
+	}
+
+	client->ec_buffer_head = head;
+
+	if (filtered) {
+		counter_u64_add(framework_counters[FRAMEWORK_COUNTER_FILTERED],
+				filtered);
+		counter_u64_add(ethread->filtered, filtered);
+	}
+
+	return significant;
 }
 
 /*
- * Clean up kqueue
+ * Ask the listener thread for a ring size check, called with the
+ * client buffer lock held after draining
+ *
+ * A check is due right away when the ring overflowed or ran more than
+ * 3/4 full, otherwise once per FRAMEWORK_EVTHREAD_RESIZE_INTERVAL.
  */
 static void
-framework_evthread_clearkqueue(struct evdev_client *client)
+framework_evthread_checkring(struct framework_evdev_thread_t *ethread)
 {
-	TRACE("evdev thread clear kqueue begin\n");
+	size_t capacity = ethread->evdev_client->ec_buffer_size;
+	bool grow = false, shrink = false;
+
+	if (ethread->resize)
+		return;
+
+	grow = (ethread->check_overflow ||
+		4 * ethread->check_highwater > 3 * capacity) &&
+		ethread->ring_reports < FRAMEWORK_EVTHREAD_RING_MAX;
+	shrink = !grow &&
+		ethread->ring_reports > FRAMEWORK_EVTHREAD_RING_MIN &&
+		sbinuptime() - ethread->resize_check >=
+		FRAMEWORK_EVTHREAD_RESIZE_INTERVAL;
+	if (!grow && !shrink)
+		return;
+
+	ethread->resize = true;
+	framework_evthread_hotplug();
+}
+
+/*
+ * Discard buffered events
+ */
+static void
+framework_evthread_clearbuffer(struct evdev_client *client)
+{
+	TRACE("evdev thread clear buffer begin\n");
 	/* analyze contents of buffer */
 	/*
 	 * code == 224 brightness lower,
@@ -114,11 +405,26 @@ framework_evthread_clearkqueue(struct evdev_client *client)
 	client->ec_buffer_head = client->ec_buffer_tail =
 		client->ec_buffer_ready = 0;
 	client->ec_clock_id = 0;
-	
-	if (!knlist_empty(&client->ec_selp.si_note)) {
-		knlist_clear(&client->ec_selp.si_note, true);
-	}
-	TRACE("evdev thread clear kqueue end\n");
+	TRACE("evdev thread clear buffer end\n");
+}
+
+/*
+ * Tell why msleep returned, called with the listener lock held
+ */
+static enum framework_wakeup_reason_t
+framework_evthread_wakereason(struct framework_evdev_listener_t *listener,
+			      int error)
+{
+	if (0 != error)
+		return FRAMEWORK_WAKEUP_SPURIOUS;
+	if (!listener->active)
+		return FRAMEWORK_WAKEUP_SHUTDOWN;
+	if (listener->hotplug)
+		return FRAMEWORK_WAKEUP_HOTPLUG;
+	if (!STAILQ_EMPTY(&listener->pending))
+		return FRAMEWORK_WAKEUP_INPUT;
+
+	return FRAMEWORK_WAKEUP_SPURIOUS;
 }
 
 /*
@@ -137,115 +443,655 @@ framework_evthread_getflags(struct framework_evdev_thread_t *ethread)
 }
 
 /*
- * Thread event handler
+ * Queue a session with input for the listener thread
+ */
+static void
+framework_evthread_enqueue(struct framework_evdev_thread_t *ethread)
+{
+	struct framework_evdev_listener_t *listener = &framework_evdev_listener;
+
+	FRAMEWORK_EVLISTENER_LOCK(listener);
+	if (!ethread->pending) {
+		ethread->pending = true;
+		ethread->notified = sbinuptime();
+		if (STAILQ_EMPTY(&listener->pending))
+			wakeup(listener);
+		STAILQ_INSERT_TAIL(&listener->pending, ethread, pending_entry);
+	}
+	FRAMEWORK_EVLISTENER_UNLOCK(listener);
+}
+
+/*
+ * Knote filter, run by evdev with the client buffer lock held
+ */
+static int
+framework_evthread_kqevent(struct knote *kn, long hint __unused)
+{
+	struct framework_evdev_thread_t *ethread = kn->kn_hook;
+	framework_evdev_thread_notifyfunc local_notifyfunc = NULL;
+	uint16_t keys[FRAMEWORK_EVTHREAD_MAXKEYS];
+	size_t nkeys = 0;
+	bool significant = false;
+
+	/*
+	 * evdev_unregister() revokes its clients before the device is
+	 * freed; forget the device and have the listener unbind us.
+	 */
+	if (ethread->evdev_client->ec_revoked) {
+		if (!ethread->revoked) {
+			ethread->revoked = true;
+			ethread->evdev_client->ec_evdev = NULL;
+			framework_evthread_hotplug();
+		}
+		return 0;
+	}
+
+	/* input without significance takes no further lock */
+	significant = framework_evthread_drain(ethread, keys, &nkeys);
+	framework_evthread_checkring(ethread);
+	if (!significant)
+		return 0;
+
+	if (atomic_load_int(&framework_evthread_direct)) {
+		FRAMEWORK_EVSESSION_LOCK(ethread);
+		local_notifyfunc = ethread->active ? ethread->notifyfunc : NULL;
+		FRAMEWORK_EVSESSION_UNLOCK(ethread);
+	}
+
+	if (local_notifyfunc) {
+		if (!local_notifyfunc(ethread->ctx, keys, nkeys))
+			return 0;
+		ethread->deferred = true;
+	} else
+		ethread->input = true;
+
+	/* add to keys still waiting for the listener */
+	for (size_t i = 0; i < nkeys; i++)
+		framework_evthread_addkey(ethread->deferred_keys,
+					  &ethread->deferred_nkeys, keys[i]);
+
+	framework_evthread_enqueue(ethread);
+
+	/* nothing to activate */
+	return 0;
+}
+
+static struct filterops framework_evthread_filtops = {
+	.f_isfd = 0,
+	.f_event = framework_evthread_kqevent,
+};
+
+/*
+ * Listener thread, dispatches input of all sessions
  */
 static void
 framework_evthread_func(void *data)
 {
-	struct framework_evdev_thread_t *edata = data;
-	uint8_t local_active = true;
-	int error = 0;
+	struct framework_evdev_listener_t *listener = data;
+	struct framework_evdev_thread_t *edata = NULL;
 	framework_evdev_thread_cbfunc local_cbfunc;
-	uint16_t keycode = 0;
-	bool have_keycode = false;
+	framework_evdev_thread_hotplugfunc local_hotplugfunc;
+	void *local_hotplugctx;
+	uint16_t keys[FRAMEWORK_EVTHREAD_MAXKEYS];
+	size_t nkeys = 0;
+	bool deferred = false, input = false;
+	sbintime_t notified = 0;
+	int error = 0;
 
-	TRACE("Started evdev thread with edata = %p.\n", edata);
+	TRACE("Started evdev listener thread.\n");
 
-	/* add THREAD flag */
-	FRAMEWORK_EVSESSION_LOCK(edata);
-	TRACE("evdev thread adding THREAD flag\n");
-	edata->flags |= FRAMEWORK_EVSESSION_FLAG_THREAD;
-	FRAMEWORK_EVSESSION_UNLOCK(edata);
+	FRAMEWORK_EVLISTENER_LOCK(listener);
+	while (listener->active) {
+		if (listener->hotplug) {
+			listener->hotplug = false;
+			local_hotplugfunc = listener->hotplugfunc;
+			local_hotplugctx = listener->hotplugctx;
+			listener->inhotplug = true;
+			FRAMEWORK_EVLISTENER_UNLOCK(listener);
 
-	while (local_active) {
-		/* Need to reset blocked to ensure we are woken up on next signal */
-		FRAMEWORK_EVTHREAD_LOCK(edata);
-		if (!edata->active) {
-			/* We got exit */
-			FRAMEWORK_EVTHREAD_UNLOCK(edata);
-			ERROR("evdev thread jumping the shark\n");
-			break;
+			if (local_hotplugfunc)
+				local_hotplugfunc(local_hotplugctx);
+
+			FRAMEWORK_EVLISTENER_LOCK(listener);
+			listener->inhotplug = false;
+			wakeup(&listener->inhotplug);
+			continue;
 		}
-		
-		TRACE("evdev thread mtx sleep begin\n");
-		edata->evdev_client->ec_blocked = true;
-		error = msleep(edata->evdev_client,
-			       &edata->evdev_client->ec_buffer_mtx,
-			       0, "sigwait", 0);
-		TRACE("evdev thread mtx sleep awoken\n");
-		
-		if (0 != error) {
-			ERROR("failed to mutex sleep in thread");
-		} else {
-			/* read any relevant keycode first */
-			have_keycode = framework_evthread_readkeycode(edata->evdev_client, &keycode);
-			
-			/* reset buffer position and clear kqueue */
-			framework_evthread_clearkqueue(edata->evdev_client);
-			
-			TRACE("evdev thread locking session\n");
-			FRAMEWORK_EVSESSION_LOCK(edata);
-			local_cbfunc = edata->cbfunc;
-			FRAMEWORK_EVSESSION_UNLOCK(edata);
-			TRACE("evdev thread unlocking session\n");
-			
-			/* moved back into lock */
-			if (local_cbfunc) {
-				/* direct to callback function */
-				TRACE("evdev thread callback begin\n");
-				FRAMEWORK_EVTHREAD_UNLOCK(edata);
-				edata->cbfunc(edata->ctx,
-					      have_keycode ? &keycode : NULL);
-				FRAMEWORK_EVTHREAD_LOCK(edata);
-				TRACE("evdev thread callback end\n");
-			}
+
+		if (STAILQ_EMPTY(&listener->pending)) {
+			TRACE("evdev thread mtx sleep begin\n");
+			FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_EVLISTENER,
+						 &listener->lockstat_stamp);
+			error = msleep(listener, &listener->lock, 0,
+				       "sigwait", 0);
+			FRAMEWORK_LOCKSTAT_WAKEUP(&listener->lockstat_stamp);
+			TRACE("evdev thread mtx sleep awoken\n");
+			SDT_PROBE1(framework, evdev, thread, wakeup, error);
+			framework_wakeup_count(listener->wakeup,
+					       framework_evthread_wakereason(listener,
+									     error));
+			continue;
 		}
 
-		local_active = edata->active;
+		edata = STAILQ_FIRST(&listener->pending);
+		STAILQ_REMOVE_HEAD(&listener->pending, pending_entry);
+		edata->pending = false;
+		notified = edata->notified;
+		listener->current = edata;
+		FRAMEWORK_EVLISTENER_UNLOCK(listener);
+
+		/* take input queued by the knote, then drain the ring */
+		FRAMEWORK_EVTHREAD_LOCK(edata);
+		deferred = edata->deferred;
+		input = edata->input;
+		nkeys = edata->deferred_nkeys;
+		memcpy(keys, edata->deferred_keys, nkeys * sizeof(keys[0]));
+		edata->deferred = false;
+		edata->input = false;
+		edata->deferred_nkeys = 0;
+		input |= framework_evthread_drain(edata, keys, &nkeys);
+		framework_evthread_checkring(edata);
 		FRAMEWORK_EVTHREAD_UNLOCK(edata);
+
+		TRACE("evdev thread locking session\n");
+		FRAMEWORK_EVSESSION_LOCK(edata);
+		if (!edata->active || (!deferred && !input))
+			local_cbfunc = NULL;
+		else
+			local_cbfunc = deferred ? edata->deferfunc : edata->cbfunc;
+		FRAMEWORK_EVSESSION_UNLOCK(edata);
+		TRACE("evdev thread unlocking session\n");
+
+		if (local_cbfunc) {
+			/* direct to callback function */
+			TRACE("evdev thread callback begin\n");
+			framework_latency_record(FRAMEWORK_LATENCY_WAKEUP,
+						 notified);
+			local_cbfunc(edata->ctx, keys, nkeys);
+			TRACE("evdev thread callback end\n");
+		}
+
+		FRAMEWORK_EVLISTENER_LOCK(listener);
+		listener->current = NULL;
+		wakeup(&listener->current);
+	}
+	TRACE("Shut down evdev listener thread.\n");
+
+	listener->running = false;
+	wakeup(&listener->running);
+	FRAMEWORK_EVLISTENER_UNLOCK(listener);
+
+	/* Terminate thread */
+	kthread_exit();
+}
+
+/*
+ * Start the listener thread
+ */
+int
+framework_evthread_listener_init(void)
+{
+	struct framework_evdev_listener_t *listener = &framework_evdev_listener;
+	int error = 0;
+
+	STAILQ_INIT(&listener->pending);
+	listener->current = NULL;
+	listener->hotplugfunc = NULL;
+	listener->hotplugctx = NULL;
+	listener->hotplug = false;
+	listener->inhotplug = false;
+	listener->active = true;
+	listener->running = true;
+	listener->wakeup = framework_wakeup_register("evdev listener");
+
+	mtx_init(&listener->lock, "framework_evdev_listener", NULL, MTX_DEF);
+	mtx_init(&listener->kq.kq_lock, "framework_evdev_kqueue", NULL,
+		 MTX_DEF | MTX_DUPOK);
+
+	error = kthread_add(framework_evthread_func, listener, NULL,
+			    NULL, 0, 0, "framework_evdev_thread");
+	if (0 != error) {
+		ERROR("kthread_add returned error code %d\n", error);
+		listener->running = false;
+		framework_evthread_listener_destroy();
+	}
+
+	return error;
+}
+
+/*
+ * Stop the listener thread, all sessions must be destroyed
+ */
+void
+framework_evthread_listener_destroy(void)
+{
+	struct framework_evdev_listener_t *listener = &framework_evdev_listener;
+
+	FRAMEWORK_EVLISTENER_LOCK(listener);
+	listener->active = false;
+	wakeup(listener);
+	while (listener->running) {
+		TRACE("evdev listener waiting for thread completion\n");
+		FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_EVLISTENER,
+					 &listener->lockstat_stamp);
+		msleep(&listener->running, &listener->lock, 0, "sigwait", 0);
+		FRAMEWORK_LOCKSTAT_WAKEUP(&listener->lockstat_stamp);
+	}
+	if (!STAILQ_EMPTY(&listener->pending))
+		ERROR("evdev listener destroyed with sessions pending\n");
+	FRAMEWORK_EVLISTENER_UNLOCK(listener);
+
+	framework_wakeup_unregister(listener->wakeup);
+	listener->wakeup = NULL;
+
+	mtx_destroy(&listener->kq.kq_lock);
+	mtx_destroy(&listener->lock);
+}
+
+/*
+ * Set the callback run for device arrival and departure
+ *
+ * Clearing it waits for a running callback to return.
+ */
+void
+framework_evthread_sethotplug(framework_evdev_thread_hotplugfunc func,
+			      void *ctx)
+{
+	struct framework_evdev_listener_t *listener = &framework_evdev_listener;
+
+	FRAMEWORK_EVLISTENER_LOCK(listener);
+	listener->hotplugfunc = func;
+	listener->hotplugctx = ctx;
+	while (NULL == func && listener->inhotplug) {
+		TRACE("evdev listener waiting for hotplug completion\n");
+		FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_EVLISTENER,
+					 &listener->lockstat_stamp);
+		msleep(&listener->inhotplug, &listener->lock, 0, "sigwait", 0);
+		FRAMEWORK_LOCKSTAT_WAKEUP(&listener->lockstat_stamp);
+	}
+	FRAMEWORK_EVLISTENER_UNLOCK(listener);
+}
+
+/*
+ * Request the hotplug callback, must not sleep
+ */
+void
+framework_evthread_hotplug(void)
+{
+	struct framework_evdev_listener_t *listener = &framework_evdev_listener;
+
+	FRAMEWORK_EVLISTENER_LOCK(listener);
+	if (!listener->hotplug) {
+		listener->hotplug = true;
+		wakeup(listener);
+	}
+	FRAMEWORK_EVLISTENER_UNLOCK(listener);
+}
+
+/*
+ * Ring overflows of the session, valid until it is destroyed
+ */
+counter_u64_t
+framework_evthread_overflows(struct framework_evdev_thread_t *ethread)
+{
+	return ethread->overflows;
+}
+
+/*
+ * Events discarded as insignificant, valid until the session is
+ * destroyed
+ */
+counter_u64_t
+framework_evthread_filtered(struct framework_evdev_thread_t *ethread)
+{
+	return ethread->filtered;
+}
+
+/*
+ * Device class of the session
+ */
+const char *
+framework_evthread_classname(struct framework_evdev_thread_t *ethread)
+{
+	return framework_evthread_filters[ethread->class].name;
+}
+
+/*
+ * Add hw.framework.filter with a node per device class
+ */
+void
+framework_evthread_sysctl_init(struct sysctl_ctx_list *ctx,
+			       struct sysctl_oid *parent)
+{
+	struct framework_evthread_filter_t *filter = NULL;
+	struct sysctl_oid *tree = NULL, *node = NULL;
+
+	tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+			       "filter", CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+			       "Input counting as activity");
+	if (NULL == tree)
+		return;
+
+	for (int i = 0; i < FRAMEWORK_EVTHREAD_CLASS_COUNT; i++) {
+		filter = &framework_evthread_filters[i];
+		node = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(tree), OID_AUTO,
+				       filter->name,
+				       CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				       "Device class");
+		if (NULL == node)
+			continue;
+
+		SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(node), OID_AUTO, "types",
+			       CTLFLAG_RWTUN | CTLFLAG_MPSAFE, &filter->types,
+			       0, "Event types counting as activity, bit per type");
+		SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(node), OID_AUTO,
+			       "threshold", CTLFLAG_RWTUN | CTLFLAG_MPSAFE,
+			       &filter->threshold, 0,
+			       "Axis motion counting as activity");
 	}
-	TRACE("Shut down evdev thread.\n");
+}
 
-	FRAMEWORK_EVSESSION_LOCK(edata);
-	TRACE("evdev thread adding SHUTDOWN flag\n");
-	edata->flags |= FRAMEWORK_EVSESSION_FLAG_SHUTDOWN;
-	FRAMEWORK_EVSESSION_UNLOCK(edata);
+/*
+ * Allocate an evdev client with a ring of buffer_size events
+ */
+static struct evdev_client *
+framework_evthread_newclient(size_t buffer_size, struct evdev_dev *evdev)
+{
+	struct evdev_client *client = NULL;
+
+	client = malloc(offsetof(struct evdev_client, ec_buffer) +
+			sizeof(struct input_event) * buffer_size,
+			M_FRAMEWORK,
+			M_WAITOK | M_ZERO);
+
+	client->ec_evdev = evdev;
 	
-	FRAMEWORK_EVTHREAD_LOCK(edata);
-	TRACE("evdev thread wakeup on evdev_client channel\n");
+	mtx_init(&client->ec_buffer_mtx,
+		 "framework_evdev_client", NULL, MTX_DEF);
 
-	FRAMEWORK_EVSESSION_LOCK(edata);
-	TRACE("evdev thread removing THREAD flag\n");
-	edata->flags &= ~(FRAMEWORK_EVSESSION_FLAG_THREAD);
-	FRAMEWORK_EVSESSION_UNLOCK(edata);
+	client->ec_buffer_size = buffer_size;
 	
-	wakeup(edata->evdev_client);
-	FRAMEWORK_EVTHREAD_UNLOCK(edata);
+	/* We are notified through the knote, not by wakeup(9) */
+	client->ec_blocked = false;
+	/* point selinfo mutex to client mutex */
+	client->ec_selp.si_mtx = &client->ec_buffer_mtx;
+	/* init knote list */
+	knlist_init_mtx(&client->ec_selp.si_note, &client->ec_buffer_mtx);
 
-	/* Terminate thread */
-	kthread_exit();
+	return client;
 }
 
+/*
+ * Free an evdev client no longer registered and without knote
+ */
 static void
-framework_evthread_dtor(void *data)
+framework_evthread_freeclient(struct evdev_client *client)
 {
-	struct evdev_client *client = (struct evdev_client *) data;
+	TRACE("evdev thread destroying knlist\n");
+	knlist_destroy(&client->ec_selp.si_note);
+	mtx_destroy(&client->ec_buffer_mtx);
+
+	TRACE("evdev thread freeing client\n");
+	free(client, M_FRAMEWORK);
+}
+
+/*
+ * Wait until event delivery is done with clients taken off evdev
+ *
+ * Like evdev_dtor(): devices not locked by their own mutex walk their
+ * client list within the input epoch.  Once the device is gone, its
+ * lock type is unknown and the epoch is waited for regardless.
+ */
+static void
+framework_evthread_waitdelivery(struct evdev_dev *evdev)
+{
+	if (NULL == evdev || EV_LOCK_MTX != evdev->ev_lock_type)
+		epoch_wait_preempt(INPUT_EPOCH);
+}
+
+/*
+ * Take a registered client off its device
+ *
+ * The client may be freed once this returns.  Clients revoked by
+ * evdev_unregister() are already off the device.
+ */
+static void
+framework_evthread_disposeclient(struct evdev_client *client)
+{
+	struct evdev_dev *evdev = NULL;
+
+	/* cleared once evdev revoked us, the device may be gone */
+	EVDEV_CLIENT_LOCKQ(client);
+	evdev = client->ec_evdev;
+	EVDEV_CLIENT_UNLOCKQ(client);
+
+	if (evdev) {
+		EVDEV_LIST_LOCK(evdev);
+		if (!client->ec_revoked) {
+			TRACE("evdev thread disposing evdev client\n");
+			evdev_dispose_client(evdev, client);
+			/* make sure we don't repeat disposal */
+			evdev_revoke_client(client);
+		}
+		EVDEV_LIST_UNLOCK(evdev);
+	}
+
+	framework_evthread_waitdelivery(evdev);
+}
+
+/*
+ * Report the ring of a session
+ */
+void
+framework_evthread_ringstats(struct framework_evdev_thread_t *ethread,
+			     struct framework_evthread_ringstats_t *stats)
+{
+	u_int reports = atomic_load_int(&ethread->ring_reports);
+
+	stats->events = reports * ethread->report_size;
+	stats->bytes = offsetof(struct evdev_client, ec_buffer) +
+		sizeof(struct input_event) * stats->events;
+	stats->highwater = atomic_load_int(&ethread->highwater);
+	stats->resizes = atomic_load_int(&ethread->resizes);
+}
+
+/*
+ * Count the events at the start of the new ring that also end the
+ * ready events of the old one
+ *
+ * While both clients are registered, a device delivering outside the
+ * list lock may push a report into both; the copies are identical
+ * down to the timestamp.  The old client must no longer be registered.
+ */
+static size_t
+framework_evthread_overlap(struct evdev_client *old, size_t oldn,
+			   struct evdev_client *client)
+{
+	size_t newn = (client->ec_buffer_ready + client->ec_buffer_size -
+		       client->ec_buffer_head) % client->ec_buffer_size;
+	struct input_event *a = NULL, *b = NULL;
+	size_t n = MIN(oldn, newn), i = 0;
+
+	for (; n > 0; n--) {
+		for (i = 0; i < n; i++) {
+			a = &old->ec_buffer[(old->ec_buffer_ready +
+					     old->ec_buffer_size - n + i) %
+					    old->ec_buffer_size];
+			b = &client->ec_buffer[(client->ec_buffer_head + i) %
+					       client->ec_buffer_size];
+			if (a->type != b->type || a->code != b->code ||
+			    a->value != b->value ||
+			    a->time.tv_sec != b->time.tv_sec ||
+			    a->time.tv_usec != b->time.tv_usec)
+				break;
+		}
+		if (i == n)
+			return n;
+	}
+
+	return 0;
+}
+
+/*
+ * Replace the evdev client of a session by one with a ring of the
+ * given number of reports, on the listener thread
+ *
+ * The new client is registered before the old one is disposed of, so
+ * no input is lost and the device stays open.  Input left in the old
+ * ring is handed to the next callback of the session, copies of it in
+ * the new ring are skipped.
+ */
+static void
+framework_evthread_resize(struct framework_evdev_thread_t *ethread,
+			  u_int reports)
+{
+	struct evdev_client *old = ethread->evdev_client, *client = NULL;
+	struct evdev_dev *evdev = NULL;
+	uint16_t keys[FRAMEWORK_EVTHREAD_MAXKEYS];
+	size_t nkeys = 0, oldn = 0, overlap = 0;
+	bool queued = false;
+	int error = 0;
+
+	if (!(framework_evthread_getflags(ethread) &
+	      FRAMEWORK_EVSESSION_FLAG_CLIENTREG))
+		return;
+
+	FRAMEWORK_EVTHREAD_LOCK(ethread);
+	evdev = old->ec_evdev;
+	FRAMEWORK_EVTHREAD_UNLOCK(ethread);
+	if (NULL == evdev)
+		return;
+
+	client = framework_evthread_newclient(ethread->report_size * reports,
+					      evdev);
+
+	EVDEV_LIST_LOCK(evdev);
+	if (old->ec_revoked) {
+		/* the device is going away, hotplug unbinds us */
+		EVDEV_LIST_UNLOCK(evdev);
+		framework_evthread_freeclient(client);
+		return;
+	}
+	error = evdev_register_client(evdev, client);
+	if (0 == error)
+		evdev_dispose_client(evdev, old);
+	EVDEV_LIST_UNLOCK(evdev);
+
+	if (0 != error) {
+		/* the old client stays registered */
+		ERROR("evdev ring resize failed with error %d\n", error);
+		framework_evthread_freeclient(client);
+		return;
+	}
+
+	/* wait for delivery still pushing into old */
+	framework_evthread_waitdelivery(evdev);
+
+	/* take the knote and what is left in the old ring */
+	FRAMEWORK_EVTHREAD_LOCK(ethread);
+	ethread->knote.kn_influx = 1;
+	knlist_remove(&old->ec_selp.si_note, &ethread->knote, 1);
+	ethread->knote.kn_influx = 0;
+	oldn = (old->ec_buffer_ready + old->ec_buffer_size -
+		old->ec_buffer_head) % old->ec_buffer_size;
+	queued = framework_evthread_drain(ethread, keys, &nkeys);
+	FRAMEWORK_EVTHREAD_UNLOCK(ethread);
+
+	/* only this thread uses evdev_client outside the knote */
+	ethread->evdev_client = client;
+	knlist_add(&client->ec_selp.si_note, &ethread->knote, 0);
+
+	FRAMEWORK_EVTHREAD_LOCK(ethread);
+	overlap = framework_evthread_overlap(old, oldn, client);
+	client->ec_buffer_head = (client->ec_buffer_head + overlap) %
+		client->ec_buffer_size;
+	for (size_t i = 0; i < nkeys; i++)
+		framework_evthread_addkey(ethread->deferred_keys,
+					  &ethread->deferred_nkeys, keys[i]);
+	ethread->input |= queued;
+	queued |= client->ec_buffer_head != client->ec_buffer_ready;
+	atomic_store_int(&ethread->ring_reports, reports);
+	atomic_store_int(&ethread->resizes, ethread->resizes + 1);
+	FRAMEWORK_EVTHREAD_UNLOCK(ethread);
+
+	if (queued)
+		framework_evthread_enqueue(ethread);
+
+	framework_evthread_freeclient(old);
+
+	DEBUG("evdev ring resized to %u reports, %zu events delivered twice\n",
+	      reports, overlap);
+}
+
+/*
+ * Resize the ring of a session if a check was requested
+ *
+ * Runs on the listener thread.  The ring doubles when input overflowed
+ * it or filled it more than 3/4, and halves when input did not fill a
+ * quarter of it since the last check.
+ */
+void
+framework_evthread_adapt(struct framework_evdev_thread_t *ethread)
+{
+	u_int reports = 0, highwater = 0;
+	size_t capacity = 0;
+	bool overflow = false;
 
-	TRACE("evdev thread dtor lock begin\n");
-	EVDEV_LIST_LOCK(client->ec_evdev);
-	if (!client->ec_revoked) {
-		evdev_dispose_client(client->ec_evdev, client);
+	if (NULL == ethread)
+		return;
 
-		TRACE("evdev thread revoking\n");	
-		/* make sure we don't repeat disposal */
-		evdev_revoke_client(client);
+	FRAMEWORK_EVTHREAD_LOCK(ethread);
+	if (!ethread->resize || ethread->revoked) {
+		FRAMEWORK_EVTHREAD_UNLOCK(ethread);
+		return;
 	}
-	EVDEV_LIST_UNLOCK(client->ec_evdev);
-	TRACE("evdev thread dtor lock end\n");
+	reports = ethread->ring_reports;
+	capacity = ethread->evdev_client->ec_buffer_size;
+	highwater = ethread->check_highwater;
+	overflow = ethread->check_overflow;
+	ethread->check_highwater = 0;
+	ethread->check_overflow = false;
+	ethread->resize_check = sbinuptime();
+	ethread->resize = false;
+	FRAMEWORK_EVTHREAD_UNLOCK(ethread);
+
+	if (overflow || 4 * highwater > 3 * capacity)
+		reports = MIN(2 * reports, FRAMEWORK_EVTHREAD_RING_MAX);
+	else if (4 * highwater < capacity)
+		reports = MAX(reports / 2, FRAMEWORK_EVTHREAD_RING_MIN);
+
+	if (reports != ethread->ring_reports)
+		framework_evthread_resize(ethread, reports);
+}
+
+/*
+ * Tell whether the session's device went away
+ */
+bool
+framework_evthread_revoked(struct framework_evdev_thread_t *ethread)
+{
+	bool revoked = false;
+
+	if (NULL == ethread)
+		return false;
 
-	/* clear kqueue - should be locked */
+	FRAMEWORK_EVTHREAD_LOCK(ethread);
+	revoked = ethread->revoked;
+	FRAMEWORK_EVTHREAD_UNLOCK(ethread);
+
+	return revoked;
+}
+
+static void
+framework_evthread_dtor(void *data)
+{
+	struct evdev_client *client = (struct evdev_client *) data;
+
+	framework_evthread_disposeclient(client);
+
+	/* clear buffer - should be locked */
 	EVDEV_CLIENT_LOCKQ(client);
-	framework_evthread_clearkqueue(client);
+	framework_evthread_clearbuffer(client);
 	EVDEV_CLIENT_UNLOCKQ(client);
 
 	TRACE("evdev thread dtor completed\n");
@@ -264,52 +1110,87 @@ framework_evthread_setcb(struct framework_evdev_thread_t *ethread,
 }
 
 /*
- * Called to initialize the event thread
+ * Set direct mode callbacks
+ *
+ * notifyfunc runs from evdev's event delivery with the client buffer
+ * lock held and must not sleep.  When it returns true, the listener
+ * thread later calls deferfunc with the same input.
+ */
+void
+framework_evthread_setnotify(struct framework_evdev_thread_t *ethread,
+			     framework_evdev_thread_notifyfunc notifyfunc,
+			     framework_evdev_thread_cbfunc deferfunc)
+{
+	FRAMEWORK_EVSESSION_LOCK(ethread);
+	ethread->notifyfunc = notifyfunc;
+	ethread->deferfunc = deferfunc;
+	FRAMEWORK_EVSESSION_UNLOCK(ethread);
+}
+
+/*
+ * Switch all sessions between threaded and direct mode
+ */
+void
+framework_evthread_setdirect(bool direct)
+{
+	atomic_store_int(&framework_evthread_direct, direct ? 1 : 0);
+}
+
+/*
+ * Tell whether sessions are in direct mode
+ */
+bool
+framework_evthread_getdirect(void)
+{
+	return (0 != atomic_load_int(&framework_evthread_direct));
+}
+
+/*
+ * Called to initialize an event session
+ *
+ * The ring starts at FRAMEWORK_EVTHREAD_RING_INIT reports of
+ * report_size events and is resized later, see
+ * framework_evthread_adapt.
  */
 struct framework_evdev_thread_t *
-framework_evthread_init(size_t buffer_size, struct evdev_dev *evdev, void *ctx)
+framework_evthread_init(size_t report_size, struct evdev_dev *evdev, void *ctx)
 {
 	struct framework_evdev_thread_t *ethread = NULL;
-	
 
 	ethread = malloc(sizeof(struct framework_evdev_thread_t), M_FRAMEWORK, M_WAITOK | M_ZERO);
 
 	ethread->ctx = ctx;
 	ethread->cbfunc = NULL;
+	ethread->notifyfunc = NULL;
+	ethread->deferfunc = NULL;
 	ethread->flags = 0;
+	ethread->overflows = counter_u64_alloc(M_WAITOK);
+	ethread->filtered = counter_u64_alloc(M_WAITOK);
+	ethread->class = framework_evthread_classify(evdev);
+	ethread->report_size = MAX(report_size, 2);
+	ethread->ring_reports = FRAMEWORK_EVTHREAD_RING_INIT;
+	ethread->resize_check = sbinuptime();
 	
 	ethread->active = true;
+
 	mtx_init(&ethread->session, "framework_evdev_session", NULL, MTX_DEF);
 
-	ethread->evdev_client = malloc(offsetof(struct evdev_client, ec_buffer) +
-				       sizeof(struct input_event) * buffer_size,
-				       M_FRAMEWORK,
-				       M_WAITOK | M_ZERO);
+	ethread->evdev_client =
+		framework_evthread_newclient(ethread->report_size *
+					     ethread->ring_reports, evdev);
+	ethread->flags |= FRAMEWORK_EVSESSION_FLAG_KQUEUE;
 
-	ethread->evdev_client->ec_evdev = evdev;
-	
-	mtx_init(&ethread->evdev_client->ec_buffer_mtx,
-		 "framework_evdev_client", NULL, MTX_DEF);
+	/* knlist_add() expects a detached knote in flux */
+	ethread->knote.kn_kq = &framework_evdev_listener.kq;
+	ethread->knote.kn_fop = &framework_evthread_filtops;
+	ethread->knote.kn_hook = ethread;
+	ethread->knote.kn_status = KN_DETACHED;
+	ethread->knote.kn_influx = 1;
+	knlist_add(&ethread->evdev_client->ec_selp.si_note, &ethread->knote, 0);
+	ethread->knote.kn_influx = 0;
+	ethread->flags |= FRAMEWORK_EVSESSION_FLAG_KNOTE;
 
-	ethread->evdev_client->ec_buffer_size = buffer_size;
-	
-	/* Set client to blocked, so to ensure we receive wakeups */
-	ethread->evdev_client->ec_blocked = true;
-	/* point selinfo mutex to client mutex */
-	ethread->evdev_client->ec_selp.si_mtx = &ethread->evdev_client->ec_buffer_mtx;
-	/* init knote list */
-	knlist_init_mtx(&ethread->evdev_client->ec_selp.si_note,
-			&ethread->evdev_client->ec_buffer_mtx);
-	ethread->flags |= FRAMEWORK_EVSESSION_FLAG_KQUEUE;
 	devfs_set_cdevpriv(ethread->evdev_client, framework_evthread_dtor);
-	
-	int error = kthread_add(framework_evthread_func, ethread, NULL,
-				NULL, 0, 0,
-				"framework_evdev_thread");
-
-	if (0 != error) {
-		ERROR("kthread_add returned error code %d\n", error);
-	}
 
 	TRACE("evdev thread init completed\n");
 
@@ -331,7 +1212,12 @@ framework_evthread_registerclient(struct framework_evdev_thread_t *ethread,
 		error = evdev_register_client(dev, ethread->evdev_client);
 		EVDEV_LIST_UNLOCK(dev);
 		TRACE("evdev thread client registration completed\n");
-		
+		if (0 != error) {
+			ERROR("evdev client registration failed with error %d\n",
+			      error);
+			return error;
+		}
+
 		FRAMEWORK_EVSESSION_LOCK(ethread);
 		TRACE("evdev thread adding CLIENTREG flag\n");
 		ethread->flags |= FRAMEWORK_EVSESSION_FLAG_CLIENTREG;
@@ -362,79 +1248,96 @@ framework_evthread_unregisterclient(struct framework_evdev_thread_t *ethread,
 }
 
 /*
- * Called to destroy the event thread
+ * Detach the session from the listener
+ *
+ * Once this returns, the listener neither queues the session nor
+ * runs its callback any more.
  */
-int
-framework_evthread_destroy(struct framework_evdev_thread_t *ethread)
+void
+framework_evthread_stop(struct framework_evdev_thread_t *ethread)
 {
-	TRACE("Switching thread %p to inactive\n", ethread);
+	struct framework_evdev_listener_t *listener = &framework_evdev_listener;
+
+	TRACE("Switching session %p to inactive\n", ethread);
 
 	if (NULL == ethread)
-		return (EINVAL);
+		return;
 
 	FRAMEWORK_EVSESSION_LOCK(ethread);
 	ethread->active = false;
 	ethread->cbfunc = NULL;
+	ethread->notifyfunc = NULL;
+	ethread->deferfunc = NULL;
 	FRAMEWORK_EVSESSION_UNLOCK(ethread);
-     
-	/* Wake up and terminate listener thread */
+
 	FRAMEWORK_EVTHREAD_LOCK(ethread);
-	TRACE("Waking up thread at %p\n", ethread->evdev_client);
-	if (framework_evthread_getflags(ethread) & FRAMEWORK_EVSESSION_FLAG_THREAD) {
-		wakeup(ethread->evdev_client);
-
-		if (!(ethread->flags & FRAMEWORK_EVSESSION_FLAG_SHUTDOWN)) {
-			TRACE("evdev thread waiting for thread completion\n");
-			/* last we know, thread is still running, sleep and wait */
-			msleep(ethread->evdev_client,
-			       &ethread->evdev_client->ec_buffer_mtx,
-			       0, "sigwait", 0);
-			TRACE("evdev thread awoke destroy func\n");
-		}
+	if (framework_evthread_getflags(ethread) & FRAMEWORK_EVSESSION_FLAG_KNOTE) {
+		TRACE("evdev thread removing knote\n");
+		ethread->knote.kn_influx = 1;
+		knlist_remove(&ethread->evdev_client->ec_selp.si_note,
+			      &ethread->knote, 1);
+		ethread->knote.kn_influx = 0;
+
+		FRAMEWORK_EVSESSION_LOCK(ethread);
+		ethread->flags &= ~(FRAMEWORK_EVSESSION_FLAG_KNOTE);
+		FRAMEWORK_EVSESSION_UNLOCK(ethread);
 	}
 	FRAMEWORK_EVTHREAD_UNLOCK(ethread);
 
-	/* if flag for client registration is set and client needs removal */
-	if (ethread->evdev_client->ec_evdev) {
-		if (framework_evthread_getflags(ethread) & FRAMEWORK_EVSESSION_FLAG_CLIENTREG) {
-			TRACE("evdev thread locking evdev list\n");
-			EVDEV_LIST_LOCK(ethread->evdev_client->ec_evdev);
-			if (!ethread->evdev_client->ec_revoked) {
-				TRACE("evdev thread disposing evdev client\n");
-				evdev_dispose_client(ethread->evdev_client->ec_evdev,
-						     ethread->evdev_client);
-				evdev_revoke_client(ethread->evdev_client);
-			}
-			EVDEV_LIST_UNLOCK(ethread->evdev_client->ec_evdev);
-
-			TRACE("evdev thread removing CLIENTREG flag\n");
-			FRAMEWORK_EVSESSION_LOCK(ethread);
-			ethread->flags &= ~(FRAMEWORK_EVSESSION_FLAG_CLIENTREG);
-			FRAMEWORK_EVSESSION_UNLOCK(ethread);
-			TRACE("evdev thread completed CLIENTREG flag removal\n");
-		}
+	FRAMEWORK_EVLISTENER_LOCK(listener);
+	if (ethread->pending) {
+		STAILQ_REMOVE(&listener->pending, ethread,
+			      framework_evdev_thread_t, pending_entry);
+		ethread->pending = false;
+	}
+	while (listener->current == ethread) {
+		TRACE("evdev thread waiting for callback completion\n");
+		FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_EVLISTENER,
+					 &listener->lockstat_stamp);
+		msleep(&listener->current, &listener->lock, 0, "sigwait", 0);
+		FRAMEWORK_LOCKSTAT_WAKEUP(&listener->lockstat_stamp);
+	}
+	FRAMEWORK_EVLISTENER_UNLOCK(listener);
+}
+
+/*
+ * Called to destroy the event session
+ */
+int
+framework_evthread_destroy(struct framework_evdev_thread_t *ethread)
+{
+	if (NULL == ethread)
+		return (EINVAL);
+
+	/* no-op if already stopped */
+	framework_evthread_stop(ethread);
+
+	/* unregistering cleared the flag, after disposing of the client */
+	if (framework_evthread_getflags(ethread) & FRAMEWORK_EVSESSION_FLAG_CLIENTREG) {
+		framework_evthread_disposeclient(ethread->evdev_client);
+
+		TRACE("evdev thread removing CLIENTREG flag\n");
+		FRAMEWORK_EVSESSION_LOCK(ethread);
+		ethread->flags &= ~(FRAMEWORK_EVSESSION_FLAG_CLIENTREG);
+		FRAMEWORK_EVSESSION_UNLOCK(ethread);
 	}
 
-	TRACE("evdev thread clearing kqueue\n");
+	TRACE("evdev thread clearing buffer\n");
 	FRAMEWORK_EVTHREAD_LOCK(ethread);
-	framework_evthread_clearkqueue(ethread->evdev_client);
+	framework_evthread_clearbuffer(ethread->evdev_client);
 	FRAMEWORK_EVTHREAD_UNLOCK(ethread);
 	TRACE("evdev thread removing KQUEUE flag\n");
 	FRAMEWORK_EVSESSION_LOCK(ethread);
 	ethread->flags &= ~(FRAMEWORK_EVSESSION_FLAG_KQUEUE);
 	FRAMEWORK_EVSESSION_UNLOCK(ethread);
-	TRACE("evdev thread destroying knlist\n");
-	knlist_destroy(&ethread->evdev_client->ec_selp.si_note);
+	framework_evthread_freeclient(ethread->evdev_client);
 
 	TRACE("evdev thread destroying mutexes\n");
 	mtx_destroy(&ethread->session);
-	mtx_destroy(&ethread->evdev_client->ec_buffer_mtx);
-
-	TRACE("evdev thread freeing client\n");
-	free(ethread->evdev_client, M_FRAMEWORK);
+	counter_u64_free(ethread->overflows);
+	counter_u64_free(ethread->filtered);
 	TRACE("evdev thread freeing main thread\n");
 	free(ethread, M_FRAMEWORK);
 	
 	return 0;
 }
-
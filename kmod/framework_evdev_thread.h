@@ -31,18 +31,108 @@
 #ifndef __FRAMEWORK_EVDEV_THREAD_H__
 #define __FRAMEWORK_EVDEV_THREAD_H__
 
+#include <sys/counter.h>
 #include <sys/kthread.h>
+#include <sys/sysctl.h>
 #include <sys/unistd.h>
 
 #include <dev/evdev/evdev_private.h>
 
+/*
+ * Event sessions
+ *
+ * Each bound evdev device gets a session with its own evdev client.
+ * A single listener thread dispatches the input of all sessions.  In
+ * direct mode, input is handed over from evdev's event delivery and
+ * only work that may sleep is left to the listener.
+ */
 struct framework_evdev_thread_t;
 
-/* callback method on input event */
-typedef void(*framework_evdev_thread_cbfunc)(void *, uint16_t *);
+/* most keys handed to a callback at once, further keys are dropped */
+#define FRAMEWORK_EVTHREAD_MAXKEYS 16
+
+/* client ring size in reports of the device: initial, lower and upper bound */
+#define FRAMEWORK_EVTHREAD_RING_INIT 8
+#define FRAMEWORK_EVTHREAD_RING_MIN 4
+#define FRAMEWORK_EVTHREAD_RING_MAX 64
+
+/* interval of ring size checks while the ring does not run full */
+#define FRAMEWORK_EVTHREAD_RESIZE_INTERVAL (60 * SBT_1S)
+
+/*
+ * Client ring of a session
+ */
+struct framework_evthread_ringstats_t {
+	size_t bytes;            /* allocated for the client */
+	u_int events;            /* capacity in events */
+	u_int highwater;         /* most events queued at once since bound */
+	u_int resizes;           /* ring replacements since bound */
+};
+
+/*
+ * Device classes, each with its own significance filter
+ *
+ * A session's class is picked once from the event types its device
+ * supports: absolute axes make a touchpad, relative ones a mouse.
+ */
+enum framework_evthread_class_t {
+	FRAMEWORK_EVTHREAD_CLASS_KEYBOARD,
+	FRAMEWORK_EVTHREAD_CLASS_MOUSE,
+	FRAMEWORK_EVTHREAD_CLASS_TOUCHPAD,
+	FRAMEWORK_EVTHREAD_CLASS_COUNT
+};
+
+/* callback method on input event, with the keys pressed */
+typedef void(*framework_evdev_thread_cbfunc)(void *, const uint16_t *,
+					     size_t);
+
+/* direct mode callback, returns true to run the deferred callback */
+typedef bool(*framework_evdev_thread_notifyfunc)(void *, const uint16_t *,
+						 size_t);
+
+/* device arrival or departure, run on the listener thread */
+typedef void(*framework_evdev_thread_hotplugfunc)(void *);
+
+/* Start listener thread */
+int framework_evthread_listener_init(void);
+
+/* Stop listener thread, after all sessions are destroyed */
+void framework_evthread_listener_destroy(void);
 
-/* Initialize event thread */
-struct framework_evdev_thread_t *framework_evthread_init(size_t, struct evdev_dev *, void *);
+/* Set hotplug callback, waits for a running one to return */
+void framework_evthread_sethotplug(framework_evdev_thread_hotplugfunc func,
+				   void *ctx);
+
+/* Have the listener thread run the hotplug callback */
+void framework_evthread_hotplug(void);
+
+/* Tell whether evdev revoked the session's client */
+bool framework_evthread_revoked(struct framework_evdev_thread_t *ethread);
+
+/* Resize the client ring from its fill level, on the listener thread */
+void framework_evthread_adapt(struct framework_evdev_thread_t *ethread);
+
+/* Report the client ring */
+void framework_evthread_ringstats(struct framework_evdev_thread_t *ethread,
+				  struct framework_evthread_ringstats_t *stats);
+
+/* Get counter of ring overflows */
+counter_u64_t framework_evthread_overflows(struct framework_evdev_thread_t *ethread);
+
+/* Get counter of events discarded as insignificant */
+counter_u64_t framework_evthread_filtered(struct framework_evdev_thread_t *ethread);
+
+/* Name the device class of a session */
+const char *framework_evthread_classname(struct framework_evdev_thread_t *ethread);
+
+/* Add hw.framework.filter below parent */
+void framework_evthread_sysctl_init(struct sysctl_ctx_list *ctx,
+				    struct sysctl_oid *parent);
+
+/* Initialize event session */
+struct framework_evdev_thread_t *framework_evthread_init(size_t report_size,
+							 struct evdev_dev *,
+							 void *);
 
 /* Register as evdev client */
 int framework_evthread_registerclient(struct framework_evdev_thread_t *ethread,
@@ -52,11 +142,25 @@ int framework_evthread_registerclient(struct framework_evdev_thread_t *ethread,
 void framework_evthread_setcb(struct framework_evdev_thread_t *ethread,
 			      framework_evdev_thread_cbfunc cbfunc);
 
+/* Set direct mode callbacks */
+void framework_evthread_setnotify(struct framework_evdev_thread_t *ethread,
+				  framework_evdev_thread_notifyfunc notifyfunc,
+				  framework_evdev_thread_cbfunc deferfunc);
+
+/* Switch between threaded and direct mode */
+void framework_evthread_setdirect(bool direct);
+
+/* Tell whether direct mode is enabled */
+bool framework_evthread_getdirect(void);
+
 /* Unregister as evdev client */
 int framework_evthread_unregisterclient(struct framework_evdev_thread_t *ethread,
 					struct evdev_dev *dev);
 
-/* Destroy event thread */
+/* Detach event session from listener */
+void framework_evthread_stop(struct framework_evdev_thread_t *ethread);
+
+/* Stop event session, then free it */
 int framework_evthread_destroy(struct framework_evdev_thread_t *ethread);
 
 #endif /* __FRAMEWORK_EVDEV_THREAD_H__ */
@@ -0,0 +1,98 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/kernel.h>
+#include <sys/sbuf.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include <machine/atomic.h>
+
+#include "framework_hist.h"
+
+/*
+ * Histogram bucket for a duration
+ */
+static int
+framework_hist_bucket(uint64_t ns, int buckets, int shift)
+{
+	int bucket = flsll(ns) - shift;
+
+	if (bucket < 0)
+		return 0;
+	if (bucket >= buckets)
+		return buckets - 1;
+
+	return bucket;
+}
+
+void
+framework_hist_add(uint64_t *hist, int buckets, int shift, uint64_t ns)
+{
+	atomic_add_64(&hist[framework_hist_bucket(ns, buckets, shift)], 1);
+}
+
+void
+framework_hist_clear(uint64_t *hist, int buckets)
+{
+	for (int i = 0; i < buckets; i++)
+		atomic_store_64(&hist[i], 0);
+}
+
+int
+framework_hist_sysctl(SYSCTL_HANDLER_ARGS)
+{
+	uint64_t *hist = arg1;
+	int buckets = arg2 >> 8;
+	int shift = arg2 & 0xff;
+	struct sbuf *sb;
+	int error = 0;
+
+	sb = sbuf_new_for_sysctl(NULL, NULL, 512, req);
+	if (NULL == sb)
+		return (ENOMEM);
+
+	for (int i = 0; i < buckets; i++) {
+		if (i < buckets - 1)
+			sbuf_printf(sb, "%s%ju:%ju", i ? " " : "",
+				    (uintmax_t)1 << (i + shift),
+				    (uintmax_t)atomic_load_64(&hist[i]));
+		else
+			sbuf_printf(sb, " inf:%ju",
+				    (uintmax_t)atomic_load_64(&hist[i]));
+	}
+
+	error = sbuf_finish(sb);
+	sbuf_delete(sb);
+
+	return (error);
+}
@@ -0,0 +1,56 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_HIST_H__
+#define __FRAMEWORK_HIST_H__
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+/*
+ * Log2 histograms of durations
+ *
+ * A histogram is an array of counters; bucket n counts times below
+ * 2^(n + shift) ns, the last one the rest.
+ */
+
+/* arg2 of framework_hist_sysctl for a histogram of buckets and shift */
+#define FRAMEWORK_HIST_ARG2(buckets, shift) (((buckets) << 8) | (shift))
+
+/* Count a duration */
+void framework_hist_add(uint64_t *hist, int buckets, int shift, uint64_t ns);
+
+/* Clear all buckets */
+void framework_hist_clear(uint64_t *hist, int buckets);
+
+/* Print the histogram arg1 as "upper_ns:count" pairs, arg2 its shape */
+int framework_hist_sysctl(SYSCTL_HANDLER_ARGS);
+
+#endif /* __FRAMEWORK_HIST_H__ */
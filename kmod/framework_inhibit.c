@@ -0,0 +1,482 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/conf.h>
+#include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/malloc.h>
+#include <sys/mutex.h>
+#include <sys/proc.h>
+#include <sys/queue.h>
+#include <sys/sbuf.h>
+#include <sys/sdt.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include <machine/atomic.h>
+
+#include "framework_counters.h"
+#include "framework_inhibit.h"
+#include "framework_lockstat.h"
+#include "framework_sysctl.h"
+#include "framework_timer.h"
+#include "framework_utils.h"
+
+/* slack for expiry, lets the deadline share a wakeup */
+#define FRAMEWORK_INHIBIT_PRECISION (SBT_1S / 10)
+
+/*
+ * An inhibitor
+ *
+ * Owned by an open file of /dev/framework, or by the registry when
+ * taken through the dimblock sysctl.  Expiry only takes it off the
+ * held list, its owner frees it.
+ */
+struct framework_inhibit_t {
+	u_int id;                         /* handle in the listing */
+	pid_t pid;                        /* owner process */
+	char owner[MAXCOMLEN + 1];        /* owner command name */
+	char reason[FRAMEWORK_INHIBIT_REASONLEN]; /* (i) */
+	sbintime_t since;                 /* (i) held since */
+	sbintime_t expires;               /* (i) 0 if held until released */
+	bool held;                        /* (i) on the held list */
+	bool dimblock;                    /* taken through dimblock */
+	LIST_ENTRY(framework_inhibit_t) entries; /* (i) */
+};
+
+static struct framework_inhibit_registry_t {
+	LIST_HEAD(, framework_inhibit_t) held; /* (i) inhibitors in force */
+	u_int next_id;                    /* (i) */
+
+	/* (i) written, read without the lock */
+	u_int active;                     /* inhibitors held */
+	uint64_t released;                /* sbinuptime() of the last release */
+
+	framework_inhibit_hookfunc hook;  /* (i) */
+	void *hook_ctx;                   /* (i) */
+
+	struct framework_timer_t *expiry; /* earliest expiry */
+	struct cdev *cdev;
+
+	struct mtx lock;                  /* i - inhibitors and hook */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;        /* (i) lock acquisition time */
+#endif
+} framework_inhibit;
+
+#define FRAMEWORK_INHIBIT_LOCK() \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_INHIBIT, \
+				    &framework_inhibit.lock, \
+				    &framework_inhibit.lockstat_stamp)
+#define FRAMEWORK_INHIBIT_UNLOCK() \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_INHIBIT, \
+				      &framework_inhibit.lock, \
+				      &framework_inhibit.lockstat_stamp)
+
+MALLOC_DECLARE(M_FRAMEWORK);
+
+SDT_PROVIDER_DECLARE(framework);
+SDT_PROBE_DEFINE2(framework, inhibit, , acquire, "u_int", "u_int");
+SDT_PROBE_DEFINE2(framework, inhibit, , release, "u_int", "u_int");
+SDT_PROBE_DEFINE2(framework, inhibit, , expire, "u_int", "u_int");
+
+static d_ioctl_t framework_inhibit_ioctl;
+
+static struct cdevsw framework_inhibit_cdevsw = {
+	.d_version = D_VERSION,
+	.d_name = FRAMEWORK_INHIBIT_DEVNAME,
+	.d_ioctl = framework_inhibit_ioctl,
+};
+
+/*
+ * Allocate an inhibitor owned by the process of td
+ */
+static struct framework_inhibit_t *
+framework_inhibit_alloc(struct thread *td, const char *reason)
+{
+	struct framework_inhibit_t *inh = NULL;
+
+	inh = malloc(sizeof(struct framework_inhibit_t), M_FRAMEWORK,
+		     M_WAITOK | M_ZERO);
+	inh->pid = td->td_proc->p_pid;
+	strlcpy(inh->owner, td->td_proc->p_comm, sizeof(inh->owner));
+	strlcpy(inh->reason, reason, sizeof(inh->reason));
+
+	return inh;
+}
+
+/*
+ * Arm the expiry timer for the earliest expiry, called with the lock held
+ */
+static void
+framework_inhibit_rearm(void)
+{
+	struct framework_inhibit_t *inh = NULL;
+	sbintime_t earliest = 0;
+
+	LIST_FOREACH(inh, &framework_inhibit.held, entries) {
+		if (inh->expires && (0 == earliest || inh->expires < earliest))
+			earliest = inh->expires;
+	}
+
+	if (earliest)
+		framework_timer_schedule(framework_inhibit.expiry, earliest,
+					 FRAMEWORK_INHIBIT_PRECISION);
+	else
+		framework_timer_cancel(framework_inhibit.expiry);
+}
+
+/*
+ * Put an inhibitor in force or renew it, called with the lock held
+ */
+static void
+framework_inhibit_hold(struct framework_inhibit_t *inh, uint32_t timeout_ms)
+{
+	sbintime_t now = sbinuptime();
+
+	inh->expires = timeout_ms ? now + mstosbt(timeout_ms) : 0;
+	if (inh->held)
+		return;
+
+	inh->id = ++framework_inhibit.next_id;
+	inh->since = now;
+	inh->held = true;
+	LIST_INSERT_HEAD(&framework_inhibit.held, inh, entries);
+	atomic_store_rel_int(&framework_inhibit.active,
+			     framework_inhibit.active + 1);
+	FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_INHIBIT);
+	SDT_PROBE2(framework, inhibit, , acquire, inh->id,
+		   framework_inhibit.active);
+
+	if (1 == framework_inhibit.active && framework_inhibit.hook)
+		framework_inhibit.hook(framework_inhibit.hook_ctx);
+}
+
+/*
+ * Take an inhibitor out of force, called with the lock held
+ */
+static void
+framework_inhibit_drop(struct framework_inhibit_t *inh, bool expired)
+{
+	if (!inh->held)
+		return;
+
+	inh->held = false;
+	LIST_REMOVE(inh, entries);
+	if (1 == framework_inhibit.active)
+		atomic_store_rel_64(&framework_inhibit.released, sbinuptime());
+	atomic_store_rel_int(&framework_inhibit.active,
+			     framework_inhibit.active - 1);
+	if (expired) {
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_INHIBIT_EXPIRE);
+		SDT_PROBE2(framework, inhibit, , expire, inh->id,
+			   framework_inhibit.active);
+	} else {
+		SDT_PROBE2(framework, inhibit, , release, inh->id,
+			   framework_inhibit.active);
+	}
+
+	if (0 == framework_inhibit.active && framework_inhibit.hook)
+		framework_inhibit.hook(framework_inhibit.hook_ctx);
+}
+
+/*
+ * Drop expired inhibitors, run by the expiry timer
+ */
+static void
+framework_inhibit_expire(void *arg __unused)
+{
+	struct framework_inhibit_t *inh = NULL;
+	struct framework_inhibit_t *tmp = NULL;
+	sbintime_t now = sbinuptime();
+
+	FRAMEWORK_INHIBIT_LOCK();
+	LIST_FOREACH_SAFE(inh, &framework_inhibit.held, entries, tmp) {
+		if (inh->expires &&
+		    inh->expires <= now + FRAMEWORK_INHIBIT_PRECISION) {
+			DEBUG("inhibitor %u of %s expired\n", inh->id,
+			      inh->owner);
+			framework_inhibit_drop(inh, true);
+		}
+	}
+	framework_inhibit_rearm();
+	FRAMEWORK_INHIBIT_UNLOCK();
+}
+
+/*
+ * Release the inhibitor of a closed file
+ */
+static void
+framework_inhibit_dtor(void *data)
+{
+	struct framework_inhibit_t *inh = data;
+
+	FRAMEWORK_INHIBIT_LOCK();
+	framework_inhibit_drop(inh, false);
+	framework_inhibit_rearm();
+	FRAMEWORK_INHIBIT_UNLOCK();
+
+	free(inh, M_FRAMEWORK);
+}
+
+/*
+ * Handle requests on /dev/framework
+ */
+static int
+framework_inhibit_ioctl(struct cdev *dev __unused, u_long cmd, caddr_t data,
+			int fflag __unused, struct thread *td)
+{
+	struct framework_inhibit_req *req = NULL;
+	struct framework_inhibit_t *inh = NULL;
+	int error = 0;
+
+	switch (cmd) {
+	case FRAMEWORKIOC_INHIBIT:
+		req = (struct framework_inhibit_req *)data;
+		req->reason[FRAMEWORK_INHIBIT_REASONLEN - 1] = '\0';
+
+		/* the first request of a file creates its inhibitor */
+		while (0 != devfs_get_cdevpriv((void **)&inh)) {
+			inh = framework_inhibit_alloc(td, req->reason);
+			error = devfs_set_cdevpriv(inh, framework_inhibit_dtor);
+			if (0 == error)
+				break;
+			free(inh, M_FRAMEWORK);
+			inh = NULL;
+			if (EBUSY != error)
+				return (error);
+		}
+
+		FRAMEWORK_INHIBIT_LOCK();
+		strlcpy(inh->reason, req->reason, sizeof(inh->reason));
+		framework_inhibit_hold(inh, req->timeout_ms);
+		framework_inhibit_rearm();
+		FRAMEWORK_INHIBIT_UNLOCK();
+		break;
+	case FRAMEWORKIOC_RELEASE:
+		/* runs framework_inhibit_dtor */
+		if (0 == devfs_get_cdevpriv((void **)&inh))
+			devfs_clear_cdevpriv();
+		break;
+	default:
+		error = (ENOTTY);
+	}
+
+	return (error);
+}
+
+/*
+ * Create /dev/framework
+ */
+int
+framework_inhibit_init(void)
+{
+	bzero(&framework_inhibit, sizeof(struct framework_inhibit_registry_t));
+
+	mtx_init(&framework_inhibit.lock, "framework_inhibit", NULL, MTX_DEF);
+	LIST_INIT(&framework_inhibit.held);
+	framework_inhibit.expiry =
+		framework_timer_register("inhibit", framework_inhibit_expire,
+					 NULL);
+
+	framework_inhibit.cdev = make_dev(&framework_inhibit_cdevsw, 0,
+					  UID_ROOT, GID_VIDEO, 0660,
+					  FRAMEWORK_INHIBIT_DEVNAME);
+
+	return 0;
+}
+
+/*
+ * Tell whether an inhibitor is held
+ */
+bool
+framework_inhibit_active(void)
+{
+	return (0 != atomic_load_acq_int(&framework_inhibit.active));
+}
+
+/*
+ * Get sbinuptime() when the last inhibitor was released
+ */
+sbintime_t
+framework_inhibit_lastrelease(void)
+{
+	return ((sbintime_t)atomic_load_acq_64(&framework_inhibit.released));
+}
+
+/*
+ * Set hook for inhibitor changes
+ */
+void
+framework_inhibit_sethook(framework_inhibit_hookfunc func, void *ctx)
+{
+	FRAMEWORK_INHIBIT_LOCK();
+	framework_inhibit.hook = func;
+	framework_inhibit.hook_ctx = ctx;
+	FRAMEWORK_INHIBIT_UNLOCK();
+}
+
+/*
+ * Take or release an inhibitor for the dimblock sysctl
+ *
+ * These have no file to be closed with and stay until released.
+ */
+void
+framework_inhibit_dimblock(bool block)
+{
+	struct framework_inhibit_t *inh = NULL;
+
+	if (block) {
+		inh = framework_inhibit_alloc(curthread, "dimblock");
+		inh->dimblock = true;
+
+		FRAMEWORK_INHIBIT_LOCK();
+		framework_inhibit_hold(inh, 0);
+		FRAMEWORK_INHIBIT_UNLOCK();
+		return;
+	}
+
+	FRAMEWORK_INHIBIT_LOCK();
+	LIST_FOREACH(inh, &framework_inhibit.held, entries) {
+		if (inh->dimblock)
+			break;
+	}
+	/* none held, nothing to release */
+	if (inh)
+		framework_inhibit_drop(inh, false);
+	FRAMEWORK_INHIBIT_UNLOCK();
+
+	free(inh, M_FRAMEWORK);
+}
+
+/*
+ * Number of inhibitors taken through the dimblock sysctl
+ */
+u_int
+framework_inhibit_dimblocks(void)
+{
+	struct framework_inhibit_t *inh = NULL;
+	u_int count = 0;
+
+	FRAMEWORK_INHIBIT_LOCK();
+	LIST_FOREACH(inh, &framework_inhibit.held, entries) {
+		if (inh->dimblock)
+			count++;
+	}
+	FRAMEWORK_INHIBIT_UNLOCK();
+
+	return count;
+}
+
+/*
+ * Print inhibitors in force
+ */
+static int
+framework_inhibit_sysctl_list(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_inhibit_t *inh = NULL;
+	struct sbuf *sb;
+	sbintime_t now = 0;
+	int error = 0;
+
+	/* no page faults while holding the lock */
+	error = sysctl_wire_old_buffer(req, 0);
+	if (0 != error)
+		return (error);
+
+	sb = sbuf_new_for_sysctl(NULL, NULL, 256, req);
+	if (NULL == sb)
+		return (ENOMEM);
+
+	sbuf_printf(sb, "%6s %7s %-19s %10s %10s %s", "id", "pid", "owner",
+		    "held_s", "expires_s", "reason");
+
+	FRAMEWORK_INHIBIT_LOCK();
+	now = sbinuptime();
+	LIST_FOREACH(inh, &framework_inhibit.held, entries) {
+		sbuf_printf(sb, "\n%6u %7d %-19s %10jd ", inh->id,
+			    (int)inh->pid, inh->owner,
+			    (intmax_t)((now - inh->since) / SBT_1S));
+		if (inh->expires)
+			sbuf_printf(sb, "%10jd ",
+				    (intmax_t)((inh->expires - now) / SBT_1S));
+		else
+			sbuf_printf(sb, "%10s ", "-");
+		sbuf_printf(sb, "%s", inh->reason);
+	}
+	FRAMEWORK_INHIBIT_UNLOCK();
+
+	error = sbuf_finish(sb);
+	sbuf_delete(sb);
+
+	return (error);
+}
+
+/*
+ * Add hw.framework.inhibitors below parent
+ */
+void
+framework_inhibit_sysctl_init(struct sysctl_ctx_list *ctx,
+			      struct sysctl_oid *parent)
+{
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(parent), OID_AUTO, "inhibitors",
+			CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_inhibit_sysctl_list, "A",
+			"Inhibitors keeping the screen from dimming");
+}
+
+/*
+ * Release all inhibitors and remove /dev/framework
+ */
+void
+framework_inhibit_destroy(void)
+{
+	struct framework_inhibit_t *inh = NULL;
+
+	/* releases the inhibitors of files still open */
+	if (framework_inhibit.cdev)
+		destroy_dev(framework_inhibit.cdev);
+	framework_inhibit.cdev = NULL;
+
+	FRAMEWORK_INHIBIT_LOCK();
+	while (NULL != (inh = LIST_FIRST(&framework_inhibit.held))) {
+		framework_inhibit_drop(inh, false);
+		free(inh, M_FRAMEWORK);
+	}
+	FRAMEWORK_INHIBIT_UNLOCK();
+
+	/* waits for a running expiry */
+	framework_timer_unregister(framework_inhibit.expiry);
+	framework_inhibit.expiry = NULL;
+
+	mtx_destroy(&framework_inhibit.lock);
+}
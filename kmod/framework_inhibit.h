@@ -0,0 +1,98 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_INHIBIT_H__
+#define __FRAMEWORK_INHIBIT_H__
+
+/*
+ * Idle inhibitors
+ *
+ * While any inhibitor is held, the screen does not move on to a deeper
+ * idle stage.  An inhibitor belongs to an open file of /dev/framework
+ * and is released when the file is closed, its owner exits or its
+ * timeout passes; idle time starts over once the last one is gone.
+ *
+ * The request layout below is shared with userland and therefore must
+ * not depend on kernel headers.
+ */
+#ifdef _KERNEL
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+#include <sys/ioccom.h>
+
+#define FRAMEWORK_INHIBIT_DEVNAME "framework"
+#define FRAMEWORK_INHIBIT_REASONLEN 64
+
+/* Take or renew the inhibitor of an open file */
+struct framework_inhibit_req {
+	uint32_t timeout_ms;         /* released after this, 0 never */
+	char reason[FRAMEWORK_INHIBIT_REASONLEN]; /* shown in the listing */
+};
+
+#define FRAMEWORKIOC_INHIBIT _IOW('F', 1, struct framework_inhibit_req)
+#define FRAMEWORKIOC_RELEASE _IO('F', 2)
+
+#ifdef _KERNEL
+
+#include <sys/sysctl.h>
+
+/* called when the first inhibitor is taken or the last one released */
+typedef void(*framework_inhibit_hookfunc)(void *);
+
+/* Create /dev/framework, needs the timer service */
+int framework_inhibit_init(void);
+
+/* Tell whether an inhibitor is held, a single atomic read */
+bool framework_inhibit_active(void);
+
+/* Get sbinuptime() when the last inhibitor was released, 0 if none yet */
+sbintime_t framework_inhibit_lastrelease(void);
+
+/* Set hook for inhibitor changes, NULL to remove it */
+void framework_inhibit_sethook(framework_inhibit_hookfunc func, void *ctx);
+
+/* Take or release an inhibitor for the dimblock sysctl */
+void framework_inhibit_dimblock(bool block);
+
+/* Number of inhibitors taken through the dimblock sysctl */
+u_int framework_inhibit_dimblocks(void);
+
+/* Add hw.framework.inhibitors below parent */
+void framework_inhibit_sysctl_init(struct sysctl_ctx_list *ctx,
+				   struct sysctl_oid *parent);
+
+/* Release all inhibitors and remove /dev/framework */
+void framework_inhibit_destroy(void);
+
+#endif /* _KERNEL */
+
+#endif /* __FRAMEWORK_INHIBIT_H__ */
@@ -38,6 +38,7 @@
 #include <sys/mutex.h>
 #include <sys/lock.h>
 
+#include "framework_counters.h"
 #include "framework_sysctl.h"
 #include "framework_utils.h"
 
@@ -132,6 +133,26 @@ framework_keyhandler_brightness_down(struct framework_keyhandler_t *kh)
 	framework_keyhandler_changebrightness(kh, false);
 }
 
+/*
+ * Tell whether a key code has a handler, does not sleep
+ */
+bool
+framework_keyhandler_haskey(struct framework_keyhandler_t *kh, uint32_t key_in)
+{
+	size_t count_max = sizeof(framework_keyhandler_vt) /
+		sizeof(framework_keyhandler_vt[0]);
+
+	if (!(FRAMEWORK_KEYHANDLER_INIT & kh->flags))
+		return false;
+
+	for (size_t counter = 0; counter < count_max; counter++) {
+		if (framework_keyhandler_vt[counter].keycode == key_in)
+			return true;
+	}
+
+	return false;
+}
+
 /*
  * Handle a key code
  */
@@ -148,6 +169,7 @@ framework_keyhandler_handlekey(struct framework_keyhandler_t *kh, uint32_t key_i
 
 	for (size_t counter = 0; counter < count_max; counter++) {
 		if (framework_keyhandler_vt[counter].keycode == key_in) {
+			FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_KEY);
 			framework_keyhandler_vt[counter].handler_func(kh);
 			return 0;
 		}
@@ -158,6 +180,17 @@ framework_keyhandler_handlekey(struct framework_keyhandler_t *kh, uint32_t key_i
 	return -1;
 }
 
+/*
+ * Handle a batch of key codes in order
+ */
+void
+framework_keyhandler_handlekeys(struct framework_keyhandler_t *kh,
+				const uint16_t *keys, size_t nkeys)
+{
+	for (size_t i = 0; i < nkeys; i++)
+		framework_keyhandler_handlekey(kh, keys[i]);
+}
+
 /*
  * Initializes a new keyhandler
  */
@@ -42,7 +42,14 @@ framework_keyhandler_init(struct framework_screen_power_config_t *power_config);
 /* Destroy previously allocated keyhandler */
 void framework_keyhandler_destroy(struct framework_keyhandler_t *kh);
 
+/* Tells whether a key has a handler */
+bool framework_keyhandler_haskey(struct framework_keyhandler_t *kh, uint32_t key_in);
+
 /* Handles a keypress */
 int framework_keyhandler_handlekey(struct framework_keyhandler_t *kh, uint32_t key_in);
 
+/* Handles the keys of one input batch */
+void framework_keyhandler_handlekeys(struct framework_keyhandler_t *kh,
+				     const uint16_t *keys, size_t nkeys);
+
 #endif /* __FRAMEWORK_KEYHANDLER__ */
@@ -0,0 +1,151 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/kernel.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+#include <sys/time.h>
+
+#include <machine/atomic.h>
+
+#include "framework_hist.h"
+#include "framework_latency.h"
+
+/*
+ * Latency statistics of one pipeline stage
+ */
+struct framework_latency_t {
+	const char *name;
+	const char *descr;
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t hist[FRAMEWORK_LATENCY_BUCKETS];
+};
+
+static struct framework_latency_t framework_latencies[FRAMEWORK_LATENCY_STAGES] = {
+	[FRAMEWORK_LATENCY_WAKEUP] = {
+		"wakeup", "evdev notification to callback" },
+	[FRAMEWORK_LATENCY_DECIDE] = {
+		"decide", "Input callback to brightness computed" },
+	[FRAMEWORK_LATENCY_BACKLIGHT] = {
+		"backlight",
+		"Brightness computed to BACKLIGHT_UPDATE_STATUS returned" }
+};
+
+sbintime_t
+framework_latency_record(enum framework_latency_stage_t stage,
+			 sbintime_t start)
+{
+	struct framework_latency_t *lat = &framework_latencies[stage];
+	sbintime_t now = sbinuptime();
+	uint64_t ns = sbttons(now - start);
+	uint64_t max = atomic_load_64(&lat->max_ns);
+
+	atomic_add_64(&lat->count, 1);
+	atomic_add_64(&lat->total_ns, ns);
+	framework_hist_add(lat->hist, FRAMEWORK_LATENCY_BUCKETS,
+			   FRAMEWORK_LATENCY_SHIFT, ns);
+	while (ns > max && !atomic_fcmpset_64(&lat->max_ns, &max, ns))
+		;
+
+	return now;
+}
+
+/*
+ * Writing a non-zero value clears all latency statistics
+ */
+static int
+framework_latency_sysctl_reset(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = 0;
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (error || NULL == req->newptr || 0 == value)
+		return (error);
+
+	for (int i = 0; i < FRAMEWORK_LATENCY_STAGES; i++) {
+		struct framework_latency_t *lat = &framework_latencies[i];
+
+		atomic_store_64(&lat->count, 0);
+		atomic_store_64(&lat->total_ns, 0);
+		atomic_store_64(&lat->max_ns, 0);
+		framework_hist_clear(lat->hist, FRAMEWORK_LATENCY_BUCKETS);
+	}
+
+	return (0);
+}
+
+void
+framework_latency_sysctl_init(struct sysctl_ctx_list *ctx,
+			      struct sysctl_oid *parent)
+{
+	struct sysctl_oid *latency_tree = NULL;
+	struct sysctl_oid *stage_tree = NULL;
+
+	latency_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+				       "latency", CTLFLAG_RD | CTLFLAG_MPSAFE,
+				       0, "Input pipeline latency");
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(latency_tree), OID_AUTO, "reset",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0, framework_latency_sysctl_reset, "IU",
+			"Write 1 to clear latency statistics");
+
+	for (int i = 0; i < FRAMEWORK_LATENCY_STAGES; i++) {
+		struct framework_latency_t *lat = &framework_latencies[i];
+
+		stage_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(latency_tree),
+					     OID_AUTO, lat->name,
+					     CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+					     lat->descr);
+
+		SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(stage_tree), OID_AUTO,
+			       "count", CTLFLAG_RD | CTLFLAG_MPSAFE,
+			       &lat->count, 0, "Samples");
+		SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(stage_tree), OID_AUTO,
+			       "total_ns", CTLFLAG_RD | CTLFLAG_MPSAFE,
+			       &lat->total_ns, 0, "Total time");
+		SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(stage_tree), OID_AUTO,
+			       "max_ns", CTLFLAG_RD | CTLFLAG_MPSAFE,
+			       &lat->max_ns, 0, "Longest time");
+		SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(stage_tree), OID_AUTO,
+				"hist",
+				CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+				lat->hist,
+				FRAMEWORK_HIST_ARG2(FRAMEWORK_LATENCY_BUCKETS,
+						    FRAMEWORK_LATENCY_SHIFT),
+				framework_hist_sysctl, "A",
+				"Latency histogram, upper bound ns:count");
+	}
+}
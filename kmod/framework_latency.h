@@ -0,0 +1,65 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_LATENCY_H__
+#define __FRAMEWORK_LATENCY_H__
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <sys/time.h>
+
+/*
+ * Input pipeline latency histograms
+ *
+ * Each stage of handling an input event is timed with sbinuptime(9)
+ * and counted in a log2 histogram, exported under
+ * hw.framework.stats.latency.
+ */
+enum framework_latency_stage_t {
+	FRAMEWORK_LATENCY_WAKEUP,    /* evdev notification to callback */
+	FRAMEWORK_LATENCY_DECIDE,    /* callback to brightness computed */
+	FRAMEWORK_LATENCY_BACKLIGHT, /* brightness computed to
+					BACKLIGHT_UPDATE_STATUS returned */
+	FRAMEWORK_LATENCY_STAGES
+};
+
+/* Histogram bucket n counts times below 2^(n + 10) ns, the last the rest */
+#define FRAMEWORK_LATENCY_BUCKETS 24
+#define FRAMEWORK_LATENCY_SHIFT 10
+
+/* Account the time since start to stage, returns the current time */
+sbintime_t framework_latency_record(enum framework_latency_stage_t stage,
+				    sbintime_t start);
+
+/* Add hw.framework.stats.latency below parent */
+void framework_latency_sysctl_init(struct sysctl_ctx_list *ctx,
+				   struct sysctl_oid *parent);
+
+#endif /* __FRAMEWORK_LATENCY_H__ */
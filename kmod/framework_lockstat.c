@@ -0,0 +1,264 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/rwlock.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+#include <sys/time.h>
+
+#include <machine/atomic.h>
+
+#include "framework_hist.h"
+#include "framework_lockstat.h"
+
+#ifdef FRAMEWORK_LOCK_PROFILING
+
+/*
+ * Statistics of one lock class
+ */
+struct framework_lockstat_t {
+	const char *name;
+	const char *descr;
+	uint64_t acquires;
+	uint64_t contended;	/* acquisitions that had to wait */
+	uint64_t wait_ns;
+	uint64_t hold_ns;	/* exclusive holds only */
+	uint64_t wait_hist[FRAMEWORK_LOCKSTAT_BUCKETS];
+	uint64_t hold_hist[FRAMEWORK_LOCKSTAT_BUCKETS];
+};
+
+static struct framework_lockstat_t framework_lockstats[FRAMEWORK_LOCKSTAT_COUNT] = {
+	[FRAMEWORK_LOCKSTAT_EVDEV] = {
+		"evdev", "FRAMEWORK_EVDEV_LOCK" },
+	[FRAMEWORK_LOCKSTAT_EVTHREAD] = {
+		"evthread", "FRAMEWORK_EVTHREAD_LOCK" },
+	[FRAMEWORK_LOCKSTAT_EVSESSION] = {
+		"evsession", "FRAMEWORK_EVSESSION_LOCK" },
+	[FRAMEWORK_LOCKSTAT_EVLISTENER] = {
+		"evlistener", "FRAMEWORK_EVLISTENER_LOCK" },
+	[FRAMEWORK_LOCKSTAT_TIMER] = {
+		"timer", "FRAMEWORK_TIMER_LOCK" },
+	[FRAMEWORK_LOCKSTAT_SCREEN] = {
+		"screen", "FRAMEWORK_SCREEN_LOCK" },
+	[FRAMEWORK_LOCKSTAT_POWER] = {
+		"power", "FRAMEWORK_POWER_LOCK" },
+	[FRAMEWORK_LOCKSTAT_STATE] = {
+		"state", "FRAMEWORK_STATE_LOCK" },
+	[FRAMEWORK_LOCKSTAT_SYSCTL] = {
+		"sysctl", "FRAMEWORK_SYSCTL_LOCK" },
+	[FRAMEWORK_LOCKSTAT_WAKEUP] = {
+		"wakeup", "FRAMEWORK_WAKEUP_LOCK" },
+	[FRAMEWORK_LOCKSTAT_TRACE] = {
+		"trace", "FRAMEWORK_TRACE_LOCK" },
+	[FRAMEWORK_LOCKSTAT_MATCH] = {
+		"match", "FRAMEWORK_MATCH_LOCK" },
+	[FRAMEWORK_LOCKSTAT_BACKLIGHT] = {
+		"backlight", "FRAMEWORK_BACKLIGHT_LOCK" },
+	[FRAMEWORK_LOCKSTAT_INHIBIT] = {
+		"inhibit", "FRAMEWORK_INHIBIT_LOCK" }
+};
+
+static void
+framework_lockstat_acquired(enum framework_lockstat_id id, sbintime_t waited)
+{
+	struct framework_lockstat_t *ls = &framework_lockstats[id];
+	uint64_t ns;
+
+	atomic_add_64(&ls->acquires, 1);
+	if (0 == waited)
+		return;
+
+	ns = sbttons(waited);
+	atomic_add_64(&ls->contended, 1);
+	atomic_add_64(&ls->wait_ns, ns);
+	framework_hist_add(ls->wait_hist, FRAMEWORK_LOCKSTAT_BUCKETS,
+			   FRAMEWORK_LOCKSTAT_SHIFT, ns);
+}
+
+void
+framework_lockstat_release(enum framework_lockstat_id id, sbintime_t *stamp)
+{
+	struct framework_lockstat_t *ls = &framework_lockstats[id];
+	uint64_t ns = sbttons(sbinuptime() - *stamp);
+
+	atomic_add_64(&ls->hold_ns, ns);
+	framework_hist_add(ls->hold_hist, FRAMEWORK_LOCKSTAT_BUCKETS,
+			   FRAMEWORK_LOCKSTAT_SHIFT, ns);
+}
+
+void
+framework_lockstat_mtx_lock(enum framework_lockstat_id id, struct mtx *m,
+			    sbintime_t *stamp)
+{
+	sbintime_t start = 0;
+
+	if (!mtx_trylock(m)) {
+		start = sbinuptime();
+		mtx_lock(m);
+	}
+
+	*stamp = sbinuptime();
+	framework_lockstat_acquired(id, start ? *stamp - start : 0);
+}
+
+void
+framework_lockstat_mtx_unlock(enum framework_lockstat_id id, struct mtx *m,
+			      sbintime_t *stamp)
+{
+	framework_lockstat_release(id, stamp);
+	mtx_unlock(m);
+}
+
+void
+framework_lockstat_rlock(enum framework_lockstat_id id, struct rwlock *rw)
+{
+	sbintime_t start = 0;
+
+	if (!rw_try_rlock(rw)) {
+		start = sbinuptime();
+		rw_rlock(rw);
+	}
+
+	framework_lockstat_acquired(id, start ? sbinuptime() - start : 0);
+}
+
+void
+framework_lockstat_wlock(enum framework_lockstat_id id, struct rwlock *rw,
+			 sbintime_t *stamp)
+{
+	sbintime_t start = 0;
+
+	if (!rw_try_wlock(rw)) {
+		start = sbinuptime();
+		rw_wlock(rw);
+	}
+
+	*stamp = sbinuptime();
+	framework_lockstat_acquired(id, start ? *stamp - start : 0);
+}
+
+void
+framework_lockstat_wunlock(enum framework_lockstat_id id, struct rwlock *rw,
+			   sbintime_t *stamp)
+{
+	framework_lockstat_release(id, stamp);
+	rw_wunlock(rw);
+}
+
+/*
+ * Writing a non-zero value clears all lock statistics
+ */
+static int
+framework_lockstat_sysctl_reset(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = 0;
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (error || NULL == req->newptr || 0 == value)
+		return (error);
+
+	for (int i = 0; i < FRAMEWORK_LOCKSTAT_COUNT; i++) {
+		struct framework_lockstat_t *ls = &framework_lockstats[i];
+
+		atomic_store_64(&ls->acquires, 0);
+		atomic_store_64(&ls->contended, 0);
+		atomic_store_64(&ls->wait_ns, 0);
+		atomic_store_64(&ls->hold_ns, 0);
+		framework_hist_clear(ls->wait_hist, FRAMEWORK_LOCKSTAT_BUCKETS);
+		framework_hist_clear(ls->hold_hist, FRAMEWORK_LOCKSTAT_BUCKETS);
+	}
+
+	return (0);
+}
+
+void
+framework_lockstat_sysctl_init(struct sysctl_ctx_list *ctx,
+			       struct sysctl_oid *parent)
+{
+	struct sysctl_oid *locks_tree = NULL;
+	struct sysctl_oid *lock_tree = NULL;
+
+	locks_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+				     "locks", CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				     "Lock profiling");
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(locks_tree), OID_AUTO, "reset",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0, framework_lockstat_sysctl_reset, "IU",
+			"Write 1 to clear lock statistics");
+
+	for (int i = 0; i < FRAMEWORK_LOCKSTAT_COUNT; i++) {
+		struct framework_lockstat_t *ls = &framework_lockstats[i];
+
+		lock_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(locks_tree),
+					    OID_AUTO, ls->name,
+					    CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+					    ls->descr);
+
+		SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(lock_tree), OID_AUTO,
+			       "acquires", CTLFLAG_RD | CTLFLAG_MPSAFE,
+			       &ls->acquires, 0, "Acquisitions");
+		SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(lock_tree), OID_AUTO,
+			       "contended", CTLFLAG_RD | CTLFLAG_MPSAFE,
+			       &ls->contended, 0,
+			       "Acquisitions that had to wait");
+		SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(lock_tree), OID_AUTO,
+			       "wait_ns", CTLFLAG_RD | CTLFLAG_MPSAFE,
+			       &ls->wait_ns, 0, "Total wait time");
+		SYSCTL_ADD_U64(ctx, SYSCTL_CHILDREN(lock_tree), OID_AUTO,
+			       "hold_ns", CTLFLAG_RD | CTLFLAG_MPSAFE,
+			       &ls->hold_ns, 0,
+			       "Total exclusive hold time");
+		SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(lock_tree), OID_AUTO,
+				"wait_hist",
+				CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+				ls->wait_hist,
+				FRAMEWORK_HIST_ARG2(FRAMEWORK_LOCKSTAT_BUCKETS,
+						    FRAMEWORK_LOCKSTAT_SHIFT),
+				framework_hist_sysctl, "A",
+				"Wait time histogram, upper bound ns:count");
+		SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(lock_tree), OID_AUTO,
+				"hold_hist",
+				CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+				ls->hold_hist,
+				FRAMEWORK_HIST_ARG2(FRAMEWORK_LOCKSTAT_BUCKETS,
+						    FRAMEWORK_LOCKSTAT_SHIFT),
+				framework_hist_sysctl, "A",
+				"Hold time histogram, upper bound ns:count");
+	}
+}
+
+#endif /* FRAMEWORK_LOCK_PROFILING */
@@ -0,0 +1,121 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_LOCKSTAT_H__
+#define __FRAMEWORK_LOCKSTAT_H__
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/lock.h>
+#include <sys/mutex.h>
+#include <sys/rwlock.h>
+#include <sys/sysctl.h>
+
+/*
+ * Lock profiling
+ *
+ * Built with FRAMEWORK_LOCK_PROFILING, the FRAMEWORK_*_LOCK macros
+ * count acquisitions and record wait and hold times per lock class.
+ * Structures owning a profiled lock keep the acquisition time in a
+ * lockstat_stamp member.  Without the option, the macros reduce to
+ * the plain mtx(9)/rwlock(9) calls.
+ */
+enum framework_lockstat_id {
+	FRAMEWORK_LOCKSTAT_EVDEV,
+	FRAMEWORK_LOCKSTAT_EVTHREAD,
+	FRAMEWORK_LOCKSTAT_EVSESSION,
+	FRAMEWORK_LOCKSTAT_EVLISTENER,
+	FRAMEWORK_LOCKSTAT_TIMER,
+	FRAMEWORK_LOCKSTAT_SCREEN,
+	FRAMEWORK_LOCKSTAT_POWER,
+	FRAMEWORK_LOCKSTAT_STATE,
+	FRAMEWORK_LOCKSTAT_SYSCTL,
+	FRAMEWORK_LOCKSTAT_WAKEUP,
+	FRAMEWORK_LOCKSTAT_TRACE,
+	FRAMEWORK_LOCKSTAT_MATCH,
+	FRAMEWORK_LOCKSTAT_BACKLIGHT,
+	FRAMEWORK_LOCKSTAT_INHIBIT,
+	FRAMEWORK_LOCKSTAT_COUNT
+};
+
+#ifdef FRAMEWORK_LOCK_PROFILING
+
+/* Histogram bucket n counts times below 2^(n + 8) ns, the last the rest */
+#define FRAMEWORK_LOCKSTAT_BUCKETS 16
+#define FRAMEWORK_LOCKSTAT_SHIFT 8
+
+void framework_lockstat_mtx_lock(enum framework_lockstat_id id,
+				 struct mtx *m, sbintime_t *stamp);
+void framework_lockstat_mtx_unlock(enum framework_lockstat_id id,
+				   struct mtx *m, sbintime_t *stamp);
+void framework_lockstat_rlock(enum framework_lockstat_id id,
+			      struct rwlock *rw);
+void framework_lockstat_wlock(enum framework_lockstat_id id,
+			      struct rwlock *rw, sbintime_t *stamp);
+void framework_lockstat_wunlock(enum framework_lockstat_id id,
+				struct rwlock *rw, sbintime_t *stamp);
+
+/* End the current hold without unlocking, e.g. before msleep(9) */
+void framework_lockstat_release(enum framework_lockstat_id id,
+				sbintime_t *stamp);
+
+/* Add hw.framework.stats.locks below parent */
+void framework_lockstat_sysctl_init(struct sysctl_ctx_list *ctx,
+				    struct sysctl_oid *parent);
+
+#define FRAMEWORK_LOCKSTAT_MTX_LOCK(id, m, stamp) \
+	framework_lockstat_mtx_lock(id, m, stamp)
+#define FRAMEWORK_LOCKSTAT_MTX_UNLOCK(id, m, stamp) \
+	framework_lockstat_mtx_unlock(id, m, stamp)
+#define FRAMEWORK_LOCKSTAT_RLOCK(id, rw) framework_lockstat_rlock(id, rw)
+#define FRAMEWORK_LOCKSTAT_RUNLOCK(id, rw) rw_runlock(rw)
+#define FRAMEWORK_LOCKSTAT_WLOCK(id, rw, stamp) \
+	framework_lockstat_wlock(id, rw, stamp)
+#define FRAMEWORK_LOCKSTAT_WUNLOCK(id, rw, stamp) \
+	framework_lockstat_wunlock(id, rw, stamp)
+
+/* bracket msleep(9) on a profiled mutex, so sleeping is not holding */
+#define FRAMEWORK_LOCKSTAT_SLEEP(id, stamp) framework_lockstat_release(id, stamp)
+#define FRAMEWORK_LOCKSTAT_WAKEUP(stamp) (*(stamp) = sbinuptime())
+
+#else
+
+#define FRAMEWORK_LOCKSTAT_MTX_LOCK(id, m, stamp) mtx_lock(m)
+#define FRAMEWORK_LOCKSTAT_MTX_UNLOCK(id, m, stamp) mtx_unlock(m)
+#define FRAMEWORK_LOCKSTAT_RLOCK(id, rw) rw_rlock(rw)
+#define FRAMEWORK_LOCKSTAT_RUNLOCK(id, rw) rw_runlock(rw)
+#define FRAMEWORK_LOCKSTAT_WLOCK(id, rw, stamp) rw_wlock(rw)
+#define FRAMEWORK_LOCKSTAT_WUNLOCK(id, rw, stamp) rw_wunlock(rw)
+#define FRAMEWORK_LOCKSTAT_SLEEP(id, stamp) do { } while (0)
+#define FRAMEWORK_LOCKSTAT_WAKEUP(stamp) do { } while (0)
+
+#endif /* FRAMEWORK_LOCK_PROFILING */
+
+#endif /* __FRAMEWORK_LOCKSTAT_H__ */
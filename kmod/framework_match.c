@@ -0,0 +1,442 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/kernel.h>
+#include <sys/lock.h>
+#include <sys/malloc.h>
+#include <sys/mutex.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include "framework_evdev.h"
+#include "framework_lockstat.h"
+#include "framework_match.h"
+#include "framework_sysctl.h"
+#include "framework_utils.h"
+
+/* devices bound unless configured otherwise */
+#define FRAMEWORK_MATCH_ALLOW_DEFAULT \
+	"TouchPad,Mouse,hcons0,hmt0,hms0,sysmouse,kbdmux,psm,atkbd"
+#define FRAMEWORK_MATCH_DENY_DEFAULT ""
+
+/*
+ * Trie node, children of a node are chained through sibling
+ *
+ * Index 0 is the root; as no node points back to it, 0 also ends
+ * the child and sibling chains.
+ */
+struct framework_match_node_t {
+	uint16_t child;                 /* first child */
+	uint16_t sibling;               /* next child of the parent */
+	char c;                         /* character leading here */
+	bool terminal;                  /* a name pattern ends here */
+};
+
+/*
+ * A compiled allow or deny list
+ */
+struct framework_match_list_t {
+	struct framework_match_node_t *nodes; /* name patterns */
+	uint32_t *ids;                  /* vendor << 16 | product, sorted */
+	uint16_t *vendors;              /* vendor with any product, sorted */
+
+	size_t nnodes;
+	size_t nids;
+	size_t nvendors;
+
+	char text[FRAMEWORK_MATCH_MAXLEN]; /* list as set */
+};
+
+/*
+ * Device matcher
+ *
+ * Lists are compiled without the lock and replaced as a whole.
+ */
+static struct framework_match_t {
+	struct framework_match_list_t *allow; /* (l) */
+	struct framework_match_list_t *deny;  /* (l) */
+
+	struct mtx lock;                      /* l - lock mechanism */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;            /* (l) lock acquisition time */
+#endif
+} framework_match;
+
+#define FRAMEWORK_MATCH_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_MATCH, &(x)->lock, \
+				    &(x)->lockstat_stamp)
+#define FRAMEWORK_MATCH_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_MATCH, &(x)->lock, \
+				      &(x)->lockstat_stamp)
+
+MALLOC_DECLARE(M_FRAMEWORK);
+
+static int
+framework_match_cmp32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int
+framework_match_cmp16(const void *a, const void *b)
+{
+	uint16_t x = *(const uint16_t *)a, y = *(const uint16_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Parse 1 to 4 hex digits
+ */
+static bool
+framework_match_parsehex(const char *s, size_t len, uint16_t *value)
+{
+	uint16_t result = 0;
+
+	if (0 == len || len > 4)
+		return false;
+
+	for (size_t i = 0; i < len; i++) {
+		result <<= 4;
+		if (s[i] >= '0' && s[i] <= '9')
+			result |= s[i] - '0';
+		else if (s[i] >= 'a' && s[i] <= 'f')
+			result |= s[i] - 'a' + 10;
+		else if (s[i] >= 'A' && s[i] <= 'F')
+			result |= s[i] - 'A' + 10;
+		else
+			return false;
+	}
+
+	*value = result;
+	return true;
+}
+
+/*
+ * Add an entry of the form vvvv:pppp or vvvv:*
+ *
+ * Returns false if the entry is no such ID.
+ */
+static bool
+framework_match_addid(struct framework_match_list_t *list,
+		      const char *entry, size_t len)
+{
+	const char *colon = memchr(entry, ':', len);
+	uint16_t vendor = 0, product = 0;
+	size_t vlen = 0;
+
+	if (NULL == colon)
+		return false;
+	vlen = colon - entry;
+
+	if (!framework_match_parsehex(entry, vlen, &vendor))
+		return false;
+
+	if (len - vlen - 1 == 1 && '*' == colon[1]) {
+		list->vendors[list->nvendors++] = vendor;
+		return true;
+	}
+
+	if (!framework_match_parsehex(colon + 1, len - vlen - 1, &product))
+		return false;
+
+	list->ids[list->nids++] = (uint32_t)vendor << 16 | product;
+	return true;
+}
+
+/*
+ * Add a name pattern to the trie
+ */
+static void
+framework_match_addname(struct framework_match_list_t *list,
+			const char *entry, size_t len)
+{
+	struct framework_match_node_t *nodes = list->nodes;
+	uint16_t node = 0, next = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		for (next = nodes[node].child; next; next = nodes[next].sibling)
+			if (nodes[next].c == entry[i])
+				break;
+
+		if (0 == next) {
+			next = list->nnodes++;
+			nodes[next].c = entry[i];
+			nodes[next].sibling = nodes[node].child;
+			nodes[node].child = next;
+		}
+		node = next;
+	}
+
+	nodes[node].terminal = true;
+}
+
+/*
+ * Compile a comma separated list
+ *
+ * Every character adds at most one trie node and every entry at most
+ * one ID, so the tables are sized from the text up front.
+ */
+static struct framework_match_list_t *
+framework_match_compile(const char *text)
+{
+	struct framework_match_list_t *list = NULL;
+	size_t len = strlen(text), nentries = 1;
+	const char *entry = NULL, *end = NULL;
+
+	for (size_t i = 0; i < len; i++)
+		if (',' == text[i])
+			nentries++;
+
+	list = malloc(sizeof(struct framework_match_list_t), M_FRAMEWORK,
+		      M_WAITOK | M_ZERO);
+	list->nodes = malloc(sizeof(struct framework_match_node_t) * (len + 1),
+			     M_FRAMEWORK, M_WAITOK | M_ZERO);
+	list->ids = malloc(sizeof(uint32_t) * nentries, M_FRAMEWORK,
+			   M_WAITOK | M_ZERO);
+	list->vendors = malloc(sizeof(uint16_t) * nentries, M_FRAMEWORK,
+			       M_WAITOK | M_ZERO);
+	list->nnodes = 1;
+	strlcpy(list->text, text, sizeof(list->text));
+
+	for (entry = text; *entry; entry = end) {
+		end = strchr(entry, ',');
+		if (NULL == end)
+			end = entry + strlen(entry);
+
+		/* trim blanks around the entry */
+		const char *first = entry, *last = end;
+		while (first < last && (' ' == *first || '\t' == *first))
+			first++;
+		while (last > first && (' ' == last[-1] || '\t' == last[-1]))
+			last--;
+
+		if (first < last &&
+		    !framework_match_addid(list, first, last - first))
+			framework_match_addname(list, first, last - first);
+
+		if (',' == *end)
+			end++;
+	}
+
+	qsort(list->ids, list->nids, sizeof(uint32_t), framework_match_cmp32);
+	qsort(list->vendors, list->nvendors, sizeof(uint16_t),
+	      framework_match_cmp16);
+
+	DEBUG("match list \"%s\": %zu trie nodes, %zu ids, %zu vendors\n",
+	      list->text, list->nnodes, list->nids, list->nvendors);
+
+	return list;
+}
+
+static void
+framework_match_free(struct framework_match_list_t *list)
+{
+	if (NULL == list)
+		return;
+
+	free(list->nodes, M_FRAMEWORK);
+	free(list->ids, M_FRAMEWORK);
+	free(list->vendors, M_FRAMEWORK);
+	free(list, M_FRAMEWORK);
+}
+
+static bool
+framework_match_isempty(const struct framework_match_list_t *list)
+{
+	return (0 == list->nodes[0].child && 0 == list->nids &&
+		0 == list->nvendors);
+}
+
+/*
+ * Tell whether a name pattern is a prefix of s
+ */
+static bool
+framework_match_prefix(const struct framework_match_list_t *list,
+		       const char *s)
+{
+	const struct framework_match_node_t *nodes = list->nodes;
+	uint16_t node = 0;
+
+	for (; *s; s++) {
+		for (node = nodes[node].child; node; node = nodes[node].sibling)
+			if (nodes[node].c == *s)
+				break;
+		if (0 == node)
+			return false;
+		if (nodes[node].terminal)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Match a device against a list
+ *
+ * The short name has to start with a pattern, the name has to
+ * contain one.
+ */
+static bool
+framework_match_list(const struct framework_match_list_t *list,
+		     const char *name, const char *shortname,
+		     uint16_t vendor, uint16_t product)
+{
+	uint32_t id = (uint32_t)vendor << 16 | product;
+
+	if (list->nids &&
+	    bsearch(&id, list->ids, list->nids, sizeof(uint32_t),
+		    framework_match_cmp32))
+		return true;
+	if (list->nvendors &&
+	    bsearch(&vendor, list->vendors, list->nvendors, sizeof(uint16_t),
+		    framework_match_cmp16))
+		return true;
+
+	if (shortname && framework_match_prefix(list, shortname))
+		return true;
+	for (; name && *name; name++)
+		if (framework_match_prefix(list, name))
+			return true;
+
+	return false;
+}
+
+bool
+framework_match_test(const char *name, const char *shortname,
+		     uint16_t vendor, uint16_t product)
+{
+	struct framework_match_t *mdata = &framework_match;
+	bool result = false;
+
+	FRAMEWORK_MATCH_LOCK(mdata);
+	result = (framework_match_isempty(mdata->allow) ||
+		  framework_match_list(mdata->allow, name, shortname,
+				       vendor, product)) &&
+		!framework_match_list(mdata->deny, name, shortname,
+				      vendor, product);
+	FRAMEWORK_MATCH_UNLOCK(mdata);
+
+	TRACE("match(\"%s\", \"%s\", %04x:%04x) = %d\n",
+	      name ? name : "", shortname ? shortname : "",
+	      vendor, product, result);
+
+	return result;
+}
+
+void
+framework_match_init(void)
+{
+	bzero(&framework_match, sizeof(framework_match));
+
+	framework_match.allow =
+		framework_match_compile(FRAMEWORK_MATCH_ALLOW_DEFAULT);
+	framework_match.deny =
+		framework_match_compile(FRAMEWORK_MATCH_DENY_DEFAULT);
+
+	mtx_init(&framework_match.lock, "framework_match", NULL, MTX_DEF);
+}
+
+/*
+ * Read or replace the allow or deny list
+ *
+ * arg2 tells which; bound devices are matched again after a change.
+ */
+static int
+framework_match_sysctl_list(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_match_t *mdata = &framework_match;
+	struct framework_match_list_t **slot = NULL;
+	struct framework_match_list_t *list = NULL, *old = NULL;
+	char *text = NULL;
+	int error = 0;
+
+	slot = arg2 ? &mdata->deny : &mdata->allow;
+	text = malloc(FRAMEWORK_MATCH_MAXLEN, M_FRAMEWORK, M_WAITOK | M_ZERO);
+
+	FRAMEWORK_MATCH_LOCK(mdata);
+	strlcpy(text, (*slot)->text, FRAMEWORK_MATCH_MAXLEN);
+	FRAMEWORK_MATCH_UNLOCK(mdata);
+
+	error = sysctl_handle_string(oidp, text, FRAMEWORK_MATCH_MAXLEN, req);
+	if (error || NULL == req->newptr) {
+		free(text, M_FRAMEWORK);
+		return (error);
+	}
+
+	list = framework_match_compile(text);
+	free(text, M_FRAMEWORK);
+
+	FRAMEWORK_MATCH_LOCK(mdata);
+	old = *slot;
+	*slot = list;
+	FRAMEWORK_MATCH_UNLOCK(mdata);
+
+	framework_match_free(old);
+
+	framework_evdev_rematch();
+
+	return (0);
+}
+
+void
+framework_match_sysctl_init(struct sysctl_ctx_list *ctx,
+			    struct sysctl_oid *parent)
+{
+	struct sysctl_oid *match_tree = NULL;
+
+	match_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+				     "match", CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				     "Input devices to monitor");
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(match_tree), OID_AUTO, "allow",
+			CTLTYPE_STRING | CTLFLAG_RWTUN | CTLFLAG_MPSAFE,
+			NULL, 0, framework_match_sysctl_list, "A",
+			"Devices to monitor, all if empty");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(match_tree), OID_AUTO, "deny",
+			CTLTYPE_STRING | CTLFLAG_RWTUN | CTLFLAG_MPSAFE,
+			NULL, 1, framework_match_sysctl_list, "A",
+			"Devices never to monitor");
+}
+
+void
+framework_match_destroy(void)
+{
+	framework_match_free(framework_match.allow);
+	framework_match_free(framework_match.deny);
+	framework_match.allow = NULL;
+	framework_match.deny = NULL;
+
+	mtx_destroy(&framework_match.lock);
+}
@@ -0,0 +1,67 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_MATCH_H__
+#define __FRAMEWORK_MATCH_H__
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+/*
+ * Input device matcher
+ *
+ * hw.framework.match.allow and hw.framework.match.deny hold comma
+ * separated entries, also settable as loader tunables.  An entry of
+ * the form vvvv:pppp (hex, pppp may be *) matches the vendor and
+ * product ID of a device; any other entry matches a device whose short
+ * name starts with it or whose name contains it.  A device is bound
+ * if the allow list matches it, or is empty, and the deny list does
+ * not.  Each list is compiled into a prefix trie for names and sorted
+ * ID tables when it is set.
+ */
+
+/* longest list accepted, including the terminating NUL */
+#define FRAMEWORK_MATCH_MAXLEN 1024
+
+/* Initialize matcher with the default lists */
+void framework_match_init(void);
+
+/* Tell whether a device is to be bound */
+bool framework_match_test(const char *name, const char *shortname,
+			  uint16_t vendor, uint16_t product);
+
+/* Add hw.framework.match below parent */
+void framework_match_sysctl_init(struct sysctl_ctx_list *ctx,
+				 struct sysctl_oid *parent);
+
+/* Free matcher */
+void framework_match_destroy(void);
+
+#endif /* __FRAMEWORK_MATCH_H__ */
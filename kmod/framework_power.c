@@ -41,6 +41,7 @@
 #include <sys/types.h>
 #include <sys/callout.h>
 #include <sys/time.h>
+#include <sys/sdt.h>
 
 #include <machine/resource.h>
 #include <machine/bus.h>
@@ -52,8 +53,11 @@
 #include <dev/acpica/acpivar.h>
 #include <dev/acpica/acpiio.h>
 
+#include "framework_counters.h"
+#include "framework_lockstat.h"
 #include "framework_power.h"
 #include "framework_sysctl.h"
+#include "framework_trace.h"
 #include "framework_utils.h"
 
 static struct framework_power_t {
@@ -68,15 +72,28 @@ static struct framework_power_t {
 	struct acpi_battinfo battinfo;
 	/* structure lock */
 	struct mtx lock;
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;     /* (l) lock acquisition time */
+#endif
 	/* when battery info was last loaded */
 	time_t last_update;
 } framework_power;
 
-#define FRAMEWORK_POWER_LOCK() mtx_lock(&framework_power.lock)
-#define FRAMEWORK_POWER_UNLOCK() mtx_unlock(&framework_power.lock)
+#define FRAMEWORK_POWER_LOCK() \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_POWER, \
+				    &framework_power.lock, \
+				    &framework_power.lockstat_stamp)
+#define FRAMEWORK_POWER_UNLOCK() \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_POWER, \
+				      &framework_power.lock, \
+				      &framework_power.lockstat_stamp)
 
 #define FRAMEWORK_POWER_CACHETIME 5
 
+SDT_PROVIDER_DECLARE(framework);
+SDT_PROBE_DEFINE0(framework, power, getpowermode, entry);
+SDT_PROBE_DEFINE1(framework, power, getpowermode, return, "int");
+
 /*
  * Load battery model information from ACPI data
  */
@@ -84,7 +101,10 @@ static int
 framework_pwr_loadbattmodel(void)
 {
 	struct acpi_bix bix = {0};
-	int error = ACPI_BATT_GET_INFO(framework_power.batt_dev, &bix, sizeof(struct acpi_bix));
+	int error = 0;
+
+	FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_ACPI_QUERY);
+	error = ACPI_BATT_GET_INFO(framework_power.batt_dev, &bix, sizeof(struct acpi_bix));
 
 	if (0 != error)
 		return error;
@@ -115,6 +135,7 @@ framework_pwr_loadbattinfo(void)
 		return 0; */
 
 	DEBUG("querying battery info\n");
+	FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_ACPI_QUERY);
 	error = acpi_battery_get_battinfo(NULL,
 					  &local_battinfo);
 	DEBUG("battery query completed with code %d\n", error);
@@ -208,8 +229,15 @@ framework_pwr_init(void)
 enum framework_power_type_t
 framework_pwr_getpowermode(void)
 {
-	if (0 != framework_pwr_loadbattinfo())
-	  return IVL;
+	sbintime_t trace_start = FRAMEWORK_TRACE_START();
+
+	SDT_PROBE0(framework, power, getpowermode, entry);
+
+	if (0 != framework_pwr_loadbattinfo()) {
+		SDT_PROBE1(framework, power, getpowermode, return, IVL);
+		FRAMEWORK_TRACE(FRAMEWORK_TRACE_POWERMODE, trace_start, IVL, 0);
+		return IVL;
+	}
 
 	enum framework_power_type_t result = 0;
 
@@ -217,6 +245,9 @@ framework_pwr_getpowermode(void)
 	result = framework_power.power_state;
 	FRAMEWORK_POWER_UNLOCK();
 
+	SDT_PROBE1(framework, power, getpowermode, return, result);
+	FRAMEWORK_TRACE(FRAMEWORK_TRACE_POWERMODE, trace_start, result, 0);
+
 	return result;
 }
 
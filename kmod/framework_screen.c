@@ -28,13 +28,18 @@
  * SUCH DAMAGE.
  */
 
+#include "framework_lockstat.h"
 #include "framework_power.h"
 #include "framework_screen.h"
 
-#define FRAMEWORK_SCREEN_LOCK(x) mtx_lock(&(x)->lock);
-#define FRAMEWORK_SCREEN_UNLOCK(x) mtx_unlock(&(x)->lock);
+#define FRAMEWORK_SCREEN_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_SCREEN, &(x)->lock, \
+				    &(x)->lockstat_stamp);
+#define FRAMEWORK_SCREEN_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_SCREEN, &(x)->lock, \
+				      &(x)->lockstat_stamp);
 
-#define FRAMEWORK_SCREEN_GETTER(type_size, config_name)	\
+#define FRAMEWORK_SCREEN_GETTER_FIELD(type_size, config_name, field) \
 	static type_size \
 	framework_screen_get ## config_name (struct framework_screen_power_config_t *config, \
 					     struct framework_screen_config_t *screen_config) \
@@ -42,21 +47,30 @@
 		type_size result = 0;					\
 									\
 		FRAMEWORK_SCREEN_LOCK(config);				\
-		result = screen_config->config_name;			\
+		result = screen_config->field;				\
 		FRAMEWORK_SCREEN_UNLOCK(config);			\
 									\
 		return result;						\
 	}
-#define FRAMEWORK_SCREEN_SETTER(type_size, config_name)	\
+#define FRAMEWORK_SCREEN_SETTER_FIELD(type_size, config_name, field) \
 	static void \
 	framework_screen_set ## config_name (struct framework_screen_power_config_t *config, \
 					     struct framework_screen_config_t *screen_config, \
 					     type_size new_value)	\
 	{								\
 		FRAMEWORK_SCREEN_LOCK(config);				\
-		screen_config->config_name = new_value;			\
+		screen_config->field = new_value;			\
+		if (NULL != config->changed)				\
+			config->changed(config->changed_ctx);		\
 		FRAMEWORK_SCREEN_UNLOCK(config);			\
 	}
+#define FRAMEWORK_SCREEN_GETTER(type_size, config_name)	\
+	FRAMEWORK_SCREEN_GETTER_FIELD(type_size, config_name, config_name)
+#define FRAMEWORK_SCREEN_SETTER(type_size, config_name)	\
+	FRAMEWORK_SCREEN_SETTER_FIELD(type_size, config_name, config_name)
+#define FRAMEWORK_SCREEN_SETGET_FIELD(type_size, config_name, field) \
+	FRAMEWORK_SCREEN_GETTER_FIELD(type_size, config_name, field) \
+		FRAMEWORK_SCREEN_SETTER_FIELD(type_size, config_name, field)
 #define FRAMEWORK_SCREEN_SETGET(type_size, config_name)	\
 	FRAMEWORK_SCREEN_GETTER(type_size, config_name) \
 		FRAMEWORK_SCREEN_SETTER(type_size, config_name)
@@ -66,14 +80,16 @@
  * Screen settings 
  */
 struct framework_screen_config_t {
-	uint32_t brightness_low;  /* (l) Dimmed brightness level */
 	uint32_t brightness_high; /* (l) High/on brightness level */
 
 	/*
-	 * Duration of inactivity - timeout after which we switch from
-	 * brightness_high to brightness_low
+	 * Idle stages, each with the duration of inactivity in
+	 * milliseconds after which we switch to its brightness
 	 */
-	uint32_t timeout_secs;
+	struct {
+		uint32_t timeout_ms;      /* (l) 0 disables the stage */
+		uint32_t brightness;      /* (l) brightness in the stage */
+	} stages[FRAMEWORK_SCREEN_MAXSTAGES];
 
 	/*
 	 * The number at which we increment or decrement brightness levels */
@@ -89,11 +105,149 @@ struct framework_screen_data_t {
 	struct framework_screen_config_t battery;
 } framework_screen_data;
 
-FRAMEWORK_SCREEN_SETGET(uint32_t, brightness_low);
+FRAMEWORK_SCREEN_SETGET_FIELD(uint32_t, brightness_low, stages[0].brightness);
 FRAMEWORK_SCREEN_SETGET(uint32_t, brightness_high);
-FRAMEWORK_SCREEN_SETGET(uint32_t, timeout_secs);
+FRAMEWORK_SCREEN_SETGET_FIELD(uint32_t, timeout_ms, stages[0].timeout_ms);
 FRAMEWORK_SCREEN_GETTER(uint8_t, increment_level);
 
+/*
+ * Get timeout in whole seconds
+ */
+static uint32_t
+framework_screen_gettimeout_secs(struct framework_screen_power_config_t *config,
+				 struct framework_screen_config_t *screen_config)
+{
+	return framework_screen_gettimeout_ms(config, screen_config) / 1000;
+}
+
+/*
+ * Set timeout in seconds
+ */
+static void
+framework_screen_settimeout_secs(struct framework_screen_power_config_t *config,
+				 struct framework_screen_config_t *screen_config,
+				 uint32_t new_value)
+{
+	/* cap at what fits in milliseconds */
+	if (new_value > (uint32_t)-1 / 1000)
+		new_value = (uint32_t)-1 / 1000;
+
+	framework_screen_settimeout_ms(config, screen_config, new_value * 1000);
+}
+
+/*
+ * Count enabled idle stages
+ */
+static u_int
+framework_screen_getstages(struct framework_screen_power_config_t *config,
+			   struct framework_screen_config_t *screen_config)
+{
+	uint32_t previous = 0;
+	u_int stages = 0;
+
+	FRAMEWORK_SCREEN_LOCK(config);
+	while (stages < FRAMEWORK_SCREEN_MAXSTAGES &&
+	       screen_config->stages[stages].timeout_ms > previous) {
+		previous = screen_config->stages[stages].timeout_ms;
+		stages++;
+	}
+	FRAMEWORK_SCREEN_UNLOCK(config);
+
+	return stages;
+}
+
+/*
+ * Get idle time until a stage, counted from 0
+ */
+static uint32_t
+framework_screen_getstage_timeout_ms(struct framework_screen_power_config_t *config,
+				     struct framework_screen_config_t *screen_config,
+				     u_int stage)
+{
+	uint32_t result = 0;
+
+	if (stage >= FRAMEWORK_SCREEN_MAXSTAGES)
+		return 0;
+
+	FRAMEWORK_SCREEN_LOCK(config);
+	result = screen_config->stages[stage].timeout_ms;
+	FRAMEWORK_SCREEN_UNLOCK(config);
+
+	return result;
+}
+
+/*
+ * Get brightness of a stage, counted from 0
+ */
+static uint32_t
+framework_screen_getstage_brightness(struct framework_screen_power_config_t *config,
+				     struct framework_screen_config_t *screen_config,
+				     u_int stage)
+{
+	uint32_t result = 0;
+
+	if (stage >= FRAMEWORK_SCREEN_MAXSTAGES)
+		return 0;
+
+	FRAMEWORK_SCREEN_LOCK(config);
+	result = screen_config->stages[stage].brightness;
+	FRAMEWORK_SCREEN_UNLOCK(config);
+
+	return result;
+}
+
+/*
+ * Set idle time until a stage
+ */
+static void
+framework_screen_setstage_timeout_ms(struct framework_screen_power_config_t *config,
+				     struct framework_screen_config_t *screen_config,
+				     u_int stage, uint32_t new_value)
+{
+	if (stage >= FRAMEWORK_SCREEN_MAXSTAGES)
+		return;
+
+	FRAMEWORK_SCREEN_LOCK(config);
+	screen_config->stages[stage].timeout_ms = new_value;
+	if (NULL != config->changed)
+		config->changed(config->changed_ctx);
+	FRAMEWORK_SCREEN_UNLOCK(config);
+}
+
+/*
+ * Set brightness of a stage
+ */
+static void
+framework_screen_setstage_brightness(struct framework_screen_power_config_t *config,
+				     struct framework_screen_config_t *screen_config,
+				     u_int stage, uint32_t new_value)
+{
+	if (stage >= FRAMEWORK_SCREEN_MAXSTAGES)
+		return;
+
+	FRAMEWORK_SCREEN_LOCK(config);
+	screen_config->stages[stage].brightness = new_value;
+	if (NULL != config->changed)
+		config->changed(config->changed_ctx);
+	FRAMEWORK_SCREEN_UNLOCK(config);
+}
+
+/*
+ * Set function to call on changed settings
+ *
+ * The function runs with the config lock held, so once cleared here it
+ * is no longer called.
+ */
+void
+framework_screen_sethook(struct framework_screen_power_config_t *config,
+			 void (*changed)(void *), void *ctx)
+{
+	FRAMEWORK_SCREEN_LOCK(config);
+	config->changed = changed;
+	config->changed_ctx = ctx;
+	FRAMEWORK_SCREEN_UNLOCK(config);
+}
+
 /*
  * Get parent of screen config
  */
@@ -166,13 +320,13 @@ framework_screen_config_changebrightness(struct framework_screen_power_config_t
 int
 framework_screen_init(struct framework_screen_power_config_t *config)
 {
-	framework_screen_data.power.timeout_secs = 10;
-	framework_screen_data.power.brightness_low = 30;
+	framework_screen_data.power.stages[0].timeout_ms = 10000;
+	framework_screen_data.power.stages[0].brightness = 30;
 	framework_screen_data.power.brightness_high = 100;
 	framework_screen_data.power.increment_level = 10;
 
-	framework_screen_data.battery.timeout_secs = 10;
-	framework_screen_data.battery.brightness_low = 3;
+	framework_screen_data.battery.stages[0].timeout_ms = 10000;
+	framework_screen_data.battery.stages[0].brightness = 3;
 	framework_screen_data.battery.brightness_high = 40;
 	framework_screen_data.battery.increment_level = 10;
 
@@ -182,8 +336,15 @@ framework_screen_init(struct framework_screen_power_config_t *config)
 	config->funcs.set_brightness_high = framework_screen_setbrightness_high;
 	config->funcs.get_timeout_secs = framework_screen_gettimeout_secs;
 	config->funcs.set_timeout_secs = framework_screen_settimeout_secs;
+	config->funcs.get_timeout_ms = framework_screen_gettimeout_ms;
+	config->funcs.set_timeout_ms = framework_screen_settimeout_ms;
 	config->funcs.get_increment_level = framework_screen_getincrement_level;
 	config->funcs.change_rel_brightness = framework_screen_config_changebrightness;
+	config->funcs.get_stages = framework_screen_getstages;
+	config->funcs.get_stage_timeout_ms = framework_screen_getstage_timeout_ms;
+	config->funcs.get_stage_brightness = framework_screen_getstage_brightness;
+	config->funcs.set_stage_timeout_ms = framework_screen_setstage_timeout_ms;
+	config->funcs.set_stage_brightness = framework_screen_setstage_brightness;
 
 	mtx_init(&config->lock, "framework_screen", NULL, MTX_DEF);
 	FRAMEWORK_SCREEN_LOCK(config);
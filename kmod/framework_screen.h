@@ -44,6 +44,16 @@
 struct framework_screen_power_config_t;
 struct framework_screen_config_t;
 
+/*
+ * Idle stages per power mode
+ *
+ * Stage n is reached once no input arrived for its timeout and sets
+ * its brightness; stage 1 is configured through brightness_low and
+ * timeout_ms.  A stage is enabled while its timeout exceeds the one
+ * of the previous stage, the first disabled stage ends the table.
+ */
+#define FRAMEWORK_SCREEN_MAXSTAGES 4
+
 /*
  * Functions for working with screen power configs
  */
@@ -54,6 +64,8 @@ struct framework_screen_power_config_funcs_t {
 				       struct framework_screen_config_t *);
 	uint32_t(*get_timeout_secs)(struct framework_screen_power_config_t *,
 				       struct framework_screen_config_t *);
+	uint32_t(*get_timeout_ms)(struct framework_screen_power_config_t *,
+				  struct framework_screen_config_t *);
 	uint8_t(*get_increment_level)(struct framework_screen_power_config_t *,
 				       struct framework_screen_config_t *);
 	void(*set_brightness_low)(struct framework_screen_power_config_t *,
@@ -65,8 +77,25 @@ struct framework_screen_power_config_funcs_t {
 	void(*set_timeout_secs)(struct framework_screen_power_config_t *,
 				struct framework_screen_config_t *,
 				uint32_t);
+	void(*set_timeout_ms)(struct framework_screen_power_config_t *,
+			      struct framework_screen_config_t *,
+			      uint32_t);
 	int(*change_rel_brightness)(struct framework_screen_power_config_t *,
 				    struct framework_screen_config_t *, int);
+	u_int(*get_stages)(struct framework_screen_power_config_t *,
+			   struct framework_screen_config_t *);
+	uint32_t(*get_stage_timeout_ms)(struct framework_screen_power_config_t *,
+					struct framework_screen_config_t *,
+					u_int);
+	uint32_t(*get_stage_brightness)(struct framework_screen_power_config_t *,
+					struct framework_screen_config_t *,
+					u_int);
+	void(*set_stage_timeout_ms)(struct framework_screen_power_config_t *,
+				    struct framework_screen_config_t *,
+				    u_int, uint32_t);
+	void(*set_stage_brightness)(struct framework_screen_power_config_t *,
+				    struct framework_screen_config_t *,
+				    u_int, uint32_t);
 };
 
 struct framework_screen_power_config_t {
@@ -75,13 +104,24 @@ struct framework_screen_power_config_t {
 
 	/* mutex lock for accessing power config */
 	struct mtx lock;
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;     /* (l) lock acquisition time */
+#endif
 
 	struct framework_screen_power_config_funcs_t funcs;
+
+	/* (l) called with the lock held after a setting changed */
+	void (*changed)(void *);
+	void *changed_ctx;             /* (l) argument to changed */
 };
 
 /* Fill config structure with default values */
 int framework_screen_init(struct framework_screen_power_config_t *config);
 
+/* Set function to call on changed settings, NULL to clear */
+void framework_screen_sethook(struct framework_screen_power_config_t *config,
+			      void (*changed)(void *), void *ctx);
+
 /* Get parent structure for screen config */
 struct framework_screen_power_config_t *
 framework_screen_config_parent(struct framework_screen_config_t *screen_config);
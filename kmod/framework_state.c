@@ -30,22 +30,28 @@
 
 #include <sys/malloc.h>
 
+#include "framework_lockstat.h"
 #include "framework_state.h"
 #include "framework_utils.h"
 
 struct framework_state_t {
 	struct mtx lock;          /* l - locking mechanism */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp; /* (l) lock acquisition time */
+#endif
 
 	uint8_t flags;            /* structure state flags */
-
-	uint32_t block_dim_count; /* (l) counter of hints that block dimming */
 };
 
 #define FRAMEWORK_STATE_INIT 1
 #define FRAMEWORK_STATE_DESTROY 2
 
-#define FRAMEWORK_STATE_LOCK(x) mtx_lock(&(x)->lock)
-#define FRAMEWORK_STATE_UNLOCK(x) mtx_unlock(&(x)->lock)
+#define FRAMEWORK_STATE_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_STATE, &(x)->lock, \
+				    &(x)->lockstat_stamp)
+#define FRAMEWORK_STATE_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_STATE, &(x)->lock, \
+				      &(x)->lockstat_stamp)
 
 MALLOC_DECLARE(M_FRAMEWORK);
 
@@ -65,56 +71,6 @@ framework_state_init(void)
 	return state;
 }
 
-/*
- * get current dim count
- */
-uint32_t
-framework_state_getdimcount(struct framework_state_t *state)
-{
-	if (NULL == state)
-		return 0;
-
-	uint32_t counter = 0;
-	
-	FRAMEWORK_STATE_LOCK(state);
-	counter = state->block_dim_count;
-	FRAMEWORK_STATE_UNLOCK(state);
-
-	return counter;	
-}
-
-/*
- * Increment block counter
- */
-void
-framework_state_incdimcount(struct framework_state_t *state)
-{
-	if (NULL == state)
-		return;
-
-	FRAMEWORK_STATE_LOCK(state);
-	state->block_dim_count++;
-	FRAMEWORK_STATE_UNLOCK(state);
-}
-
-/*
- * Decrement block counter
- */
-void
-framework_state_decdimcount(struct framework_state_t *state)
-{
-	if (NULL == state)
-		return;
-
-	FRAMEWORK_STATE_LOCK(state);
-	if (0 == state->block_dim_count) {
-		ERROR("block_dim_count == 0 fails to decrement\n");
-	} else {
-		state->block_dim_count--;
-	}
-	FRAMEWORK_STATE_UNLOCK(state);	
-}
-
 /*
  * Destroy previously initialized state structure
  */
@@ -41,15 +41,6 @@ struct framework_state_t;
 /* Initialize framework state structure */
 struct framework_state_t *framework_state_init(void);
 
-/* Get current counter value */
-uint32_t framework_state_getdimcount(struct framework_state_t *state);
-
-/* Increment block counter */
-void framework_state_incdimcount(struct framework_state_t *state);
-
-/* Decrement block counter */
-void framework_state_decdimcount(struct framework_state_t *state);
-
 /* Destroy a previously allocated state structure */
 void framework_state_destroy(struct framework_state_t *state);
 
@@ -33,9 +33,16 @@
 #include <sys/systm.h>
 
 #include "framework_backlight.h"
+#include "framework_counters.h"
+#include "framework_evdev.h"
+#include "framework_inhibit.h"
+#include "framework_latency.h"
+#include "framework_match.h"
 #include "framework_power.h"
 #include "framework_screen.h"
 #include "framework_sysctl.h"
+#include "framework_trace.h"
+#include "framework_wakeup.h"
 
 static char *FRAMEWORK_POWER_PWR = "PWR";
 static char *FRAMEWORK_POWER_BAT = "BAT";
@@ -119,6 +126,95 @@ framework_sysctl_screen_brightness(SYSCTL_HANDLER_ARGS)
 FRAMEWORK_SYSCTL_SCREENCONF_HANDLER(brightness_low, 100);
 FRAMEWORK_SYSCTL_SCREENCONF_HANDLER(brightness_high, 100);
 FRAMEWORK_SYSCTL_SCREENCONF_HANDLER(timeout_secs, 0);
+FRAMEWORK_SYSCTL_SCREENCONF_HANDLER(timeout_ms, 0);
+
+/*
+ * Called to process the timeout of an idle stage, arg2 is the stage
+ */
+static int
+framework_sysctl_screen_stage_timeout_ms(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_screen_config_t *screen_config = arg1;
+	struct framework_screen_power_config_t *config =
+		framework_screen_config_parent(screen_config);
+	uint32_t value = config->funcs.get_stage_timeout_ms(config,
+							    screen_config,
+							    arg2);
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (0 != error || NULL == req->newptr)
+		return error;
+
+	config->funcs.set_stage_timeout_ms(config, screen_config, arg2, value);
+
+	return 0;
+}
+
+/*
+ * Called to process the brightness of an idle stage, arg2 is the stage
+ */
+static int
+framework_sysctl_screen_stage_brightness(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_screen_config_t *screen_config = arg1;
+	struct framework_screen_power_config_t *config =
+		framework_screen_config_parent(screen_config);
+	uint32_t value = config->funcs.get_stage_brightness(config,
+							    screen_config,
+							    arg2);
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (0 != error || NULL == req->newptr)
+		return error;
+
+	if (value > 100)
+		return (EINVAL);
+
+	config->funcs.set_stage_brightness(config, screen_config, arg2, value);
+
+	return 0;
+}
+
+/*
+ * Add a node per idle stage below a power mode tree
+ */
+static void
+framework_sysctl_stages_init(struct framework_sysctl_t *fsp,
+			     struct sysctl_oid *parent,
+			     struct framework_screen_config_t *screen_config)
+{
+	struct sysctl_oid *stages, *stage;
+	char name[8];
+
+	stages = SYSCTL_ADD_NODE(&fsp->framework_sysctl_ctx,
+				 SYSCTL_CHILDREN(parent), OID_AUTO, "stages",
+				 CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				 "Idle stages, 1 is brightness_low after timeout_ms");
+
+	for (u_int i = 0; i < FRAMEWORK_SCREEN_MAXSTAGES; i++) {
+		snprintf(name, sizeof(name), "%u", i + 1);
+		stage = SYSCTL_ADD_NODE(&fsp->framework_sysctl_ctx,
+					SYSCTL_CHILDREN(stages), OID_AUTO, name,
+					CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+					"Idle stage");
+
+		SYSCTL_ADD_PROC(&fsp->framework_sysctl_ctx,
+				SYSCTL_CHILDREN(stage), OID_AUTO, "timeout_ms",
+				CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+				screen_config, i,
+				framework_sysctl_screen_stage_timeout_ms, "IU",
+				"Idle time until the stage in milliseconds, 0 disables");
+
+		SYSCTL_ADD_PROC(&fsp->framework_sysctl_ctx,
+				SYSCTL_CHILDREN(stage), OID_AUTO, "brightness",
+				CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+				screen_config, i,
+				framework_sysctl_screen_stage_brightness, "IU",
+				"Brightness in the stage");
+	}
+}
 
 /*
  * Called to process power source sysctl
@@ -189,30 +285,81 @@ framework_sysctl_debug(SYSCTL_HANDLER_ARGS)
 	return error;
 }
 
+/*
+ * Writing a non-zero value clears the activity counters
+ */
+static int
+framework_sysctl_stats_reset(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = 0;
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (error || NULL == req->newptr || 0 == value)
+		return (error);
+
+	framework_counters_zero();
+	framework_evdev_zerocounters();
+
+	return (0);
+}
+
+/*
+ * Switch input notification between listener thread and direct mode
+ */
+static int
+framework_sysctl_direct_notify(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = framework_evthread_getdirect() ? 1 : 0;
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (error || NULL == req->newptr)
+		return (error);
+
+	framework_evthread_setdirect(0 != value);
+
+	return (0);
+}
+
+/*
+ * Minimum interval between brightness updates for continuous input
+ */
+static int
+framework_sysctl_notify_interval(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t value = framework_evdev_getnotifyinterval();
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (error || NULL == req->newptr)
+		return (error);
+
+	framework_evdev_setnotifyinterval(value);
+
+	return (0);
+}
+
 /*
  * Called to process dim blocker
+ *
+ * A write of a new value takes or releases one inhibitor; unlike
+ * those of /dev/framework, they stay until released here.
  */
 static int
 framework_sysctl_dimblock(SYSCTL_HANDLER_ARGS)
 {
-	struct framework_state_t *state = arg1;
-
-	uint32_t counter = framework_state_getdimcount(state);
+	uint32_t counter = framework_inhibit_dimblocks();
 	uint32_t value = counter;
 
 	int error = sysctl_handle_32(oidp, &value, 0, req);
+	if (error || NULL == req->newptr)
+		return (error);
 
-	if (value != counter) {
-		if (value > 0) {
-			/* increment counter */
-			framework_state_incdimcount(state);
-		} else {
-			/* decrement counter */
-			framework_state_decdimcount(state);
-		}
-	}
+	if (value != counter)
+		framework_inhibit_dimblock(value > 0);
 
-	return error;
+	return (0);
 }
 
 /*
@@ -252,6 +399,22 @@ framework_sysctl_init(struct framework_sysctl_t *fsp,
 			fsp, 0,
 			framework_sysctl_debug, "IU",
 			"Enable verbose logging");
+
+	SYSCTL_ADD_PROC(&fsp->framework_sysctl_ctx,
+			SYSCTL_CHILDREN(fsp->oid_framework_tree),
+			OID_AUTO, "direct_notify",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0,
+			framework_sysctl_direct_notify, "IU",
+			"Record input from evdev event delivery while >0");
+
+	SYSCTL_ADD_PROC(&fsp->framework_sysctl_ctx,
+			SYSCTL_CHILDREN(fsp->oid_framework_tree),
+			OID_AUTO, "notify_interval_ms",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0,
+			framework_sysctl_notify_interval, "IU",
+			"Minimum interval between brightness updates for input");
 	
 	fsp->oid_framework_screen_tree =
 		FRAMEWORK_SYSCTL_NODE(tree, "screen",
@@ -261,6 +424,10 @@ framework_sysctl_init(struct framework_sysctl_t *fsp,
 		FRAMEWORK_SYSCTL_NODE(tree, "power",
 				"Frame.work battery and power");
 
+	fsp->oid_framework_stats_tree =
+		FRAMEWORK_SYSCTL_NODE(tree, "stats",
+				      "Runtime statistics");
+
 	fsp->oid_framework_screen_power_tree =
 		FRAMEWORK_SYSCTL_NODE(screen_tree, "power",
 				      "Settings when on power");
@@ -273,7 +440,7 @@ framework_sysctl_init(struct framework_sysctl_t *fsp,
 			SYSCTL_CHILDREN(fsp->oid_framework_screen_tree),
 			OID_AUTO, "dimblock",
 			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
-			state, 0,
+			NULL, 0,
 			framework_sysctl_dimblock, "IU",
 			"Block screen from dimming while >0");
 	
@@ -296,6 +463,50 @@ framework_sysctl_init(struct framework_sysctl_t *fsp,
 	FRAMEWORK_SYSCTL_SCREENCONF_NODES(brightness_low, "Lower brightness threshold");
 	FRAMEWORK_SYSCTL_SCREENCONF_NODES(brightness_high, "Upper brightness threshold");
 	FRAMEWORK_SYSCTL_SCREENCONF_NODES(timeout_secs, "Timeout for switch from high to low");
+	FRAMEWORK_SYSCTL_SCREENCONF_NODES(timeout_ms, "Timeout for switch from high to low in milliseconds");
+
+	framework_sysctl_stages_init(fsp, fsp->oid_framework_screen_battery_tree,
+				     power_config->battery);
+	framework_sysctl_stages_init(fsp, fsp->oid_framework_screen_power_tree,
+				     power_config->power);
+
+	SYSCTL_ADD_PROC(&fsp->framework_sysctl_ctx,
+			SYSCTL_CHILDREN(fsp->oid_framework_stats_tree),
+			OID_AUTO, "reset",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0,
+			framework_sysctl_stats_reset, "IU",
+			"Write 1 to clear activity counters");
+
+	framework_counters_sysctl_init(&fsp->framework_sysctl_ctx,
+				       fsp->oid_framework_stats_tree);
+
+	framework_evdev_sysctl_init(&fsp->framework_sysctl_ctx,
+				    fsp->oid_framework_tree,
+				    fsp->oid_framework_stats_tree);
+
+	framework_wakeup_sysctl_init(&fsp->framework_sysctl_ctx,
+				     fsp->oid_framework_stats_tree);
+
+	framework_latency_sysctl_init(&fsp->framework_sysctl_ctx,
+				      fsp->oid_framework_stats_tree);
+
+	framework_trace_sysctl_init(&fsp->framework_sysctl_ctx,
+				    fsp->oid_framework_tree);
+
+	framework_match_sysctl_init(&fsp->framework_sysctl_ctx,
+				    fsp->oid_framework_tree);
+
+	framework_bl_sysctl_init(&fsp->framework_sysctl_ctx,
+				 fsp->oid_framework_tree);
+
+	framework_inhibit_sysctl_init(&fsp->framework_sysctl_ctx,
+				      fsp->oid_framework_tree);
+
+#ifdef FRAMEWORK_LOCK_PROFILING
+	framework_lockstat_sysctl_init(&fsp->framework_sysctl_ctx,
+				       fsp->oid_framework_stats_tree);
+#endif
 
 	sysctl_cache = fsp;
 	
@@ -36,6 +36,7 @@
 #include <sys/lock.h>
 #include <sys/mutex.h>
 
+#include "framework_lockstat.h"
 #include "framework_state.h"
 
 struct framework_sysctl_t {
@@ -45,6 +46,7 @@ struct framework_sysctl_t {
 	struct sysctl_oid *oid_framework_screen_power_tree;
 	struct sysctl_oid *oid_framework_screen_battery_tree;
 	struct sysctl_oid *oid_framework_power_tree;
+	struct sysctl_oid *oid_framework_stats_tree;
 
 	/* Reference to power config */
 	struct framework_screen_power_config_t *power_config;
@@ -54,13 +56,20 @@ struct framework_sysctl_t {
 
 	/* l - sysctl lock */
 	struct mtx lock;
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp; /* (l) lock acquisition time */
+#endif
 	
 	/* (l) debug flag */
 	uint8_t debug;
 };
 
-#define FRAMEWORK_SYSCTL_LOCK(x) mtx_lock(&(x)->lock);
-#define FRAMEWORK_SYSCTL_UNLOCK(x) mtx_unlock(&(x)->lock);
+#define FRAMEWORK_SYSCTL_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_SYSCTL, &(x)->lock, \
+				    &(x)->lockstat_stamp);
+#define FRAMEWORK_SYSCTL_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_SYSCTL, &(x)->lock, \
+				      &(x)->lockstat_stamp);
 
 /* Get current debug level */
 uint8_t framework_sysctl_debuglevel(void);
@@ -0,0 +1,337 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/callout.h>
+#include <sys/kernel.h>
+#include <sys/kthread.h>
+#include <sys/lock.h>
+#include <sys/malloc.h>
+#include <sys/mutex.h>
+#include <sys/proc.h>
+#include <sys/queue.h>
+#include <sys/systm.h>
+
+#include "framework_counters.h"
+#include "framework_lockstat.h"
+#include "framework_sysctl.h"
+#include "framework_timer.h"
+#include "framework_utils.h"
+#include "framework_wakeup.h"
+
+/*
+ * A registered timer
+ */
+struct framework_timer_t {
+	struct callout callout;               /* (t) */
+	const char *name;
+	framework_timer_func func;
+	void *arg;
+	sbintime_t deadline;                  /* (t) armed, 0 if disarmed */
+	sbintime_t precision;                 /* (t) of the armed deadline */
+	bool due;                             /* (t) queued for the thread */
+	STAILQ_ENTRY(framework_timer_t) due_entry; /* (t) */
+};
+
+/*
+ * Service thread running the functions of expired timers
+ */
+static struct framework_timer_service_t {
+	STAILQ_HEAD(, framework_timer_t) due; /* (t) expired timers */
+
+	/* (t) timer whose function is running */
+	struct framework_timer_t *current;
+
+	uint8_t active;          /* (t) flag whether thread should remain active */
+	uint8_t running;         /* (t) thread has not exited yet */
+
+	struct framework_wakeup_t *wakeup;    /* wakeup accounting */
+
+	struct mtx lock;         /* t - timers, also held by their callouts */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;            /* (t) lock acquisition time */
+#endif
+} framework_timer_service;
+
+#define FRAMEWORK_TIMER_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_TIMER, &(x)->lock, \
+				    &(x)->lockstat_stamp)
+#define FRAMEWORK_TIMER_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_TIMER, &(x)->lock, \
+				      &(x)->lockstat_stamp)
+#define FRAMEWORK_TIMER_LOCK_ASSERT(x) mtx_assert(&(x)->lock, MA_OWNED)
+
+MALLOC_DECLARE(M_FRAMEWORK);
+
+/*
+ * Callout of a timer, queues it for the service thread
+ */
+static void
+framework_timer_expire(void *arg)
+{
+	struct framework_timer_service_t *service = &framework_timer_service;
+	struct framework_timer_t *timer = arg;
+
+	FRAMEWORK_TIMER_LOCK_ASSERT(service);
+
+	timer->deadline = 0;
+	if (timer->due)
+		return;
+
+	timer->due = true;
+	if (STAILQ_EMPTY(&service->due))
+		wakeup(service);
+	STAILQ_INSERT_TAIL(&service->due, timer, due_entry);
+}
+
+/*
+ * Tell why msleep returned, called with the service lock held
+ */
+static enum framework_wakeup_reason_t
+framework_timer_wakereason(struct framework_timer_service_t *service,
+			   int error)
+{
+	if (0 != error)
+		return FRAMEWORK_WAKEUP_SPURIOUS;
+	if (!service->active)
+		return FRAMEWORK_WAKEUP_SHUTDOWN;
+	if (!STAILQ_EMPTY(&service->due))
+		return FRAMEWORK_WAKEUP_TIMEOUT;
+
+	return FRAMEWORK_WAKEUP_SPURIOUS;
+}
+
+/*
+ * Service thread, sleeps until a timer expires
+ */
+static void
+framework_timer_thread(void *data)
+{
+	struct framework_timer_service_t *service = data;
+	struct framework_timer_t *timer = NULL;
+	int error = 0;
+
+	TRACE("timer thread start\n");
+
+	FRAMEWORK_TIMER_LOCK(service);
+	while (service->active) {
+		if (STAILQ_EMPTY(&service->due)) {
+			FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_TIMER,
+						 &service->lockstat_stamp);
+			error = msleep(service, &service->lock, 0, "timer", 0);
+			FRAMEWORK_LOCKSTAT_WAKEUP(&service->lockstat_stamp);
+			framework_wakeup_count(service->wakeup,
+					       framework_timer_wakereason(service,
+									  error));
+			continue;
+		}
+
+		timer = STAILQ_FIRST(&service->due);
+		STAILQ_REMOVE_HEAD(&service->due, due_entry);
+		timer->due = false;
+		service->current = timer;
+		FRAMEWORK_TIMER_UNLOCK(service);
+
+		TRACE("timer %s expired\n", timer->name);
+		timer->func(timer->arg);
+
+		FRAMEWORK_TIMER_LOCK(service);
+		service->current = NULL;
+		wakeup(&service->current);
+	}
+	TRACE("timer thread stopped\n");
+
+	service->running = false;
+	wakeup(&service->running);
+	FRAMEWORK_TIMER_UNLOCK(service);
+
+	kthread_exit();
+}
+
+/*
+ * Start the service thread
+ */
+int
+framework_timer_init(void)
+{
+	struct framework_timer_service_t *service = &framework_timer_service;
+	int error = 0;
+
+	STAILQ_INIT(&service->due);
+	service->current = NULL;
+	service->active = true;
+	service->running = true;
+	service->wakeup = framework_wakeup_register("timer");
+
+	mtx_init(&service->lock, "framework_timer", NULL, MTX_DEF);
+
+	error = kthread_add(framework_timer_thread, service, NULL,
+			    NULL, 0, 0, "framework_timer_thread");
+	if (0 != error) {
+		ERROR("kthread_add returned error code %d\n", error);
+		service->running = false;
+		framework_timer_destroy();
+	}
+
+	return error;
+}
+
+/*
+ * Stop the service thread, all timers must be unregistered
+ */
+void
+framework_timer_destroy(void)
+{
+	struct framework_timer_service_t *service = &framework_timer_service;
+
+	FRAMEWORK_TIMER_LOCK(service);
+	service->active = false;
+	wakeup(service);
+	while (service->running) {
+		FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_TIMER,
+					 &service->lockstat_stamp);
+		msleep(&service->running, &service->lock, 0, "sigwait", 0);
+		FRAMEWORK_LOCKSTAT_WAKEUP(&service->lockstat_stamp);
+	}
+	if (!STAILQ_EMPTY(&service->due))
+		ERROR("timer service destroyed with timers due\n");
+	FRAMEWORK_TIMER_UNLOCK(service);
+
+	framework_wakeup_unregister(service->wakeup);
+	service->wakeup = NULL;
+
+	mtx_destroy(&service->lock);
+}
+
+/*
+ * Add a timer, disarmed until scheduled
+ */
+struct framework_timer_t *
+framework_timer_register(const char *name, framework_timer_func func,
+			 void *arg)
+{
+	struct framework_timer_t *timer = NULL;
+
+	timer = malloc(sizeof(struct framework_timer_t), M_FRAMEWORK,
+		       M_WAITOK | M_ZERO);
+
+	timer->name = name;
+	timer->func = func;
+	timer->arg = arg;
+	callout_init_mtx(&timer->callout, &framework_timer_service.lock, 0);
+
+	return timer;
+}
+
+/*
+ * Arm a timer for an absolute sbinuptime() deadline
+ *
+ * An armed deadline within precision of the new one is kept, so
+ * callers may reschedule on every event that might move the deadline
+ * without rearming the callout each time.
+ */
+void
+framework_timer_schedule(struct framework_timer_t *timer,
+			 sbintime_t deadline, sbintime_t precision)
+{
+	struct framework_timer_service_t *service = &framework_timer_service;
+
+	FRAMEWORK_TIMER_LOCK(service);
+	if (0 != timer->deadline &&
+	    timer->deadline >= deadline - precision &&
+	    timer->deadline <= deadline + precision) {
+		FRAMEWORK_TIMER_UNLOCK(service);
+		FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_TIMER_SKIP);
+		return;
+	}
+
+	callout_reset_sbt(&timer->callout, deadline, precision,
+			  framework_timer_expire, timer, C_ABSOLUTE);
+	timer->deadline = deadline;
+	timer->precision = precision;
+	FRAMEWORK_TIMER_UNLOCK(service);
+
+	FRAMEWORK_COUNTER_INC(FRAMEWORK_COUNTER_TIMER_ARM);
+}
+
+/*
+ * Disarm a timer, called with the service lock held
+ */
+static void
+framework_timer_stop(struct framework_timer_service_t *service,
+		     struct framework_timer_t *timer)
+{
+	callout_stop(&timer->callout);
+	timer->deadline = 0;
+	if (timer->due) {
+		STAILQ_REMOVE(&service->due, timer, framework_timer_t,
+			      due_entry);
+		timer->due = false;
+	}
+}
+
+/*
+ * Disarm a timer
+ */
+void
+framework_timer_cancel(struct framework_timer_t *timer)
+{
+	struct framework_timer_service_t *service = &framework_timer_service;
+
+	FRAMEWORK_TIMER_LOCK(service);
+	framework_timer_stop(service, timer);
+	FRAMEWORK_TIMER_UNLOCK(service);
+}
+
+/*
+ * Disarm a timer, wait for its function to return and free it
+ */
+void
+framework_timer_unregister(struct framework_timer_t *timer)
+{
+	struct framework_timer_service_t *service = &framework_timer_service;
+
+	if (NULL == timer)
+		return;
+
+	FRAMEWORK_TIMER_LOCK(service);
+	framework_timer_stop(service, timer);
+	while (service->current == timer) {
+		FRAMEWORK_LOCKSTAT_SLEEP(FRAMEWORK_LOCKSTAT_TIMER,
+					 &service->lockstat_stamp);
+		msleep(&service->current, &service->lock, 0, "sigwait", 0);
+		FRAMEWORK_LOCKSTAT_WAKEUP(&service->lockstat_stamp);
+	}
+	FRAMEWORK_TIMER_UNLOCK(service);
+
+	callout_drain(&timer->callout);
+	free(timer, M_FRAMEWORK);
+}
@@ -0,0 +1,72 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_TIMER_H__
+#define __FRAMEWORK_TIMER_H__
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+/*
+ * Timer service
+ *
+ * Timers are callout(9) deadlines in sbintime with a precision the
+ * callout subsystem may use to coalesce them with other wakeups.  A
+ * timer stays disarmed until scheduled, so nothing wakes up while no
+ * deadline is pending.  Timer functions run on the service thread and
+ * may sleep.
+ */
+struct framework_timer_t;
+
+/* timer function, called with the registered argument */
+typedef void(*framework_timer_func)(void *);
+
+/* Start service thread */
+int framework_timer_init(void);
+
+/* Stop service thread, after all timers are unregistered */
+void framework_timer_destroy(void);
+
+/* Add a disarmed timer */
+struct framework_timer_t *framework_timer_register(const char *name,
+						   framework_timer_func func,
+						   void *arg);
+
+/* Run func once deadline passed, unless already due within precision */
+void framework_timer_schedule(struct framework_timer_t *timer,
+			      sbintime_t deadline, sbintime_t precision);
+
+/* Disarm, a function already running is not waited for */
+void framework_timer_cancel(struct framework_timer_t *timer);
+
+/* Disarm and remove a timer, waits for its function to return */
+void framework_timer_unregister(struct framework_timer_t *timer);
+
+#endif /* __FRAMEWORK_TIMER_H__ */
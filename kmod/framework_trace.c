@@ -0,0 +1,269 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/kernel.h>
+#include <sys/malloc.h>
+#include <sys/proc.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include <machine/atomic.h>
+
+#include "framework_lockstat.h"
+#include "framework_trace.h"
+#include "framework_utils.h"
+
+/* ring capacity in records, a power of two */
+#define FRAMEWORK_TRACE_RECORDS 4096
+
+/*
+ * Trace ring
+ *
+ * head and tail are free running record counts; the ring holds the
+ * records from tail up to head, overwriting the oldest when full.
+ */
+static struct framework_trace_t {
+	struct framework_trace_record_t *ring;  /* (l) allocated on enable */
+
+	uint64_t head;                          /* (l) next record to write */
+	uint64_t tail;                          /* (l) next record to drain */
+	uint32_t dropped;                       /* (l) overwritten since drain */
+
+	struct mtx lock;                        /* l - lock mechanism */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;              /* (l) lock acquisition time */
+#endif
+} framework_trace;
+
+#define FRAMEWORK_TRACE_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_TRACE, &(x)->lock, \
+				    &(x)->lockstat_stamp)
+#define FRAMEWORK_TRACE_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_TRACE, &(x)->lock, \
+				      &(x)->lockstat_stamp)
+
+u_int framework_trace_enabled = 0;
+
+MALLOC_DECLARE(M_FRAMEWORK);
+
+void
+framework_trace_init(void)
+{
+	bzero(&framework_trace, sizeof(framework_trace));
+	atomic_store_int(&framework_trace_enabled, 0);
+
+	mtx_init(&framework_trace.lock, "framework_trace", NULL, MTX_DEF);
+}
+
+void
+framework_trace_record(enum framework_trace_type_t type, sbintime_t start,
+		       int32_t arg0, int32_t arg1)
+{
+	struct framework_trace_record_t *rec = NULL;
+	sbintime_t now = sbinuptime();
+
+	FRAMEWORK_TRACE_LOCK(&framework_trace);
+	if (NULL == framework_trace.ring) {
+		FRAMEWORK_TRACE_UNLOCK(&framework_trace);
+		return;
+	}
+
+	if (framework_trace.head - framework_trace.tail >=
+	    FRAMEWORK_TRACE_RECORDS) {
+		framework_trace.tail++;
+		framework_trace.dropped++;
+	}
+
+	rec = &framework_trace.ring[framework_trace.head %
+				    FRAMEWORK_TRACE_RECORDS];
+	rec->ts_ns = sbttons(start ? start : now);
+	rec->seq = framework_trace.head;
+	rec->dur_ns = start ? sbttons(now - start) : 0;
+	rec->tid = curthread->td_tid;
+	rec->type = type;
+	rec->flags = 0;
+	rec->arg0 = arg0;
+	rec->arg1 = arg1;
+	framework_trace.head++;
+	FRAMEWORK_TRACE_UNLOCK(&framework_trace);
+}
+
+/*
+ * Enable or disable recording; the ring is allocated on first enable
+ */
+static int
+framework_trace_sysctl_enable(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_trace_record_t *ring = NULL;
+	uint32_t value = atomic_load_int(&framework_trace_enabled);
+	int error = 0;
+
+	error = sysctl_handle_32(oidp, &value, 0, req);
+	if (error || NULL == req->newptr)
+		return (error);
+
+	if (value) {
+		ring = malloc(sizeof(struct framework_trace_record_t) *
+			      FRAMEWORK_TRACE_RECORDS, M_FRAMEWORK,
+			      M_WAITOK | M_ZERO);
+
+		FRAMEWORK_TRACE_LOCK(&framework_trace);
+		if (NULL == framework_trace.ring) {
+			framework_trace.ring = ring;
+			ring = NULL;
+		}
+		FRAMEWORK_TRACE_UNLOCK(&framework_trace);
+
+		if (ring)
+			free(ring, M_FRAMEWORK);
+	}
+
+	atomic_store_int(&framework_trace_enabled, value ? 1 : 0);
+
+	return (0);
+}
+
+/*
+ * Drain the ring, as many records as fit into the request
+ */
+static int
+framework_trace_sysctl_records(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_trace_header_t header = {0};
+	struct framework_trace_record_t *buffer = NULL;
+	uint64_t pending = 0;
+	size_t room = 0;
+	int error = 0;
+
+	header.magic = FRAMEWORK_TRACE_MAGIC;
+	header.version = FRAMEWORK_TRACE_VERSION;
+	header.record_size = sizeof(struct framework_trace_record_t);
+
+	FRAMEWORK_TRACE_LOCK(&framework_trace);
+	pending = framework_trace.head - framework_trace.tail;
+	FRAMEWORK_TRACE_UNLOCK(&framework_trace);
+
+	/* size query */
+	if (NULL == req->oldptr)
+		return SYSCTL_OUT(req, NULL, sizeof(header) +
+				  pending * sizeof(struct framework_trace_record_t));
+
+	if (req->oldlen > sizeof(header))
+		room = (req->oldlen - sizeof(header)) /
+			sizeof(struct framework_trace_record_t);
+	if (room > FRAMEWORK_TRACE_RECORDS)
+		room = FRAMEWORK_TRACE_RECORDS;
+	if (room)
+		buffer = malloc(sizeof(struct framework_trace_record_t) * room,
+				M_FRAMEWORK, M_WAITOK);
+
+	/* copy out of the ring under the lock, to userland without it */
+	FRAMEWORK_TRACE_LOCK(&framework_trace);
+	pending = framework_trace.head - framework_trace.tail;
+	if (NULL == framework_trace.ring)
+		pending = 0;
+	if (pending > room)
+		pending = room;
+	for (uint64_t i = 0; i < pending; i++) {
+		buffer[i] = framework_trace.ring[framework_trace.tail %
+						 FRAMEWORK_TRACE_RECORDS];
+		framework_trace.tail++;
+	}
+	header.count = pending;
+	header.dropped = framework_trace.dropped;
+	framework_trace.dropped = 0;
+	FRAMEWORK_TRACE_UNLOCK(&framework_trace);
+
+	error = SYSCTL_OUT(req, &header, sizeof(header));
+	if (0 == error && pending)
+		error = SYSCTL_OUT(req, buffer, pending *
+				   sizeof(struct framework_trace_record_t));
+
+	if (buffer)
+		free(buffer, M_FRAMEWORK);
+
+	return (error);
+}
+
+/*
+ * Number of records waiting to be drained
+ */
+static int
+framework_trace_sysctl_pending(SYSCTL_HANDLER_ARGS)
+{
+	uint32_t pending = 0;
+
+	FRAMEWORK_TRACE_LOCK(&framework_trace);
+	pending = framework_trace.head - framework_trace.tail;
+	FRAMEWORK_TRACE_UNLOCK(&framework_trace);
+
+	return sysctl_handle_32(oidp, &pending, 0, req);
+}
+
+void
+framework_trace_sysctl_init(struct sysctl_ctx_list *ctx,
+			    struct sysctl_oid *parent)
+{
+	struct sysctl_oid *trace_tree = NULL;
+
+	trace_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+				     "trace", CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				     "Input and decision trace recorder");
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(trace_tree), OID_AUTO, "enable",
+			CTLTYPE_U32 | CTLFLAG_RW | CTLFLAG_MPSAFE,
+			NULL, 0, framework_trace_sysctl_enable, "IU",
+			"Record trace events while >0");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(trace_tree), OID_AUTO, "pending",
+			CTLTYPE_U32 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_trace_sysctl_pending, "IU",
+			"Records waiting to be drained");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(trace_tree), OID_AUTO, "records",
+			CTLTYPE_OPAQUE | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_trace_sysctl_records, "S",
+			"Drain trace records (binary)");
+	SYSCTL_ADD_U32(ctx, SYSCTL_CHILDREN(trace_tree), OID_AUTO, "size",
+		       CTLFLAG_RD | CTLFLAG_MPSAFE, NULL,
+		       FRAMEWORK_TRACE_RECORDS, "Ring capacity in records");
+}
+
+void
+framework_trace_destroy(void)
+{
+	atomic_store_int(&framework_trace_enabled, 0);
+
+	if (framework_trace.ring)
+		free(framework_trace.ring, M_FRAMEWORK);
+	framework_trace.ring = NULL;
+
+	mtx_destroy(&framework_trace.lock);
+}
@@ -0,0 +1,119 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_TRACE_H__
+#define __FRAMEWORK_TRACE_H__
+
+/*
+ * Input/decision trace recorder
+ *
+ * When enabled through hw.framework.trace.enable, input events, idle
+ * stage changes, power mode reads and backlight writes are appended
+ * to a preallocated ring of fixed size records.  Reading
+ * hw.framework.trace.records (e.g. sysctl -b) drains the ring; each
+ * read returns a header followed by the records it consumed.
+ *
+ * The record layout below is shared with the userland converter
+ * framework-trace(1) and therefore must not depend on kernel headers.
+ * Records are in host byte order.
+ */
+#ifdef _KERNEL
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#define FRAMEWORK_TRACE_MAGIC 0x52545746   /* "FWTR" */
+#define FRAMEWORK_TRACE_VERSION 3
+
+enum framework_trace_type_t {
+	FRAMEWORK_TRACE_INPUT = 1,   /* arg0 = first key or -1, arg1 = keys */
+	FRAMEWORK_TRACE_LEVEL,       /* arg0 = old idle stage, arg1 = new,
+					0 while in use */
+	FRAMEWORK_TRACE_POWERMODE,   /* arg0 = power mode, spans the read */
+	FRAMEWORK_TRACE_BACKLIGHT    /* arg0 = brightness, arg1 = error,
+					spans the write */
+};
+
+/* Precedes the records returned by one drain */
+struct framework_trace_header_t {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;
+	uint32_t count;              /* records following */
+	uint32_t dropped;            /* records overwritten since last drain */
+};
+
+struct framework_trace_record_t {
+	uint64_t ts_ns;              /* uptime at start of the event */
+	uint64_t dur_ns;             /* duration, 0 for instant events */
+	uint32_t seq;                /* record sequence number */
+	uint32_t tid;                /* recording thread */
+	uint16_t type;               /* enum framework_trace_type_t */
+	uint16_t flags;
+	int32_t arg0;
+	int32_t arg1;
+};
+
+#ifdef _KERNEL
+
+#include <sys/sysctl.h>
+
+#include <machine/atomic.h>
+
+/* non-zero while recording, checked before any timestamp is taken */
+extern u_int framework_trace_enabled;
+
+/* Initialize recorder, disabled */
+void framework_trace_init(void);
+
+/* Append a record; a non-zero start makes it span start until now */
+void framework_trace_record(enum framework_trace_type_t type,
+			    sbintime_t start, int32_t arg0, int32_t arg1);
+
+/* Add hw.framework.trace below parent */
+void framework_trace_sysctl_init(struct sysctl_ctx_list *ctx,
+				 struct sysctl_oid *parent);
+
+/* Destroy recorder and free ring */
+void framework_trace_destroy(void);
+
+/* Start time for a span, or 0 while disabled */
+#define FRAMEWORK_TRACE_START() \
+	(atomic_load_int(&framework_trace_enabled) ? sbinuptime() : 0)
+
+#define FRAMEWORK_TRACE(type, start, arg0, arg1) do {			\
+		if (atomic_load_int(&framework_trace_enabled))		\
+			framework_trace_record(type, start, arg0, arg1); \
+	} while (0)
+
+#endif /* _KERNEL */
+
+#endif /* __FRAMEWORK_TRACE_H__ */
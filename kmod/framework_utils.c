@@ -45,6 +45,8 @@
 #include "framework_screen.h"
 #include "framework_utils.h"
 
+MALLOC_DECLARE(M_FRAMEWORK);
+
 /*
  * Retrieve correct screen config to use in current operating mode
  */
@@ -89,16 +91,49 @@ void *
 framework_util_lookupcdev_drv1(const char *devname)
 {
 	struct cdev_priv *cdp = NULL;
+	void *drv1 = NULL;
 
+	dev_lock();
 	TAILQ_FOREACH(cdp, &cdevp_list, cdp_list) {
 		if (*devname != *cdp->cdp_c.si_name)
 			continue;
 
-		if (0 == strcmp(devname, cdp->cdp_c.si_name))
-			return cdp->cdp_c.si_drv1;
+		if (0 == strcmp(devname, cdp->cdp_c.si_name)) {
+			drv1 = cdp->cdp_c.si_drv1;
+			break;
+		}
 	}
+	dev_unlock();
 	
-	return NULL;
+	return drv1;
+}
+
+/*
+ * Reference up to max character devices whose name starts with
+ * devname, returns how many there are
+ */
+static size_t
+framework_util_refcdevs(const char *devname, struct cdev **devs, size_t max)
+{
+	struct cdev_priv *cdp = NULL;
+	size_t name_len = strlen(devname);
+	size_t count = 0;
+
+	dev_lock();
+	TAILQ_FOREACH(cdp, &cdevp_list, cdp_list) {
+		if (!(cdp->cdp_flags & CDP_ACTIVE) ||
+		    0 != strncmp(devname, cdp->cdp_c.si_name, name_len))
+			continue;
+
+		if (count < max) {
+			dev_refl(&cdp->cdp_c);
+			devs[count] = &cdp->cdp_c;
+		}
+		count++;
+	}
+	dev_unlock();
+
+	return count;
 }
 
 /*
@@ -107,28 +142,44 @@ framework_util_lookupcdev_drv1(const char *devname)
  *
  * Calls cbfunc with full device name and driver pointer
  * Stops iteration if cbfunc returns non-zero return value
+ *
+ * cbfunc runs without the devfs lock, holding the device like its
+ * own methods do, so it may sleep while the device is destroyed.
  */
 int
 framework_util_matchcdev_drv1(const char *devname,
 			      framework_cdev_cbmatch cbfunc,
 			      void *ctx)
 {
-	struct cdev_priv *cdp = NULL;
+	struct cdev **devs = NULL;
+	size_t count = 0, ndevs = 0;
 	int result = 0;
-	size_t name_len = strlen(devname);
+	int ref = 0;
 
-	TAILQ_FOREACH(cdp, &cdevp_list, cdp_list) {
-		if (*devname != *cdp->cdp_c.si_name)
-			continue;
+	/* devices may come and go while the list is unlocked */
+	ndevs = framework_util_refcdevs(devname, NULL, 0);
+	do {
+		for (size_t i = 0; i < count; i++)
+			dev_rel(devs[i]);
+		free(devs, M_FRAMEWORK);
 
-		if (0 == strncmp(devname, cdp->cdp_c.si_name, name_len)) {
-			if (cbfunc)
-				result |= cbfunc(cdp->cdp_c.si_name, cdp->cdp_c.si_drv1, ctx);
+		count = ndevs;
+		devs = malloc(MAX(count, 1) * sizeof(*devs), M_FRAMEWORK,
+			      M_WAITOK);
+		ndevs = framework_util_refcdevs(devname, devs, count);
+	} while (ndevs > count);
 
-			if (result)
-				break;
+	for (size_t i = 0; i < ndevs; i++) {
+		/* destroy_dev() waits for us before the driver goes away */
+		if (0 == result && cbfunc &&
+		    NULL != dev_refthread(devs[i], &ref)) {
+			result |= cbfunc(devs[i]->si_name, devs[i]->si_drv1,
+					 ctx);
+			dev_relthread(devs[i], ref);
 		}
+		dev_rel(devs[i]);
 	}
+	free(devs, M_FRAMEWORK);
 	
 	return result;
 }
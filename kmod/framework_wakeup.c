@@ -0,0 +1,307 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/kernel.h>
+#include <sys/malloc.h>
+#include <sys/queue.h>
+#include <sys/sbuf.h>
+#include <sys/sysctl.h>
+#include <sys/systm.h>
+
+#include <machine/atomic.h>
+
+#include "framework_lockstat.h"
+#include "framework_utils.h"
+#include "framework_wakeup.h"
+
+/* length of the rate window, in seconds */
+#define FRAMEWORK_WAKEUP_WINDOW 60
+#define FRAMEWORK_WAKEUP_NAMELEN 32
+
+/*
+ * Wakeup statistics of one thread
+ *
+ * Counters are only written by the owning thread and read without
+ * locking, so sysctl readers may see a slightly stale window.
+ */
+struct framework_wakeup_t {
+	LIST_ENTRY(framework_wakeup_t) entries;   /* (l) */
+
+	char name[FRAMEWORK_WAKEUP_NAMELEN];
+
+	uint64_t count[FRAMEWORK_WAKEUP_REASONS];
+
+	/* wakeups per second of uptime, for the rate */
+	struct {
+		time_t second;
+		uint32_t count;
+	} window[FRAMEWORK_WAKEUP_WINDOW];
+};
+
+static struct framework_wakeup_registry_t {
+	LIST_HEAD(, framework_wakeup_t) threads;  /* (l) registered threads */
+
+	/* (l) counts of threads that already exited */
+	uint64_t exited[FRAMEWORK_WAKEUP_REASONS];
+
+	struct mtx lock;                          /* l - lock mechanism */
+#ifdef FRAMEWORK_LOCK_PROFILING
+	sbintime_t lockstat_stamp;                /* (l) lock acquisition time */
+#endif
+} framework_wakeup_registry;
+
+#define FRAMEWORK_WAKEUP_LOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_LOCK(FRAMEWORK_LOCKSTAT_WAKEUP, &(x)->lock, \
+				    &(x)->lockstat_stamp)
+#define FRAMEWORK_WAKEUP_UNLOCK(x) \
+	FRAMEWORK_LOCKSTAT_MTX_UNLOCK(FRAMEWORK_LOCKSTAT_WAKEUP, &(x)->lock, \
+				      &(x)->lockstat_stamp)
+
+static const char *framework_wakeup_reasons[FRAMEWORK_WAKEUP_REASONS] = {
+	"timeout",
+	"input",
+	"shutdown",
+	"spurious",
+	"hotplug"
+};
+
+MALLOC_DECLARE(M_FRAMEWORK);
+
+void
+framework_wakeup_init(void)
+{
+	LIST_INIT(&framework_wakeup_registry.threads);
+	bzero(framework_wakeup_registry.exited,
+	      sizeof(framework_wakeup_registry.exited));
+
+	mtx_init(&framework_wakeup_registry.lock,
+		 "framework_wakeup", NULL, MTX_DEF);
+}
+
+struct framework_wakeup_t *
+framework_wakeup_register(const char *name)
+{
+	struct framework_wakeup_t *wakeup = NULL;
+
+	wakeup = malloc(sizeof(struct framework_wakeup_t), M_FRAMEWORK,
+			M_WAITOK | M_ZERO);
+	strlcpy(wakeup->name, name, sizeof(wakeup->name));
+
+	FRAMEWORK_WAKEUP_LOCK(&framework_wakeup_registry);
+	LIST_INSERT_HEAD(&framework_wakeup_registry.threads, wakeup, entries);
+	FRAMEWORK_WAKEUP_UNLOCK(&framework_wakeup_registry);
+
+	return wakeup;
+}
+
+void
+framework_wakeup_count(struct framework_wakeup_t *wakeup,
+		       enum framework_wakeup_reason_t reason)
+{
+	time_t now = time_uptime;
+	int slot = now % FRAMEWORK_WAKEUP_WINDOW;
+
+	if (NULL == wakeup)
+		return;
+
+	atomic_add_64(&wakeup->count[reason], 1);
+
+	if (wakeup->window[slot].second != now) {
+		atomic_store_32(&wakeup->window[slot].count, 0);
+		wakeup->window[slot].second = now;
+	}
+	atomic_add_32(&wakeup->window[slot].count, 1);
+}
+
+void
+framework_wakeup_unregister(struct framework_wakeup_t *wakeup)
+{
+	if (NULL == wakeup)
+		return;
+
+	FRAMEWORK_WAKEUP_LOCK(&framework_wakeup_registry);
+	LIST_REMOVE(wakeup, entries);
+	for (int i = 0; i < FRAMEWORK_WAKEUP_REASONS; i++)
+		framework_wakeup_registry.exited[i] += wakeup->count[i];
+	FRAMEWORK_WAKEUP_UNLOCK(&framework_wakeup_registry);
+
+	free(wakeup, M_FRAMEWORK);
+}
+
+/*
+ * Wakeups within the last minute
+ */
+static uint32_t
+framework_wakeup_rate(struct framework_wakeup_t *wakeup, time_t now)
+{
+	uint32_t rate = 0;
+
+	for (int i = 0; i < FRAMEWORK_WAKEUP_WINDOW; i++) {
+		if (wakeup->window[i].second + FRAMEWORK_WAKEUP_WINDOW <= now)
+			continue;
+		rate += atomic_load_32(&wakeup->window[i].count);
+	}
+
+	return rate;
+}
+
+static uint64_t
+framework_wakeup_total(const uint64_t *count)
+{
+	uint64_t total = 0;
+
+	for (int i = 0; i < FRAMEWORK_WAKEUP_REASONS; i++)
+		total += atomic_load_64(&count[i]);
+
+	return total;
+}
+
+static void
+framework_wakeup_printrow(struct sbuf *sb, const char *name,
+			  const uint64_t *count, uint32_t rate)
+{
+	sbuf_printf(sb, "\n%-24s %10ju", name,
+		    (uintmax_t)framework_wakeup_total(count));
+	for (int i = 0; i < FRAMEWORK_WAKEUP_REASONS; i++)
+		sbuf_printf(sb, " %10ju", (uintmax_t)atomic_load_64(&count[i]));
+	sbuf_printf(sb, " %10u", rate);
+}
+
+/*
+ * Print wakeup table, one row per thread
+ */
+static int
+framework_wakeup_sysctl_threads(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_wakeup_t *wakeup = NULL;
+	time_t now = time_uptime;
+	struct sbuf *sb;
+	int error = 0;
+
+	/* no page faults while holding the lock */
+	error = sysctl_wire_old_buffer(req, 0);
+	if (0 != error)
+		return (error);
+
+	sb = sbuf_new_for_sysctl(NULL, NULL, 512, req);
+	if (NULL == sb)
+		return (ENOMEM);
+
+	sbuf_printf(sb, "%-24s %10s", "thread", "total");
+	for (int i = 0; i < FRAMEWORK_WAKEUP_REASONS; i++)
+		sbuf_printf(sb, " %10s", framework_wakeup_reasons[i]);
+	sbuf_printf(sb, " %10s", "per_min");
+
+	FRAMEWORK_WAKEUP_LOCK(&framework_wakeup_registry);
+	LIST_FOREACH(wakeup, &framework_wakeup_registry.threads, entries) {
+		framework_wakeup_printrow(sb, wakeup->name, wakeup->count,
+					  framework_wakeup_rate(wakeup, now));
+	}
+	framework_wakeup_printrow(sb, "(exited)",
+				  framework_wakeup_registry.exited, 0);
+	FRAMEWORK_WAKEUP_UNLOCK(&framework_wakeup_registry);
+
+	error = sbuf_finish(sb);
+	sbuf_delete(sb);
+
+	return (error);
+}
+
+/*
+ * Sum of wakeups within the last minute across all threads
+ */
+static int
+framework_wakeup_sysctl_rate(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_wakeup_t *wakeup = NULL;
+	time_t now = time_uptime;
+	uint32_t rate = 0;
+
+	FRAMEWORK_WAKEUP_LOCK(&framework_wakeup_registry);
+	LIST_FOREACH(wakeup, &framework_wakeup_registry.threads, entries)
+		rate += framework_wakeup_rate(wakeup, now);
+	FRAMEWORK_WAKEUP_UNLOCK(&framework_wakeup_registry);
+
+	return sysctl_handle_32(oidp, &rate, 0, req);
+}
+
+/*
+ * Sum of all wakeups since load, including exited threads
+ */
+static int
+framework_wakeup_sysctl_total(SYSCTL_HANDLER_ARGS)
+{
+	struct framework_wakeup_t *wakeup = NULL;
+	uint64_t total = 0;
+
+	FRAMEWORK_WAKEUP_LOCK(&framework_wakeup_registry);
+	LIST_FOREACH(wakeup, &framework_wakeup_registry.threads, entries)
+		total += framework_wakeup_total(wakeup->count);
+	total += framework_wakeup_total(framework_wakeup_registry.exited);
+	FRAMEWORK_WAKEUP_UNLOCK(&framework_wakeup_registry);
+
+	return sysctl_handle_64(oidp, &total, 0, req);
+}
+
+void
+framework_wakeup_sysctl_init(struct sysctl_ctx_list *ctx,
+			     struct sysctl_oid *parent)
+{
+	struct sysctl_oid *wakeup_tree = NULL;
+
+	wakeup_tree = SYSCTL_ADD_NODE(ctx, SYSCTL_CHILDREN(parent), OID_AUTO,
+				      "wakeups", CTLFLAG_RD | CTLFLAG_MPSAFE, 0,
+				      "Kernel thread wakeups");
+
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(wakeup_tree), OID_AUTO, "threads",
+			CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_wakeup_sysctl_threads, "A",
+			"Wakeups per thread and reason");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(wakeup_tree), OID_AUTO,
+			"per_minute",
+			CTLTYPE_U32 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_wakeup_sysctl_rate, "IU",
+			"Wakeups of all threads within the last minute");
+	SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(wakeup_tree), OID_AUTO, "total",
+			CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE,
+			NULL, 0, framework_wakeup_sysctl_total, "QU",
+			"Wakeups of all threads since load");
+}
+
+void
+framework_wakeup_destroy(void)
+{
+	if (!LIST_EMPTY(&framework_wakeup_registry.threads))
+		ERROR("wakeup registry destroyed with threads registered\n");
+
+	mtx_destroy(&framework_wakeup_registry.lock);
+}
@@ -0,0 +1,75 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __FRAMEWORK_WAKEUP_H__
+#define __FRAMEWORK_WAKEUP_H__
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+/*
+ * Kernel thread wakeup accounting
+ *
+ * Each kthread registers once and counts every return from msleep(9)
+ * with the reason it woke up.  The figures are exported as a table
+ * under hw.framework.stats.wakeups.
+ */
+enum framework_wakeup_reason_t {
+	FRAMEWORK_WAKEUP_TIMEOUT,   /* sleep timed out */
+	FRAMEWORK_WAKEUP_INPUT,     /* woken with input to process */
+	FRAMEWORK_WAKEUP_SHUTDOWN,  /* woken to terminate */
+	FRAMEWORK_WAKEUP_SPURIOUS,  /* woken with nothing to do */
+	FRAMEWORK_WAKEUP_HOTPLUG,   /* woken for device arrival/departure */
+	FRAMEWORK_WAKEUP_REASONS
+};
+
+struct framework_wakeup_t;
+
+/* Initialize thread registry */
+void framework_wakeup_init(void);
+
+/* Register a thread for accounting */
+struct framework_wakeup_t *framework_wakeup_register(const char *name);
+
+/* Count a wakeup; only called by the owning thread */
+void framework_wakeup_count(struct framework_wakeup_t *wakeup,
+			    enum framework_wakeup_reason_t reason);
+
+/* Remove a thread, its counts are kept in the exited row */
+void framework_wakeup_unregister(struct framework_wakeup_t *wakeup);
+
+/* Add hw.framework.stats.wakeups below parent */
+void framework_wakeup_sysctl_init(struct sysctl_ctx_list *ctx,
+				  struct sysctl_oid *parent);
+
+/* Destroy thread registry */
+void framework_wakeup_destroy(void);
+
+#endif /* __FRAMEWORK_WAKEUP_H__ */
@@ -0,0 +1,321 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Multi-device input flood
+ *
+ * Floods 1, 2, 4, ... N input devices at realistic rates from several
+ * producer threads and reports, per step, the CPU time spent in the
+ * module's kernel threads, lock contention and dropped reports.
+ *
+ * Devices cycle through a 1 kHz mouse, a 125 Hz touchpad, a keyboard
+ * in key repeat (30 Hz) and kbdmux mirroring it.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shim.h"
+
+#define NS_PER_S	1000000000LL
+#define FLOOD_MAXDEVS	64
+#define FLOOD_MAXLOCKS	64
+
+struct flood_type {
+	const char *name;
+	const char *shortname;
+	uint16_t bustype;
+	int rate;		/* reports per second */
+	size_t report_size;
+	uint32_t types;		/* supported event types */
+};
+
+static const struct flood_type flood_types[] = {
+	{ "Logitech USB Optical Mouse", "ums", BUS_USB, 1000, 4,
+	  SHIM_EV_MOUSE },
+	{ "PIXA3854:00 093A:0274 TouchPad", "hmt", BUS_I2C, 125, 8,
+	  SHIM_EV_TOUCHPAD },
+	{ "AT Translated Set 2 keyboard", "atkbd", BUS_I8042, 30, 4,
+	  SHIM_EV_KEYBOARD },
+	{ "System keyboard multiplexer", "kbdmux", BUS_VIRTUAL, 30, 4,
+	  SHIM_EV_KEYBOARD }
+};
+
+struct flood_dev {
+	const struct flood_type *type;
+	struct evdev_dev *evdev;
+	int64_t next;		/* due time of the next report */
+	uint64_t reports;
+};
+
+struct flood_producer {
+	pthread_t td;
+	struct flood_dev *devs[FLOOD_MAXDEVS];
+	int ndevs;
+	int64_t end;
+};
+
+static struct flood_dev flood_devs[FLOOD_MAXDEVS];
+
+static int64_t
+flood_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * NS_PER_S + ts.tv_nsec);
+}
+
+static int64_t
+flood_cputime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+	return (ts.tv_sec * NS_PER_S + ts.tv_nsec);
+}
+
+static void
+flood_report(struct flood_dev *dev)
+{
+	struct evdev_dev *evdev = dev->evdev;
+
+	switch (dev->type->bustype) {
+	case BUS_USB:
+		shim_evdev_push(evdev, EV_REL, REL_X, 2);
+		shim_evdev_push(evdev, EV_REL, REL_Y, -1);
+		break;
+	case BUS_I2C:
+		shim_evdev_push(evdev, EV_ABS, ABS_X, 400 + dev->reports % 64);
+		shim_evdev_push(evdev, EV_ABS, ABS_Y, 300);
+		break;
+	default:
+		/* autorepeat */
+		shim_evdev_push(evdev, EV_KEY, KEY_A, 2);
+		break;
+	}
+	shim_evdev_sync(evdev);
+	dev->reports++;
+}
+
+static void *
+flood_produce(void *arg)
+{
+	struct flood_producer *p = arg;
+	struct flood_dev *dev;
+	struct timespec ts;
+
+	for (;;) {
+		dev = p->devs[0];
+		for (int i = 1; i < p->ndevs; i++) {
+			if (p->devs[i]->next < dev->next)
+				dev = p->devs[i];
+		}
+		if (dev->next >= p->end)
+			break;
+
+		ts.tv_sec = dev->next / NS_PER_S;
+		ts.tv_nsec = dev->next % NS_PER_S;
+		while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+						&ts, NULL))
+			;
+
+		flood_report(dev);
+		dev->next += NS_PER_S / dev->type->rate;
+	}
+
+	return (NULL);
+}
+
+static void
+flood_step(int ndevs, int nthreads, int seconds)
+{
+	struct flood_producer producers[nthreads];
+	struct shim_lockstat_info locks[FLOOD_MAXLOCKS];
+	int64_t kcpu, pcpu, wall, start;
+	uint64_t wakeups, reports = 0, dropped = 0;
+	int nlocks, error;
+
+	for (int i = 0; i < ndevs; i++) {
+		const struct flood_type *type =
+			&flood_types[i % (sizeof(flood_types) / sizeof(flood_types[0]))];
+		char shortname[32];
+
+		snprintf(shortname, sizeof(shortname), "%s%d",
+			 type->shortname, i);
+		flood_devs[i].type = type;
+		flood_devs[i].reports = 0;
+		flood_devs[i].evdev = shim_evdev_create(type->name, shortname,
+							type->bustype, 0, 0,
+							type->report_size,
+							type->types);
+	}
+
+	error = shim_kldload("framework");
+	if (0 != error)
+		errx(1, "kldload failed with error %d", error);
+	for (int i = 0; i < ndevs; i++) {
+		for (int wait = 0;
+		     shim_evdev_nclients(flood_devs[i].evdev) < 1; wait++) {
+			if (wait > 5000)
+				errx(1, "module did not bind %s",
+				     flood_devs[i].type->name);
+			usleep(1000);
+		}
+	}
+	shim_vclock_settle();
+
+	memset(producers, 0, sizeof(producers));
+	start = flood_now() + NS_PER_S / 100;
+	for (int i = 0; i < ndevs; i++) {
+		struct flood_producer *p = &producers[i % nthreads];
+
+		/* spread the first reports over one period */
+		flood_devs[i].next = start + i * (NS_PER_S /
+			flood_devs[i].type->rate) / ndevs;
+		p->devs[p->ndevs++] = &flood_devs[i];
+	}
+
+	shim_lockstat_reset();
+	kcpu = shim_kthread_cputime_ns();
+	pcpu = flood_cputime();
+	wakeups = shim_kthread_wakeups();
+	wall = flood_now();
+
+	for (int t = 0; t < nthreads && t < ndevs; t++) {
+		producers[t].end = start + seconds * NS_PER_S;
+		pthread_create(&producers[t].td, NULL, flood_produce,
+			       &producers[t]);
+	}
+	for (int t = 0; t < nthreads && t < ndevs; t++)
+		pthread_join(producers[t].td, NULL);
+	shim_vclock_settle();
+
+	wall = flood_now() - wall;
+	kcpu = shim_kthread_cputime_ns() - kcpu;
+	pcpu = flood_cputime() - pcpu;
+	wakeups = shim_kthread_wakeups() - wakeups;
+	nlocks = shim_lockstat_get(locks, FLOOD_MAXLOCKS);
+
+	for (int i = 0; i < ndevs; i++) {
+		reports += flood_devs[i].reports;
+		dropped += shim_evdev_dropped(flood_devs[i].evdev);
+	}
+
+	printf("flood.%d.reports %llu\n", ndevs, (unsigned long long)reports);
+	printf("flood.%d.reports_per_s %.0f\n", ndevs,
+	       (double)reports * NS_PER_S / wall);
+	printf("flood.%d.dropped %llu\n", ndevs, (unsigned long long)dropped);
+	printf("flood.%d.kthread_wakeups %llu\n", ndevs,
+	       (unsigned long long)wakeups);
+	printf("flood.%d.kthread_cpu_ms %.3f\n", ndevs, kcpu / 1e6);
+	printf("flood.%d.kthread_cpu_pct %.2f\n", ndevs,
+	       100.0 * kcpu / wall);
+	printf("flood.%d.kthread_ns_per_report %.0f\n", ndevs,
+	       reports ? (double)kcpu / reports : 0.0);
+	printf("flood.%d.process_cpu_ms %.3f\n", ndevs, pcpu / 1e6);
+	for (int i = 0; i < nlocks; i++) {
+		if (0 == locks[i].acquires)
+			continue;
+		printf("flood.%d.lock.%s.acquires %llu\n", ndevs,
+		       locks[i].name, (unsigned long long)locks[i].acquires);
+		printf("flood.%d.lock.%s.contended %llu\n", ndevs,
+		       locks[i].name, (unsigned long long)locks[i].contended);
+		printf("flood.%d.lock.%s.wait_ns %llu\n", ndevs,
+		       locks[i].name, (unsigned long long)locks[i].wait_ns);
+	}
+
+	error = shim_kldunload("framework");
+	if (0 != error)
+		errx(1, "kldunload failed with error %d", error);
+	shim_kthread_drain();
+
+	for (int i = 0; i < ndevs; i++)
+		shim_evdev_destroy(flood_devs[i].evdev);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench_flood [-v] [-d seconds] [-N devices] "
+		"[-t threads]\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	int seconds = 2, maxdevs = 16, nthreads = 4;
+	bool verbose = false;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "d:N:t:v")) != -1) {
+		switch (ch) {
+		case 'd':
+			seconds = atoi(optarg);
+			break;
+		case 'N':
+			maxdevs = atoi(optarg);
+			break;
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (seconds <= 0 || maxdevs <= 0 || maxdevs > FLOOD_MAXDEVS ||
+	    nthreads <= 0)
+		usage();
+
+	shim_console_set(verbose ? stderr : NULL);
+	shim_acpi_attach(ACPI_BATT_STAT_CHARGING);
+	shim_backlight_attach(50);
+
+	printf("flood.threads %d\n", nthreads);
+	printf("flood.seconds %d\n", seconds);
+
+	for (int n = 1; n <= maxdevs; n *= 2)
+		flood_step(n, nthreads, seconds);
+
+	return (0);
+}
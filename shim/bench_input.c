@@ -0,0 +1,373 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Smoke test and input throughput bench for the module running on
+ * the userspace shim.
+ *
+ * Loads the module against a charging battery, a backlight and two
+ * input devices, checks the initial dim and the undim on input, pushes
+ * a burst of key reports and unloads again.  Results are printed as
+ * "key value" lines; the exit status is non-zero if a check failed.
+ */
+
+#include <err.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shim.h"
+
+#define BENCH_WAIT_NS		(5LL * 1000000000LL)
+
+static int bench_failed = 0;
+
+static void
+bench_check(bool cond, const char *what)
+{
+	printf("check.%s %s\n", what, cond ? "ok" : "FAIL");
+	if (!cond)
+		bench_failed = 1;
+}
+
+/*
+ * Poll until the backlight reaches level or BENCH_WAIT_NS passes
+ */
+static bool
+bench_wait_backlight(uint32_t level)
+{
+	int64_t deadline = shim_uptime_ns() + BENCH_WAIT_NS;
+
+	while (shim_backlight_get() != level) {
+		if (shim_uptime_ns() > deadline)
+			return (false);
+		usleep(1000);
+	}
+
+	return (true);
+}
+
+/*
+ * Poll until evdev has at least n clients
+ */
+static bool
+bench_wait_clients(struct evdev_dev *evdev, int n)
+{
+	int64_t deadline = shim_uptime_ns() + BENCH_WAIT_NS;
+
+	while (shim_evdev_nclients(evdev) < n) {
+		if (shim_uptime_ns() > deadline)
+			return (false);
+		usleep(1000);
+	}
+
+	return (true);
+}
+
+static void
+bench_key(struct evdev_dev *evdev, uint16_t code)
+{
+	shim_evdev_push(evdev, EV_KEY, code, 1);
+	shim_evdev_sync(evdev);
+	shim_evdev_push(evdev, EV_KEY, code, 0);
+	shim_evdev_sync(evdev);
+}
+
+/*
+ * Press and release at human pace, so each report is handled on
+ * its own wakeup
+ */
+static void
+bench_typekey(struct evdev_dev *evdev, uint16_t code)
+{
+	shim_evdev_push(evdev, EV_KEY, code, 1);
+	shim_evdev_sync(evdev);
+	usleep(20000);
+	shim_evdev_push(evdev, EV_KEY, code, 0);
+	shim_evdev_sync(evdev);
+	usleep(20000);
+}
+
+/*
+ * Read a counter below hw.framework.stats
+ */
+static uint64_t
+bench_counter(const char *name)
+{
+	char oid[128];
+	uint64_t value = 0;
+	size_t len = sizeof(value);
+
+	snprintf(oid, sizeof(oid), "hw.framework.stats.%s", name);
+	if (0 != shim_sysctlbyname(oid, &value, &len, NULL, 0))
+		return (0);
+
+	return (value);
+}
+
+/*
+ * Read a statistic of a device below hw.framework.input, -1 if the
+ * device has no such node
+ */
+static int64_t
+bench_devstat(const char *device, const char *name)
+{
+	char oid[128];
+	uint64_t value = 0;
+	size_t len = sizeof(value);
+
+	snprintf(oid, sizeof(oid), "hw.framework.input.%s.%s", device, name);
+	if (0 != shim_sysctlbyname(oid, &value, &len, NULL, 0))
+		return (-1);
+
+	return ((int64_t)value);
+}
+
+/*
+ * Tell whether hw.framework.stats.devices lists a device
+ */
+static bool
+bench_bound(const char *name)
+{
+	char table[4096];
+	size_t len = sizeof(table) - 1;
+
+	if (0 != shim_sysctlbyname("hw.framework.stats.devices", table, &len,
+				   NULL, 0))
+		return (false);
+	table[len] = '\0';
+
+	return (NULL != strstr(table, name));
+}
+
+/*
+ * Set a string sysctl
+ */
+static int
+bench_setstr(const char *oid, const char *value)
+{
+	return (shim_sysctlbyname(oid, NULL, NULL, value, strlen(value)));
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench_input [-v] [-n reports]\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct evdev_dev *kbd, *touchpad, *mouse;
+	uint32_t low = 0, high = 0;
+	int64_t start, elapsed;
+	uint64_t keys = 0, drops = 0, coalesced = 0, inputs = 0, filtered = 0;
+	int64_t ring = 0;
+	long reports = 100000;
+	bool verbose = false;
+	int ch, error;
+
+	while ((ch = getopt(argc, argv, "n:v")) != -1) {
+		switch (ch) {
+		case 'n':
+			reports = strtol(optarg, NULL, 10);
+			if (reports <= 0)
+				usage();
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	shim_console_set(verbose ? stderr : NULL);
+
+	shim_acpi_attach(ACPI_BATT_STAT_CHARGING);
+	shim_backlight_attach(50);
+	kbd = shim_evdev_create("System keyboard multiplexer", "kbdmux",
+				BUS_VIRTUAL, 0, 0, 8, SHIM_EV_KEYBOARD);
+	touchpad = shim_evdev_create("PIXA3854:00 093A:0274 TouchPad",
+				     "hmt0", BUS_I2C, 0x093a, 0x0274, 16,
+				     SHIM_EV_TOUCHPAD);
+	/* not matched by the module */
+	(void)shim_evdev_create("Power Button", "acpi_button",
+				BUS_HOST, 0, 0, 4, SHIM_EV_BUTTON);
+
+	error = shim_kldload("framework");
+	bench_check(0 == error, "kldload");
+	if (0 != error)
+		errx(1, "kldload failed with error %d", error);
+
+	bench_check(bench_wait_clients(kbd, 1) &&
+		    bench_wait_clients(touchpad, 1), "clients");
+
+	shim_sysctl_getu32("hw.framework.screen.power.brightness_low", &low);
+	shim_sysctl_getu32("hw.framework.screen.power.brightness_high", &high);
+
+	/* uptime is past the timeout without any input: dim right away */
+	bench_check(bench_wait_backlight(low), "dim_on_load");
+
+	bench_typekey(kbd, KEY_A);
+	bench_check(bench_wait_backlight(high), "undim_on_input");
+
+	bench_typekey(kbd, KEY_BRIGHTNESSDOWN);
+	bench_check(bench_wait_backlight(high - 10), "brightness_key");
+
+	/* several keys in one report all reach the key handler */
+	keys = bench_counter("keys");
+	for (int i = 0; i < 3; i++) {
+		shim_evdev_push(kbd, EV_KEY, KEY_BRIGHTNESSDOWN, 1);
+		shim_evdev_push(kbd, EV_KEY, KEY_BRIGHTNESSDOWN, 0);
+	}
+	shim_evdev_sync(kbd);
+	bench_check(bench_wait_backlight(high - 40) &&
+		    bench_counter("keys") - keys == 3, "brightness_burst");
+
+	/* a report larger than the ring overflows it */
+	ring = bench_devstat("kbdmux", "ring_events");
+	drops = bench_counter("syn_dropped");
+	for (int i = 0; i < 100; i++)
+		shim_evdev_push(kbd, EV_KEY, KEY_A, 2);
+	shim_evdev_sync(kbd);
+	shim_vclock_settle();
+	bench_check(1 == shim_evdev_dropped(kbd) &&
+		    bench_counter("syn_dropped") - drops == 1 &&
+		    1 == bench_devstat("kbdmux", "overflows"), "syn_dropped");
+
+	/* which makes the ring grow, without losing input afterwards */
+	inputs = bench_counter("inputs");
+	bench_typekey(kbd, KEY_A);
+	shim_vclock_settle();
+	bench_check(2 * ring == bench_devstat("kbdmux", "ring_events") &&
+		    1 == bench_devstat("kbdmux", "ring_resizes") &&
+		    bench_devstat("kbdmux", "ring_highwater") > 0 &&
+		    bench_counter("inputs") > inputs, "ring_grow");
+
+	/* a device plugged in while loaded is bound until it goes away */
+	mouse = shim_evdev_create("Logitech USB Optical Mouse", "ums0",
+				  BUS_USB, 0x046d, 0xc077, 4, SHIM_EV_MOUSE);
+	bench_check(bench_wait_clients(mouse, 1), "hotplug_attach");
+	inputs = bench_counter("inputs");
+	shim_evdev_push(mouse, EV_REL, REL_X, 4);
+	shim_evdev_sync(mouse);
+	shim_vclock_settle();
+	bench_check(bench_counter("inputs") > inputs &&
+		    bench_bound("Logitech") &&
+		    1 == bench_devstat("ums0", "inputs"), "hotplug_input");
+	shim_evdev_destroy(mouse);
+	shim_vclock_settle();
+	bench_check(!bench_bound("Logitech") && bench_bound("TouchPad") &&
+		    -1 == bench_devstat("ums0", "inputs"), "hotplug_detach");
+
+	/* a device denied while bound is released, and bound again */
+	error = bench_setstr("hw.framework.match.deny", " 093A:0274 ");
+	shim_vclock_settle();
+	bench_check(0 == error && 0 == shim_evdev_nclients(touchpad) &&
+		    !bench_bound("TouchPad") && bench_bound("keyboard"),
+		    "match_deny");
+	error = bench_setstr("hw.framework.match.deny", "");
+	bench_check(0 == error && bench_wait_clients(touchpad, 1) &&
+		    bench_bound("TouchPad"), "match_rebind");
+
+	/* continuous input while bright is coalesced */
+	coalesced = bench_counter("coalesced");
+	start = shim_uptime_ns();
+	for (long i = 0; i < reports; i++)
+		bench_key((i & 1) ? touchpad : kbd, KEY_A);
+	elapsed = shim_uptime_ns() - start;
+	shim_vclock_settle();
+	bench_check(bench_counter("coalesced") > coalesced, "coalesced");
+	bench_check(bench_devstat("hmt0", "inputs") > 0 &&
+		    bench_devstat("hmt0", "callbacks") > 0 &&
+		    bench_devstat("hmt0", "callback_ns") > 0 &&
+		    bench_devstat("hmt0", "last_input_ms") > 0 &&
+		    bench_devstat("hmt0", "rate") >= 0, "device_stats");
+
+	/* touch jitter and scan codes do not count as activity */
+	shim_evdev_push(touchpad, EV_ABS, ABS_X, 1000);
+	shim_evdev_sync(touchpad);
+	shim_vclock_settle();
+	inputs = bench_devstat("hmt0", "inputs");
+	filtered = bench_counter("filtered");
+	for (int i = 0; i < 10; i++) {
+		shim_evdev_push(touchpad, EV_ABS, ABS_X, 1000 + (i & 1) * 3);
+		shim_evdev_push(touchpad, EV_MSC, MSC_SCAN, 0x70004);
+		shim_evdev_sync(touchpad);
+	}
+	shim_vclock_settle();
+	bench_check(inputs == bench_devstat("hmt0", "inputs") &&
+		    bench_counter("filtered") - filtered >= 30 &&
+		    bench_devstat("hmt0", "filtered") >= 30, "filter_jitter");
+	shim_evdev_push(touchpad, EV_ABS, ABS_X, 1100);
+	shim_evdev_sync(touchpad);
+	shim_vclock_settle();
+	bench_check(inputs + 1 == bench_devstat("hmt0", "inputs"),
+		    "filter_motion");
+
+	/* a swing across the whole axis range is motion, not jitter */
+	shim_evdev_push(touchpad, EV_ABS, ABS_X, INT32_MAX);
+	shim_evdev_sync(touchpad);
+	shim_evdev_push(touchpad, EV_ABS, ABS_X, INT32_MIN);
+	shim_evdev_sync(touchpad);
+	shim_vclock_settle();
+	bench_check(inputs + 3 == bench_devstat("hmt0", "inputs"),
+		    "filter_range");
+
+	printf("input.reports %ld\n", reports * 2);
+	printf("input.push_ns_per_report %.1f\n",
+	       (double)elapsed / (reports * 2));
+	printf("input.dropped %llu\n", (unsigned long long)
+	       (shim_evdev_dropped(kbd) + shim_evdev_dropped(touchpad)));
+	printf("acpi.queries %llu\n",
+	       (unsigned long long)shim_acpi_queries());
+	printf("backlight.writes %llu\n",
+	       (unsigned long long)shim_backlight_writes());
+
+	if (verbose)
+		shim_sysctl_dump(stderr, "hw.framework");
+
+	error = shim_kldunload("framework");
+	bench_check(0 == error, "kldunload");
+
+	shim_kthread_drain();
+	bench_check(0 == shim_kthread_count(), "threads_exited");
+	bench_check(0 == shim_evdev_nclients(kbd) &&
+		    0 == shim_evdev_nclients(touchpad), "clients_released");
+	bench_check(0 == shim_malloc_inuse("framework") &&
+		    0 == shim_malloc_inuse("counter"), "no_leaks");
+
+	return (bench_failed);
+}
@@ -0,0 +1,361 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Input-to-backlight latency benchmark
+ *
+ * Times every hop between an evdev report and the backlight update:
+ *
+ *	wake		report pushed -> input thread back from msleep
+ *	dispatch	thread wakeup -> framework_evdev_oninput
+ *	intr		oninput -> framework_callout_inputintr
+ *	powermode	framework_pwr_getpowermode, entry to return
+ *	decision	inputintr entry -> brightness decided
+ *	backlight	framework_bl_setbrightness, entry to return
+ *	handler		inputintr entry -> inputintr return
+ *	chain		report pushed -> inputintr return
+ *
+ * Two scenarios run: "nowrite" types a key the module has nothing to
+ * do for while the screen is bright, "write" alternates the brightness
+ * keys so each chain ends in BACKLIGHT_UPDATE_STATUS.  Hops a report
+ * does not pass are left out of the results.  Results are "key value"
+ * lines in ns.
+ */
+
+#include <err.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/sdt.h>
+
+#include "shim.h"
+
+enum lat_hop {
+	HOP_WAKE,
+	HOP_DISPATCH,
+	HOP_INTR,
+	HOP_POWERMODE,
+	HOP_DECISION,
+	HOP_BACKLIGHT,
+	HOP_HANDLER,
+	HOP_CHAIN,
+	HOP_COUNT
+};
+
+static const char *lat_hopnames[HOP_COUNT] = {
+	"wake", "dispatch", "intr", "powermode", "decision", "backlight",
+	"handler", "chain"
+};
+
+enum lat_stamp {
+	STAMP_PUSH,
+	STAMP_WAKEUP,
+	STAMP_INPUT,
+	STAMP_INTR_ENTRY,
+	STAMP_POWER_ENTRY,
+	STAMP_POWER_RETURN,
+	STAMP_DECISION,
+	STAMP_BL_ENTRY,
+	STAMP_BL_RETURN,
+	STAMP_INTR_RETURN,
+	STAMP_COUNT
+};
+
+/*
+ * The report in flight; stamps are taken on the input thread only
+ */
+static struct lat_state {
+	pthread_mutex_t lock;
+	pthread_cond_t cv;
+	bool armed;
+	bool done;
+	int64_t stamps[STAMP_COUNT];
+} lat = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cv = PTHREAD_COND_INITIALIZER
+};
+
+/* set on the input thread between its wakeup and inputintr return */
+static __thread bool lat_inchain;
+
+static void
+lat_stamp(enum lat_stamp which)
+{
+	/* first occurrence only, getpowermode runs more than once */
+	if (0 == lat.stamps[which])
+		lat.stamps[which] = shim_uptime_ns();
+}
+
+static void
+lat_probe(struct sdt_probe *probe, uintptr_t arg0 __unused,
+	  uintptr_t arg1 __unused, uintptr_t arg2 __unused,
+	  uintptr_t arg3 __unused, uintptr_t arg4 __unused)
+{
+	bool entry = (0 == strcmp(probe->name, "entry"));
+
+	if (0 == strcmp(probe->func, "thread") &&
+	    0 == strcmp(probe->mod, "evdev")) {
+		pthread_mutex_lock(&lat.lock);
+		lat_inchain = lat.armed;
+		pthread_mutex_unlock(&lat.lock);
+		if (lat_inchain)
+			lat_stamp(STAMP_WAKEUP);
+		return;
+	}
+
+	if (!lat_inchain)
+		return;
+
+	if (0 == strcmp(probe->mod, "evdev")) {
+		lat_stamp(STAMP_INPUT);
+	} else if (0 == strcmp(probe->func, "inputintr")) {
+		if (entry) {
+			lat_stamp(STAMP_INTR_ENTRY);
+			return;
+		}
+
+		lat_stamp(STAMP_INTR_RETURN);
+		lat_inchain = false;
+		pthread_mutex_lock(&lat.lock);
+		lat.armed = false;
+		lat.done = true;
+		pthread_cond_signal(&lat.cv);
+		pthread_mutex_unlock(&lat.lock);
+	} else if (0 == strcmp(probe->func, "getpowermode")) {
+		lat_stamp(entry ? STAMP_POWER_ENTRY : STAMP_POWER_RETURN);
+	} else if (0 == strcmp(probe->name, "decision")) {
+		lat_stamp(STAMP_DECISION);
+	} else if (0 == strcmp(probe->func, "setbrightness")) {
+		lat_stamp(entry ? STAMP_BL_ENTRY : STAMP_BL_RETURN);
+	}
+}
+
+static int
+lat_cmp(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+	return ((x > y) - (x < y));
+}
+
+/*
+ * Add the time from stamp from to stamp to, if the report passed both
+ */
+static void
+lat_sample(int64_t *samples[HOP_COUNT], long counts[HOP_COUNT],
+	   enum lat_hop hop, enum lat_stamp from, enum lat_stamp to)
+{
+	if (0 == lat.stamps[from] || 0 == lat.stamps[to])
+		return;
+
+	samples[hop][counts[hop]++] = lat.stamps[to] - lat.stamps[from];
+}
+
+static void
+lat_report(const char *scenario, int64_t *samples[HOP_COUNT],
+	   long counts[HOP_COUNT], long count)
+{
+	printf("latency.%s.events %ld\n", scenario, count);
+
+	for (int hop = 0; hop < HOP_COUNT; hop++) {
+		int64_t *s = samples[hop];
+		long n = counts[hop];
+		double sum = 0;
+
+		if (0 == n)
+			continue;
+
+		qsort(s, n, sizeof(*s), lat_cmp);
+		for (long i = 0; i < n; i++)
+			sum += s[i];
+
+		printf("latency.%s.%s.avg_ns %.0f\n", scenario,
+		       lat_hopnames[hop], sum / n);
+		printf("latency.%s.%s.p50_ns %lld\n", scenario,
+		       lat_hopnames[hop], (long long)s[n / 2]);
+		printf("latency.%s.%s.p99_ns %lld\n", scenario,
+		       lat_hopnames[hop], (long long)s[n * 99 / 100]);
+		printf("latency.%s.%s.max_ns %lld\n", scenario,
+		       lat_hopnames[hop], (long long)s[n - 1]);
+	}
+}
+
+/*
+ * Send count reports through the module and time each of them
+ */
+static void
+lat_run(const char *scenario, struct evdev_dev *kbd, long count, bool write)
+{
+	int64_t *samples[HOP_COUNT];
+	long counts[HOP_COUNT] = { 0 };
+	uint64_t writes = shim_backlight_writes();
+	struct timespec ts;
+	uint16_t key = KEY_A;
+	int error;
+
+	for (int hop = 0; hop < HOP_COUNT; hop++) {
+		samples[hop] = calloc(count, sizeof(int64_t));
+		if (NULL == samples[hop])
+			err(1, "calloc");
+	}
+
+	for (long i = 0; i < count; i++) {
+		if (write)
+			key = (i & 1) ? KEY_BRIGHTNESSUP : KEY_BRIGHTNESSDOWN;
+		shim_vclock_settle();
+
+		pthread_mutex_lock(&lat.lock);
+		memset(lat.stamps, 0, sizeof(lat.stamps));
+		lat.done = false;
+		lat.armed = true;
+		pthread_mutex_unlock(&lat.lock);
+
+		lat.stamps[STAMP_PUSH] = shim_uptime_ns();
+		shim_evdev_push(kbd, EV_KEY, key, 1);
+		shim_evdev_sync(kbd);
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += 5;
+		pthread_mutex_lock(&lat.lock);
+		while (!lat.done) {
+			error = pthread_cond_timedwait(&lat.cv, &lat.lock, &ts);
+			if (ETIMEDOUT == error)
+				errx(1, "%s: report %ld never reached the "
+				     "backlight", scenario, i);
+		}
+		pthread_mutex_unlock(&lat.lock);
+
+		lat_sample(samples, counts, HOP_WAKE, STAMP_PUSH,
+			   STAMP_WAKEUP);
+		lat_sample(samples, counts, HOP_DISPATCH, STAMP_WAKEUP,
+			   STAMP_INPUT);
+		lat_sample(samples, counts, HOP_INTR, STAMP_INPUT,
+			   STAMP_INTR_ENTRY);
+		lat_sample(samples, counts, HOP_POWERMODE, STAMP_POWER_ENTRY,
+			   STAMP_POWER_RETURN);
+		lat_sample(samples, counts, HOP_DECISION, STAMP_INTR_ENTRY,
+			   STAMP_DECISION);
+		lat_sample(samples, counts, HOP_BACKLIGHT, STAMP_BL_ENTRY,
+			   STAMP_BL_RETURN);
+		lat_sample(samples, counts, HOP_HANDLER, STAMP_INTR_ENTRY,
+			   STAMP_INTR_RETURN);
+		lat_sample(samples, counts, HOP_CHAIN, STAMP_PUSH,
+			   STAMP_INTR_RETURN);
+
+		/* release, handled on its own wakeup and not timed */
+		shim_vclock_settle();
+		shim_evdev_push(kbd, EV_KEY, key, 0);
+		shim_evdev_sync(kbd);
+	}
+
+	lat_report(scenario, samples, counts, count);
+	printf("latency.%s.backlight_writes %llu\n", scenario,
+	       (unsigned long long)(shim_backlight_writes() - writes));
+
+	for (int hop = 0; hop < HOP_COUNT; hop++)
+		free(samples[hop]);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench_latency [-v] [-a acpi_ns] "
+		"[-b backlight_ns] [-n reports]\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct evdev_dev *kbd;
+	int64_t acpi_ns = 0, backlight_ns = 0;
+	long count = 10000;
+	bool verbose = false;
+	int ch, error;
+
+	while ((ch = getopt(argc, argv, "a:b:n:v")) != -1) {
+		switch (ch) {
+		case 'a':
+			acpi_ns = strtoll(optarg, NULL, 10);
+			break;
+		case 'b':
+			backlight_ns = strtoll(optarg, NULL, 10);
+			break;
+		case 'n':
+			count = strtol(optarg, NULL, 10);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (count <= 0 || acpi_ns < 0 || backlight_ns < 0)
+		usage();
+
+	shim_console_set(verbose ? stderr : NULL);
+
+	shim_acpi_attach(ACPI_BATT_STAT_CHARGING);
+	shim_backlight_attach(50);
+	kbd = shim_evdev_create("System keyboard multiplexer", "kbdmux",
+				BUS_VIRTUAL, 0, 0, 8, SHIM_EV_KEYBOARD);
+
+	error = shim_kldload("framework");
+	if (0 != error)
+		errx(1, "kldload failed with error %d", error);
+
+	/* keep the idle dim out of the measurement */
+	shim_sysctl_setu32("hw.framework.screen.power.timeout_secs", 3600);
+	shim_sysctl_setu32("hw.framework.screen.battery.timeout_secs", 3600);
+	/* every report has to run the whole chain */
+	shim_sysctl_setu32("hw.framework.notify_interval_ms", 0);
+
+	shim_acpi_setlatency(acpi_ns);
+	shim_backlight_setlatency(backlight_ns);
+	printf("latency.acpi_delay_ns %lld\n", (long long)acpi_ns);
+	printf("latency.backlight_delay_ns %lld\n", (long long)backlight_ns);
+
+	shim_sdt_sethook(lat_probe);
+	lat_run("nowrite", kbd, count, false);
+	lat_run("write", kbd, count, true);
+	shim_sdt_sethook(NULL);
+
+	error = shim_kldunload("framework");
+	if (0 != error)
+		errx(1, "kldunload failed with error %d", error);
+	shim_kthread_drain();
+
+	return (0);
+}
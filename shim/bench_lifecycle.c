@@ -0,0 +1,213 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Module lifecycle benchmark
+ *
+ * Attaches N input devices, then loads and unloads the module in a
+ * loop and reports load and unload latency percentiles.  Load time
+ * includes binding every device; unload time is the full kldunload,
+ * which returns once all kernel threads have stopped.
+ */
+
+#include <err.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shim.h"
+
+#define NS_PER_S	1000000000LL
+#define LIFE_MAXDEVS	256
+
+static const struct {
+	const char *name;
+	const char *shortname;
+	uint16_t bustype;
+	size_t report_size;
+	uint32_t types;
+} life_types[] = {
+	{ "Logitech USB Optical Mouse", "ums", BUS_USB, 4, SHIM_EV_MOUSE },
+	{ "PIXA3854:00 093A:0274 TouchPad", "hmt", BUS_I2C, 8,
+	  SHIM_EV_TOUCHPAD },
+	{ "AT Translated Set 2 keyboard", "atkbd", BUS_I8042, 4,
+	  SHIM_EV_KEYBOARD },
+	{ "System keyboard multiplexer", "kbdmux", BUS_VIRTUAL, 4,
+	  SHIM_EV_KEYBOARD }
+};
+
+static struct evdev_dev *life_devs[LIFE_MAXDEVS];
+
+static int64_t
+life_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * NS_PER_S + ts.tv_nsec);
+}
+
+static int
+life_cmp(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+	return ((x > y) - (x < y));
+}
+
+static void
+life_report(const char *what, int ndevs, int64_t *s, int count)
+{
+	double sum = 0;
+
+	qsort(s, count, sizeof(*s), life_cmp);
+	for (int i = 0; i < count; i++)
+		sum += s[i];
+
+	printf("lifecycle.%d.%s.avg_us %.1f\n", ndevs, what, sum / count / 1e3);
+	printf("lifecycle.%d.%s.p50_us %.1f\n", ndevs, what,
+	       s[count / 2] / 1e3);
+	printf("lifecycle.%d.%s.p99_us %.1f\n", ndevs, what,
+	       s[count * 99 / 100] / 1e3);
+	printf("lifecycle.%d.%s.max_us %.1f\n", ndevs, what,
+	       s[count - 1] / 1e3);
+}
+
+static void
+life_run(int ndevs, int iterations)
+{
+	int64_t *load = calloc(iterations, sizeof(int64_t));
+	int64_t *unload = calloc(iterations, sizeof(int64_t));
+	int64_t start;
+	int error;
+
+	if (NULL == load || NULL == unload)
+		err(1, "calloc");
+
+	for (int i = 0; i < ndevs; i++) {
+		int t = i % (sizeof(life_types) / sizeof(life_types[0]));
+		char shortname[32];
+
+		snprintf(shortname, sizeof(shortname), "%s%d",
+			 life_types[t].shortname, i);
+		life_devs[i] = shim_evdev_create(life_types[t].name, shortname,
+						 life_types[t].bustype, 0, 0,
+						 life_types[t].report_size,
+						 life_types[t].types);
+	}
+
+	for (int it = 0; it < iterations; it++) {
+		start = life_now();
+		error = shim_kldload("framework");
+		if (0 != error)
+			errx(1, "kldload failed with error %d", error);
+		for (int i = 0; i < ndevs; i++) {
+			for (int wait = 0;
+			     shim_evdev_nclients(life_devs[i]) < 1; wait++) {
+				if (wait > 50000)
+					errx(1, "module did not bind device %d",
+					     i);
+				usleep(100);
+			}
+		}
+		load[it] = life_now() - start;
+
+		/* unload from steady state, every thread asleep */
+		shim_vclock_settle();
+
+		start = life_now();
+		error = shim_kldunload("framework");
+		if (0 != error)
+			errx(1, "kldunload failed with error %d", error);
+		unload[it] = life_now() - start;
+
+		shim_kthread_drain();
+		for (int i = 0; i < ndevs; i++) {
+			if (0 != shim_evdev_nclients(life_devs[i]))
+				errx(1, "device %d still has clients", i);
+		}
+	}
+
+	printf("lifecycle.%d.iterations %d\n", ndevs, iterations);
+	life_report("load", ndevs, load, iterations);
+	life_report("unload", ndevs, unload, iterations);
+
+	for (int i = 0; i < ndevs; i++)
+		shim_evdev_destroy(life_devs[i]);
+	free(load);
+	free(unload);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench_lifecycle [-v] [-n iterations] "
+		"[-N devices]\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	int iterations = 100, maxdevs = 64;
+	bool verbose = false;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "n:N:v")) != -1) {
+		switch (ch) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'N':
+			maxdevs = atoi(optarg);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (iterations <= 0 || maxdevs <= 0 || maxdevs > LIFE_MAXDEVS)
+		usage();
+
+	shim_console_set(verbose ? stderr : NULL);
+	shim_acpi_attach(ACPI_BATT_STAT_CHARGING);
+	shim_backlight_attach(50);
+
+	for (int n = 1; n <= maxdevs; n *= 4)
+		life_run(n, iterations);
+
+	return (0);
+}
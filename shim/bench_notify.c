@@ -0,0 +1,275 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Threaded versus direct input notification
+ *
+ * Sends reports through one keyboard with hw.framework.direct_notify
+ * off and on, one at a time, and reports per mode:
+ *
+ *	latency		report pushed -> activity recorded
+ *	cpu		process CPU time per report
+ *	kthread_cpu	CPU time of the module's kernel threads per report
+ *	wakeups		kernel thread wakeups per report
+ *	intr		reports reaching framework_callout_inputintr
+ *
+ * Reports are key repeats while the screen is bright, which direct
+ * mode records without waking the listener.  Both modes coalesce them
+ * within hw.framework.notify_interval_ms.  A brightness key is sent
+ * last and has to reach the key handler in either mode.  Results are
+ * "key value" lines in ns.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/sdt.h>
+
+#include "shim.h"
+
+#define NS_PER_S	1000000000LL
+#define KEY_BRIGHTNESSUP 225
+
+/*
+ * The report in flight
+ */
+static struct notify_state {
+	pthread_mutex_t lock;
+	pthread_cond_t cv;
+	bool recorded;		/* activity recorded for the report */
+	bool intr;		/* inputintr returned for the report */
+	int64_t recorded_ns;
+	uint64_t intrs;
+} notify = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cv = PTHREAD_COND_INITIALIZER
+};
+
+static void
+notify_probe(struct sdt_probe *probe, uintptr_t arg0 __unused,
+	     uintptr_t arg1 __unused, uintptr_t arg2 __unused,
+	     uintptr_t arg3 __unused, uintptr_t arg4 __unused)
+{
+	int64_t now = shim_uptime_ns();
+
+	pthread_mutex_lock(&notify.lock);
+	if (0 == strcmp(probe->mod, "evdev") &&
+	    0 == strcmp(probe->name, "input")) {
+		notify.recorded_ns = now;
+		notify.recorded = true;
+		pthread_cond_signal(&notify.cv);
+	} else if (0 == strcmp(probe->func, "inputintr") &&
+		   0 == strcmp(probe->name, "return")) {
+		notify.intrs++;
+		notify.intr = true;
+		pthread_cond_signal(&notify.cv);
+	}
+	pthread_mutex_unlock(&notify.lock);
+}
+
+static int64_t
+notify_cputime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+	return (ts.tv_sec * NS_PER_S + ts.tv_nsec);
+}
+
+/*
+ * Wait for *flag, set by the probe hook
+ */
+static void
+notify_wait(bool *flag, const char *mode, const char *what)
+{
+	struct timespec ts;
+	int error;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += 5;
+	pthread_mutex_lock(&notify.lock);
+	while (!*flag) {
+		error = pthread_cond_timedwait(&notify.cv, &notify.lock, &ts);
+		if (ETIMEDOUT == error)
+			errx(1, "%s: %s timed out", mode, what);
+	}
+	pthread_mutex_unlock(&notify.lock);
+}
+
+static int
+notify_cmp(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+	return ((x > y) - (x < y));
+}
+
+static void
+notify_run(const char *mode, struct evdev_dev *kbd, long count)
+{
+	int64_t *samples, push, cpu, kcpu;
+	uint64_t wakeups, intrs;
+	double sum = 0;
+
+	samples = calloc(count, sizeof(int64_t));
+	if (NULL == samples)
+		err(1, "calloc");
+
+	shim_sysctl_setu32("hw.framework.direct_notify",
+			   0 == strcmp(mode, "direct"));
+	shim_vclock_settle();
+
+	pthread_mutex_lock(&notify.lock);
+	intrs = notify.intrs;
+	pthread_mutex_unlock(&notify.lock);
+	cpu = notify_cputime();
+	kcpu = shim_kthread_cputime_ns();
+	wakeups = shim_kthread_wakeups();
+
+	for (long i = 0; i < count; i++) {
+		pthread_mutex_lock(&notify.lock);
+		notify.recorded = false;
+		pthread_mutex_unlock(&notify.lock);
+
+		push = shim_uptime_ns();
+		shim_evdev_push(kbd, EV_KEY, KEY_A, 2);
+		shim_evdev_sync(kbd);
+		notify_wait(&notify.recorded, mode, "report");
+
+		samples[i] = notify.recorded_ns - push;
+	}
+	shim_vclock_settle();
+
+	cpu = notify_cputime() - cpu;
+	kcpu = shim_kthread_cputime_ns() - kcpu;
+	wakeups = shim_kthread_wakeups() - wakeups;
+	pthread_mutex_lock(&notify.lock);
+	intrs = notify.intrs - intrs;
+	pthread_mutex_unlock(&notify.lock);
+
+	qsort(samples, count, sizeof(*samples), notify_cmp);
+	for (long i = 0; i < count; i++)
+		sum += samples[i];
+
+	printf("notify.%s.reports %ld\n", mode, count);
+	printf("notify.%s.latency.avg_ns %.0f\n", mode, sum / count);
+	printf("notify.%s.latency.p50_ns %lld\n", mode,
+	       (long long)samples[count / 2]);
+	printf("notify.%s.latency.p99_ns %lld\n", mode,
+	       (long long)samples[count * 99 / 100]);
+	printf("notify.%s.latency.max_ns %lld\n", mode,
+	       (long long)samples[count - 1]);
+	printf("notify.%s.cpu_ns_per_report %.0f\n", mode,
+	       (double)cpu / count);
+	printf("notify.%s.kthread_cpu_ns_per_report %.0f\n", mode,
+	       (double)kcpu / count);
+	printf("notify.%s.wakeups_per_report %.3f\n", mode,
+	       (double)wakeups / count);
+	printf("notify.%s.intr %llu\n", mode, (unsigned long long)intrs);
+
+	/* brightness keys still need the key handler */
+	pthread_mutex_lock(&notify.lock);
+	notify.intr = false;
+	pthread_mutex_unlock(&notify.lock);
+	shim_evdev_push(kbd, EV_KEY, KEY_BRIGHTNESSUP, 1);
+	shim_evdev_sync(kbd);
+	notify_wait(&notify.intr, mode, "brightness key");
+	shim_vclock_settle();
+	shim_evdev_push(kbd, EV_KEY, KEY_BRIGHTNESSUP, 0);
+	shim_evdev_sync(kbd);
+	shim_vclock_settle();
+
+	free(samples);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bench_notify [-v] [-n reports]\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct evdev_dev *kbd;
+	long count = 10000;
+	bool verbose = false;
+	int ch, error;
+
+	while ((ch = getopt(argc, argv, "n:v")) != -1) {
+		switch (ch) {
+		case 'n':
+			count = strtol(optarg, NULL, 10);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (count <= 0)
+		usage();
+
+	shim_console_set(verbose ? stderr : NULL);
+
+	shim_acpi_attach(ACPI_BATT_STAT_CHARGING);
+	shim_backlight_attach(50);
+	kbd = shim_evdev_create("System keyboard multiplexer", "kbdmux",
+				BUS_VIRTUAL, 0, 0, 8, SHIM_EV_KEYBOARD);
+
+	error = shim_kldload("framework");
+	if (0 != error)
+		errx(1, "kldload failed with error %d", error);
+
+	/* keep the idle dim out of the measurement */
+	shim_sysctl_setu32("hw.framework.screen.power.timeout_secs", 3600);
+	shim_sysctl_setu32("hw.framework.screen.battery.timeout_secs", 3600);
+
+	shim_sdt_sethook(notify_probe);
+	notify_run("threaded", kbd, count);
+	notify_run("direct", kbd, count);
+	shim_sdt_sethook(NULL);
+
+	error = shim_kldunload("framework");
+	if (0 != error)
+		errx(1, "kldunload failed with error %d", error);
+	shim_kthread_drain();
+
+	return (0);
+}
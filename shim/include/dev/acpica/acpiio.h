@@ -0,0 +1,75 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_DEV_ACPICA_ACPIIO_H__
+#define __SHIM_DEV_ACPICA_ACPIIO_H__
+
+/* Stand-in for <dev/acpica/acpiio.h> */
+#include <stdint.h>
+
+#define ACPI_CMBAT_MAXSTRLEN	32
+
+#define ACPI_BATT_STAT_DISCHARG	0x0001
+#define ACPI_BATT_STAT_CHARGING	0x0002
+#define ACPI_BATT_STAT_CRITICAL	0x0004
+#define ACPI_BATT_STAT_NOT_PRESENT 0x0007
+
+struct acpi_battinfo {
+	int cap;	/* percent */
+	int min;	/* remaining time (in minutes) */
+	int state;	/* battery state */
+	int rate;	/* emptying rate */
+};
+
+struct acpi_bix {
+	uint16_t rev;
+	uint32_t units;
+	uint32_t dcap;
+	uint32_t lfcap;
+	uint32_t btech;
+	uint32_t dvol;
+	uint32_t wcap;
+	uint32_t lcap;
+	uint32_t cycles;
+	uint32_t accuracy;
+	uint32_t stmax;
+	uint32_t stmin;
+	uint32_t aimax;
+	uint32_t aimin;
+	uint32_t gra1;
+	uint32_t gra2;
+	char model[ACPI_CMBAT_MAXSTRLEN];
+	char serial[ACPI_CMBAT_MAXSTRLEN];
+	char type[ACPI_CMBAT_MAXSTRLEN];
+	char oeminfo[ACPI_CMBAT_MAXSTRLEN];
+	uint32_t scap;
+};
+
+#endif /* __SHIM_DEV_ACPICA_ACPIIO_H__ */
@@ -0,0 +1,123 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_DEV_EVDEV_EVDEV_PRIVATE_H__
+#define __SHIM_DEV_EVDEV_EVDEV_PRIVATE_H__
+
+/*
+ * Stand-in for <dev/evdev/evdev_private.h>
+ *
+ * Mirrors the fields of the evdev device and client structures that
+ * kmod/ touches directly.  Events are delivered by shim_evdev_push()
+ * with the same ring and wakeup semantics as evdev_client_push().
+ */
+#include <shim_kernel.h>
+#include <sys/conf.h>
+#include <sys/epoch.h>
+#include <sys/selinfo.h>
+
+#include <dev/evdev/input.h>
+
+#define NAMELEN		80
+
+/* epoch client lists are walked in, unless delivered under ev_mtx */
+#define INPUT_EPOCH	global_epoch_preempt
+
+enum evdev_lock_type {
+	EV_LOCK_INTERNAL = 0,	/* internal mutex, lists walked in epoch */
+	EV_LOCK_MTX,		/* driver's mutex, also guards the lists */
+	EV_LOCK_EXT_EPOCH,	/* external epoch */
+};
+
+struct evdev_client;
+
+struct evdev_dev {
+	char ev_name[NAMELEN];
+	char ev_shortname[NAMELEN];
+	char ev_serial[NAMELEN];
+	struct cdev *ev_cdev;
+	struct input_id ev_id;
+	size_t ev_report_size;
+	uint32_t ev_type_flags;		/* shim: bitstr_t, bit per EV_ type */
+
+	enum evdev_lock_type ev_lock_type;
+	struct mtx ev_mtx;		/* event delivery lock */
+	struct mtx ev_list_lock;
+	LIST_HEAD(, evdev_client) ev_clients;
+
+	uint64_t ev_dropped;		/* shim: client ring overflows */
+};
+
+struct evdev_client {
+	struct evdev_dev *ec_evdev;
+	struct mtx ec_buffer_mtx;
+	size_t ec_buffer_size;
+	size_t ec_buffer_head;
+	size_t ec_buffer_tail;
+	size_t ec_buffer_ready;
+	int ec_clock_id;
+	struct selinfo ec_selp;
+	bool ec_async;
+	bool ec_revoked;
+	bool ec_blocked;
+	bool ec_selected;
+
+	LIST_ENTRY(evdev_client) ec_link;
+
+	struct input_event ec_buffer[];
+};
+
+/* the shim never interrupts sleeps, so the signal variant cannot fail */
+static __inline int
+shim_evdev_list_lock_sig(struct evdev_dev *evdev)
+{
+	mtx_lock(&evdev->ev_list_lock);
+	return (0);
+}
+
+#define EVDEV_LIST_LOCK(evdev)		mtx_lock(&(evdev)->ev_list_lock)
+#define EVDEV_LIST_LOCK_SIG(evdev)	shim_evdev_list_lock_sig(evdev)
+#define EVDEV_LIST_UNLOCK(evdev)	mtx_unlock(&(evdev)->ev_list_lock)
+
+#define EVDEV_CLIENT_LOCKQ(client)	mtx_lock(&(client)->ec_buffer_mtx)
+#define EVDEV_CLIENT_UNLOCKQ(client)	mtx_unlock(&(client)->ec_buffer_mtx)
+
+static __inline bool
+evdev_event_supported(struct evdev_dev *evdev, uint16_t type)
+{
+	return (type < EV_CNT && (evdev->ev_type_flags & (1u << type)));
+}
+
+int evdev_register_client(struct evdev_dev *evdev, struct evdev_client *client);
+void evdev_dispose_client(struct evdev_dev *evdev, struct evdev_client *client);
+void evdev_revoke_client(struct evdev_client *client);
+void evdev_notify_event(struct evdev_client *client);
+
+#endif /* __SHIM_DEV_EVDEV_EVDEV_PRIVATE_H__ */
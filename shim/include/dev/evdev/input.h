@@ -0,0 +1,107 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_DEV_EVDEV_INPUT_H__
+#define __SHIM_DEV_EVDEV_INPUT_H__
+
+/*
+ * Stand-in for <dev/evdev/input.h>
+ *
+ * Event layout and the subset of event codes used by kmod/ and the
+ * harness programs.
+ */
+#include <stdint.h>
+#include <sys/time.h>
+
+struct input_event {
+	struct timeval time;
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+};
+
+struct input_id {
+	uint16_t bustype;
+	uint16_t vendor;
+	uint16_t product;
+	uint16_t version;
+};
+
+#define EV_SYN			0x00
+#define EV_KEY			0x01
+#define EV_REL			0x02
+#define EV_ABS			0x03
+#define EV_MSC			0x04
+#define EV_SW			0x05
+#define EV_LED			0x11
+#define EV_REP			0x14
+#define EV_CNT			0x20
+
+#define SYN_REPORT		0
+#define SYN_CONFIG		1
+#define SYN_MT_REPORT		2
+#define SYN_DROPPED		3
+
+#define REL_X			0x00
+#define REL_Y			0x01
+#define REL_HWHEEL		0x06
+#define REL_WHEEL		0x08
+#define REL_MAX			0x0f
+#define REL_CNT			(REL_MAX + 1)
+
+#define ABS_X			0x00
+#define ABS_Y			0x01
+#define ABS_PRESSURE		0x18
+#define ABS_MT_SLOT		0x2f
+#define ABS_MT_POSITION_X	0x35
+#define ABS_MT_POSITION_Y	0x36
+#define ABS_MT_TRACKING_ID	0x39
+#define ABS_MAX			0x3f
+#define ABS_CNT			(ABS_MAX + 1)
+
+#define MSC_SCAN		0x04
+
+#define SW_LID			0x00
+
+#define KEY_A			30
+#define KEY_SPACE		57
+#define KEY_BRIGHTNESSDOWN	224
+#define KEY_BRIGHTNESSUP	225
+#define BTN_LEFT		0x110
+#define BTN_TOUCH		0x14a
+
+#define BUS_PCI			0x01
+#define BUS_USB			0x03
+#define BUS_HOST		0x19
+#define BUS_I8042		0x11
+#define BUS_I2C			0x18
+#define BUS_VIRTUAL		0x06
+
+#endif /* __SHIM_DEV_EVDEV_INPUT_H__ */
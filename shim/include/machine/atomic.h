@@ -0,0 +1,91 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_MACHINE_ATOMIC_H__
+#define __SHIM_MACHINE_ATOMIC_H__
+
+/*
+ * Stand-in for <machine/atomic.h>
+ *
+ * Only the operations used by kmod/, mapped onto the compiler's
+ * __atomic builtins.
+ */
+#include <stdint.h>
+
+#define atomic_add_int(p, v)	((void)__atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST))
+#define atomic_add_32(p, v)	((void)__atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST))
+#define atomic_add_64(p, v)	((void)__atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST))
+#define atomic_subtract_int(p, v) ((void)__atomic_sub_fetch((p), (v), __ATOMIC_SEQ_CST))
+#define atomic_subtract_32(p, v) ((void)__atomic_sub_fetch((p), (v), __ATOMIC_SEQ_CST))
+#define atomic_subtract_64(p, v) ((void)__atomic_sub_fetch((p), (v), __ATOMIC_SEQ_CST))
+
+#define atomic_load_int(p)	__atomic_load_n((p), __ATOMIC_RELAXED)
+#define atomic_load_32(p)	__atomic_load_n((p), __ATOMIC_RELAXED)
+#define atomic_load_64(p)	__atomic_load_n((p), __ATOMIC_RELAXED)
+#define atomic_load_acq_int(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomic_load_acq_32(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomic_load_acq_64(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define atomic_load_acq_ptr(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+
+#define atomic_store_int(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define atomic_store_32(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define atomic_store_64(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define atomic_store_rel_int(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atomic_store_rel_32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atomic_store_rel_64(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define atomic_store_rel_ptr(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#define atomic_fetchadd_int(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define atomic_fetchadd_32(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define atomic_fetchadd_64(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+
+/* non-zero on success, *p is left unchanged on failure like FreeBSD */
+#define atomic_cmpset_int(p, cmp, set)					\
+	__extension__ ({						\
+		__typeof__(*(p) + 0) __cmp = (cmp);			\
+		__atomic_compare_exchange_n((p), &__cmp, (set), 0,	\
+					    __ATOMIC_SEQ_CST,		\
+					    __ATOMIC_SEQ_CST);		\
+	})
+#define atomic_cmpset_32(p, cmp, set)	atomic_cmpset_int(p, cmp, set)
+#define atomic_cmpset_64(p, cmp, set)	atomic_cmpset_int(p, cmp, set)
+
+/* on failure *cmp is updated with the current value */
+#define atomic_fcmpset_int(p, cmp, set)					\
+	__atomic_compare_exchange_n((p), (cmp), (set), 0,		\
+				    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define atomic_fcmpset_32(p, cmp, set)	atomic_fcmpset_int(p, cmp, set)
+#define atomic_fcmpset_64(p, cmp, set)	atomic_fcmpset_int(p, cmp, set)
+
+#define atomic_thread_fence_acq()	__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define atomic_thread_fence_rel()	__atomic_thread_fence(__ATOMIC_RELEASE)
+#define atomic_thread_fence_seq_cst()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#endif /* __SHIM_MACHINE_ATOMIC_H__ */
@@ -0,0 +1,391 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_KERNEL_H__
+#define __SHIM_KERNEL_H__
+
+/*
+ * Userspace stand-ins for the kernel interfaces used by kmod/
+ *
+ * Sources compiled with -D_KERNEL see the kernel names (malloc(9),
+ * printf(9), time_uptime, ...).  The shim implementation and the
+ * harness programs are compiled without _KERNEL and only see the
+ * shim_ prefixed functions backing them.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#include <sys/queue.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#ifndef __unused
+#define __unused		__attribute__((__unused__))
+#endif
+#define __dead2			__attribute__((__noreturn__))
+#define __printflike(f, a)	__attribute__((__format__(__printf__, f, a)))
+#define __predict_true(x)	__builtin_expect(!!(x), 1)
+#define __predict_false(x)	__builtin_expect(!!(x), 0)
+#define __aligned(x)		__attribute__((__aligned__(x)))
+#define CTASSERT(x)		_Static_assert(x, "compile-time assertion failed")
+#ifndef nitems
+#define nitems(x)		(sizeof((x)) / sizeof((x)[0]))
+#endif
+
+#define CACHE_LINE_SIZE		64
+#define MAXCOMLEN		19
+
+typedef unsigned char		u_char;
+typedef unsigned short		u_short;
+typedef unsigned int		u_int;
+typedef unsigned long		u_long;
+
+typedef int32_t			lwpid_t;
+
+/* The harness process, shared by all threads */
+struct proc {
+	pid_t p_pid;
+	char p_comm[MAXCOMLEN + 1];
+};
+
+/* Only the thread id and process; every pthread gets its own instance */
+struct thread {
+	lwpid_t td_tid;
+	struct proc *td_proc;
+};
+
+struct thread *shim_curthread(void);
+
+/*
+ * Time keeping
+ *
+ * The shim clock starts at one second of uptime when the process
+ * starts and runs at hz = 1000.
+ */
+typedef int64_t sbintime_t;
+
+#define SBT_1S	((sbintime_t)1 << 32)
+#define SBT_1MS	(SBT_1S / 1000)
+#define SBT_1US	(SBT_1S / 1000000)
+#define SBT_1NS	(SBT_1S / 1000000000)
+
+static __inline int64_t
+sbttons(sbintime_t sbt)
+{
+	return ((sbt >> 32) * 1000000000 +
+		(int64_t)(((uint64_t)1000000000 * (uint32_t)sbt) >> 32));
+}
+
+static __inline int64_t
+sbttoms(sbintime_t sbt)
+{
+	return ((sbt >> 32) * 1000 +
+		(int64_t)(((uint64_t)1000 * (uint32_t)sbt) >> 32));
+}
+
+static __inline sbintime_t
+nstosbt(int64_t ns)
+{
+	return (((sbintime_t)(ns / 1000000000) << 32) +
+		(((sbintime_t)(ns % 1000000000) << 32) / 1000000000));
+}
+
+static __inline sbintime_t
+mstosbt(int64_t ms)
+{
+	sbintime_t sb = 0;
+
+	if (ms >= 1000) {
+		sb = (ms / 1000) * SBT_1S;
+		ms = ms % 1000;
+	}
+	sb += ((ms * (((uint64_t)1 << 63) / 500)) >> 32);
+
+	return (sb);
+}
+
+extern int hz;
+extern int tick;
+
+sbintime_t shim_sbinuptime(void);
+time_t shim_time_uptime(void);
+int shim_ticks(void);
+int tvtohz(struct timeval *tv);
+
+/*
+ * Console
+ */
+int shim_printf(const char *fmt, ...) __printflike(1, 2);
+
+/*
+ * malloc(9)
+ */
+struct malloc_type {
+	const char *ks_shortdesc;
+	struct malloc_type *ks_next;
+	uint64_t ks_calls;		/* number of allocations */
+	int64_t ks_memuse;		/* bytes in use */
+	int64_t ks_inuse;		/* allocations in use */
+};
+
+#define M_NOWAIT	0x0001
+#define M_WAITOK	0x0002
+#define M_ZERO		0x0100
+
+#define MALLOC_DEFINE(type, shortdesc, longdesc)			\
+	struct malloc_type type[1] = { { .ks_shortdesc = (shortdesc) } }; \
+	static void __attribute__((__constructor__))			\
+	shim_malloc_define_ ## type(void)				\
+	{								\
+		shim_malloc_register(type);				\
+	}								\
+	struct __hack
+#define MALLOC_DECLARE(type)						\
+	extern struct malloc_type type[1]
+
+void shim_malloc_register(struct malloc_type *type);
+void *shim_malloc(size_t size, struct malloc_type *type, int flags);
+void shim_free(void *addr, struct malloc_type *type);
+
+/*
+ * Locks
+ */
+struct shim_lockstat;
+
+struct lock_object {
+	const char *lo_name;
+	struct shim_lockstat *lo_stat;	/* contention, shared per name */
+};
+
+struct mtx {
+	struct lock_object lock_object;
+	pthread_mutex_t mtx_lock;
+	pthread_t mtx_owner;		/* valid while mtx_recurse >= 0 */
+	volatile int mtx_recurse;	/* -1 while unowned */
+};
+
+struct rwlock {
+	struct lock_object lock_object;
+	pthread_rwlock_t rw_lock;
+};
+
+#define MTX_DEF		0x00000000
+#define MTX_SPIN	0x00000001
+#define MTX_RECURSE	0x00000004
+#define MTX_NOWITNESS	0x00000008
+#define MTX_DUPOK	0x00000010
+
+#define MA_NOTOWNED	0x00
+#define MA_OWNED	0x01
+
+#define RA_LOCKED	0x01
+#define RA_WLOCKED	0x04
+
+void shim_mtx_init(struct mtx *m, const char *name, const char *type, int opts);
+void shim_mtx_destroy(struct mtx *m);
+void shim_mtx_lock(struct mtx *m);
+int shim_mtx_trylock(struct mtx *m);
+void shim_mtx_unlock(struct mtx *m);
+int shim_mtx_owned(struct mtx *m);
+void shim_mtx_assert(struct mtx *m, int what, const char *file, int line);
+
+void shim_rw_init(struct rwlock *rw, const char *name);
+void shim_rw_destroy(struct rwlock *rw);
+void shim_rw_rlock(struct rwlock *rw);
+int shim_rw_try_rlock(struct rwlock *rw);
+void shim_rw_runlock(struct rwlock *rw);
+void shim_rw_wlock(struct rwlock *rw);
+int shim_rw_try_wlock(struct rwlock *rw);
+void shim_rw_wunlock(struct rwlock *rw);
+
+#define mtx_init(m, n, t, o)	shim_mtx_init((m), (n), (t), (o))
+#define mtx_destroy(m)		shim_mtx_destroy(m)
+#define mtx_lock(m)		shim_mtx_lock(m)
+#define mtx_trylock(m)		shim_mtx_trylock(m)
+#define mtx_unlock(m)		shim_mtx_unlock(m)
+#define mtx_owned(m)		shim_mtx_owned(m)
+#define mtx_assert(m, what)	shim_mtx_assert((m), (what), __FILE__, __LINE__)
+
+#define rw_init(rw, n)		shim_rw_init((rw), (n))
+#define rw_destroy(rw)		shim_rw_destroy(rw)
+#define rw_rlock(rw)		shim_rw_rlock(rw)
+#define rw_try_rlock(rw)	shim_rw_try_rlock(rw)
+#define rw_try_wlock(rw)	shim_rw_try_wlock(rw)
+#define rw_runlock(rw)		shim_rw_runlock(rw)
+#define rw_wlock(rw)		shim_rw_wlock(rw)
+#define rw_wunlock(rw)		shim_rw_wunlock(rw)
+#define rw_assert(rw, what)	((void)0)
+
+/*
+ * Sleep and wakeup
+ */
+#define PCATCH		0x100
+#define PDROP		0x200
+
+/* callout(9) flags, only C_ABSOLUTE has a meaning here */
+#define C_ABSOLUTE	0x0200
+
+int shim_msleep(const void *chan, struct mtx *mtx, int priority,
+		const char *wmesg, int timo);
+int shim_msleep_sbt(const void *chan, struct mtx *mtx, int priority,
+		    const char *wmesg, sbintime_t sbt, int flags);
+void shim_wakeup(const void *chan);
+void shim_wakeup_one(const void *chan);
+
+#define msleep(chan, mtx, pri, wmesg, timo)				\
+	shim_msleep((chan), (mtx), (pri), (wmesg), (timo))
+#define msleep_sbt(chan, mtx, pri, wmesg, sbt, pr, flags)		\
+	shim_msleep_sbt((chan), (mtx), (pri), (wmesg), (sbt), (flags))
+#define mtx_sleep(chan, mtx, pri, wmesg, timo)				\
+	shim_msleep((chan), (mtx), (pri), (wmesg), (timo))
+#define tsleep(chan, pri, wmesg, timo)					\
+	shim_msleep((chan), NULL, (pri), (wmesg), (timo))
+#define pause(wmesg, timo)						\
+	((void)shim_msleep(&hz, NULL, 0, (wmesg), (timo)))
+#define wakeup(chan)		shim_wakeup(chan)
+#define wakeup_one(chan)	shim_wakeup_one(chan)
+
+/*
+ * Callouts, run by a softclock kernel thread that only exists while
+ * callouts are pending or running
+ */
+struct callout {
+	TAILQ_ENTRY(callout) c_link;	/* on the pending list */
+	sbintime_t c_time;		/* deadline */
+	void (*c_func)(void *);
+	void *c_arg;
+	struct mtx *c_lock;		/* held around c_func */
+	uint64_t c_gen;			/* bumped by every reset and stop */
+	int c_flags;
+};
+
+#define CALLOUT_ACTIVE		0x0002
+#define CALLOUT_PENDING		0x0004
+
+void shim_callout_init_mtx(struct callout *c, struct mtx *mtx, int flags);
+int shim_callout_reset_sbt(struct callout *c, sbintime_t sbt,
+			   sbintime_t precision, void (*func)(void *),
+			   void *arg, int flags);
+int shim_callout_stop(struct callout *c);
+int shim_callout_drain(struct callout *c);
+
+#define callout_init_mtx(c, mtx, flags)	shim_callout_init_mtx((c), (mtx), (flags))
+#define callout_reset_sbt(c, sbt, pr, func, arg, flags)			\
+	shim_callout_reset_sbt((c), (sbt), (pr), (func), (arg), (flags))
+#define callout_stop(c)		shim_callout_stop(c)
+#define callout_drain(c)	shim_callout_drain(c)
+#define callout_pending(c)	((c)->c_flags & CALLOUT_PENDING)
+#define callout_active(c)	((c)->c_flags & CALLOUT_ACTIVE)
+#define callout_deactivate(c)	((c)->c_flags &= ~CALLOUT_ACTIVE)
+
+/*
+ * Kernel threads
+ */
+int shim_kthread_add(void (*func)(void *), void *arg, struct proc *p,
+		     struct thread **newtdp, int flags, int pages,
+		     const char *fmt, ...) __printflike(7, 8);
+void shim_kthread_exit(void) __dead2;
+
+#define kthread_add(func, arg, p, tdp, flags, pages, ...)		\
+	shim_kthread_add((func), (arg), (p), (tdp), (flags), (pages),	\
+			 __VA_ARGS__)
+#define kthread_exit()		shim_kthread_exit()
+
+/*
+ * Modules
+ */
+typedef struct module *module_t;
+typedef int (*modeventhand_t)(module_t, int, void *);
+
+typedef struct moduledata {
+	const char *name;
+	modeventhand_t evhand;
+	void *priv;
+} moduledata_t;
+
+enum modeventtype {
+	MOD_LOAD,
+	MOD_UNLOAD,
+	MOD_SHUTDOWN,
+	MOD_QUIESCE
+};
+
+#define SI_SUB_DRIVERS		0x3100000
+#define SI_ORDER_MIDDLE		0x1000000
+
+void shim_module_register(moduledata_t *data);
+
+#define DECLARE_MODULE(name, data, sub, order)				\
+	static void __attribute__((__constructor__))			\
+	shim_declare_module_ ## name(void)				\
+	{								\
+		shim_module_register(&(data));				\
+	}								\
+	struct __hack
+
+/*
+ * libkern
+ */
+char *strnstr(const char *s, const char *find, size_t slen);
+size_t strlcpy(char *dst, const char *src, size_t dsize);
+size_t strlcat(char *dst, const char *src, size_t dsize);
+
+static __inline int
+flsll(long long mask)
+{
+	return (mask ? 64 - __builtin_clzll((unsigned long long)mask) : 0);
+}
+
+#ifdef _KERNEL
+#define time_uptime		(shim_time_uptime())
+#define ticks			(shim_ticks())
+#define sbinuptime()		shim_sbinuptime()
+#define getsbinuptime()		shim_sbinuptime()
+#define curthread		(shim_curthread())
+
+#define printf(...)		shim_printf(__VA_ARGS__)
+#define malloc(size, type, flags) shim_malloc((size), (type), (flags))
+#define free(addr, type)	shim_free((addr), (type))
+#endif /* _KERNEL */
+
+#endif /* __SHIM_KERNEL_H__ */
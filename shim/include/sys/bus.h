@@ -0,0 +1,74 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_BUS_H__
+#define __SHIM_SYS_BUS_H__
+
+/*
+ * Stand-in for <sys/bus.h>
+ *
+ * Devices are looked up through their devclass.  Instead of kobj
+ * dispatch each device carries the handful of interface methods the
+ * module calls on it (see backlight_if.h and acpivar.h).
+ */
+#include <shim_kernel.h>
+
+struct backlight_props;
+
+typedef struct _device *device_t;
+typedef struct devclass *devclass_t;
+
+struct shim_device_methods {
+	int (*backlight_get_status)(device_t, struct backlight_props *);
+	int (*backlight_update_status)(device_t, struct backlight_props *);
+	int (*acpi_batt_get_info)(device_t, void *, size_t);
+};
+
+struct _device {
+	const char *name;
+	int unit;
+	void *softc;
+	const struct shim_device_methods *methods;
+	devclass_t devclass;
+};
+
+devclass_t devclass_find(const char *classname);
+device_t devclass_get_device(devclass_t dc, int unit);
+void *device_get_softc(device_t dev);
+
+/* device_attach event, see <sys/eventhandler.h> */
+typedef void (*device_attach_fn)(void *, device_t);
+
+device_t shim_device_add(const char *classname, int unit,
+			 const struct shim_device_methods *methods,
+			 void *softc);
+void shim_device_delete(device_t dev);
+
+#endif /* __SHIM_SYS_BUS_H__ */
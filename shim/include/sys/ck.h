@@ -0,0 +1,92 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_CK_H__
+#define __SHIM_SYS_CK_H__
+
+/*
+ * Stand-in for <sys/ck.h>
+ *
+ * Only the CK_LIST subset of ck_queue.h.  Writers are serialized by
+ * the caller; readers may walk a list concurrently, so links are
+ * published with release stores once an element is fully set up.
+ */
+#include <shim_kernel.h>
+
+#define CK_LIST_HEAD(name, type)					\
+struct name {								\
+	struct type *clh_first;						\
+}
+
+#define CK_LIST_ENTRY(type)						\
+struct {								\
+	struct type *cle_next;						\
+	struct type **cle_prev;						\
+}
+
+#define CK_LIST_FIRST(head)						\
+	__atomic_load_n(&(head)->clh_first, __ATOMIC_ACQUIRE)
+#define CK_LIST_NEXT(elm, field)					\
+	__atomic_load_n(&(elm)->field.cle_next, __ATOMIC_ACQUIRE)
+#define CK_LIST_EMPTY(head)	(NULL == CK_LIST_FIRST((head)))
+
+#define CK_LIST_INIT(head) do {						\
+	__atomic_store_n(&(head)->clh_first, NULL, __ATOMIC_RELEASE);	\
+} while (0)
+
+#define CK_LIST_FOREACH(var, head, field)				\
+	for ((var) = CK_LIST_FIRST((head));				\
+	    (var);							\
+	    (var) = CK_LIST_NEXT((var), field))
+
+#define CK_LIST_FOREACH_SAFE(var, head, field, tvar)			\
+	for ((var) = CK_LIST_FIRST((head));				\
+	    (var) && ((tvar) = CK_LIST_NEXT((var), field), 1);		\
+	    (var) = (tvar))
+
+#define CK_LIST_INSERT_HEAD(head, elm, field) do {			\
+	(elm)->field.cle_next = (head)->clh_first;			\
+	(elm)->field.cle_prev = &(head)->clh_first;			\
+	if (NULL != (head)->clh_first)					\
+		(head)->clh_first->field.cle_prev =			\
+			&(elm)->field.cle_next;				\
+	__atomic_store_n(&(head)->clh_first, (elm), __ATOMIC_RELEASE);	\
+} while (0)
+
+/* the removed element keeps its next link for readers still on it */
+#define CK_LIST_REMOVE(elm, field) do {					\
+	if (NULL != (elm)->field.cle_next)				\
+		(elm)->field.cle_next->field.cle_prev =			\
+			(elm)->field.cle_prev;				\
+	__atomic_store_n((elm)->field.cle_prev, (elm)->field.cle_next,	\
+			 __ATOMIC_RELEASE);				\
+} while (0)
+
+#endif /* __SHIM_SYS_CK_H__ */
@@ -0,0 +1,104 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_CONF_H__
+#define __SHIM_SYS_CONF_H__
+
+/*
+ * Stand-in for <sys/conf.h>
+ *
+ * Character devices carry a name, their driver data and, when made
+ * with make_dev(), their cdevsw; the shim devfs keeps them on
+ * cdevp_list under dev_lock() like the real one does.  Harness
+ * programs open them with shim_open().
+ */
+#include <shim_kernel.h>
+
+#define SPECNAMELEN	255
+
+#define D_VERSION	0x17122009
+
+#define UID_ROOT	0
+#define GID_WHEEL	0
+#define GID_OPERATOR	5
+#define GID_VIDEO	44
+
+struct cdev;
+
+typedef int d_open_t(struct cdev *dev, int oflags, int devtype,
+		     struct thread *td);
+typedef int d_close_t(struct cdev *dev, int fflag, int devtype,
+		      struct thread *td);
+typedef int d_ioctl_t(struct cdev *dev, u_long cmd, caddr_t data,
+		      int fflag, struct thread *td);
+
+struct cdevsw {
+	int d_version;
+	u_int d_flags;
+	const char *d_name;
+	d_open_t *d_open;
+	d_close_t *d_close;
+	d_ioctl_t *d_ioctl;
+};
+
+struct cdev {
+	void *si_drv1;
+	void *si_drv2;
+	struct cdevsw *si_devsw;
+	int si_refcount;		/* (d) dev_ref() and cdevp_list */
+	int si_threadcount;		/* (d) dev_refthread() */
+	char si_name[SPECNAMELEN + 1];
+};
+
+typedef void d_priv_dtor_t(void *data);
+
+struct cdev *shim_make_dev(void *drv1, const char *fmt, ...) __printflike(2, 3);
+void shim_destroy_dev(struct cdev *dev);
+
+#ifdef _KERNEL
+struct cdev *make_dev(struct cdevsw *devsw, int unit, uid_t uid, gid_t gid,
+		      int perms, const char *fmt, ...) __printflike(6, 7);
+void destroy_dev(struct cdev *dev);
+#endif
+
+void dev_lock(void);
+void dev_unlock(void);
+void dev_ref(struct cdev *dev);
+void dev_refl(struct cdev *dev);
+void dev_rel(struct cdev *dev);
+struct cdevsw *dev_refthread(struct cdev *dev, int *ref);
+void dev_relthread(struct cdev *dev, int ref);
+
+/* Per open file data, only within the methods of an open file */
+int devfs_set_cdevpriv(void *priv, d_priv_dtor_t *dtr);
+int devfs_get_cdevpriv(void **datap);
+void devfs_clear_cdevpriv(void);
+
+#endif /* __SHIM_SYS_CONF_H__ */
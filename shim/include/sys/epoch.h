@@ -0,0 +1,59 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_EPOCH_H__
+#define __SHIM_SYS_EPOCH_H__
+
+/*
+ * Stand-in for <sys/epoch.h>
+ *
+ * Readers count themselves into one of two slots selected by the
+ * epoch's generation.  epoch_wait_preempt() flips the generation and
+ * waits for the slot readers entered before the flip to drain.
+ */
+#include <shim_kernel.h>
+
+#define EPOCH_PREEMPT	0x1
+
+typedef struct epoch *epoch_t;
+
+struct epoch_tracker {
+	int et_slot;
+};
+
+epoch_t epoch_alloc(const char *name, int flags);
+void epoch_free(epoch_t epoch);
+void epoch_enter_preempt(epoch_t epoch, struct epoch_tracker *et);
+void epoch_exit_preempt(epoch_t epoch, struct epoch_tracker *et);
+void epoch_wait_preempt(epoch_t epoch);
+
+extern epoch_t global_epoch_preempt;
+
+#endif /* __SHIM_SYS_EPOCH_H__ */
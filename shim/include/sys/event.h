@@ -0,0 +1,86 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_EVENT_H__
+#define __SHIM_SYS_EVENT_H__
+
+/*
+ * Stand-in for <sys/event.h>
+ *
+ * Only the knote list plumbing drivers use to notify kqueue filters
+ * is provided.  knote() calls each filter directly with the list lock
+ * held, and the lock of the knote's kqueue if it has one; knotes are
+ * never activated.
+ */
+#include <shim_kernel.h>
+
+struct knote;
+struct kqueue;
+
+struct filterops {
+	int f_isfd;
+	int (*f_attach)(struct knote *kn);
+	void (*f_detach)(struct knote *kn);
+	int (*f_event)(struct knote *kn, long hint);
+};
+
+struct knote {
+	SLIST_ENTRY(knote) kn_selnext;
+	struct knlist *kn_knlist;
+	struct kqueue *kn_kq;
+	struct filterops *kn_fop;
+	void *kn_hook;
+	int kn_status;
+	int kn_influx;
+};
+
+#define KN_DETACHED	0x08		/* knote is detached */
+
+SLIST_HEAD(klist, knote);
+
+struct knlist {
+	struct klist kl_list;
+	struct mtx *kl_lockarg;
+};
+
+void knlist_init_mtx(struct knlist *knl, struct mtx *lock);
+void knlist_add(struct knlist *knl, struct knote *kn, int islocked);
+void knlist_remove(struct knlist *knl, struct knote *kn, int islocked);
+int knlist_empty(struct knlist *knl);
+void knlist_clear(struct knlist *knl, int islocked);
+void knlist_destroy(struct knlist *knl);
+void knote(struct knlist *list, long hint, int lockflags);
+
+#define KNF_LISTLOCKED	0x0001
+
+#define KNOTE_LOCKED(list, hint)	knote((list), (hint), KNF_LISTLOCKED)
+#define KNOTE_UNLOCKED(list, hint)	knote((list), (hint), 0)
+
+#endif /* __SHIM_SYS_EVENT_H__ */
@@ -0,0 +1,60 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_EVENTHANDLER_H__
+#define __SHIM_SYS_EVENTHANDLER_H__
+
+/*
+ * Stand-in for <sys/eventhandler.h>
+ *
+ * Handlers are kept in one list keyed by event name.  Events are
+ * invoked by the stand-in subsystems that raise them, for example
+ * device_attach by shim_evdev_create().
+ */
+#include <shim_kernel.h>
+
+#define EVENTHANDLER_PRI_FIRST	0
+#define EVENTHANDLER_PRI_ANY	10000
+#define EVENTHANDLER_PRI_LAST	20000
+
+typedef struct eventhandler_entry *eventhandler_tag;
+
+eventhandler_tag shim_eventhandler_register(const char *name,
+					    void (*func)(void),
+					    void *arg, int priority);
+void shim_eventhandler_deregister(const char *name, eventhandler_tag tag);
+
+#define EVENTHANDLER_REGISTER(name, func, arg, priority)		\
+	shim_eventhandler_register(#name, (void (*)(void))(func),	\
+				   (arg), (priority))
+#define EVENTHANDLER_DEREGISTER(name, tag)				\
+	shim_eventhandler_deregister(#name, (tag))
+
+#endif /* __SHIM_SYS_EVENTHANDLER_H__ */
@@ -0,0 +1,64 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_SBUF_H__
+#define __SHIM_SYS_SBUF_H__
+
+/*
+ * Stand-in for <sys/sbuf.h>
+ *
+ * Automatically growing buffers only; a buffer made by
+ * sbuf_new_for_sysctl() is copied out to the request by sbuf_finish().
+ */
+#include <shim_kernel.h>
+
+struct sysctl_req;
+
+struct sbuf {
+	char *s_buf;
+	size_t s_len;			/* excluding the terminating NUL */
+	size_t s_size;
+	int s_error;
+	struct sysctl_req *s_req;	/* drain target, if any */
+};
+
+struct sbuf *sbuf_new_auto(void);
+struct sbuf *sbuf_new_for_sysctl(struct sbuf *s, char *buf, int length,
+				 struct sysctl_req *req);
+int sbuf_printf(struct sbuf *s, const char *fmt, ...) __printflike(2, 3);
+int sbuf_cat(struct sbuf *s, const char *str);
+int sbuf_putc(struct sbuf *s, int c);
+int sbuf_finish(struct sbuf *s);
+char *sbuf_data(struct sbuf *s);
+ssize_t sbuf_len(struct sbuf *s);
+void sbuf_clear(struct sbuf *s);
+void sbuf_delete(struct sbuf *s);
+
+#endif /* __SHIM_SYS_SBUF_H__ */
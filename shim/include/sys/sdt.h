@@ -0,0 +1,104 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_SDT_H__
+#define __SHIM_SYS_SDT_H__
+
+/*
+ * Stand-in for <sys/sdt.h>
+ *
+ * Probes are always compiled in and fire into the hook a harness
+ * installs with shim_sdt_sethook().
+ */
+#include <shim_kernel.h>
+
+struct sdt_provider {
+	const char *name;
+};
+
+struct sdt_probe {
+	struct sdt_provider *prov;
+	const char *mod;
+	const char *func;
+	const char *name;
+};
+
+typedef void shim_sdt_probe_func_t(struct sdt_probe *, uintptr_t, uintptr_t,
+				   uintptr_t, uintptr_t, uintptr_t);
+
+extern shim_sdt_probe_func_t *shim_sdt_probe_func;
+
+#define SDT_PROVIDER_DEFINE(prov)					\
+	struct sdt_provider sdt_provider_##prov[1] = { { #prov } }
+#define SDT_PROVIDER_DECLARE(prov)					\
+	extern struct sdt_provider sdt_provider_##prov[1]
+
+#define SDT_PROBE_DEFINE(prov, mod, func, name)				\
+	struct sdt_probe sdt_##prov##_##mod##_##func##_##name[1] = {	\
+		{ sdt_provider_##prov, #mod, #func, #name } }
+#define SDT_PROBE_DECLARE(prov, mod, func, name)			\
+	extern struct sdt_probe sdt_##prov##_##mod##_##func##_##name[1]
+
+#define SDT_PROBE_DEFINE0(prov, mod, func, name)			\
+	SDT_PROBE_DEFINE(prov, mod, func, name)
+#define SDT_PROBE_DEFINE1(prov, mod, func, name, a0)			\
+	SDT_PROBE_DEFINE(prov, mod, func, name)
+#define SDT_PROBE_DEFINE2(prov, mod, func, name, a0, a1)		\
+	SDT_PROBE_DEFINE(prov, mod, func, name)
+#define SDT_PROBE_DEFINE3(prov, mod, func, name, a0, a1, a2)		\
+	SDT_PROBE_DEFINE(prov, mod, func, name)
+#define SDT_PROBE_DEFINE4(prov, mod, func, name, a0, a1, a2, a3)	\
+	SDT_PROBE_DEFINE(prov, mod, func, name)
+#define SDT_PROBE_DEFINE5(prov, mod, func, name, a0, a1, a2, a3, a4)	\
+	SDT_PROBE_DEFINE(prov, mod, func, name)
+
+#define SDT_PROBE(prov, mod, func, name, a0, a1, a2, a3, a4) do {	\
+	shim_sdt_probe_func_t *_f =					\
+		__atomic_load_n(&shim_sdt_probe_func, __ATOMIC_ACQUIRE);	\
+	if (__predict_false(_f != NULL))				\
+		_f(sdt_##prov##_##mod##_##func##_##name,		\
+		   (uintptr_t)(a0), (uintptr_t)(a1), (uintptr_t)(a2),	\
+		   (uintptr_t)(a3), (uintptr_t)(a4));			\
+} while (0)
+
+#define SDT_PROBE0(prov, mod, func, name)				\
+	SDT_PROBE(prov, mod, func, name, 0, 0, 0, 0, 0)
+#define SDT_PROBE1(prov, mod, func, name, a0)				\
+	SDT_PROBE(prov, mod, func, name, a0, 0, 0, 0, 0)
+#define SDT_PROBE2(prov, mod, func, name, a0, a1)			\
+	SDT_PROBE(prov, mod, func, name, a0, a1, 0, 0, 0)
+#define SDT_PROBE3(prov, mod, func, name, a0, a1, a2)			\
+	SDT_PROBE(prov, mod, func, name, a0, a1, a2, 0, 0)
+#define SDT_PROBE4(prov, mod, func, name, a0, a1, a2, a3)		\
+	SDT_PROBE(prov, mod, func, name, a0, a1, a2, a3, 0)
+#define SDT_PROBE5(prov, mod, func, name, a0, a1, a2, a3, a4)		\
+	SDT_PROBE(prov, mod, func, name, a0, a1, a2, a3, a4)
+
+#endif /* __SHIM_SYS_SDT_H__ */
@@ -0,0 +1,181 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_SYS_SYSCTL_H__
+#define __SHIM_SYS_SYSCTL_H__
+
+/*
+ * Stand-in for <sys/sysctl.h>
+ *
+ * Dynamic OIDs are kept in an in-memory tree rooted at "hw" which the
+ * harness reads and writes through shim_sysctlbyname().
+ */
+#include <shim_kernel.h>
+
+#define CTLTYPE			0xf
+#define CTLTYPE_NODE		1
+#define CTLTYPE_INT		2
+#define CTLTYPE_STRING		3
+#define CTLTYPE_S64		4
+#define CTLTYPE_OPAQUE		5
+#define CTLTYPE_UINT		6
+#define CTLTYPE_LONG		7
+#define CTLTYPE_ULONG		8
+#define CTLTYPE_U64		9
+#define CTLTYPE_U8		0xa
+#define CTLTYPE_U16		0xb
+#define CTLTYPE_S32		0xe
+#define CTLTYPE_U32		0xf
+
+#define CTLFLAG_RD		0x80000000
+#define CTLFLAG_WR		0x40000000
+#define CTLFLAG_RW		(CTLFLAG_RD | CTLFLAG_WR)
+#define CTLFLAG_TUN		0x00080000
+#define CTLFLAG_RDTUN		(CTLFLAG_RD | CTLFLAG_TUN)
+#define CTLFLAG_RWTUN		(CTLFLAG_RW | CTLFLAG_TUN)
+#define CTLFLAG_MPSAFE		0x00040000
+#define CTLFLAG_STATS		0x00002000
+
+#define OID_AUTO		(-1)
+
+struct sysctl_oid;
+struct sysctl_req;
+
+#define SYSCTL_HANDLER_ARGS						\
+	struct sysctl_oid *oidp, void *arg1, intmax_t arg2,		\
+	struct sysctl_req *req
+
+typedef int (*sysctl_handler_t)(SYSCTL_HANDLER_ARGS);
+
+struct sysctl_req {
+	void *oldptr;
+	size_t oldlen;
+	size_t oldidx;
+	const void *newptr;
+	size_t newlen;
+	size_t newidx;
+};
+
+SLIST_HEAD(sysctl_oid_list, sysctl_oid);
+
+struct sysctl_oid {
+	struct sysctl_oid_list oid_children;
+	struct sysctl_oid_list *oid_parent;
+	SLIST_ENTRY(sysctl_oid) oid_link;
+	int oid_number;
+	u_int oid_kind;
+	void *oid_arg1;
+	intmax_t oid_arg2;
+	const char *oid_name;
+	sysctl_handler_t oid_handler;
+	const char *oid_fmt;
+	const char *oid_descr;
+};
+
+struct sysctl_ctx_entry {
+	struct sysctl_oid *entry;
+	TAILQ_ENTRY(sysctl_ctx_entry) link;
+};
+
+TAILQ_HEAD(sysctl_ctx_list, sysctl_ctx_entry);
+
+extern struct sysctl_oid sysctl___hw;
+
+int sysctl_handle_int(SYSCTL_HANDLER_ARGS);
+int sysctl_handle_32(SYSCTL_HANDLER_ARGS);
+int sysctl_handle_64(SYSCTL_HANDLER_ARGS);
+int sysctl_handle_string(SYSCTL_HANDLER_ARGS);
+int sysctl_handle_opaque(SYSCTL_HANDLER_ARGS);
+int sysctl_handle_counter_u64(SYSCTL_HANDLER_ARGS);
+
+/* old buffers are plain memory, nothing to wire */
+#define sysctl_wire_old_buffer(req, len)	(0)
+
+int sysctl_ctx_init(struct sysctl_ctx_list *clist);
+int sysctl_ctx_free(struct sysctl_ctx_list *clist);
+
+struct sysctl_oid *shim_sysctl_add_oid(struct sysctl_ctx_list *clist,
+				       struct sysctl_oid_list *parent,
+				       int nbr, const char *name, int kind,
+				       void *arg1, intmax_t arg2,
+				       sysctl_handler_t handler,
+				       const char *fmt, const char *descr);
+int shim_sysctl_out(struct sysctl_req *req, const void *p, size_t l);
+int shim_sysctl_in(struct sysctl_req *req, void *p, size_t l);
+
+#define SYSCTL_OUT(r, p, l)	shim_sysctl_out((r), (p), (l))
+#define SYSCTL_IN(r, p, l)	shim_sysctl_in((r), (p), (l))
+
+#define SYSCTL_CHILDREN(oid_ptr)	(&(oid_ptr)->oid_children)
+#define SYSCTL_STATIC_CHILDREN(oid_name) (&sysctl__ ## oid_name.oid_children)
+
+#define SYSCTL_ADD_OID(ctx, parent, nbr, name, kind, a1, a2, handler, fmt, descr) \
+	shim_sysctl_add_oid((ctx), (parent), (nbr), (name), (kind),	\
+			    (a1), (a2), (handler), (fmt), (descr))
+
+#define SYSCTL_ADD_NODE(ctx, parent, nbr, name, access, handler, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name),			\
+		       CTLTYPE_NODE | (access), NULL, 0, (handler), "N", (descr))
+
+#define SYSCTL_ADD_PROC(ctx, parent, nbr, name, access, ptr, arg, handler, fmt, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name), (access),	\
+		       (ptr), (arg), (handler), (fmt), (descr))
+
+#define SYSCTL_ADD_INT(ctx, parent, nbr, name, access, ptr, val, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name),			\
+		       CTLTYPE_INT | (access), (ptr), (val),		\
+		       sysctl_handle_int, "I", (descr))
+
+#define SYSCTL_ADD_UINT(ctx, parent, nbr, name, access, ptr, val, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name),			\
+		       CTLTYPE_UINT | (access), (ptr), (val),		\
+		       sysctl_handle_int, "IU", (descr))
+
+#define SYSCTL_ADD_U32(ctx, parent, nbr, name, access, ptr, val, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name),			\
+		       CTLTYPE_U32 | (access), (ptr), (val),		\
+		       sysctl_handle_32, "IU", (descr))
+
+#define SYSCTL_ADD_U64(ctx, parent, nbr, name, access, ptr, val, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name),			\
+		       CTLTYPE_U64 | (access), (ptr), (val),		\
+		       sysctl_handle_64, "QU", (descr))
+
+#define SYSCTL_ADD_COUNTER_U64(ctx, parent, nbr, name, access, ptr, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name),			\
+		       CTLTYPE_U64 | CTLFLAG_STATS | (access), (ptr), 0,	\
+		       sysctl_handle_counter_u64, "QU", (descr))
+
+#define SYSCTL_ADD_STRING(ctx, parent, nbr, name, access, arg, len, descr) \
+	SYSCTL_ADD_OID((ctx), (parent), (nbr), (name),			\
+		       CTLTYPE_STRING | (access), (arg), (len),		\
+		       sysctl_handle_string, "A", (descr))
+
+#endif /* __SHIM_SYS_SYSCTL_H__ */
@@ -0,0 +1,200 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_H__
+#define __SHIM_H__
+
+/*
+ * Harness side of the kernel shim
+ *
+ * Programs linking the userspace build of kmod/ use these functions
+ * to set up the stand-in hardware, load and unload the module and
+ * feed it input.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <dev/evdev/input.h>
+#include <dev/acpica/acpiio.h>
+
+struct evdev_dev;
+struct sdt_probe;
+
+/* Route kernel console output to fp, NULL discards it */
+void shim_console_set(FILE *fp);
+
+/* Current shim uptime in nanoseconds */
+int64_t shim_uptime_ns(void);
+
+/*
+ * Load or unload a module linked into the program; with SHIM_STATS set
+ * in the environment, hw.<module>.stats is reported at unload
+ */
+int shim_kldload(const char *name);
+int shim_kldunload(const char *name);
+
+/* Number of kernel threads still running */
+int shim_kthread_count(void);
+
+/* Wait until all kernel threads have exited */
+void shim_kthread_drain(void);
+
+/* Number of times a sleeping kernel thread was made runnable */
+uint64_t shim_kthread_wakeups(void);
+
+/*
+ * Virtual clock
+ *
+ * Once enabled, uptime only moves through shim_vclock_advance(), which
+ * first waits for all kernel threads to go to sleep and then fires
+ * msleep() timeouts in deadline order.  Enable before loading modules.
+ */
+void shim_vclock_enable(void);
+
+/* Wait until every kernel thread sleeps */
+void shim_vclock_settle(void);
+
+/* Move the virtual clock forward by ns nanoseconds */
+void shim_vclock_advance(int64_t ns);
+
+/*
+ * Called for every SDT probe that fires, see <sys/sdt.h>
+ */
+typedef void shim_sdt_hook_t(struct sdt_probe *probe, uintptr_t arg0,
+			     uintptr_t arg1, uintptr_t arg2, uintptr_t arg3,
+			     uintptr_t arg4);
+
+/* Install hook, NULL disables probes again */
+void shim_sdt_sethook(shim_sdt_hook_t *hook);
+
+/*
+ * Lock contention, summed over all locks sharing a name
+ */
+struct shim_lockstat_info {
+	const char *name;
+	uint64_t acquires;
+	uint64_t contended;	/* acquisitions that had to wait */
+	uint64_t wait_ns;	/* total time spent waiting */
+};
+
+/* Fill up to max entries, returns the number filled */
+int shim_lockstat_get(struct shim_lockstat_info *info, int max);
+void shim_lockstat_reset(void);
+
+/* CPU time consumed by kernel threads, live and exited */
+int64_t shim_kthread_cputime_ns(void);
+
+/* Bytes still allocated through malloc(9) type shortdesc */
+int64_t shim_malloc_inuse(const char *shortdesc);
+
+/* sysctlbyname(3) for the shim sysctl tree */
+int shim_sysctlbyname(const char *name, void *oldp, size_t *oldlenp,
+		      const void *newp, size_t newlen);
+
+/* Convenience wrappers for integer sysctls */
+int shim_sysctl_getu32(const char *name, uint32_t *value);
+int shim_sysctl_setu32(const char *name, uint32_t value);
+
+/* Print every leaf below prefix as "name: value" */
+void shim_sysctl_dump(FILE *fp, const char *prefix);
+
+/*
+ * Create an input device, visible as input/eventN; raises device_attach
+ * like a hot plugged device.  types has a bit per supported event type,
+ * EV_SYN is always supported.
+ */
+struct evdev_dev *shim_evdev_create(const char *name, const char *shortname,
+				    uint16_t bustype, uint16_t vendor,
+				    uint16_t product, size_t report_size,
+				    uint32_t types);
+
+/* Event types of common devices, for shim_evdev_create() */
+#define SHIM_EV_KEYBOARD	(1u << EV_KEY | 1u << EV_LED | 1u << EV_REP)
+#define SHIM_EV_MOUSE		(1u << EV_KEY | 1u << EV_REL)
+#define SHIM_EV_TOUCHPAD	(1u << EV_KEY | 1u << EV_ABS)
+#define SHIM_EV_BUTTON		(1u << EV_KEY)
+
+/* Remove an input device, revoking all of its clients */
+void shim_evdev_destroy(struct evdev_dev *evdev);
+
+/* Deliver one event to all clients of evdev */
+void shim_evdev_push(struct evdev_dev *evdev, uint16_t type,
+		     uint16_t code, int32_t value);
+
+/* Deliver EV_SYN/SYN_REPORT, completing the current report */
+void shim_evdev_sync(struct evdev_dev *evdev);
+
+/* Number of clients registered on evdev */
+int shim_evdev_nclients(struct evdev_dev *evdev);
+
+/* Number of client ring overflows on evdev */
+uint64_t shim_evdev_dropped(struct evdev_dev *evdev);
+
+/* Attach or detach backlight/backlight0 */
+void shim_backlight_attach(uint32_t brightness);
+void shim_backlight_detach(void);
+
+/* Current backlight level and number of BACKLIGHT_UPDATE_STATUS calls */
+uint32_t shim_backlight_get(void);
+uint64_t shim_backlight_writes(void);
+
+/* Report nlevels discrete levels from 0 to 100, 0 for none */
+void shim_backlight_setlevels(uint32_t nlevels);
+
+/* Delay every backlight method call by ns nanoseconds */
+void shim_backlight_setlatency(int64_t ns);
+
+/* Attach or detach the acpi node and battery0 */
+void shim_acpi_attach(int state);
+void shim_acpi_detach(void);
+
+/* Battery state reported to acpi_battery_get_battinfo() */
+void shim_acpi_setstate(int state);
+
+/* Number of battery queries served */
+uint64_t shim_acpi_queries(void);
+
+/* Delay every battery query by ns nanoseconds */
+void shim_acpi_setlatency(int64_t ns);
+
+/*
+ * open(2), ioctl(2) and close(2) on a device node made with make_dev(),
+ * name as below /dev; closing runs the cdevpriv destructor
+ */
+struct shim_file;
+
+int shim_open(const char *name, struct shim_file **fpp);
+int shim_ioctl(struct shim_file *fp, unsigned long cmd, void *data);
+void shim_close(struct shim_file *fp);
+
+#endif /* __SHIM_H__ */
@@ -0,0 +1,145 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * ACPI stand-in: the acpi device node and battery0
+ */
+
+#include <shim_kernel.h>
+#include <sys/bus.h>
+#include <sys/conf.h>
+#include <sys/power.h>
+
+#include <dev/acpica/acpivar.h>
+
+#include "shim.h"
+#include "shim_internal.h"
+
+struct acpi_softc {
+	device_t acpi_dev;
+};
+
+static struct shim_acpi_t {
+	struct acpi_softc sc;
+	struct cdev *cdev;
+	device_t batt_dev;
+	int state;
+	uint64_t queries;
+	int64_t latency;
+} shim_acpi;
+
+static int
+shim_acpi_batt_get_info(device_t dev __unused, void *data, size_t len)
+{
+	struct acpi_bix bix = {
+		.rev = 0,
+		.units = 0,
+		.dcap = 5491,
+		.lfcap = 5270,
+		.dvol = 15480
+	};
+
+	shim_delay(__atomic_load_n(&shim_acpi.latency, __ATOMIC_RELAXED));
+
+	snprintf(bix.model, sizeof(bix.model), "Framework Laptop");
+	snprintf(bix.serial, sizeof(bix.serial), "0001");
+	snprintf(bix.type, sizeof(bix.type), "LION");
+	snprintf(bix.oeminfo, sizeof(bix.oeminfo), "shim");
+
+	memcpy(data, &bix, MIN(len, sizeof(bix)));
+
+	return (0);
+}
+
+static const struct shim_device_methods shim_acpi_batt_methods = {
+	.acpi_batt_get_info = shim_acpi_batt_get_info
+};
+
+int
+acpi_battery_get_battinfo(device_t dev __unused, struct acpi_battinfo *info)
+{
+	shim_delay(__atomic_load_n(&shim_acpi.latency, __ATOMIC_RELAXED));
+	__atomic_add_fetch(&shim_acpi.queries, 1, __ATOMIC_RELAXED);
+
+	info->cap = 80;
+	info->min = -1;
+	info->rate = -1;
+	info->state = __atomic_load_n(&shim_acpi.state, __ATOMIC_RELAXED);
+
+	return (0);
+}
+
+void
+shim_acpi_attach(int state)
+{
+	memset(&shim_acpi, 0, sizeof(shim_acpi));
+	shim_acpi.state = state;
+	shim_acpi.cdev = shim_make_dev(&shim_acpi.sc, "acpi");
+	shim_acpi.batt_dev = shim_device_add("battery", 0,
+					     &shim_acpi_batt_methods, NULL);
+}
+
+void
+shim_acpi_detach(void)
+{
+	if (NULL == shim_acpi.cdev)
+		return;
+
+	shim_device_delete(shim_acpi.batt_dev);
+	shim_destroy_dev(shim_acpi.cdev);
+	shim_acpi.batt_dev = NULL;
+	shim_acpi.cdev = NULL;
+}
+
+void
+shim_acpi_setstate(int state)
+{
+	const int battery = ACPI_BATT_STAT_DISCHARG | ACPI_BATT_STAT_CRITICAL;
+	int old = __atomic_exchange_n(&shim_acpi.state, state,
+				      __ATOMIC_RELAXED);
+
+	/* the AC line changed */
+	if (!(old & battery) != !(state & battery))
+		shim_eventhandler_power_profile_change((state & battery) ?
+						       POWER_PROFILE_ECONOMY :
+						       POWER_PROFILE_PERFORMANCE);
+}
+
+uint64_t
+shim_acpi_queries(void)
+{
+	return (__atomic_load_n(&shim_acpi.queries, __ATOMIC_RELAXED));
+}
+
+void
+shim_acpi_setlatency(int64_t ns)
+{
+	__atomic_store_n(&shim_acpi.latency, ns, __ATOMIC_RELAXED);
+}
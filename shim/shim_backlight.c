@@ -0,0 +1,146 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * backlight(9) stand-in, registered as backlight/backlight0
+ */
+
+#include <shim_kernel.h>
+#include <sys/bus.h>
+#include <sys/conf.h>
+
+#include <dev/backlight/backlight.h>
+
+#include "shim.h"
+#include "shim_internal.h"
+
+/* same layout as the softc in dev/backlight/backlight.c */
+struct backlight_softc {
+	struct cdev *cdev;
+	struct cdev *alias;
+	int unit;
+	device_t dev;
+	uint32_t cached_brightness;
+};
+
+static struct shim_backlight_t {
+	struct backlight_softc sc;
+	uint32_t brightness;
+	uint32_t nlevels;
+	uint64_t writes;
+	int64_t latency;
+} shim_backlight;
+
+static int
+shim_backlight_get_status(device_t dev __unused, struct backlight_props *props)
+{
+	shim_delay(__atomic_load_n(&shim_backlight.latency, __ATOMIC_RELAXED));
+
+	memset(props, 0, sizeof(*props));
+	props->brightness = __atomic_load_n(&shim_backlight.brightness,
+					    __ATOMIC_RELAXED);
+
+	/* evenly spaced from 0 to 100, like a panel with few steps */
+	props->nlevels = shim_backlight.nlevels;
+	for (uint32_t i = 0; i < props->nlevels; i++)
+		props->levels[i] = (1 == props->nlevels) ? 100 :
+			i * 100 / (props->nlevels - 1);
+
+	return (0);
+}
+
+static int
+shim_backlight_update_status(device_t dev __unused,
+			     struct backlight_props *props)
+{
+	shim_delay(__atomic_load_n(&shim_backlight.latency, __ATOMIC_RELAXED));
+
+	if (props->brightness > 100)
+		return (ERANGE);
+
+	__atomic_store_n(&shim_backlight.brightness, props->brightness,
+			 __ATOMIC_RELAXED);
+	__atomic_add_fetch(&shim_backlight.writes, 1, __ATOMIC_RELAXED);
+
+	return (0);
+}
+
+static const struct shim_device_methods shim_backlight_methods = {
+	.backlight_get_status = shim_backlight_get_status,
+	.backlight_update_status = shim_backlight_update_status
+};
+
+void
+shim_backlight_attach(uint32_t brightness)
+{
+	memset(&shim_backlight, 0, sizeof(shim_backlight));
+	shim_backlight.brightness = brightness;
+	shim_backlight.sc.dev = shim_device_add("backlight", 0,
+						&shim_backlight_methods,
+						&shim_backlight.sc);
+	shim_backlight.sc.cdev = shim_make_dev(&shim_backlight.sc,
+					       "backlight/backlight0");
+}
+
+void
+shim_backlight_detach(void)
+{
+	if (NULL == shim_backlight.sc.cdev)
+		return;
+
+	shim_destroy_dev(shim_backlight.sc.cdev);
+	shim_device_delete(shim_backlight.sc.dev);
+	shim_backlight.sc.cdev = NULL;
+	shim_backlight.sc.dev = NULL;
+}
+
+uint32_t
+shim_backlight_get(void)
+{
+	return (__atomic_load_n(&shim_backlight.brightness, __ATOMIC_RELAXED));
+}
+
+uint64_t
+shim_backlight_writes(void)
+{
+	return (__atomic_load_n(&shim_backlight.writes, __ATOMIC_RELAXED));
+}
+
+void
+shim_backlight_setlevels(uint32_t nlevels)
+{
+	shim_backlight.nlevels = MIN(nlevels, BACKLIGHTMAXLEVELS);
+}
+
+void
+shim_backlight_setlatency(int64_t ns)
+{
+	__atomic_store_n(&shim_backlight.latency, ns, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,233 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Callouts
+ *
+ * A softclock kernel thread runs the callouts once their deadline
+ * passed, with the callout's mutex held.  It is started by the first
+ * callout armed and exits once none is pending, so it never outlives
+ * the module that armed them.  Precision is ignored.
+ */
+
+#include <shim_kernel.h>
+
+#include "shim.h"
+#include "shim_internal.h"
+
+static struct shim_softclock {
+	struct mtx lock;
+	TAILQ_HEAD(, callout) pending;
+	struct callout *running;	/* callout whose function runs */
+	bool started;			/* thread exists */
+} shim_softclock;
+
+static void __attribute__((__constructor__))
+shim_callout_init(void)
+{
+	mtx_init(&shim_softclock.lock, "softclock", NULL, MTX_DEF);
+	TAILQ_INIT(&shim_softclock.pending);
+}
+
+/*
+ * Earliest pending callout, called with the softclock lock held
+ */
+static struct callout *
+shim_softclock_next(void)
+{
+	struct callout *c, *next = NULL;
+
+	TAILQ_FOREACH(c, &shim_softclock.pending, c_link) {
+		if (NULL == next || c->c_time < next->c_time)
+			next = c;
+	}
+
+	return (next);
+}
+
+/*
+ * Run a callout that is due, called with the softclock lock held
+ *
+ * A callout reset or stopped while its mutex was being acquired is
+ * not run, as callout(9) promises for callouts with a mutex.
+ */
+static void
+shim_softclock_run(struct callout *c)
+{
+	void (*func)(void *) = NULL;
+	void *arg = NULL;
+	uint64_t gen = c->c_gen;
+
+	TAILQ_REMOVE(&shim_softclock.pending, c, c_link);
+	c->c_flags &= ~CALLOUT_PENDING;
+	shim_softclock.running = c;
+	mtx_unlock(&shim_softclock.lock);
+
+	if (c->c_lock)
+		mtx_lock(c->c_lock);
+	mtx_lock(&shim_softclock.lock);
+	if (gen == c->c_gen) {
+		func = c->c_func;
+		arg = c->c_arg;
+	}
+	mtx_unlock(&shim_softclock.lock);
+
+	if (func)
+		func(arg);
+	if (c->c_lock)
+		mtx_unlock(c->c_lock);
+
+	mtx_lock(&shim_softclock.lock);
+	shim_softclock.running = NULL;
+	wakeup(&shim_softclock.running);
+}
+
+static void
+shim_softclock_thread(void *arg __unused)
+{
+	struct callout *c;
+
+	mtx_lock(&shim_softclock.lock);
+	for (;;) {
+		c = shim_softclock_next();
+		if (NULL == c)
+			break;
+
+		if (c->c_time <= shim_sbinuptime()) {
+			shim_softclock_run(c);
+			continue;
+		}
+
+		msleep_sbt(&shim_softclock.pending, &shim_softclock.lock, 0,
+			   "softclock", c->c_time, 0, C_ABSOLUTE);
+	}
+	shim_softclock.started = false;
+	mtx_unlock(&shim_softclock.lock);
+}
+
+void
+shim_callout_init_mtx(struct callout *c, struct mtx *mtx, int flags __unused)
+{
+	memset(c, 0, sizeof(*c));
+	c->c_lock = mtx;
+}
+
+/*
+ * Remove a callout from the pending list, called with the softclock
+ * lock held; returns whether it was pending
+ *
+ * The softclock thread is woken up to pick its next deadline, or to
+ * exit once nothing is left pending.
+ */
+static int
+shim_callout_cancel(struct callout *c)
+{
+	c->c_gen++;
+	if (!(c->c_flags & CALLOUT_PENDING))
+		return (0);
+
+	TAILQ_REMOVE(&shim_softclock.pending, c, c_link);
+	c->c_flags &= ~CALLOUT_PENDING;
+	wakeup(&shim_softclock.pending);
+
+	return (1);
+}
+
+int
+shim_callout_reset_sbt(struct callout *c, sbintime_t sbt,
+		       sbintime_t precision __unused, void (*func)(void *),
+		       void *arg, int flags)
+{
+	int cancelled;
+
+	if (c->c_lock)
+		mtx_assert(c->c_lock, MA_OWNED);
+
+	mtx_lock(&shim_softclock.lock);
+	cancelled = shim_callout_cancel(c);
+	c->c_time = (flags & C_ABSOLUTE) ? sbt : shim_sbinuptime() + sbt;
+	c->c_func = func;
+	c->c_arg = arg;
+	c->c_flags |= CALLOUT_PENDING | CALLOUT_ACTIVE;
+	TAILQ_INSERT_TAIL(&shim_softclock.pending, c, c_link);
+
+	if (!shim_softclock.started) {
+		shim_softclock.started = true;
+		if (0 != kthread_add(shim_softclock_thread, NULL, NULL, NULL,
+				     0, 0, "softclock")) {
+			fprintf(stderr, "shim: cannot start softclock\n");
+			abort();
+		}
+	} else {
+		wakeup(&shim_softclock.pending);
+	}
+	mtx_unlock(&shim_softclock.lock);
+
+	return (cancelled);
+}
+
+int
+shim_callout_stop(struct callout *c)
+{
+	int cancelled;
+
+	if (c->c_lock)
+		mtx_assert(c->c_lock, MA_OWNED);
+
+	mtx_lock(&shim_softclock.lock);
+	cancelled = shim_callout_cancel(c);
+	c->c_flags &= ~CALLOUT_ACTIVE;
+	mtx_unlock(&shim_softclock.lock);
+
+	return (cancelled);
+}
+
+/*
+ * Stop a callout and wait for its function to return, must be called
+ * without the callout's mutex
+ */
+int
+shim_callout_drain(struct callout *c)
+{
+	int cancelled;
+
+	if (c->c_lock)
+		mtx_assert(c->c_lock, MA_NOTOWNED);
+
+	mtx_lock(&shim_softclock.lock);
+	cancelled = shim_callout_cancel(c);
+	c->c_flags &= ~CALLOUT_ACTIVE;
+	while (shim_softclock.running == c)
+		msleep(&shim_softclock.running, &shim_softclock.lock, 0,
+		       "codrain", 0);
+	mtx_unlock(&shim_softclock.lock);
+
+	return (cancelled);
+}
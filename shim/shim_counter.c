@@ -0,0 +1,84 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * counter(9) for the shim
+ */
+
+#include <shim_kernel.h>
+#include <sys/counter.h>
+#include <sys/sysctl.h>
+
+MALLOC_DEFINE(M_COUNTER, "counter", "counter(9) stand-in");
+
+counter_u64_t
+counter_u64_alloc(int flags)
+{
+	return (shim_malloc(sizeof(uint64_t), M_COUNTER, flags | M_ZERO));
+}
+
+void
+counter_u64_free(counter_u64_t c)
+{
+	if (NULL != c)
+		shim_free(c, M_COUNTER);
+}
+
+void
+counter_u64_zero(counter_u64_t c)
+{
+	atomic_store_64(c, 0);
+}
+
+uint64_t
+counter_u64_fetch(counter_u64_t c)
+{
+	return (atomic_load_64(c));
+}
+
+/*
+ * Reads return the counter, any write zeroes it
+ */
+int
+sysctl_handle_counter_u64(SYSCTL_HANDLER_ARGS)
+{
+	counter_u64_t c = *(counter_u64_t *)arg1;
+	uint64_t out = counter_u64_fetch(c);
+	int error = SYSCTL_OUT(req, &out, sizeof(out));
+
+	if (error || !req->newptr)
+		return (error);
+
+	error = SYSCTL_IN(req, &out, sizeof(out));
+	if (0 == error)
+		counter_u64_zero(c);
+
+	return (error);
+}
@@ -0,0 +1,613 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Device plumbing: devfs character devices, devclasses, event
+ * handlers and knote lists.
+ */
+
+#include <shim_kernel.h>
+#include <sys/bus.h>
+#include <sys/conf.h>
+#include <sys/event.h>
+#include <sys/eventvar.h>
+#include <sys/eventhandler.h>
+#include <sys/ioccom.h>
+#include <sys/power.h>
+
+#include <fs/devfs/devfs.h>
+#include <fs/devfs/devfs_int.h>
+
+#include "shim_internal.h"
+
+struct cdev_priv_list cdevp_list = TAILQ_HEAD_INITIALIZER(cdevp_list);
+
+/* dev_lock(), also guarding cdevp_list; destroy_dev() waits on drain */
+static pthread_mutex_t shim_dev_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t shim_dev_drain = PTHREAD_COND_INITIALIZER;
+
+/* cdevsw of devices made by drivers with shim_make_dev() */
+static struct cdevsw shim_drv_cdevsw = {
+	.d_version = D_VERSION,
+	.d_name = "shim",
+};
+
+#define SHIM_MAXUNITS 8
+
+struct devclass {
+	char name[32];
+	device_t devices[SHIM_MAXUNITS];
+	TAILQ_ENTRY(devclass) link;
+};
+
+static TAILQ_HEAD(, devclass) shim_devclasses =
+	TAILQ_HEAD_INITIALIZER(shim_devclasses);
+
+/*
+ * Character devices
+ */
+struct cdev *
+shim_make_dev(void *drv1, const char *fmt, ...)
+{
+	struct cdev_priv *cdp = calloc(1, sizeof(*cdp));
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(cdp->cdp_c.si_name, sizeof(cdp->cdp_c.si_name), fmt, ap);
+	va_end(ap);
+	cdp->cdp_c.si_drv1 = drv1;
+	cdp->cdp_c.si_devsw = &shim_drv_cdevsw;
+	cdp->cdp_c.si_refcount = 1;
+	cdp->cdp_flags = CDP_ACTIVE;
+
+	dev_lock();
+	TAILQ_INSERT_TAIL(&cdevp_list, cdp, cdp_list);
+	dev_unlock();
+
+	return (&cdp->cdp_c);
+}
+
+void
+dev_lock(void)
+{
+	pthread_mutex_lock(&shim_dev_mtx);
+}
+
+void
+dev_unlock(void)
+{
+	pthread_mutex_unlock(&shim_dev_mtx);
+}
+
+void
+dev_refl(struct cdev *dev)
+{
+	dev->si_refcount++;
+}
+
+void
+dev_ref(struct cdev *dev)
+{
+	dev_lock();
+	dev_refl(dev);
+	dev_unlock();
+}
+
+void
+dev_rel(struct cdev *dev)
+{
+	bool last;
+
+	dev_lock();
+	last = (0 == --dev->si_refcount);
+	dev_unlock();
+
+	if (last)
+		free((struct cdev_priv *)dev);
+}
+
+/*
+ * Like the kernel, NULL once destroy_dev() started, which then waits
+ * for the threads within the device to leave
+ */
+struct cdevsw *
+dev_refthread(struct cdev *dev, int *ref)
+{
+	struct cdev_priv *cdp = (struct cdev_priv *)dev;
+	struct cdevsw *csw = NULL;
+
+	dev_lock();
+	if (cdp->cdp_flags & CDP_ACTIVE) {
+		dev->si_threadcount++;
+		csw = dev->si_devsw;
+	}
+	dev_unlock();
+	*ref = (NULL != csw);
+
+	return (csw);
+}
+
+void
+dev_relthread(struct cdev *dev, int ref)
+{
+	if (0 == ref)
+		return;
+
+	dev_lock();
+	if (0 == --dev->si_threadcount)
+		pthread_cond_broadcast(&shim_dev_drain);
+	dev_unlock();
+}
+
+/*
+ * Open files, each with the cdevpriv data of devfs(9)
+ */
+struct shim_file {
+	struct cdev *dev;		/* NULL once the device is gone */
+	void *priv;
+	d_priv_dtor_t *dtor;
+	TAILQ_ENTRY(shim_file) link;
+};
+
+static pthread_mutex_t shim_file_lock = PTHREAD_MUTEX_INITIALIZER;
+static TAILQ_HEAD(, shim_file) shim_files =
+	TAILQ_HEAD_INITIALIZER(shim_files);
+
+/* file whose method runs on this thread, for devfs_*_cdevpriv() */
+static __thread struct shim_file *shim_curfile;
+
+/*
+ * Run and forget the cdevpriv destructor of fp
+ */
+static void
+shim_file_clearpriv(struct shim_file *fp)
+{
+	void *priv = fp->priv;
+	d_priv_dtor_t *dtor = fp->dtor;
+
+	fp->priv = NULL;
+	fp->dtor = NULL;
+	if (dtor)
+		dtor(priv);
+}
+
+void
+shim_destroy_dev(struct cdev *dev)
+{
+	struct cdev_priv *cdp = (struct cdev_priv *)dev;
+	struct shim_file *fp;
+
+	/* like destroy_dev(9), files still open lose their data now */
+	pthread_mutex_lock(&shim_file_lock);
+	TAILQ_FOREACH(fp, &shim_files, link) {
+		if (fp->dev != dev)
+			continue;
+		fp->dev = NULL;
+		shim_file_clearpriv(fp);
+	}
+	pthread_mutex_unlock(&shim_file_lock);
+
+	dev_lock();
+	cdp->cdp_flags &= ~CDP_ACTIVE;
+	while (dev->si_threadcount > 0)
+		pthread_cond_wait(&shim_dev_drain, &shim_dev_mtx);
+	TAILQ_REMOVE(&cdevp_list, cdp, cdp_list);
+	dev_unlock();
+
+	/* the list's reference */
+	dev_rel(dev);
+}
+
+struct cdev *
+make_dev(struct cdevsw *devsw, int unit __unused, uid_t uid __unused,
+	 gid_t gid __unused, int perms __unused, const char *fmt, ...)
+{
+	struct cdev *dev;
+	char name[SPECNAMELEN + 1];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(name, sizeof(name), fmt, ap);
+	va_end(ap);
+
+	dev = shim_make_dev(NULL, "%s", name);
+	dev->si_devsw = devsw;
+
+	return (dev);
+}
+
+void
+destroy_dev(struct cdev *dev)
+{
+	shim_destroy_dev(dev);
+}
+
+int
+shim_open(const char *name, struct shim_file **fpp)
+{
+	struct cdev_priv *cdp;
+	struct shim_file *fp;
+	struct cdev *dev = NULL;
+	int error = 0;
+
+	dev_lock();
+	TAILQ_FOREACH(cdp, &cdevp_list, cdp_list) {
+		if (0 == strcmp(cdp->cdp_c.si_name, name) &&
+		    &shim_drv_cdevsw != cdp->cdp_c.si_devsw) {
+			dev = &cdp->cdp_c;
+			break;
+		}
+	}
+	dev_unlock();
+	if (NULL == dev)
+		return (ENOENT);
+
+	fp = calloc(1, sizeof(*fp));
+	fp->dev = dev;
+	if (dev->si_devsw->d_open) {
+		shim_curfile = fp;
+		error = dev->si_devsw->d_open(dev, 0, 0, shim_curthread());
+		shim_curfile = NULL;
+	}
+	if (0 != error) {
+		shim_file_clearpriv(fp);
+		free(fp);
+		return (error);
+	}
+
+	pthread_mutex_lock(&shim_file_lock);
+	TAILQ_INSERT_TAIL(&shim_files, fp, link);
+	pthread_mutex_unlock(&shim_file_lock);
+	*fpp = fp;
+
+	return (0);
+}
+
+int
+shim_ioctl(struct shim_file *fp, unsigned long cmd, void *data)
+{
+	char buf[IOCPARM_MASK + 1];
+	size_t len = IOCPARM_LEN(cmd);
+	int error;
+
+	if (NULL == fp->dev)
+		return (ENXIO);
+	if (NULL == fp->dev->si_devsw->d_ioctl)
+		return (ENODEV);
+
+	/* the kernel works on a copy of the argument */
+	memset(buf, 0, len);
+	if (cmd & IOC_IN)
+		memcpy(buf, data, len);
+
+	shim_curfile = fp;
+	error = fp->dev->si_devsw->d_ioctl(fp->dev, cmd, buf, 0,
+					    shim_curthread());
+	shim_curfile = NULL;
+
+	if (0 == error && (cmd & IOC_OUT))
+		memcpy(data, buf, len);
+
+	return (error);
+}
+
+void
+shim_close(struct shim_file *fp)
+{
+	pthread_mutex_lock(&shim_file_lock);
+	TAILQ_REMOVE(&shim_files, fp, link);
+	pthread_mutex_unlock(&shim_file_lock);
+
+	shim_file_clearpriv(fp);
+	free(fp);
+}
+
+/*
+ * Without an open file there is no descriptor to attach data to,
+ * which is also what the kernel reports to kernel threads.
+ */
+int
+devfs_set_cdevpriv(void *priv, d_priv_dtor_t *dtr)
+{
+	if (NULL == shim_curfile)
+		return (ENOENT);
+	if (NULL != shim_curfile->dtor)
+		return (EBUSY);
+
+	shim_curfile->priv = priv;
+	shim_curfile->dtor = dtr;
+
+	return (0);
+}
+
+int
+devfs_get_cdevpriv(void **datap)
+{
+	if (NULL == shim_curfile || NULL == shim_curfile->dtor)
+		return (ENOENT);
+
+	*datap = shim_curfile->priv;
+
+	return (0);
+}
+
+void
+devfs_clear_cdevpriv(void)
+{
+	if (shim_curfile)
+		shim_file_clearpriv(shim_curfile);
+}
+
+/*
+ * Devclasses and devices
+ */
+devclass_t
+devclass_find(const char *classname)
+{
+	struct devclass *dc;
+
+	TAILQ_FOREACH(dc, &shim_devclasses, link) {
+		if (0 == strcmp(dc->name, classname))
+			return (dc);
+	}
+
+	return (NULL);
+}
+
+device_t
+devclass_get_device(devclass_t dc, int unit)
+{
+	if (NULL == dc || unit < 0 || unit >= SHIM_MAXUNITS)
+		return (NULL);
+
+	return (dc->devices[unit]);
+}
+
+void *
+device_get_softc(device_t dev)
+{
+	return (dev->softc);
+}
+
+device_t
+shim_device_add(const char *classname, int unit,
+		const struct shim_device_methods *methods, void *softc)
+{
+	struct devclass *dc = devclass_find(classname);
+	device_t dev;
+
+	if (unit < 0 || unit >= SHIM_MAXUNITS)
+		return (NULL);
+
+	if (NULL == dc) {
+		dc = calloc(1, sizeof(*dc));
+		snprintf(dc->name, sizeof(dc->name), "%s", classname);
+		TAILQ_INSERT_TAIL(&shim_devclasses, dc, link);
+	}
+	if (dc->devices[unit])
+		return (NULL);
+
+	dev = calloc(1, sizeof(*dev));
+	dev->name = dc->name;
+	dev->unit = unit;
+	dev->softc = softc;
+	dev->methods = methods;
+	dev->devclass = dc;
+	dc->devices[unit] = dev;
+
+	return (dev);
+}
+
+void
+shim_device_delete(device_t dev)
+{
+	struct devclass *dc = dev->devclass;
+
+	dc->devices[dev->unit] = NULL;
+	free(dev);
+
+	for (int i = 0; i < SHIM_MAXUNITS; i++) {
+		if (dc->devices[i])
+			return;
+	}
+	TAILQ_REMOVE(&shim_devclasses, dc, link);
+	free(dc);
+}
+
+/*
+ * Event handlers
+ */
+struct eventhandler_entry {
+	const char *name;
+	void (*func)(void);
+	void *arg;
+	int priority;
+	TAILQ_ENTRY(eventhandler_entry) link;
+};
+
+static pthread_mutex_t shim_eventhandler_lock = PTHREAD_MUTEX_INITIALIZER;
+static TAILQ_HEAD(, eventhandler_entry) shim_eventhandlers =
+	TAILQ_HEAD_INITIALIZER(shim_eventhandlers);
+
+eventhandler_tag
+shim_eventhandler_register(const char *name, void (*func)(void), void *arg,
+			   int priority)
+{
+	struct eventhandler_entry *ee = calloc(1, sizeof(*ee));
+	struct eventhandler_entry *pos;
+
+	ee->name = name;
+	ee->func = func;
+	ee->arg = arg;
+	ee->priority = priority;
+
+	pthread_mutex_lock(&shim_eventhandler_lock);
+	TAILQ_FOREACH(pos, &shim_eventhandlers, link) {
+		if (pos->priority > priority)
+			break;
+	}
+	if (pos)
+		TAILQ_INSERT_BEFORE(pos, ee, link);
+	else
+		TAILQ_INSERT_TAIL(&shim_eventhandlers, ee, link);
+	pthread_mutex_unlock(&shim_eventhandler_lock);
+
+	return (ee);
+}
+
+void
+shim_eventhandler_deregister(const char *name __unused, eventhandler_tag tag)
+{
+	if (NULL == tag)
+		return;
+
+	pthread_mutex_lock(&shim_eventhandler_lock);
+	TAILQ_REMOVE(&shim_eventhandlers, tag, link);
+	pthread_mutex_unlock(&shim_eventhandler_lock);
+	free(tag);
+}
+
+/*
+ * Invoke device_attach handlers; the lock is held across the calls,
+ * which keeps deregistration from returning while a handler runs
+ */
+void
+shim_eventhandler_device_attach(device_t dev)
+{
+	struct eventhandler_entry *ee;
+
+	pthread_mutex_lock(&shim_eventhandler_lock);
+	TAILQ_FOREACH(ee, &shim_eventhandlers, link) {
+		if (0 == strcmp(ee->name, "device_attach"))
+			((device_attach_fn)ee->func)(ee->arg, dev);
+	}
+	pthread_mutex_unlock(&shim_eventhandler_lock);
+}
+
+/*
+ * Invoke power_profile_change handlers, see shim_eventhandler_device_attach
+ */
+void
+shim_eventhandler_power_profile_change(int profile)
+{
+	struct eventhandler_entry *ee;
+
+	pthread_mutex_lock(&shim_eventhandler_lock);
+	TAILQ_FOREACH(ee, &shim_eventhandlers, link) {
+		if (0 == strcmp(ee->name, "power_profile_change"))
+			((power_profile_change_hook)ee->func)(ee->arg,
+							      profile);
+	}
+	pthread_mutex_unlock(&shim_eventhandler_lock);
+}
+
+/*
+ * Knote lists
+ */
+void
+knlist_init_mtx(struct knlist *knl, struct mtx *lock)
+{
+	SLIST_INIT(&knl->kl_list);
+	knl->kl_lockarg = lock;
+}
+
+void
+knlist_add(struct knlist *knl, struct knote *kn, int islocked)
+{
+	if (!islocked)
+		mtx_lock(knl->kl_lockarg);
+	SLIST_INSERT_HEAD(&knl->kl_list, kn, kn_selnext);
+	kn->kn_knlist = knl;
+	kn->kn_status &= ~KN_DETACHED;
+	if (!islocked)
+		mtx_unlock(knl->kl_lockarg);
+}
+
+void
+knlist_remove(struct knlist *knl, struct knote *kn, int islocked)
+{
+	if (!islocked)
+		mtx_lock(knl->kl_lockarg);
+	SLIST_REMOVE(&knl->kl_list, kn, knote, kn_selnext);
+	kn->kn_knlist = NULL;
+	kn->kn_status |= KN_DETACHED;
+	if (!islocked)
+		mtx_unlock(knl->kl_lockarg);
+}
+
+int
+knlist_empty(struct knlist *knl)
+{
+	return (SLIST_EMPTY(&knl->kl_list));
+}
+
+void
+knlist_clear(struct knlist *knl, int islocked)
+{
+	struct knote *kn;
+
+	if (!islocked)
+		mtx_lock(knl->kl_lockarg);
+	while ((kn = SLIST_FIRST(&knl->kl_list))) {
+		SLIST_REMOVE_HEAD(&knl->kl_list, kn_selnext);
+		kn->kn_knlist = NULL;
+		kn->kn_status |= KN_DETACHED;
+	}
+	if (!islocked)
+		mtx_unlock(knl->kl_lockarg);
+}
+
+void
+knlist_destroy(struct knlist *knl)
+{
+	if (!SLIST_EMPTY(&knl->kl_list)) {
+		fprintf(stderr, "shim: destroying non-empty knlist\n");
+		abort();
+	}
+	knl->kl_lockarg = NULL;
+}
+
+void
+knote(struct knlist *list, long hint, int lockflags)
+{
+	struct knote *kn, *tkn;
+
+	if (!(lockflags & KNF_LISTLOCKED))
+		mtx_lock(list->kl_lockarg);
+	SLIST_FOREACH_SAFE(kn, &list->kl_list, kn_selnext, tkn) {
+		if (kn->kn_kq)
+			mtx_lock(&kn->kn_kq->kq_lock);
+		kn->kn_fop->f_event(kn, hint);
+		if (kn->kn_kq)
+			mtx_unlock(&kn->kn_kq->kq_lock);
+	}
+	if (!(lockflags & KNF_LISTLOCKED))
+		mtx_unlock(list->kl_lockarg);
+}
@@ -0,0 +1,239 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * evdev(4) devices and clients
+ *
+ * Event delivery follows evdev_client_push(): events are appended at
+ * the ring tail, a full ring is flushed down to a single SYN_DROPPED
+ * event, and readers are only notified once SYN_REPORT completes the
+ * report.
+ */
+
+#include <shim_kernel.h>
+#include <sys/conf.h>
+#include <sys/event.h>
+
+#include <dev/evdev/evdev_private.h>
+
+#include "shim.h"
+#include "shim_internal.h"
+
+static pthread_mutex_t shim_evdev_lock = PTHREAD_MUTEX_INITIALIZER;
+static int shim_evdev_unit;
+
+struct evdev_dev *
+shim_evdev_create(const char *name, const char *shortname,
+		  uint16_t bustype, uint16_t vendor, uint16_t product,
+		  size_t report_size, uint32_t types)
+{
+	struct evdev_dev *evdev = calloc(1, sizeof(*evdev));
+	int unit;
+
+	snprintf(evdev->ev_name, sizeof(evdev->ev_name), "%s", name);
+	snprintf(evdev->ev_shortname, sizeof(evdev->ev_shortname), "%s",
+		 shortname);
+	evdev->ev_id.bustype = bustype;
+	evdev->ev_id.vendor = vendor;
+	evdev->ev_id.product = product;
+	evdev->ev_report_size = report_size;
+	evdev->ev_type_flags = types | 1u << EV_SYN;
+
+	evdev->ev_lock_type = EV_LOCK_INTERNAL;
+	mtx_init(&evdev->ev_mtx, "evmtx", NULL, MTX_DEF);
+	mtx_init(&evdev->ev_list_lock, "evsx", NULL, MTX_DEF);
+	LIST_INIT(&evdev->ev_clients);
+
+	pthread_mutex_lock(&shim_evdev_lock);
+	unit = shim_evdev_unit++;
+	evdev->ev_cdev = shim_make_dev(evdev, "input/event%d", unit);
+	pthread_mutex_unlock(&shim_evdev_lock);
+
+	/* like the attach of a driver registering the evdev device */
+	shim_eventhandler_device_attach(NULL);
+
+	return (evdev);
+}
+
+/*
+ * Like evdev_unregister(): revoke every client and wake it up
+ */
+void
+shim_evdev_destroy(struct evdev_dev *evdev)
+{
+	struct evdev_client *client, *tmp;
+
+	EVDEV_LIST_LOCK(evdev);
+	evdev->ev_cdev->si_drv1 = NULL;
+	LIST_FOREACH_SAFE(client, &evdev->ev_clients, ec_link, tmp) {
+		evdev_revoke_client(client);
+		evdev_dispose_client(evdev, client);
+		EVDEV_CLIENT_LOCKQ(client);
+		evdev_notify_event(client);
+		EVDEV_CLIENT_UNLOCKQ(client);
+	}
+	EVDEV_LIST_UNLOCK(evdev);
+
+	pthread_mutex_lock(&shim_evdev_lock);
+	shim_destroy_dev(evdev->ev_cdev);
+	pthread_mutex_unlock(&shim_evdev_lock);
+
+	mtx_destroy(&evdev->ev_list_lock);
+	mtx_destroy(&evdev->ev_mtx);
+	free(evdev);
+}
+
+int
+evdev_register_client(struct evdev_dev *evdev, struct evdev_client *client)
+{
+	mtx_lock(&evdev->ev_mtx);
+	LIST_INSERT_HEAD(&evdev->ev_clients, client, ec_link);
+	mtx_unlock(&evdev->ev_mtx);
+
+	return (0);
+}
+
+void
+evdev_dispose_client(struct evdev_dev *evdev, struct evdev_client *client)
+{
+	mtx_lock(&evdev->ev_mtx);
+	if (client->ec_link.le_prev) {
+		LIST_REMOVE(client, ec_link);
+		client->ec_link.le_prev = NULL;
+	}
+	mtx_unlock(&evdev->ev_mtx);
+}
+
+void
+evdev_revoke_client(struct evdev_client *client)
+{
+	client->ec_revoked = true;
+}
+
+void
+evdev_notify_event(struct evdev_client *client)
+{
+	if (client->ec_blocked) {
+		client->ec_blocked = false;
+		wakeup(client);
+	}
+	if (client->ec_selected)
+		client->ec_selected = false;
+	KNOTE_LOCKED(&client->ec_selp.si_note, 0);
+}
+
+static void
+shim_evdev_client_push(struct evdev_client *client, uint16_t type,
+		       uint16_t code, int32_t value, struct timeval *tv)
+{
+	size_t head = client->ec_buffer_head;
+	size_t tail = client->ec_buffer_tail;
+	size_t count = client->ec_buffer_size;
+
+	/* If queue is full drop its content and place SYN_DROPPED event */
+	if ((tail + 1) % count == head) {
+		head = (tail + count - 1) % count;
+		client->ec_buffer[head] = (struct input_event) {
+			.time = *tv,
+			.type = EV_SYN,
+			.code = SYN_DROPPED,
+			.value = 0
+		};
+		client->ec_buffer_head = head;
+		client->ec_buffer_ready = head;
+		__atomic_add_fetch(&client->ec_evdev->ev_dropped, 1,
+				   __ATOMIC_RELAXED);
+	}
+
+	client->ec_buffer[tail].time = *tv;
+	client->ec_buffer[tail].type = type;
+	client->ec_buffer[tail].code = code;
+	client->ec_buffer[tail].value = value;
+	client->ec_buffer_tail = (tail + 1) % count;
+
+	/* Allow users to read events only after report has been completed */
+	if (EV_SYN == type && SYN_REPORT == code) {
+		client->ec_buffer_ready = client->ec_buffer_tail;
+		evdev_notify_event(client);
+	}
+}
+
+void
+shim_evdev_push(struct evdev_dev *evdev, uint16_t type, uint16_t code,
+		int32_t value)
+{
+	struct evdev_client *client;
+	struct epoch_tracker et;
+	struct timeval tv;
+	int64_t ns = shim_uptime_ns();
+
+	tv.tv_sec = ns / 1000000000;
+	tv.tv_usec = (ns % 1000000000) / 1000;
+
+	/* clients may only be freed after an epoch_wait_preempt() */
+	if (EV_LOCK_MTX != evdev->ev_lock_type)
+		epoch_enter_preempt(INPUT_EPOCH, &et);
+	mtx_lock(&evdev->ev_mtx);
+	LIST_FOREACH(client, &evdev->ev_clients, ec_link) {
+		EVDEV_CLIENT_LOCKQ(client);
+		if (!client->ec_revoked)
+			shim_evdev_client_push(client, type, code, value, &tv);
+		EVDEV_CLIENT_UNLOCKQ(client);
+	}
+	mtx_unlock(&evdev->ev_mtx);
+	if (EV_LOCK_MTX != evdev->ev_lock_type)
+		epoch_exit_preempt(INPUT_EPOCH, &et);
+}
+
+void
+shim_evdev_sync(struct evdev_dev *evdev)
+{
+	shim_evdev_push(evdev, EV_SYN, SYN_REPORT, 1);
+}
+
+int
+shim_evdev_nclients(struct evdev_dev *evdev)
+{
+	struct evdev_client *client;
+	int count = 0;
+
+	mtx_lock(&evdev->ev_mtx);
+	LIST_FOREACH(client, &evdev->ev_clients, ec_link)
+		count++;
+	mtx_unlock(&evdev->ev_mtx);
+
+	return (count);
+}
+
+uint64_t
+shim_evdev_dropped(struct evdev_dev *evdev)
+{
+	return (__atomic_load_n(&evdev->ev_dropped, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,63 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef __SHIM_INTERNAL_H__
+#define __SHIM_INTERNAL_H__
+
+/*
+ * Interfaces shared between the shim implementation files
+ */
+
+#include <shim_kernel.h>
+#include <sys/bus.h>
+
+/* Convert an uptime deadline to a CLOCK_MONOTONIC timespec */
+void shim_clock_abstime(sbintime_t deadline, struct timespec *ts);
+
+/* Virtual clock state, see shim_vclock_enable() */
+bool shim_vclock_enabled(void);
+void shim_vclock_set(sbintime_t now);
+
+/* True when called from a thread started by kthread_add() */
+bool shim_kthread_self(void);
+
+/* Account a kernel thread starting (1) or exiting (-1) for settling */
+void shim_sched_kthreads(int delta);
+
+/* Run the device_attach event handlers */
+void shim_eventhandler_device_attach(device_t dev);
+
+/* Run the power_profile_change event handlers */
+void shim_eventhandler_power_profile_change(int profile);
+
+/* Spend ns nanoseconds inside a stand-in driver */
+void shim_delay(int64_t ns);
+
+#endif /* __SHIM_INTERNAL_H__ */
@@ -0,0 +1,637 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Core kernel services: clock, console, malloc(9), kernel threads,
+ * module registration and libkern odds and ends.
+ */
+
+#include <shim_kernel.h>
+#include <sys/sdt.h>
+
+#include "shim.h"
+#include "shim_internal.h"
+
+int hz = 1000;
+int tick = 1000;		/* microseconds per tick */
+
+char cpu_model[128] = "shim";
+
+shim_sdt_probe_func_t *shim_sdt_probe_func;
+
+/* uptime at program start; modules load well after boot */
+#define SHIM_BOOT_SBT		(60 * SBT_1S)
+
+static struct timespec shim_clock_base;
+static bool shim_vclock_on;
+static sbintime_t shim_vclock_now;
+
+static pthread_mutex_t shim_console_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *shim_console;
+static bool shim_console_isset;
+
+static pthread_mutex_t shim_malloc_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct malloc_type *shim_malloc_types;
+
+/*
+ * Allocation header, keeps the size for malloc(9) accounting
+ */
+struct shim_malloc_hdr {
+	size_t size;
+	struct malloc_type *type;
+} __aligned(16);
+
+/*
+ * A running kernel thread
+ */
+struct shim_kthread {
+	void (*func)(void *);
+	void *arg;
+	char name[MAXCOMLEN + 1];
+	clockid_t cpuclock;
+	bool started;
+	TAILQ_ENTRY(shim_kthread) link;
+};
+
+static pthread_mutex_t shim_kthread_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t shim_kthread_cv = PTHREAD_COND_INITIALIZER;
+static int shim_kthread_running;
+static TAILQ_HEAD(, shim_kthread) shim_kthreads =
+	TAILQ_HEAD_INITIALIZER(shim_kthreads);
+static int64_t shim_kthread_exited_ns;	/* CPU time of exited threads */
+static __thread struct shim_kthread *shim_curkthread;
+
+#define SHIM_MAXMODULES 8
+
+struct module {
+	moduledata_t *data;
+	bool loaded;
+};
+
+static struct module shim_modules[SHIM_MAXMODULES];
+
+static void __attribute__((__constructor__))
+shim_kern_init(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &shim_clock_base);
+}
+
+/*
+ * Clock
+ */
+sbintime_t
+shim_sbinuptime(void)
+{
+	struct timespec ts;
+	int64_t ns;
+
+	if (__atomic_load_n(&shim_vclock_on, __ATOMIC_ACQUIRE))
+		return (__atomic_load_n(&shim_vclock_now, __ATOMIC_ACQUIRE));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ns = (ts.tv_sec - shim_clock_base.tv_sec) * 1000000000 +
+		(ts.tv_nsec - shim_clock_base.tv_nsec);
+
+	return (SHIM_BOOT_SBT + nstosbt(ns));
+}
+
+time_t
+shim_time_uptime(void)
+{
+	return (shim_sbinuptime() >> 32);
+}
+
+int
+shim_ticks(void)
+{
+	return ((int)(sbttons(shim_sbinuptime()) / (1000000000 / hz)));
+}
+
+int64_t
+shim_uptime_ns(void)
+{
+	return (sbttons(shim_sbinuptime()));
+}
+
+void
+shim_vclock_enable(void)
+{
+	if (shim_vclock_on)
+		return;
+
+	/* start from a fixed point so runs are reproducible */
+	shim_vclock_now = SHIM_BOOT_SBT;
+	__atomic_store_n(&shim_vclock_on, true, __ATOMIC_RELEASE);
+}
+
+bool
+shim_vclock_enabled(void)
+{
+	return (__atomic_load_n(&shim_vclock_on, __ATOMIC_ACQUIRE));
+}
+
+void
+shim_vclock_set(sbintime_t now)
+{
+	__atomic_store_n(&shim_vclock_now, now, __ATOMIC_RELEASE);
+}
+
+void
+shim_clock_abstime(sbintime_t deadline, struct timespec *ts)
+{
+	int64_t ns = sbttons(deadline - SHIM_BOOT_SBT);
+
+	if (ns < 0)
+		ns = 0;
+	ts->tv_sec = shim_clock_base.tv_sec + ns / 1000000000;
+	ts->tv_nsec = shim_clock_base.tv_nsec + ns % 1000000000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+/*
+ * Short delays spin like DELAY(9), the sleep timer slack on Linux
+ * would otherwise add tens of microseconds
+ */
+#define SHIM_DELAY_SPIN_NS	200000
+
+void
+shim_delay(int64_t ns)
+{
+	struct timespec ts, now;
+	int64_t end;
+
+	if (ns <= 0)
+		return;
+
+	if (ns < SHIM_DELAY_SPIN_NS) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		end = now.tv_sec * 1000000000LL + now.tv_nsec + ns;
+		do {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+		} while (now.tv_sec * 1000000000LL + now.tv_nsec < end);
+		return;
+	}
+
+	ts.tv_sec = ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR)
+		;
+}
+
+/*
+ * Convert a timeval to ticks, rounding up and adding one tick like
+ * the kernel does so the full interval is guaranteed to pass.
+ */
+int
+tvtohz(struct timeval *tv)
+{
+	int64_t usec = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+
+	if (usec <= 0)
+		return (1);
+
+	return ((int)((usec + tick - 1) / tick) + 1);
+}
+
+/*
+ * Console
+ */
+void
+shim_console_set(FILE *fp)
+{
+	pthread_mutex_lock(&shim_console_lock);
+	shim_console = fp;
+	shim_console_isset = true;
+	pthread_mutex_unlock(&shim_console_lock);
+}
+
+int
+shim_printf(const char *fmt, ...)
+{
+	va_list ap;
+	int result = 0;
+	FILE *fp;
+
+	pthread_mutex_lock(&shim_console_lock);
+	fp = shim_console_isset ? shim_console : stderr;
+	if (fp) {
+		va_start(ap, fmt);
+		result = vfprintf(fp, fmt, ap);
+		va_end(ap);
+	}
+	pthread_mutex_unlock(&shim_console_lock);
+
+	return (result);
+}
+
+/*
+ * malloc(9)
+ */
+void
+shim_malloc_register(struct malloc_type *type)
+{
+	pthread_mutex_lock(&shim_malloc_lock);
+	type->ks_next = shim_malloc_types;
+	shim_malloc_types = type;
+	pthread_mutex_unlock(&shim_malloc_lock);
+}
+
+void *
+shim_malloc(size_t size, struct malloc_type *type, int flags)
+{
+	struct shim_malloc_hdr *hdr;
+
+	hdr = (flags & M_ZERO) ? calloc(1, sizeof(*hdr) + size) :
+		malloc(sizeof(*hdr) + size);
+	if (NULL == hdr) {
+		if (flags & M_NOWAIT)
+			return (NULL);
+		abort();
+	}
+
+	hdr->size = size;
+	hdr->type = type;
+	__atomic_add_fetch(&type->ks_calls, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&type->ks_inuse, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&type->ks_memuse, size, __ATOMIC_RELAXED);
+
+	return (hdr + 1);
+}
+
+void
+shim_free(void *addr, struct malloc_type *type)
+{
+	struct shim_malloc_hdr *hdr;
+
+	if (NULL == addr)
+		return;
+
+	hdr = (struct shim_malloc_hdr *)addr - 1;
+	if (hdr->type != type) {
+		fprintf(stderr, "shim: free(%p) with type %s, allocated as %s\n",
+			addr, type->ks_shortdesc, hdr->type->ks_shortdesc);
+		abort();
+	}
+
+	__atomic_sub_fetch(&type->ks_inuse, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&type->ks_memuse, hdr->size, __ATOMIC_RELAXED);
+	free(hdr);
+}
+
+int64_t
+shim_malloc_inuse(const char *shortdesc)
+{
+	struct malloc_type *type;
+	int64_t result = 0;
+
+	pthread_mutex_lock(&shim_malloc_lock);
+	for (type = shim_malloc_types; type; type = type->ks_next) {
+		if (0 == strcmp(type->ks_shortdesc, shortdesc))
+			result += __atomic_load_n(&type->ks_memuse, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&shim_malloc_lock);
+
+	return (result);
+}
+
+/*
+ * Kernel threads
+ */
+static void *
+shim_kthread_start(void *ptr)
+{
+	struct shim_kthread *kt = ptr;
+
+	shim_curkthread = kt;
+	pthread_mutex_lock(&shim_kthread_lock);
+	pthread_getcpuclockid(pthread_self(), &kt->cpuclock);
+	kt->started = true;
+	pthread_mutex_unlock(&shim_kthread_lock);
+
+	kt->func(kt->arg);
+	shim_kthread_exit();
+}
+
+int
+shim_kthread_add(void (*func)(void *), void *arg, struct proc *p __unused,
+		 struct thread **newtdp __unused, int flags __unused,
+		 int pages __unused, const char *fmt, ...)
+{
+	struct shim_kthread *kt;
+	pthread_attr_t attr;
+	pthread_t td;
+	va_list ap;
+	int error;
+
+	kt = calloc(1, sizeof(*kt));
+	if (NULL == kt)
+		return (ENOMEM);
+	kt->func = func;
+	kt->arg = arg;
+	va_start(ap, fmt);
+	vsnprintf(kt->name, sizeof(kt->name), fmt, ap);
+	va_end(ap);
+
+	pthread_mutex_lock(&shim_kthread_lock);
+	shim_kthread_running++;
+	TAILQ_INSERT_TAIL(&shim_kthreads, kt, link);
+	pthread_mutex_unlock(&shim_kthread_lock);
+	shim_sched_kthreads(1);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	error = pthread_create(&td, &attr, shim_kthread_start, kt);
+	pthread_attr_destroy(&attr);
+
+	if (0 != error) {
+		shim_sched_kthreads(-1);
+		pthread_mutex_lock(&shim_kthread_lock);
+		shim_kthread_running--;
+		TAILQ_REMOVE(&shim_kthreads, kt, link);
+		pthread_mutex_unlock(&shim_kthread_lock);
+		free(kt);
+		return (error);
+	}
+
+	/* thread names are limited to 15 characters on Linux */
+	char tdname[16];
+	strncpy(tdname, kt->name, sizeof(tdname) - 1);
+	tdname[sizeof(tdname) - 1] = '\0';
+	pthread_setname_np(td, tdname);
+
+	return (0);
+}
+
+void
+shim_kthread_exit(void)
+{
+	struct shim_kthread *kt = shim_curkthread;
+	struct timespec ts;
+
+	shim_curkthread = NULL;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	shim_sched_kthreads(-1);
+	pthread_mutex_lock(&shim_kthread_lock);
+	TAILQ_REMOVE(&shim_kthreads, kt, link);
+	shim_kthread_exited_ns += ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	free(kt);
+	shim_kthread_running--;
+	pthread_cond_broadcast(&shim_kthread_cv);
+	pthread_mutex_unlock(&shim_kthread_lock);
+
+	pthread_exit(NULL);
+}
+
+int64_t
+shim_kthread_cputime_ns(void)
+{
+	struct shim_kthread *kt;
+	struct timespec ts;
+	int64_t result;
+
+	pthread_mutex_lock(&shim_kthread_lock);
+	result = shim_kthread_exited_ns;
+	TAILQ_FOREACH(kt, &shim_kthreads, link) {
+		if (kt->started && 0 == clock_gettime(kt->cpuclock, &ts))
+			result += ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	}
+	pthread_mutex_unlock(&shim_kthread_lock);
+
+	return (result);
+}
+
+static struct proc shim_proc;
+static pthread_once_t shim_proc_once = PTHREAD_ONCE_INIT;
+
+static void
+shim_proc_init(void)
+{
+	shim_proc.p_pid = getpid();
+	strlcpy(shim_proc.p_comm, program_invocation_short_name,
+		sizeof(shim_proc.p_comm));
+}
+
+struct thread *
+shim_curthread(void)
+{
+	static __thread struct thread td;
+
+	if (0 == td.td_tid) {
+		pthread_once(&shim_proc_once, shim_proc_init);
+		td.td_tid = gettid();
+		td.td_proc = &shim_proc;
+	}
+
+	return (&td);
+}
+
+bool
+shim_kthread_self(void)
+{
+	return (NULL != shim_curkthread);
+}
+
+int
+shim_kthread_count(void)
+{
+	int result;
+
+	pthread_mutex_lock(&shim_kthread_lock);
+	result = shim_kthread_running;
+	pthread_mutex_unlock(&shim_kthread_lock);
+
+	return (result);
+}
+
+void
+shim_kthread_drain(void)
+{
+	pthread_mutex_lock(&shim_kthread_lock);
+	while (shim_kthread_running > 0)
+		pthread_cond_wait(&shim_kthread_cv, &shim_kthread_lock);
+	pthread_mutex_unlock(&shim_kthread_lock);
+}
+
+/*
+ * Statically defined tracing
+ */
+void
+shim_sdt_sethook(shim_sdt_hook_t *hook)
+{
+	__atomic_store_n(&shim_sdt_probe_func, hook, __ATOMIC_RELEASE);
+}
+
+/*
+ * Modules
+ */
+void
+shim_module_register(moduledata_t *data)
+{
+	for (int i = 0; i < SHIM_MAXMODULES; i++) {
+		if (NULL == shim_modules[i].data) {
+			shim_modules[i].data = data;
+			return;
+		}
+	}
+	fprintf(stderr, "shim: too many modules, dropping %s\n", data->name);
+}
+
+static struct module *
+shim_module_find(const char *name)
+{
+	for (int i = 0; i < SHIM_MAXMODULES; i++) {
+		if (shim_modules[i].data &&
+		    0 == strcmp(shim_modules[i].data->name, name))
+			return (&shim_modules[i]);
+	}
+	return (NULL);
+}
+
+int
+shim_kldload(const char *name)
+{
+	struct module *mod = shim_module_find(name);
+	int error;
+
+	if (NULL == mod)
+		return (ENOENT);
+	if (mod->loaded)
+		return (EEXIST);
+
+	error = mod->data->evhand(mod, MOD_LOAD, mod->data->priv);
+	if (0 == error)
+		mod->loaded = true;
+
+	return (error);
+}
+
+/*
+ * Report hw.<module>.stats before unloading when SHIM_STATS is set,
+ * "-" writes to stderr, anything else names a file to append to
+ */
+static void
+shim_kldstats(const char *name)
+{
+	const char *target = getenv("SHIM_STATS");
+	char prefix[128];
+	FILE *fp = stderr;
+
+	if (NULL == target || '\0' == target[0])
+		return;
+	if (strcmp(target, "-")) {
+		fp = fopen(target, "a");
+		if (NULL == fp) {
+			fprintf(stderr, "shim: cannot open %s: %s\n", target,
+				strerror(errno));
+			return;
+		}
+	}
+
+	snprintf(prefix, sizeof(prefix), "hw.%s.stats", name);
+	shim_sysctl_dump(fp, prefix);
+
+	if (stderr != fp)
+		fclose(fp);
+}
+
+int
+shim_kldunload(const char *name)
+{
+	struct module *mod = shim_module_find(name);
+	int error;
+
+	if (NULL == mod)
+		return (ENOENT);
+	if (!mod->loaded)
+		return (ENOENT);
+
+	shim_kldstats(mod->data->name);
+
+	error = mod->data->evhand(mod, MOD_UNLOAD, mod->data->priv);
+	if (0 == error)
+		mod->loaded = false;
+
+	return (error);
+}
+
+/*
+ * Copy src into dst of dsize bytes, always NUL terminated
+ */
+size_t
+strlcpy(char *dst, const char *src, size_t dsize)
+{
+	size_t len = strlen(src);
+
+	if (dsize > 0) {
+		size_t n = len < dsize - 1 ? len : dsize - 1;
+
+		memcpy(dst, src, n);
+		dst[n] = '\0';
+	}
+
+	return (len);
+}
+
+/*
+ * Append src to the string in dst of dsize bytes, always NUL terminated
+ */
+size_t
+strlcat(char *dst, const char *src, size_t dsize)
+{
+	size_t dlen = strnlen(dst, dsize);
+
+	if (dlen == dsize)
+		return (dsize + strlen(src));
+
+	return (dlen + strlcpy(dst + dlen, src, dsize - dlen));
+}
+
+/*
+ * Find the first occurrence of find in the first slen characters of s
+ */
+char *
+strnstr(const char *s, const char *find, size_t slen)
+{
+	size_t len = strlen(find);
+
+	if (0 == len)
+		return ((char *)s);
+
+	for (; slen >= len && *s; s++, slen--) {
+		if (*s == *find && 0 == strncmp(s, find, len))
+			return ((char *)s);
+	}
+
+	return (NULL);
+}
@@ -0,0 +1,179 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * sbuf(9) for the shim
+ */
+
+#include <shim_kernel.h>
+#include <sys/sbuf.h>
+#include <sys/sysctl.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+sbuf_grow(struct sbuf *s, size_t needed)
+{
+	size_t size = s->s_size ? s->s_size : 64;
+	char *buf;
+
+	while (size < s->s_len + needed + 1)
+		size *= 2;
+	if (size == s->s_size)
+		return (0);
+
+	buf = realloc(s->s_buf, size);
+	if (NULL == buf) {
+		s->s_error = ENOMEM;
+		return (ENOMEM);
+	}
+	s->s_buf = buf;
+	s->s_size = size;
+
+	return (0);
+}
+
+struct sbuf *
+sbuf_new_auto(void)
+{
+	struct sbuf *s = calloc(1, sizeof(*s));
+
+	if (NULL == s)
+		return (NULL);
+	if (0 != sbuf_grow(s, 0)) {
+		free(s);
+		return (NULL);
+	}
+	s->s_buf[0] = '\0';
+
+	return (s);
+}
+
+struct sbuf *
+sbuf_new_for_sysctl(struct sbuf *s, char *buf, int length,
+		    struct sysctl_req *req)
+{
+	/* caller supplied storage is not supported, always allocate */
+	if (NULL != s || NULL != buf)
+		return (NULL);
+
+	s = sbuf_new_auto();
+	if (NULL == s)
+		return (NULL);
+	if (length > 0)
+		sbuf_grow(s, length);
+	s->s_req = req;
+
+	return (s);
+}
+
+int
+sbuf_printf(struct sbuf *s, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	if (s->s_error)
+		return (-1);
+
+	va_start(ap, fmt);
+	len = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	if (len < 0 || 0 != sbuf_grow(s, len))
+		return (-1);
+
+	va_start(ap, fmt);
+	vsnprintf(s->s_buf + s->s_len, s->s_size - s->s_len, fmt, ap);
+	va_end(ap);
+	s->s_len += len;
+
+	return (0);
+}
+
+int
+sbuf_cat(struct sbuf *s, const char *str)
+{
+	return (sbuf_printf(s, "%s", str));
+}
+
+int
+sbuf_putc(struct sbuf *s, int c)
+{
+	return (sbuf_printf(s, "%c", c));
+}
+
+int
+sbuf_finish(struct sbuf *s)
+{
+	if (s->s_error)
+		return (s->s_error);
+
+	/* sysctl strings are copied out including the NUL, like sbuf(9) */
+	if (s->s_req)
+		return (SYSCTL_OUT(s->s_req, s->s_buf, s->s_len + 1));
+
+	return (0);
+}
+
+char *
+sbuf_data(struct sbuf *s)
+{
+	return (s->s_buf);
+}
+
+ssize_t
+sbuf_len(struct sbuf *s)
+{
+	if (s->s_error)
+		return (-1);
+
+	return (s->s_len);
+}
+
+void
+sbuf_clear(struct sbuf *s)
+{
+	s->s_len = 0;
+	s->s_error = 0;
+	s->s_buf[0] = '\0';
+}
+
+void
+sbuf_delete(struct sbuf *s)
+{
+	if (NULL == s)
+		return;
+
+	free(s->s_buf);
+	free(s);
+}
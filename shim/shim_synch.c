@@ -0,0 +1,671 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Locks, sleep and wakeup
+ *
+ * Sleepers queue on a single sleep queue keyed by wait channel.  A
+ * sleeper is enqueued before its interlock is dropped, so a wakeup
+ * issued by anyone holding the interlock can never be missed.
+ */
+
+#include <shim_kernel.h>
+#include <sys/epoch.h>
+
+#include <sched.h>
+
+#include "shim.h"
+#include "shim_internal.h"
+
+/*
+ * A thread blocked in msleep()
+ */
+struct shim_sleeper {
+	const void *chan;
+	const char *wmesg;
+	pthread_cond_t cv;
+	sbintime_t deadline;	/* virtual clock timeout, 0 if none */
+	bool woken;
+	bool timedout;
+	bool kthread;
+	TAILQ_ENTRY(shim_sleeper) link;
+};
+
+static pthread_mutex_t shim_sleepq_lock = PTHREAD_MUTEX_INITIALIZER;
+static TAILQ_HEAD(, shim_sleeper) shim_sleepq =
+	TAILQ_HEAD_INITIALIZER(shim_sleepq);
+
+/*
+ * Settling state, protected by shim_sleepq_lock
+ *
+ * The system is settled once every kernel thread sleeps in msleep();
+ * only then may the virtual clock move forward.
+ */
+static pthread_cond_t shim_settle_cv = PTHREAD_COND_INITIALIZER;
+static int shim_sched_nkthreads;
+static int shim_sched_nasleep;
+static uint64_t shim_sched_nwakeups;
+
+/* a settle taking longer than this is a hang in the module */
+#define SHIM_SETTLE_TIMEOUT	30
+
+/*
+ * Lock contention accounting, one slot per lock name
+ */
+struct shim_lockstat {
+	char name[32];
+	uint64_t acquires;
+	uint64_t contended;
+	uint64_t wait_ns;
+};
+
+#define SHIM_MAXLOCKSTATS	64
+
+static pthread_mutex_t shim_lockstat_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct shim_lockstat shim_lockstats[SHIM_MAXLOCKSTATS];
+static int shim_nlockstats;
+
+static struct shim_lockstat *
+shim_lockstat_lookup(const char *name)
+{
+	struct shim_lockstat *ls = NULL;
+
+	pthread_mutex_lock(&shim_lockstat_lock);
+	for (int i = 0; i < shim_nlockstats; i++) {
+		if (0 == strcmp(shim_lockstats[i].name, name)) {
+			ls = &shim_lockstats[i];
+			break;
+		}
+	}
+	if (NULL == ls && shim_nlockstats < SHIM_MAXLOCKSTATS) {
+		ls = &shim_lockstats[shim_nlockstats++];
+		snprintf(ls->name, sizeof(ls->name), "%s", name);
+	}
+	pthread_mutex_unlock(&shim_lockstat_lock);
+
+	return (ls);
+}
+
+static int64_t
+shim_lockstat_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+static void
+shim_lockstat_account(struct lock_object *lo, int64_t since)
+{
+	struct shim_lockstat *ls = lo->lo_stat;
+
+	if (NULL == ls)
+		return;
+
+	__atomic_add_fetch(&ls->acquires, 1, __ATOMIC_RELAXED);
+	if (since) {
+		__atomic_add_fetch(&ls->contended, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&ls->wait_ns, shim_lockstat_now() - since,
+				   __ATOMIC_RELAXED);
+	}
+}
+
+int
+shim_lockstat_get(struct shim_lockstat_info *info, int max)
+{
+	int count;
+
+	pthread_mutex_lock(&shim_lockstat_lock);
+	count = MIN(max, shim_nlockstats);
+	for (int i = 0; i < count; i++) {
+		info[i].name = shim_lockstats[i].name;
+		info[i].acquires = __atomic_load_n(&shim_lockstats[i].acquires,
+						   __ATOMIC_RELAXED);
+		info[i].contended = __atomic_load_n(&shim_lockstats[i].contended,
+						    __ATOMIC_RELAXED);
+		info[i].wait_ns = __atomic_load_n(&shim_lockstats[i].wait_ns,
+						  __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&shim_lockstat_lock);
+
+	return (count);
+}
+
+void
+shim_lockstat_reset(void)
+{
+	pthread_mutex_lock(&shim_lockstat_lock);
+	for (int i = 0; i < shim_nlockstats; i++) {
+		__atomic_store_n(&shim_lockstats[i].acquires, 0,
+				 __ATOMIC_RELAXED);
+		__atomic_store_n(&shim_lockstats[i].contended, 0,
+				 __ATOMIC_RELAXED);
+		__atomic_store_n(&shim_lockstats[i].wait_ns, 0,
+				 __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&shim_lockstat_lock);
+}
+
+/*
+ * Mutexes
+ */
+void
+shim_mtx_init(struct mtx *m, const char *name, const char *type __unused,
+	      int opts)
+{
+	pthread_mutexattr_t attr;
+
+	memset(m, 0, sizeof(*m));
+	m->lock_object.lo_name = name;
+	m->lock_object.lo_stat = shim_lockstat_lookup(name);
+	m->mtx_recurse = -1;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, (opts & MTX_RECURSE) ?
+				  PTHREAD_MUTEX_RECURSIVE :
+				  PTHREAD_MUTEX_ERRORCHECK);
+	pthread_mutex_init(&m->mtx_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+void
+shim_mtx_destroy(struct mtx *m)
+{
+	if (m->mtx_recurse >= 0) {
+		fprintf(stderr, "shim: destroying owned mutex %s\n",
+			m->lock_object.lo_name);
+		abort();
+	}
+	pthread_mutex_destroy(&m->mtx_lock);
+}
+
+void
+shim_mtx_lock(struct mtx *m)
+{
+	int64_t since = 0;
+	int error;
+
+	error = pthread_mutex_trylock(&m->mtx_lock);
+	if (EBUSY == error) {
+		since = shim_lockstat_now();
+		error = pthread_mutex_lock(&m->mtx_lock);
+	}
+	if (0 != error) {
+		fprintf(stderr, "shim: mtx_lock(%s) failed with %d\n",
+			m->lock_object.lo_name, error);
+		abort();
+	}
+	m->mtx_owner = pthread_self();
+	m->mtx_recurse++;
+	shim_lockstat_account(&m->lock_object, since);
+}
+
+int
+shim_mtx_trylock(struct mtx *m)
+{
+	if (0 != pthread_mutex_trylock(&m->mtx_lock))
+		return (0);
+
+	m->mtx_owner = pthread_self();
+	m->mtx_recurse++;
+	shim_lockstat_account(&m->lock_object, 0);
+
+	return (1);
+}
+
+void
+shim_mtx_unlock(struct mtx *m)
+{
+	int error;
+
+	m->mtx_recurse--;
+	error = pthread_mutex_unlock(&m->mtx_lock);
+	if (0 != error) {
+		fprintf(stderr, "shim: mtx_unlock(%s) failed with %d\n",
+			m->lock_object.lo_name, error);
+		abort();
+	}
+}
+
+int
+shim_mtx_owned(struct mtx *m)
+{
+	return (m->mtx_recurse >= 0 &&
+		pthread_equal(m->mtx_owner, pthread_self()));
+}
+
+void
+shim_mtx_assert(struct mtx *m, int what, const char *file, int line)
+{
+	bool owned = shim_mtx_owned(m);
+
+	if ((what & MA_OWNED) ? owned : !owned)
+		return;
+
+	fprintf(stderr, "shim: mutex %s %sowned at %s:%d\n",
+		m->lock_object.lo_name, owned ? "" : "not ", file, line);
+	abort();
+}
+
+/*
+ * Reader/writer locks
+ */
+void
+shim_rw_init(struct rwlock *rw, const char *name)
+{
+	memset(rw, 0, sizeof(*rw));
+	rw->lock_object.lo_name = name;
+	rw->lock_object.lo_stat = shim_lockstat_lookup(name);
+	pthread_rwlock_init(&rw->rw_lock, NULL);
+}
+
+void
+shim_rw_destroy(struct rwlock *rw)
+{
+	pthread_rwlock_destroy(&rw->rw_lock);
+}
+
+void
+shim_rw_rlock(struct rwlock *rw)
+{
+	int64_t since = 0;
+
+	if (0 != pthread_rwlock_tryrdlock(&rw->rw_lock)) {
+		since = shim_lockstat_now();
+		pthread_rwlock_rdlock(&rw->rw_lock);
+	}
+	shim_lockstat_account(&rw->lock_object, since);
+}
+
+int
+shim_rw_try_rlock(struct rwlock *rw)
+{
+	if (0 != pthread_rwlock_tryrdlock(&rw->rw_lock))
+		return (0);
+
+	shim_lockstat_account(&rw->lock_object, 0);
+
+	return (1);
+}
+
+void
+shim_rw_runlock(struct rwlock *rw)
+{
+	pthread_rwlock_unlock(&rw->rw_lock);
+}
+
+void
+shim_rw_wlock(struct rwlock *rw)
+{
+	int64_t since = 0;
+
+	if (0 != pthread_rwlock_trywrlock(&rw->rw_lock)) {
+		since = shim_lockstat_now();
+		pthread_rwlock_wrlock(&rw->rw_lock);
+	}
+	shim_lockstat_account(&rw->lock_object, since);
+}
+
+int
+shim_rw_try_wlock(struct rwlock *rw)
+{
+	if (0 != pthread_rwlock_trywrlock(&rw->rw_lock))
+		return (0);
+
+	shim_lockstat_account(&rw->lock_object, 0);
+
+	return (1);
+}
+
+void
+shim_rw_wunlock(struct rwlock *rw)
+{
+	pthread_rwlock_unlock(&rw->rw_lock);
+}
+
+/*
+ * Epochs
+ */
+struct epoch {
+	const char *name;
+	unsigned int gen;		/* slot of new readers is gen & 1 */
+	unsigned int readers[2];
+	pthread_mutex_t wait_lock;	/* serializes epoch_wait_preempt */
+};
+
+epoch_t
+epoch_alloc(const char *name, int flags __unused)
+{
+	epoch_t epoch = calloc(1, sizeof(*epoch));
+
+	epoch->name = name;
+	pthread_mutex_init(&epoch->wait_lock, NULL);
+
+	return (epoch);
+}
+
+void
+epoch_free(epoch_t epoch)
+{
+	if (epoch->readers[0] || epoch->readers[1]) {
+		fprintf(stderr, "shim: freeing epoch %s with readers\n",
+			epoch->name);
+		abort();
+	}
+	pthread_mutex_destroy(&epoch->wait_lock);
+	free(epoch);
+}
+
+void
+epoch_enter_preempt(epoch_t epoch, struct epoch_tracker *et)
+{
+	unsigned int gen;
+
+	/* retry if the generation flipped before we were counted */
+	for (;;) {
+		gen = __atomic_load_n(&epoch->gen, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&epoch->readers[gen & 1], 1,
+				   __ATOMIC_SEQ_CST);
+		if (gen == __atomic_load_n(&epoch->gen, __ATOMIC_SEQ_CST))
+			break;
+		__atomic_sub_fetch(&epoch->readers[gen & 1], 1,
+				   __ATOMIC_SEQ_CST);
+	}
+	et->et_slot = gen & 1;
+}
+
+void
+epoch_exit_preempt(epoch_t epoch, struct epoch_tracker *et)
+{
+	__atomic_sub_fetch(&epoch->readers[et->et_slot], 1, __ATOMIC_SEQ_CST);
+}
+
+static struct epoch shim_global_epoch = {
+	.name = "global_preempt",
+	.wait_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+epoch_t global_epoch_preempt = &shim_global_epoch;
+
+void
+epoch_wait_preempt(epoch_t epoch)
+{
+	unsigned int gen;
+
+	pthread_mutex_lock(&epoch->wait_lock);
+	gen = __atomic_fetch_add(&epoch->gen, 1, __ATOMIC_SEQ_CST);
+	while (0 != __atomic_load_n(&epoch->readers[gen & 1],
+				    __ATOMIC_SEQ_CST))
+		sched_yield();
+	pthread_mutex_unlock(&epoch->wait_lock);
+}
+
+/*
+ * Mark sleeper runnable, called with shim_sleepq_lock held
+ */
+static void
+shim_sleeper_wake(struct shim_sleeper *sleeper, bool timedout)
+{
+	if (sleeper->woken)
+		return;
+
+	sleeper->woken = true;
+	sleeper->timedout = timedout;
+	if (sleeper->kthread) {
+		shim_sched_nasleep--;
+		shim_sched_nwakeups++;
+	}
+	pthread_cond_signal(&sleeper->cv);
+}
+
+/*
+ * Sleep on chan until deadline, dropping mtx while asleep
+ *
+ * Returns 0 when woken up and EWOULDBLOCK once the deadline passed,
+ * a deadline of 0 sleeps until woken.  With the virtual clock,
+ * timeouts fire from shim_vclock_advance().
+ */
+static int
+shim_sleep_deadline(const void *chan, struct mtx *mtx, int priority,
+		    const char *wmesg, sbintime_t deadline)
+{
+	struct shim_sleeper sleeper = {
+		.chan = chan,
+		.wmesg = wmesg,
+		.kthread = shim_kthread_self()
+	};
+	bool vclock = shim_vclock_enabled();
+	pthread_condattr_t attr;
+	struct timespec ts;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&sleeper.cv, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if (deadline > 0) {
+		if (vclock)
+			sleeper.deadline = deadline;
+		else
+			shim_clock_abstime(deadline, &ts);
+	}
+
+	pthread_mutex_lock(&shim_sleepq_lock);
+	TAILQ_INSERT_TAIL(&shim_sleepq, &sleeper, link);
+	if (sleeper.kthread &&
+	    ++shim_sched_nasleep == shim_sched_nkthreads)
+		pthread_cond_broadcast(&shim_settle_cv);
+	if (mtx)
+		shim_mtx_unlock(mtx);
+
+	while (!sleeper.woken) {
+		if (deadline > 0 && !vclock) {
+			if (ETIMEDOUT == pthread_cond_timedwait(&sleeper.cv,
+								&shim_sleepq_lock,
+								&ts))
+				shim_sleeper_wake(&sleeper, true);
+		} else {
+			pthread_cond_wait(&sleeper.cv, &shim_sleepq_lock);
+		}
+	}
+
+	TAILQ_REMOVE(&shim_sleepq, &sleeper, link);
+	pthread_mutex_unlock(&shim_sleepq_lock);
+	pthread_cond_destroy(&sleeper.cv);
+
+	if (mtx && !(priority & PDROP))
+		shim_mtx_lock(mtx);
+
+	return (sleeper.timedout ? EWOULDBLOCK : 0);
+}
+
+/*
+ * Sleep on chan for at most timo ticks, 0 sleeps until woken
+ */
+int
+shim_msleep(const void *chan, struct mtx *mtx, int priority,
+	    const char *wmesg, int timo)
+{
+	sbintime_t deadline = 0;
+
+	if (timo > 0)
+		deadline = shim_sbinuptime() + (sbintime_t)timo * (SBT_1S / hz);
+
+	return (shim_sleep_deadline(chan, mtx, priority, wmesg, deadline));
+}
+
+/*
+ * Sleep on chan for sbt, or until sbt with C_ABSOLUTE
+ *
+ * Like msleep_sbt(9), a zero sbt sleeps until woken up.
+ */
+int
+shim_msleep_sbt(const void *chan, struct mtx *mtx, int priority,
+		const char *wmesg, sbintime_t sbt, int flags)
+{
+	sbintime_t deadline = 0;
+
+	if (sbt > 0)
+		deadline = (flags & C_ABSOLUTE) ? sbt : shim_sbinuptime() + sbt;
+
+	return (shim_sleep_deadline(chan, mtx, priority, wmesg, deadline));
+}
+
+static void
+shim_wakeup_chan(const void *chan, bool one)
+{
+	struct shim_sleeper *sleeper;
+
+	pthread_mutex_lock(&shim_sleepq_lock);
+	TAILQ_FOREACH(sleeper, &shim_sleepq, link) {
+		if (sleeper->chan != chan || sleeper->woken)
+			continue;
+
+		shim_sleeper_wake(sleeper, false);
+		if (one)
+			break;
+	}
+	pthread_mutex_unlock(&shim_sleepq_lock);
+}
+
+void
+shim_wakeup(const void *chan)
+{
+	shim_wakeup_chan(chan, false);
+}
+
+void
+shim_wakeup_one(const void *chan)
+{
+	shim_wakeup_chan(chan, true);
+}
+
+/*
+ * Virtual clock scheduling
+ */
+void
+shim_sched_kthreads(int delta)
+{
+	pthread_mutex_lock(&shim_sleepq_lock);
+	shim_sched_nkthreads += delta;
+	if (shim_sched_nasleep == shim_sched_nkthreads)
+		pthread_cond_broadcast(&shim_settle_cv);
+	pthread_mutex_unlock(&shim_sleepq_lock);
+}
+
+/*
+ * Wait until all kernel threads sleep, called with shim_sleepq_lock held
+ */
+static void
+shim_settle_locked(void)
+{
+	struct shim_sleeper *sleeper;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += SHIM_SETTLE_TIMEOUT;
+
+	while (shim_sched_nasleep != shim_sched_nkthreads) {
+		if (ETIMEDOUT != pthread_cond_timedwait(&shim_settle_cv,
+							&shim_sleepq_lock,
+							&ts))
+			continue;
+
+		fprintf(stderr, "shim: settle timed out, %d of %d kernel "
+			"threads asleep\n", shim_sched_nasleep,
+			shim_sched_nkthreads);
+		TAILQ_FOREACH(sleeper, &shim_sleepq, link)
+			fprintf(stderr, "shim:   %p \"%s\"%s\n", sleeper->chan,
+				sleeper->wmesg, sleeper->woken ? " woken" : "");
+		abort();
+	}
+}
+
+void
+shim_vclock_settle(void)
+{
+	pthread_mutex_lock(&shim_sleepq_lock);
+	shim_settle_locked();
+	pthread_mutex_unlock(&shim_sleepq_lock);
+}
+
+void
+shim_vclock_advance(int64_t ns)
+{
+	struct shim_sleeper *sleeper;
+	sbintime_t target, next;
+	bool fired;
+
+	pthread_mutex_lock(&shim_sleepq_lock);
+	target = shim_sbinuptime() + nstosbt(ns);
+
+	for (;;) {
+		shim_settle_locked();
+
+		/* earliest pending timeout up to target */
+		next = target;
+		TAILQ_FOREACH(sleeper, &shim_sleepq, link) {
+			if (!sleeper->woken && sleeper->deadline > 0 &&
+			    sleeper->deadline < next)
+				next = sleeper->deadline;
+		}
+
+		if (next > shim_sbinuptime())
+			shim_vclock_set(next);
+
+		fired = false;
+		TAILQ_FOREACH(sleeper, &shim_sleepq, link) {
+			if (!sleeper->woken && sleeper->deadline > 0 &&
+			    sleeper->deadline <= next) {
+				shim_sleeper_wake(sleeper, true);
+				fired = true;
+			}
+		}
+
+		if (!fired && next == target)
+			break;
+	}
+
+	pthread_mutex_unlock(&shim_sleepq_lock);
+}
+
+uint64_t
+shim_kthread_wakeups(void)
+{
+	uint64_t result;
+
+	pthread_mutex_lock(&shim_sleepq_lock);
+	result = shim_sched_nwakeups;
+	pthread_mutex_unlock(&shim_sleepq_lock);
+
+	return (result);
+}
@@ -0,0 +1,426 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * sysctl(9) tree
+ *
+ * Only the "hw" root exists statically; everything below it is added
+ * at runtime through the SYSCTL_ADD_* macros.
+ */
+
+#include <shim_kernel.h>
+#include <sys/sysctl.h>
+
+#include "shim.h"
+
+struct sysctl_oid sysctl___hw = {
+	.oid_children = SLIST_HEAD_INITIALIZER(sysctl___hw.oid_children),
+	.oid_kind = CTLTYPE_NODE | CTLFLAG_RW,
+	.oid_name = "hw",
+	.oid_fmt = "N",
+	.oid_descr = "hardware"
+};
+
+static pthread_rwlock_t shim_sysctl_lock = PTHREAD_RWLOCK_INITIALIZER;
+static int shim_sysctl_nextnumber = 0x100;
+
+int
+shim_sysctl_out(struct sysctl_req *req, const void *p, size_t l)
+{
+	size_t i = 0;
+
+	if (req->oldptr) {
+		i = l;
+		if (req->oldlen <= req->oldidx)
+			i = 0;
+		else if (i > req->oldlen - req->oldidx)
+			i = req->oldlen - req->oldidx;
+		if (i > 0)
+			memcpy((char *)req->oldptr + req->oldidx, p, i);
+	}
+	req->oldidx += l;
+
+	if (req->oldptr && i != l)
+		return (ENOMEM);
+
+	return (0);
+}
+
+int
+shim_sysctl_in(struct sysctl_req *req, void *p, size_t l)
+{
+	if (NULL == req->newptr)
+		return (0);
+	if (req->newlen - req->newidx < l)
+		return (EINVAL);
+
+	memcpy(p, (const char *)req->newptr + req->newidx, l);
+	req->newidx += l;
+
+	return (0);
+}
+
+int
+sysctl_handle_int(SYSCTL_HANDLER_ARGS)
+{
+	int tmpout = arg1 ? *(int *)arg1 : (int)arg2;
+	int error = SYSCTL_OUT(req, &tmpout, sizeof(tmpout));
+
+	if (error || !req->newptr)
+		return (error);
+	if (!arg1)
+		return (EPERM);
+
+	return (SYSCTL_IN(req, arg1, sizeof(int)));
+}
+
+int
+sysctl_handle_32(SYSCTL_HANDLER_ARGS)
+{
+	int32_t tmpout = arg1 ? *(int32_t *)arg1 : (int32_t)arg2;
+	int error = SYSCTL_OUT(req, &tmpout, sizeof(tmpout));
+
+	if (error || !req->newptr)
+		return (error);
+	if (!arg1)
+		return (EPERM);
+
+	return (SYSCTL_IN(req, arg1, sizeof(int32_t)));
+}
+
+int
+sysctl_handle_64(SYSCTL_HANDLER_ARGS)
+{
+	int64_t tmpout = arg1 ? *(int64_t *)arg1 : (int64_t)arg2;
+	int error = SYSCTL_OUT(req, &tmpout, sizeof(tmpout));
+
+	if (error || !req->newptr)
+		return (error);
+	if (!arg1)
+		return (EPERM);
+
+	return (SYSCTL_IN(req, arg1, sizeof(int64_t)));
+}
+
+int
+sysctl_handle_string(SYSCTL_HANDLER_ARGS)
+{
+	char *str = arg1;
+	size_t outlen = strlen(str) + 1;
+	int error = SYSCTL_OUT(req, str, outlen);
+
+	if (error || !req->newptr)
+		return (error);
+	if (arg2 <= 0)
+		return (EPERM);
+	if (req->newlen - req->newidx >= (size_t)arg2)
+		return (EINVAL);
+
+	size_t inlen = req->newlen - req->newidx;
+	error = SYSCTL_IN(req, str, inlen);
+	str[inlen] = '\0';
+
+	return (error);
+}
+
+int
+sysctl_handle_opaque(SYSCTL_HANDLER_ARGS)
+{
+	int error = SYSCTL_OUT(req, arg1, arg2);
+
+	if (error || !req->newptr)
+		return (error);
+
+	return (SYSCTL_IN(req, arg1, arg2));
+}
+
+int
+sysctl_ctx_init(struct sysctl_ctx_list *clist)
+{
+	TAILQ_INIT(clist);
+	return (0);
+}
+
+/*
+ * Remove all OIDs registered with clist, newest first
+ */
+int
+sysctl_ctx_free(struct sysctl_ctx_list *clist)
+{
+	struct sysctl_ctx_entry *e, *tmp;
+
+	pthread_rwlock_wrlock(&shim_sysctl_lock);
+	TAILQ_FOREACH_REVERSE_SAFE(e, clist, sysctl_ctx_list, link, tmp) {
+		struct sysctl_oid *oidp = e->entry;
+
+		if (!SLIST_EMPTY(&oidp->oid_children)) {
+			pthread_rwlock_unlock(&shim_sysctl_lock);
+			return (ENOTEMPTY);
+		}
+		SLIST_REMOVE(oidp->oid_parent, oidp, sysctl_oid, oid_link);
+		TAILQ_REMOVE(clist, e, link);
+		free((char *)oidp->oid_name);
+		free(oidp);
+		free(e);
+	}
+	pthread_rwlock_unlock(&shim_sysctl_lock);
+
+	return (0);
+}
+
+struct sysctl_oid *
+shim_sysctl_add_oid(struct sysctl_ctx_list *clist,
+		    struct sysctl_oid_list *parent, int nbr,
+		    const char *name, int kind, void *arg1, intmax_t arg2,
+		    sysctl_handler_t handler, const char *fmt,
+		    const char *descr)
+{
+	struct sysctl_oid *oidp;
+	struct sysctl_ctx_entry *e;
+
+	pthread_rwlock_wrlock(&shim_sysctl_lock);
+	SLIST_FOREACH(oidp, parent, oid_link) {
+		if (0 == strcmp(oidp->oid_name, name)) {
+			fprintf(stderr, "shim: sysctl %s already exists\n", name);
+			pthread_rwlock_unlock(&shim_sysctl_lock);
+			return (NULL);
+		}
+	}
+
+	oidp = calloc(1, sizeof(*oidp));
+	SLIST_INIT(&oidp->oid_children);
+	oidp->oid_parent = parent;
+	oidp->oid_number = (OID_AUTO == nbr) ? shim_sysctl_nextnumber++ : nbr;
+	oidp->oid_kind = kind;
+	oidp->oid_arg1 = arg1;
+	oidp->oid_arg2 = arg2;
+	oidp->oid_name = strdup(name);
+	oidp->oid_handler = handler;
+	oidp->oid_fmt = fmt;
+	oidp->oid_descr = descr;
+
+	/* keep children in creation order */
+	if (SLIST_EMPTY(parent)) {
+		SLIST_INSERT_HEAD(parent, oidp, oid_link);
+	} else {
+		struct sysctl_oid *last = SLIST_FIRST(parent);
+
+		while (SLIST_NEXT(last, oid_link))
+			last = SLIST_NEXT(last, oid_link);
+		SLIST_INSERT_AFTER(last, oidp, oid_link);
+	}
+
+	if (clist) {
+		e = calloc(1, sizeof(*e));
+		e->entry = oidp;
+		TAILQ_INSERT_TAIL(clist, e, link);
+	}
+	pthread_rwlock_unlock(&shim_sysctl_lock);
+
+	return (oidp);
+}
+
+/*
+ * Look up an OID by its dotted name
+ */
+static struct sysctl_oid *
+shim_sysctl_find(const char *name)
+{
+	struct sysctl_oid_list *list = NULL;
+	struct sysctl_oid *oidp = NULL;
+	const char *part = name;
+
+	if (0 == strncmp(name, "hw", 2) && ('\0' == name[2] || '.' == name[2])) {
+		oidp = &sysctl___hw;
+		part = name[2] ? name + 3 : name + 2;
+	} else {
+		return (NULL);
+	}
+
+	while (*part) {
+		size_t len = strcspn(part, ".");
+
+		list = SYSCTL_CHILDREN(oidp);
+		SLIST_FOREACH(oidp, list, oid_link) {
+			if (strlen(oidp->oid_name) == len &&
+			    0 == strncmp(oidp->oid_name, part, len))
+				break;
+		}
+		if (NULL == oidp)
+			return (NULL);
+
+		part += len;
+		if ('.' == *part)
+			part++;
+	}
+
+	return (oidp);
+}
+
+/*
+ * Run the handler of oidp, called with the tree read locked
+ */
+static int
+shim_sysctl_handle(struct sysctl_oid *oidp, void *oldp, size_t *oldlenp,
+		   const void *newp, size_t newlen)
+{
+	struct sysctl_req req = {
+		.oldptr = oldp,
+		.oldlen = oldlenp ? *oldlenp : 0,
+		.newptr = newp,
+		.newlen = newlen
+	};
+	int error;
+
+	if (CTLTYPE_NODE == (oidp->oid_kind & CTLTYPE) && !oidp->oid_handler)
+		return (EISDIR);
+	if (newp && !(oidp->oid_kind & CTLFLAG_WR))
+		return (EPERM);
+
+	error = oidp->oid_handler(oidp, oidp->oid_arg1, oidp->oid_arg2, &req);
+	if (oldlenp)
+		*oldlenp = req.oldidx;
+
+	return (error);
+}
+
+int
+shim_sysctlbyname(const char *name, void *oldp, size_t *oldlenp,
+		  const void *newp, size_t newlen)
+{
+	struct sysctl_oid *oidp;
+	int error = ENOENT;
+
+	pthread_rwlock_rdlock(&shim_sysctl_lock);
+	oidp = shim_sysctl_find(name);
+	if (oidp)
+		error = shim_sysctl_handle(oidp, oldp, oldlenp, newp, newlen);
+	pthread_rwlock_unlock(&shim_sysctl_lock);
+
+	return (error);
+}
+
+int
+shim_sysctl_getu32(const char *name, uint32_t *value)
+{
+	size_t len = sizeof(*value);
+
+	return (shim_sysctlbyname(name, value, &len, NULL, 0));
+}
+
+int
+shim_sysctl_setu32(const char *name, uint32_t value)
+{
+	return (shim_sysctlbyname(name, NULL, NULL, &value, sizeof(value)));
+}
+
+static void
+shim_sysctl_dumpoid(FILE *fp, struct sysctl_oid *oidp, char *path,
+		    size_t pathlen)
+{
+	size_t len = strlen(path);
+	char buffer[4096];
+	size_t buflen = sizeof(buffer) - 1;
+	int error;
+
+	if (len)
+		snprintf(path + len, pathlen - len, ".%s", oidp->oid_name);
+	else
+		snprintf(path, pathlen, "%s", oidp->oid_name);
+
+	if (CTLTYPE_NODE == (oidp->oid_kind & CTLTYPE) && !oidp->oid_handler) {
+		struct sysctl_oid *child;
+
+		SLIST_FOREACH(child, SYSCTL_CHILDREN(oidp), oid_link)
+			shim_sysctl_dumpoid(fp, child, path, pathlen);
+		path[len] = '\0';
+		return;
+	}
+
+	error = shim_sysctl_handle(oidp, buffer, &buflen, NULL, 0);
+	if (0 != error && ENOMEM != error) {
+		fprintf(fp, "%s: <error %d>\n", path, error);
+		path[len] = '\0';
+		return;
+	}
+	if (buflen > sizeof(buffer) - 1)
+		buflen = sizeof(buffer) - 1;
+
+	switch (oidp->oid_kind & CTLTYPE) {
+	case CTLTYPE_INT:
+	case CTLTYPE_S32:
+		fprintf(fp, "%s: %d\n", path, *(int32_t *)buffer);
+		break;
+	case CTLTYPE_UINT:
+	case CTLTYPE_U32:
+		fprintf(fp, "%s: %u\n", path, *(uint32_t *)buffer);
+		break;
+	case CTLTYPE_S64:
+		fprintf(fp, "%s: %jd\n", path, (intmax_t)*(int64_t *)buffer);
+		break;
+	case CTLTYPE_U64:
+		fprintf(fp, "%s: %ju\n", path, (uintmax_t)*(uint64_t *)buffer);
+		break;
+	case CTLTYPE_STRING:
+		buffer[buflen] = '\0';
+		fprintf(fp, "%s: %s\n", path, buffer);
+		break;
+	default:
+		fprintf(fp, "%s: <%zu bytes>\n", path, buflen);
+		break;
+	}
+	path[len] = '\0';
+}
+
+void
+shim_sysctl_dump(FILE *fp, const char *prefix)
+{
+	char path[1024] = "";
+	struct sysctl_oid *oidp;
+	char *dot;
+
+	pthread_rwlock_rdlock(&shim_sysctl_lock);
+	oidp = shim_sysctl_find(prefix);
+	if (NULL == oidp) {
+		pthread_rwlock_unlock(&shim_sysctl_lock);
+		return;
+	}
+
+	/* children are printed with their full path */
+	snprintf(path, sizeof(path), "%s", prefix);
+	dot = strrchr(path, '.');
+	if (dot)
+		*dot = '\0';
+	else
+		path[0] = '\0';
+
+	shim_sysctl_dumpoid(fp, oidp, path, sizeof(path));
+	pthread_rwlock_unlock(&shim_sysctl_lock);
+}
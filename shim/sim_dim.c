@@ -0,0 +1,801 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Dimming policy simulation on a virtual clock
+ *
+ * Replays an input trace against the module with the shim clock in
+ * virtual mode, so a day of activity runs in well under a second of
+ * wall time.  Every probe that fires is printed with its virtual
+ * timestamp; a summary with wakeup counts and dim latency follows.
+ *
+ * Trace files hold one event per line, times in milliseconds since
+ * the module was loaded:
+ *
+ *	<ms> key <code>			press and release on the keyboard
+ *	<ms> motion			one touchpad report
+ *	<ms> battery <charging|discharging>
+ *	<ms> sysctl <name> <value>	set an integer sysctl
+ *	<ms> inhibit <timeout_ms>	open /dev/framework and inhibit,
+ *					0 holds until released
+ *	<ms> release			close the last inhibiting file
+ *	<ms> end			stop the simulation
+ *
+ * Without a trace file, a synthetic day is generated from a seed.
+ *
+ * With -n, the backlight reports that many discrete levels, so fade
+ * steps that stay between two of them are not written.
+ *
+ * With -o, the module's trace recorder is enabled and drained into
+ * the given file, for conversion with framework-trace(1).
+ */
+
+#include <err.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/sdt.h>
+
+#include "framework_inhibit.h"
+#include "framework_trace.h"
+#include "shim.h"
+
+#define NS_PER_MS	1000000LL
+#define NS_PER_S	1000000000LL
+
+enum sim_kind {
+	SIM_KEY,
+	SIM_MOTION,
+	SIM_BATTERY,
+	SIM_SYSCTL,
+	SIM_INHIBIT,
+	SIM_RELEASE,
+	SIM_END
+};
+
+struct sim_event {
+	int64_t ms;
+	enum sim_kind kind;
+	uint32_t value;
+	char name[64];
+};
+
+static struct sim_trace {
+	struct sim_event *events;
+	size_t count;
+	size_t size;
+} sim_trace;
+
+/* idle stages per power mode, FRAMEWORK_SCREEN_MAXSTAGES */
+#define SIM_MAXSTAGES	4
+
+/*
+ * Screen config for one power mode, mirrored from the sysctls
+ */
+struct sim_mode {
+	uint32_t low;
+	uint32_t high;
+	uint32_t timeout;	/* ms */
+	u_int stages;		/* enabled idle stages */
+	uint32_t stage[SIM_MAXSTAGES];	/* brightness per idle stage */
+};
+
+/*
+ * Simulation state; kernel threads only run while the main thread
+ * settles, so the probe hook never races the main thread.
+ */
+static struct sim_state {
+	int64_t start_ns;
+	bool quiet;
+	bool charging;
+	struct sim_mode power;
+	struct sim_mode battery;
+
+	int64_t last_input_ns;
+	bool dim_pending;
+	bool dimmed;
+	int64_t brightness;	/* last backlight write, -1 before */
+	bool fading;
+	u_int inhibited;	/* inhibitors held */
+	int32_t abs_x;		/* touchpad position */
+
+	uint64_t inputs;
+	uint64_t decisions;
+	uint64_t wakeups;
+	uint64_t sleeps;
+	uint64_t writes;
+	uint64_t fades;
+	uint64_t fade_writes;
+	uint64_t dims;
+	uint64_t inhibits;
+	uint64_t inhibit_expiries;
+	uint64_t inhibited_dims;
+	uint64_t undims;
+	uint64_t latency_count;
+	int64_t latency_sum_ns;
+	int64_t latency_min_ns;
+	int64_t latency_max_ns;
+} sim;
+
+/* files of /dev/framework holding an inhibitor, last opened on top */
+#define SIM_MAXFILES	16
+static struct shim_file *sim_files[SIM_MAXFILES];
+static size_t sim_nfiles;
+
+static struct evdev_dev *sim_kbd;
+static struct evdev_dev *sim_touchpad;
+static FILE *sim_dump;
+
+static struct sim_mode *
+sim_curmode(void)
+{
+	return (sim.charging ? &sim.power : &sim.battery);
+}
+
+static double
+sim_now(void)
+{
+	return ((double)(shim_uptime_ns() - sim.start_ns) / NS_PER_S);
+}
+
+/*
+ * Tell whether brightness is the one of an idle stage
+ */
+static bool
+sim_isstage(struct sim_mode *mode, uint32_t brightness)
+{
+	for (u_int i = 0; i < mode->stages; i++) {
+		if (brightness == mode->stage[i])
+			return (true);
+	}
+
+	return (false);
+}
+
+/*
+ * Account a new backlight level: dims, undims and dim latency
+ *
+ * Latency is measured for the first idle stage only.  A fade counts
+ * once, at its start, with the level it heads for.
+ */
+static void
+sim_level(uint32_t brightness)
+{
+	struct sim_mode *mode = sim_curmode();
+	int64_t latency;
+
+	if (!sim_isstage(mode, brightness)) {
+		if (sim.dimmed)
+			sim.undims++;
+		sim.dimmed = false;
+		return;
+	}
+
+	sim.dims++;
+	sim.dimmed = true;
+	if (sim.inhibited)
+		sim.inhibited_dims++;
+	if (!sim.dim_pending)
+		return;
+
+	/* time past the moment the timeout expired */
+	latency = shim_uptime_ns() -
+		(sim.last_input_ns + mode->timeout * NS_PER_MS);
+	sim.dim_pending = false;
+	sim.latency_count++;
+	sim.latency_sum_ns += latency;
+	if (1 == sim.latency_count || latency < sim.latency_min_ns)
+		sim.latency_min_ns = latency;
+	if (1 == sim.latency_count || latency > sim.latency_max_ns)
+		sim.latency_max_ns = latency;
+}
+
+/*
+ * Account a backlight write, the steps of a fade only as writes
+ */
+static void
+sim_backlight(uint32_t brightness)
+{
+	sim.writes++;
+	sim.brightness = brightness;
+	if (!sim.fading)
+		sim_level(brightness);
+}
+
+/*
+ * Account the start, end or cancellation of a fade
+ */
+static const char *
+sim_fade(const char *name, uintptr_t arg0 __unused, uintptr_t arg1)
+{
+	if (0 == strcmp(name, "start")) {
+		sim.fades++;
+		sim.fading = true;
+		sim_level((uint32_t)arg1);
+		return ("fade");
+	}
+
+	sim.fading = false;
+	if (0 == strcmp(name, "done")) {
+		sim.fade_writes += arg1;
+		return ("faded");
+	}
+
+	return ("fadestop");
+}
+
+/*
+ * Account an inhibitor change; the last release restarts idle time
+ */
+static const char *
+sim_inhibit(const char *name, uintptr_t arg1)
+{
+	sim.inhibited = (u_int)arg1;
+	if (0 == strcmp(name, "acquire")) {
+		sim.inhibits++;
+		return ("inhibit");
+	}
+
+	if (0 == strcmp(name, "expire"))
+		sim.inhibit_expiries++;
+	if (0 == sim.inhibited) {
+		sim.last_input_ns = shim_uptime_ns();
+		sim.dim_pending = true;
+	}
+
+	return (name);
+}
+
+static void
+sim_probe(struct sdt_probe *probe, uintptr_t arg0, uintptr_t arg1,
+	  uintptr_t arg2 __unused, uintptr_t arg3 __unused,
+	  uintptr_t arg4 __unused)
+{
+	const char *what = NULL;
+
+	if (0 == strcmp(probe->mod, "inhibit")) {
+		what = sim_inhibit(probe->name, arg1);
+	} else if (0 == strcmp(probe->mod, "evdev")) {
+		sim.inputs++;
+		sim.last_input_ns = shim_uptime_ns();
+		sim.dim_pending = true;
+		what = "input";
+	} else if (0 == strcmp(probe->name, "decision")) {
+		sim.decisions++;
+		what = "decision";
+	} else if (0 == strcmp(probe->name, "wakeup")) {
+		sim.wakeups++;
+		what = "wakeup";
+	} else if (0 == strcmp(probe->name, "sleep")) {
+		sim.sleeps++;
+		what = "sleep";
+	} else if (0 == strcmp(probe->mod, "backlight") &&
+		   0 == strcmp(probe->func, "fade")) {
+		what = sim_fade(probe->name, arg0, arg1);
+	} else if (0 == strcmp(probe->mod, "backlight")) {
+		sim_backlight((uint32_t)arg0);
+		what = "backlight";
+	}
+
+	if (sim.quiet || NULL == what)
+		return;
+
+	printf("%12.3f %-9s %ld %ld\n", sim_now(), what,
+	       (long)arg0, (long)arg1);
+}
+
+static void
+sim_loadmode(const char *which, struct sim_mode *mode)
+{
+	uint32_t previous = 0;
+	char name[128];
+
+	snprintf(name, sizeof(name), "hw.framework.screen.%s.brightness_low",
+		 which);
+	shim_sysctl_getu32(name, &mode->low);
+	snprintf(name, sizeof(name), "hw.framework.screen.%s.brightness_high",
+		 which);
+	shim_sysctl_getu32(name, &mode->high);
+	snprintf(name, sizeof(name), "hw.framework.screen.%s.timeout_ms",
+		 which);
+	shim_sysctl_getu32(name, &mode->timeout);
+
+	/* enabled while the timeouts increase, as the module counts */
+	for (mode->stages = 0; mode->stages < SIM_MAXSTAGES; mode->stages++) {
+		uint32_t timeout = 0;
+
+		snprintf(name, sizeof(name),
+			 "hw.framework.screen.%s.stages.%u.timeout_ms", which,
+			 mode->stages + 1);
+		shim_sysctl_getu32(name, &timeout);
+		if (timeout <= previous)
+			break;
+		previous = timeout;
+
+		snprintf(name, sizeof(name),
+			 "hw.framework.screen.%s.stages.%u.brightness", which,
+			 mode->stages + 1);
+		shim_sysctl_getu32(name, &mode->stage[mode->stages]);
+	}
+}
+
+static struct sim_event *
+sim_addevent(int64_t ms, enum sim_kind kind)
+{
+	struct sim_event *ev;
+
+	if (sim_trace.count == sim_trace.size) {
+		sim_trace.size = sim_trace.size ? sim_trace.size * 2 : 1024;
+		sim_trace.events = realloc(sim_trace.events,
+					   sim_trace.size * sizeof(*ev));
+		if (NULL == sim_trace.events)
+			err(1, "realloc");
+	}
+
+	ev = &sim_trace.events[sim_trace.count++];
+	memset(ev, 0, sizeof(*ev));
+	ev->ms = ms;
+	ev->kind = kind;
+
+	return (ev);
+}
+
+static void
+sim_readtrace(const char *path)
+{
+	struct sim_event *ev;
+	char line[256], verb[32], arg[64];
+	long long ms;
+	unsigned value;
+	int lineno = 0, n;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (NULL == fp)
+		err(1, "%s", path);
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if ('#' == line[0] || '\n' == line[0])
+			continue;
+
+		n = sscanf(line, "%lld %31s %63s %u", &ms, verb, arg, &value);
+		if (n < 2)
+			errx(1, "%s:%d: malformed line", path, lineno);
+		if (sim_trace.count && ms < sim_trace.events[sim_trace.count - 1].ms)
+			errx(1, "%s:%d: time goes backwards", path, lineno);
+
+		if (0 == strcmp(verb, "key") && n >= 3) {
+			ev = sim_addevent(ms, SIM_KEY);
+			ev->value = strtoul(arg, NULL, 0);
+		} else if (0 == strcmp(verb, "motion")) {
+			sim_addevent(ms, SIM_MOTION);
+		} else if (0 == strcmp(verb, "battery") && n >= 3) {
+			ev = sim_addevent(ms, SIM_BATTERY);
+			ev->value = (0 == strcmp(arg, "charging"));
+		} else if (0 == strcmp(verb, "sysctl") && 4 == n) {
+			ev = sim_addevent(ms, SIM_SYSCTL);
+			snprintf(ev->name, sizeof(ev->name), "%s", arg);
+			ev->value = value;
+		} else if (0 == strcmp(verb, "inhibit") && n >= 3) {
+			ev = sim_addevent(ms, SIM_INHIBIT);
+			ev->value = strtoul(arg, NULL, 0);
+		} else if (0 == strcmp(verb, "release")) {
+			sim_addevent(ms, SIM_RELEASE);
+		} else if (0 == strcmp(verb, "end")) {
+			sim_addevent(ms, SIM_END);
+		} else {
+			errx(1, "%s:%d: unknown event \"%s\"", path, lineno,
+			     verb);
+		}
+	}
+
+	fclose(fp);
+}
+
+/*
+ * xorshift64*, so traces do not depend on the libc generator
+ */
+static uint64_t sim_seed;
+
+static uint64_t
+sim_random(void)
+{
+	sim_seed ^= sim_seed >> 12;
+	sim_seed ^= sim_seed << 25;
+	sim_seed ^= sim_seed >> 27;
+
+	return (sim_seed * 0x2545F4914F6CDD1DULL);
+}
+
+/* uniform in [lo, hi) */
+static int64_t
+sim_uniform(int64_t lo, int64_t hi)
+{
+	return (lo + (int64_t)(sim_random() % (uint64_t)(hi - lo)));
+}
+
+/* exponential with the given mean, capped at 20 means */
+static int64_t
+sim_exponential(int64_t mean)
+{
+	double u = (double)(sim_random() >> 11) / (double)(1ULL << 53);
+	double x = -log1p(-u) * mean;
+
+	return (x > 20.0 * mean ? 20 * mean : (int64_t)x + 1);
+}
+
+/*
+ * Generate duration seconds of alternating work sessions and breaks
+ */
+static void
+sim_gentrace(int64_t duration)
+{
+	struct sim_event *ev;
+	int64_t end = duration * 1000;
+	int64_t ms = sim_uniform(0, 60 * 1000);
+	int64_t session_end;
+	bool charging = true;
+
+	while (ms < end) {
+		/* plug or unplug at the start of some sessions */
+		if (sim_uniform(0, 10) < 3) {
+			charging = !charging;
+			ev = sim_addevent(ms, SIM_BATTERY);
+			ev->value = charging;
+		}
+
+		session_end = ms + sim_uniform(5, 90) * 60 * 1000;
+		while (ms < session_end && ms < end) {
+			if (sim_uniform(0, 10) < 7) {
+				ev = sim_addevent(ms, SIM_KEY);
+				ev->value = KEY_A + sim_uniform(0, 26);
+			} else {
+				sim_addevent(ms, SIM_MOTION);
+			}
+
+			/* mostly typing, now and then reading */
+			if (sim_uniform(0, 100) < 5)
+				ms += sim_uniform(5, 120) * 1000;
+			else
+				ms += sim_exponential(1500);
+		}
+
+		ms += sim_exponential(20 * 60 * 1000);
+	}
+
+	sim_addevent(end, SIM_END);
+}
+
+static void
+sim_push(struct evdev_dev *evdev, uint16_t type, uint16_t code,
+	 int32_t value)
+{
+	shim_evdev_push(evdev, type, code, value);
+	shim_evdev_sync(evdev);
+	shim_vclock_settle();
+}
+
+static void
+sim_apply(struct sim_event *ev)
+{
+	struct framework_inhibit_req req;
+	struct shim_file *fp;
+	int error;
+
+	switch (ev->kind) {
+	case SIM_KEY:
+		sim_push(sim_kbd, EV_KEY, ev->value, 1);
+		sim_push(sim_kbd, EV_KEY, ev->value, 0);
+		break;
+	case SIM_MOTION:
+		/* far enough from the last position to count */
+		sim.abs_x = (sim.abs_x + 64) % 1024;
+		sim_push(sim_touchpad, EV_ABS, ABS_X, sim.abs_x);
+		break;
+	case SIM_BATTERY:
+		sim.charging = ev->value;
+		shim_acpi_setstate(sim.charging ? ACPI_BATT_STAT_CHARGING :
+				   ACPI_BATT_STAT_DISCHARG);
+		if (!sim.quiet)
+			printf("%12.3f %-9s %s\n", sim_now(), "battery",
+			       sim.charging ? "charging" : "discharging");
+		break;
+	case SIM_SYSCTL:
+		error = shim_sysctl_setu32(ev->name, ev->value);
+		if (0 != error)
+			errx(1, "sysctl %s=%u failed with error %d",
+			     ev->name, ev->value, error);
+		sim_loadmode("power", &sim.power);
+		sim_loadmode("battery", &sim.battery);
+		/* let the dim check a write kicks run before the next event */
+		shim_vclock_settle();
+		break;
+	case SIM_INHIBIT:
+		if (SIM_MAXFILES == sim_nfiles)
+			errx(1, "more than %d inhibitors", SIM_MAXFILES);
+		error = shim_open(FRAMEWORK_INHIBIT_DEVNAME, &fp);
+		if (0 != error)
+			errx(1, "opening /dev/%s failed with error %d",
+			     FRAMEWORK_INHIBIT_DEVNAME, error);
+		memset(&req, 0, sizeof(req));
+		req.timeout_ms = ev->value;
+		snprintf(req.reason, sizeof(req.reason), "trace line %zu",
+			 (size_t)(ev - sim_trace.events) + 1);
+		error = shim_ioctl(fp, FRAMEWORKIOC_INHIBIT, &req);
+		if (0 != error)
+			errx(1, "inhibit failed with error %d", error);
+		sim_files[sim_nfiles++] = fp;
+		shim_vclock_settle();
+		break;
+	case SIM_RELEASE:
+		if (0 == sim_nfiles)
+			errx(1, "release without inhibitor");
+		shim_close(sim_files[--sim_nfiles]);
+		shim_vclock_settle();
+		break;
+	case SIM_END:
+		break;
+	}
+}
+
+/*
+ * Append the records waiting in the module's trace ring to the dump
+ */
+static void
+sim_drain(void)
+{
+	static char buffer[sizeof(struct framework_trace_header_t) +
+			   256 * sizeof(struct framework_trace_record_t)];
+	struct framework_trace_header_t *header = (void *)buffer;
+	size_t len;
+	int error;
+
+	if (NULL == sim_dump)
+		return;
+
+	do {
+		len = sizeof(buffer);
+		error = shim_sysctlbyname("hw.framework.trace.records",
+					  buffer, &len, NULL, 0);
+		if (0 != error)
+			errx(1, "draining trace failed with error %d", error);
+		if ((header->count || header->dropped) &&
+		    1 != fwrite(buffer, len, 1, sim_dump))
+			err(1, "writing trace");
+	} while (256 == header->count);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: sim_dim [-qv] [-d seconds] [-s seed] "
+		"[-l max_latency_ms] [-w max_wakeups] [-b brightness] "
+		"[-n levels] [-f max_fade_writes] [-o dump] [trace]\n");
+	exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct timespec wall_start, wall_end;
+	int64_t duration = 86400, max_latency = -1, max_wakeups = -1;
+	int64_t final_brightness = -1, max_fade_writes = -1;
+	uint32_t nlevels = 0;
+	int64_t target, end_ns;
+	bool verbose = false;
+	int ch, error, failed = 0;
+
+	sim_seed = 1;
+	while ((ch = getopt(argc, argv, "b:d:f:l:n:o:qs:vw:")) != -1) {
+		switch (ch) {
+		case 'b':
+			final_brightness = strtoll(optarg, NULL, 10);
+			break;
+		case 'd':
+			duration = strtoll(optarg, NULL, 10);
+			break;
+		case 'f':
+			max_fade_writes = strtoll(optarg, NULL, 10);
+			break;
+		case 'l':
+			max_latency = strtoll(optarg, NULL, 10);
+			break;
+		case 'n':
+			nlevels = strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			sim_dump = fopen(optarg, "w");
+			if (NULL == sim_dump)
+				err(1, "%s", optarg);
+			break;
+		case 'q':
+			sim.quiet = true;
+			break;
+		case 's':
+			sim_seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'w':
+			max_wakeups = strtoll(optarg, NULL, 10);
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (duration <= 0 || 0 == sim_seed || argc > 1)
+		usage();
+
+	if (1 == argc)
+		sim_readtrace(argv[0]);
+	else
+		sim_gentrace(duration);
+
+	shim_console_set(verbose ? stderr : NULL);
+	shim_vclock_enable();
+
+	sim.charging = true;
+	sim.brightness = -1;
+	shim_acpi_attach(ACPI_BATT_STAT_CHARGING);
+	shim_backlight_attach(50);
+	shim_backlight_setlevels(nlevels);
+	sim_kbd = shim_evdev_create("System keyboard multiplexer", "kbdmux",
+				    BUS_VIRTUAL, 0, 0, 8, SHIM_EV_KEYBOARD);
+	sim_touchpad = shim_evdev_create("PIXA3854:00 093A:0274 TouchPad",
+					 "hmt0", BUS_I2C, 0x093a, 0x0274, 16,
+					 SHIM_EV_TOUCHPAD);
+
+	shim_sdt_sethook(sim_probe);
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+	sim.start_ns = shim_uptime_ns();
+
+	error = shim_kldload("framework");
+	if (0 != error)
+		errx(1, "kldload failed with error %d", error);
+	if (sim_dump && 0 != shim_sysctl_setu32("hw.framework.trace.enable", 1))
+		errx(1, "cannot enable trace recorder");
+	shim_vclock_settle();
+
+	sim_loadmode("power", &sim.power);
+	sim_loadmode("battery", &sim.battery);
+
+	end_ns = sim.start_ns + duration * NS_PER_S;
+	for (size_t i = 0; i < sim_trace.count; i++) {
+		struct sim_event *ev = &sim_trace.events[i];
+
+		target = sim.start_ns + ev->ms * NS_PER_MS;
+		if (SIM_END == ev->kind || target > end_ns) {
+			end_ns = MIN(target, end_ns);
+			break;
+		}
+
+		if (target > shim_uptime_ns())
+			shim_vclock_advance(target - shim_uptime_ns());
+		sim_drain();
+		sim_apply(ev);
+	}
+	if (end_ns > shim_uptime_ns())
+		shim_vclock_advance(end_ns - shim_uptime_ns());
+	sim_drain();
+	if (sim_dump && 0 != fclose(sim_dump))
+		err(1, "closing trace dump");
+
+	shim_sdt_sethook(NULL);
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+	error = shim_kldunload("framework");
+	if (0 != error)
+		errx(1, "kldunload failed with error %d", error);
+	shim_kthread_drain();
+
+	/* unloading released their inhibitors already */
+	while (sim_nfiles)
+		shim_close(sim_files[--sim_nfiles]);
+
+	printf("sim.duration_s %.3f\n", sim_now());
+	printf("sim.trace_events %zu\n", sim_trace.count);
+	printf("sim.inputs %llu\n", (unsigned long long)sim.inputs);
+	printf("sim.callout_wakeups %llu\n", (unsigned long long)sim.wakeups);
+	printf("sim.kthread_wakeups %llu\n",
+	       (unsigned long long)shim_kthread_wakeups());
+	printf("sim.decisions %llu\n", (unsigned long long)sim.decisions);
+	printf("sim.backlight_writes %llu\n", (unsigned long long)sim.writes);
+	printf("sim.fades %llu\n", (unsigned long long)sim.fades);
+	printf("sim.fade_writes %llu\n", (unsigned long long)sim.fade_writes);
+	printf("sim.acpi_queries %llu\n",
+	       (unsigned long long)shim_acpi_queries());
+	printf("sim.dims %llu\n", (unsigned long long)sim.dims);
+	printf("sim.undims %llu\n", (unsigned long long)sim.undims);
+	printf("sim.inhibits %llu\n", (unsigned long long)sim.inhibits);
+	printf("sim.inhibit_expiries %llu\n",
+	       (unsigned long long)sim.inhibit_expiries);
+	printf("sim.inhibited_dims %llu\n",
+	       (unsigned long long)sim.inhibited_dims);
+	printf("sim.brightness %lld\n", (long long)sim.brightness);
+	printf("sim.dim_latency_count %llu\n",
+	       (unsigned long long)sim.latency_count);
+	if (sim.latency_count) {
+		printf("sim.dim_latency_min_ms %.3f\n",
+		       (double)sim.latency_min_ns / NS_PER_MS);
+		printf("sim.dim_latency_avg_ms %.3f\n",
+		       (double)sim.latency_sum_ns / sim.latency_count /
+		       NS_PER_MS);
+		printf("sim.dim_latency_max_ms %.3f\n",
+		       (double)sim.latency_max_ns / NS_PER_MS);
+	}
+	printf("sim.wall_ms %.3f\n",
+	       (wall_end.tv_sec - wall_start.tv_sec) * 1e3 +
+	       (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6);
+
+	if (max_latency >= 0 &&
+	    sim.latency_max_ns > max_latency * NS_PER_MS) {
+		warnx("dim latency above %lld ms", (long long)max_latency);
+		failed = 1;
+	}
+	if (max_wakeups >= 0 && sim.wakeups > (uint64_t)max_wakeups) {
+		warnx("more than %lld callout wakeups",
+		      (long long)max_wakeups);
+		failed = 1;
+	}
+	if (0 != sim.inhibited_dims) {
+		warnx("dimmed %llu times while inhibited",
+		      (unsigned long long)sim.inhibited_dims);
+		failed = 1;
+	}
+	if (max_fade_writes >= 0 &&
+	    sim.fade_writes > (uint64_t)max_fade_writes) {
+		warnx("more than %lld backlight writes in fades",
+		      (long long)max_fade_writes);
+		failed = 1;
+	}
+	if (final_brightness >= 0 && sim.brightness != final_brightness) {
+		warnx("brightness %lld at the end, expected %lld",
+		      (long long)sim.brightness, (long long)final_brightness);
+		failed = 1;
+	}
+	if (0 != shim_malloc_inuse("framework")) {
+		warnx("module leaked %lld bytes",
+		      (long long)shim_malloc_inuse("framework"));
+		failed = 1;
+	}
+
+	free(sim_trace.events);
+
+	return (failed);
+}
@@ -0,0 +1,315 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (c) 2025 Chris Moerz
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Convert framework(4) trace dumps into Chrome/Perfetto trace JSON
+ *
+ * A dump is what reading hw.framework.trace.records returns, or any
+ * concatenation of such reads: a header followed by its records.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "framework_trace.h"
+
+/* trace viewers group events by pid, all records share one */
+#define TRACE_PID 1
+
+struct trace_stats {
+	uint64_t chunks;
+	uint64_t records;
+	uint64_t dropped;
+	uint64_t unknown;
+};
+
+static bool text_output = false;
+static bool first_event = true;
+
+static const char *
+trace_powermode(int32_t mode)
+{
+	/* enum framework_power_type_t */
+	switch (mode) {
+	case 0:
+		return "BAT";
+	case 1:
+		return "PWR";
+	default:
+		return "INVALID";
+	}
+}
+
+/*
+ * Start a JSON event, ts in microseconds as viewers expect
+ */
+static void
+json_begin(FILE *out, const char *name, const char *cat, char ph,
+	   uint64_t ts_ns, uint32_t tid)
+{
+	fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+		"\"ts\":%ju.%03u,\"pid\":%d,\"tid\":%u",
+		first_event ? "" : ",", name, cat, ph,
+		(uintmax_t)(ts_ns / 1000), (unsigned)(ts_ns % 1000),
+		TRACE_PID, tid);
+	first_event = false;
+}
+
+static void
+json_dur(FILE *out, uint64_t dur_ns)
+{
+	fprintf(out, ",\"dur\":%ju.%03u", (uintmax_t)(dur_ns / 1000),
+		(unsigned)(dur_ns % 1000));
+}
+
+static void
+json_record(FILE *out, const struct framework_trace_record_t *rec,
+	    struct trace_stats *stats)
+{
+	switch (rec->type) {
+	case FRAMEWORK_TRACE_INPUT:
+		json_begin(out, "input", "evdev", 'i', rec->ts_ns, rec->tid);
+		fprintf(out, ",\"s\":\"t\",\"args\":{\"keycode\":%d,"
+			"\"keys\":%d}}", rec->arg0, rec->arg1);
+		break;
+	case FRAMEWORK_TRACE_LEVEL:
+		/* idle stages, 0 while in use */
+		json_begin(out, rec->arg1 > rec->arg0 ? "dim" : "undim",
+			   "callout", 'i', rec->ts_ns, rec->tid);
+		fprintf(out, ",\"s\":\"p\",\"args\":{\"from\":%d,"
+			"\"to\":%d}}", rec->arg0, rec->arg1);
+		json_begin(out, "stage", "callout", 'C', rec->ts_ns, rec->tid);
+		fprintf(out, ",\"args\":{\"stage\":%d}}", rec->arg1);
+		break;
+	case FRAMEWORK_TRACE_POWERMODE:
+		json_begin(out, "getpowermode", "power", 'X', rec->ts_ns,
+			   rec->tid);
+		json_dur(out, rec->dur_ns);
+		fprintf(out, ",\"args\":{\"mode\":\"%s\"}}",
+			trace_powermode(rec->arg0));
+		break;
+	case FRAMEWORK_TRACE_BACKLIGHT:
+		json_begin(out, "setbrightness", "backlight", 'X', rec->ts_ns,
+			   rec->tid);
+		json_dur(out, rec->dur_ns);
+		fprintf(out, ",\"args\":{\"brightness\":%d,\"error\":%d}}",
+			rec->arg0, rec->arg1);
+		json_begin(out, "brightness", "backlight", 'C',
+			   rec->ts_ns + rec->dur_ns, rec->tid);
+		fprintf(out, ",\"args\":{\"brightness\":%d}}", rec->arg0);
+		break;
+	default:
+		stats->unknown++;
+		break;
+	}
+}
+
+static void
+text_record(FILE *out, const struct framework_trace_record_t *rec,
+	    struct trace_stats *stats)
+{
+	fprintf(out, "%10u %6ju.%09u %6u ", rec->seq,
+		(uintmax_t)(rec->ts_ns / 1000000000),
+		(unsigned)(rec->ts_ns % 1000000000), rec->tid);
+
+	switch (rec->type) {
+	case FRAMEWORK_TRACE_INPUT:
+		fprintf(out, "input keycode=%d keys=%d\n", rec->arg0,
+			rec->arg1);
+		break;
+	case FRAMEWORK_TRACE_LEVEL:
+		fprintf(out, "stage %d -> %d\n", rec->arg0, rec->arg1);
+		break;
+	case FRAMEWORK_TRACE_POWERMODE:
+		fprintf(out, "getpowermode mode=%s dur=%juns\n",
+			trace_powermode(rec->arg0), (uintmax_t)rec->dur_ns);
+		break;
+	case FRAMEWORK_TRACE_BACKLIGHT:
+		fprintf(out, "setbrightness brightness=%d error=%d "
+			"dur=%juns\n", rec->arg0, rec->arg1,
+			(uintmax_t)rec->dur_ns);
+		break;
+	default:
+		fprintf(out, "unknown type=%u\n", rec->type);
+		stats->unknown++;
+		break;
+	}
+}
+
+/*
+ * Note records lost to ring overwrites before the chunk
+ */
+static void
+trace_dropped(FILE *out, uint32_t dropped, uint64_t ts_ns)
+{
+	if (text_output) {
+		fprintf(out, "# %u records dropped\n", dropped);
+		return;
+	}
+
+	json_begin(out, "dropped", "trace", 'i', ts_ns, 0);
+	fprintf(out, ",\"s\":\"g\",\"args\":{\"records\":%u}}", dropped);
+}
+
+/*
+ * Read one dump, returns 0 on success
+ */
+static int
+trace_convert(FILE *in, const char *name, FILE *out,
+	      struct trace_stats *stats)
+{
+	struct framework_trace_header_t header;
+	struct framework_trace_record_t rec;
+	uint64_t last_ts = 0;
+	size_t n;
+
+	while (1 == (n = fread(&header, sizeof(header), 1, in))) {
+		if (FRAMEWORK_TRACE_MAGIC != header.magic) {
+			warnx("%s: bad magic 0x%08x at chunk %ju", name,
+			      header.magic, (uintmax_t)stats->chunks);
+			return (-1);
+		}
+		if (FRAMEWORK_TRACE_VERSION != header.version ||
+		    header.record_size < sizeof(rec)) {
+			warnx("%s: unsupported version %u, record size %u",
+			      name, header.version, header.record_size);
+			return (-1);
+		}
+		stats->chunks++;
+
+		if (header.dropped) {
+			stats->dropped += header.dropped;
+			trace_dropped(out, header.dropped, last_ts);
+		}
+
+		for (uint32_t i = 0; i < header.count; i++) {
+			if (1 != fread(&rec, sizeof(rec), 1, in)) {
+				warnx("%s: truncated after %ju records", name,
+				      (uintmax_t)stats->records);
+				return (-1);
+			}
+			/* newer kernels may append fields, skip them */
+			for (size_t skip = header.record_size - sizeof(rec);
+			     skip > 0; skip--) {
+				if (EOF == fgetc(in)) {
+					warnx("%s: truncated record", name);
+					return (-1);
+				}
+			}
+
+			stats->records++;
+			last_ts = rec.ts_ns;
+			if (text_output)
+				text_record(out, &rec, stats);
+			else
+				json_record(out, &rec, stats);
+		}
+	}
+
+	if (ferror(in)) {
+		warn("%s", name);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: framework-trace [-t] [-o output] "
+		"[dump ...]\n");
+	exit(EX_USAGE);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct trace_stats stats = {0};
+	FILE *out = stdout;
+	FILE *in = NULL;
+	int ch, error = 0;
+
+	while ((ch = getopt(argc, argv, "o:t")) != -1) {
+		switch (ch) {
+		case 'o':
+			out = fopen(optarg, "w");
+			if (NULL == out)
+				err(EX_CANTCREAT, "%s", optarg);
+			break;
+		case 't':
+			text_output = true;
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (!text_output)
+		fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+	if (0 == argc) {
+		error = trace_convert(stdin, "stdin", out, &stats);
+	} else {
+		for (int i = 0; i < argc && 0 == error; i++) {
+			in = strcmp(argv[i], "-") ? fopen(argv[i], "r") : stdin;
+			if (NULL == in)
+				err(EX_NOINPUT, "%s", argv[i]);
+			error = trace_convert(in, argv[i], out, &stats);
+			if (stdin != in)
+				fclose(in);
+		}
+	}
+
+	if (!text_output) {
+		json_begin(out, "process_name", "__metadata", 'M', 0, 0);
+		fprintf(out, ",\"args\":{\"name\":\"framework\"}}");
+		fprintf(out, "\n]}\n");
+	}
+
+	if (stdout != out && 0 != fclose(out))
+		err(EX_IOERR, "close");
+
+	fprintf(stderr, "%ju chunks, %ju records, %ju dropped, "
+		"%ju unknown\n", (uintmax_t)stats.chunks,
+		(uintmax_t)stats.records, (uintmax_t)stats.dropped,
+		(uintmax_t)stats.unknown);
+
+	return (error ? EX_DATAERR : 0);
+}